@@ -0,0 +1,264 @@
+// File: AnytimeDispatch.cpp
+//
+// Contains the deadline bounded dispatch of the PowerGrid class.  See
+// AnytimeDispatch.h for a description of the moves and the quality gap.
+//
+#include "PowerGrid.h"
+#include <chrono>
+#include <numeric>
+#include <algorithm>
+using namespace std;
+
+//
+// unitCost():  Cost of delivering one MW through an allocation's plant and line
+//
+static double unitCost(const Plant* plant, const TransLine& line) {
+    return plant->getCostPerMW() / line.getEfficiency();
+}
+
+
+//
+// anytimeDispatch():  Makes the greedy dispatch, then moves power to
+//      cheaper plant and line pairs until no move helps or budgetMs after
+//      the greedy dispatch ends.
+//
+// Each pass visits the allocations most expensive first and tries two
+// moves for each: the cheapest plant with room over the same line, which
+// needs no line room, and the cheapest plant with room over the most
+// efficient line with room.  An allocation neither move improves is
+// skipped.  Passes repeat until one makes no move, and only then has the
+// search converged.  Within a pass the plants and lines before the first
+// with room are not looked at again; a move can give room back to one of
+// them, which the next pass finds.
+//
+AnytimeResult PowerGrid::anytimeDispatch(double budgetMs) {
+    AnytimeResult result;
+    auto start = chrono::steady_clock::now();
+    auto elapsedMs = [&]() { return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); };
+
+    auto totalCost = [this]() {
+        double cost = 0;
+        for (auto& demand : demands)
+            cost += demand.getTotalPowerCost();
+        return cost;
+    };
+
+    redispatch();
+    result.greedyMs = elapsedMs();
+    result.greedyCost = totalCost();
+    auto deadline = chrono::steady_clock::now() +
+        chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double, milli>(budgetMs));
+
+    // Room left on a plant or line, in the units of the dispatch mode
+    auto plantHasRoom = [this](const Plant* plant, const TransLine& line) {
+        return fixedPoint ? plant->getAvailTicks() * line.getEfficiencyPPM() / EFFICIENCY_SCALE > 0
+                          : plant->getAvailCapacity() > 0.001;
+    };
+    auto plantHasAnyRoom = [this](const Plant* plant) {
+        return fixedPoint ? plant->getAvailTicks() > 0 : plant->getAvailCapacity() > 0.001;
+    };
+    auto lineHasRoom = [this](const TransLine& line) {
+        return fixedPoint ? line.getAvailTicks() > 0 : line.getAvailCapacity() > 0.001;
+    };
+    auto hasPower = [this](const Allocation& entry) {
+        return fixedPoint ? entry.suppliedTicks > 0 : entry.supplied > 0.001;
+    };
+
+    const PlantView& byCost = plantViews.getView(DP_COST);
+    const OrderIndex& byEfficiency = getLineOrder(LK_EFFICIENCY);
+    PlantView::const_iterator firstPlant;
+    size_t firstLine = 0;
+
+    // Cheapest plant with room over the line, or nullptr
+    auto cheapestPlant = [&](uint32_t line) -> Plant* {
+        while (firstPlant != byCost.end() && !plantHasAnyRoom(*firstPlant))
+            ++firstPlant;
+        for (auto it = firstPlant; it != byCost.end(); ++it) {
+            if (plantHasRoom(*it, transLines[line]))
+                return *it;
+        }
+        return nullptr;
+    };
+    // Most efficient line with room, or UINT32_MAX
+    auto bestLine = [&]() -> uint32_t {
+        while (firstLine < byEfficiency.size() && !lineHasRoom(transLines[byEfficiency[firstLine]]))
+            firstLine++;
+        return (firstLine < byEfficiency.size()) ? byEfficiency[firstLine] : UINT32_MAX;
+    };
+
+    vector<uint32_t> order;
+    bool improved = true, outOfTime = false;
+    long tries = 0;
+    while (improved && !outOfTime) {
+        improved = false;
+        firstPlant = byCost.begin();
+        firstLine = 0;
+
+        order.clear();
+        for (uint32_t i = 0; i < ledger.size(); i++) {
+            if (hasPower(ledger[i]))
+                order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return unitCost(ledger[a].plant, transLines[ledger[a].line]) > unitCost(ledger[b].plant, transLines[ledger[b].line]);
+        });
+
+        for (size_t k = 0; k < order.size() && !outOfTime; k++) {
+            uint32_t i = order[k];
+
+            while (hasPower(ledger[i])) {
+                if ((tries++ & 15) == 0 && chrono::steady_clock::now() >= deadline) {
+                    outOfTime = true;
+                    break;
+                }
+
+                // A cheaper plant over the same line, then over a better line
+                const Allocation& entry = ledger[i];
+                double current = unitCost(entry.plant, transLines[entry.line]);
+                uint32_t to = entry.line;
+                Plant* best = cheapestPlant(to);
+                double bestCost = best ? unitCost(best, transLines[to]) : current;
+
+                uint32_t line = bestLine();
+                if (line != UINT32_MAX && line != entry.line) {
+                    Plant* plant = cheapestPlant(line);
+                    if (plant && unitCost(plant, transLines[line]) < bestCost) {
+                        best = plant;
+                        to = line;
+                        bestCost = unitCost(plant, transLines[line]);
+                    }
+                }
+
+                if (!best || bestCost >= current * (1 - 1e-9))
+                    break;
+
+                moveAllocation(i, best, to);
+                result.moves++;
+                improved = true;
+            }
+        }
+    }
+    result.converged = !outOfTime;
+
+    // Moves to more efficient lines free plant capacity, which may cover
+    // locations that were left short
+    if (chrono::steady_clock::now() < deadline)
+        allocateDeficits();
+
+    result.finalCost = totalCost();
+    result.lowerBound = dispatchCostLowerBound();
+    result.gap = (result.finalCost > 0) ? max(0.0, (result.finalCost - result.lowerBound) / result.finalCost) : 0;
+    result.elapsedMs = elapsedMs();
+
+    publishDispatch();
+    return result;
+}
+
+
+//
+// moveAllocation():  Moves as much of a ledger entry's power as fits to
+//      plant over line to.  The location keeps the same power and price;
+//      only its cost changes.  Over the entry's own line the power it
+//      releases is the room it needs.
+//
+void PowerGrid::moveAllocation(uint32_t entryIndex, Plant* plant, uint32_t to) {
+    Allocation& entry = ledger[entryIndex];
+    Demand& demand = demands[entry.demand];
+    TransLine& fromLine = transLines[entry.line];
+    TransLine& toLine = transLines[to];
+    Allocation moved = entry;
+
+    if (fixedPoint) {
+        int64_t efficiency = toLine.getEfficiencyPPM();
+        PowerTicks lineRoom = (to == entry.line) ? entry.suppliedTicks : toLine.getAvailTicks();
+        PowerTicks amount = min(entry.suppliedTicks, min(lineRoom, plant->getAvailTicks() * efficiency / EFFICIENCY_SCALE));
+
+        // The part moved off the old plant, in proportion, rounded down
+        PowerTicks rawOld = entry.rawTicks * amount / entry.suppliedTicks;
+        MoneyTicks costOld = entry.costTicks * amount / entry.suppliedTicks;
+        MoneyTicks sellPrice = entry.sellTicks * amount / entry.suppliedTicks;
+        if (amount == entry.suppliedTicks) {
+            rawOld = entry.rawTicks;
+            costOld = entry.costTicks;
+            sellPrice = entry.sellTicks;
+        }
+
+        PowerTicks rawNew = (amount * EFFICIENCY_SCALE + efficiency - 1) / efficiency;
+        MoneyTicks costNew = priceOfPower(rawNew, plant->getCostTicks());
+
+        entry.plant->releaseCapacityTicks(rawOld);
+        fromLine.releaseLineTicks(amount);
+        plant->reduceCapacityTicks(rawNew);
+        toLine.allocateLineTicks(amount);
+        demand.addPowerTicks(0, 0, costNew - costOld);
+
+        entry.suppliedTicks -= amount;
+        entry.rawTicks -= rawOld;
+        entry.costTicks -= costOld;
+        entry.sellTicks -= sellPrice;
+        entry.supplied = toMW(entry.suppliedTicks);
+        entry.rawFromPlant = toMW(entry.rawTicks);
+        entry.cost = toDollars(entry.costTicks);
+        entry.sellPrice = toDollars(entry.sellTicks);
+
+        moved = { plant, entry.demand, to, toMW(amount), toMW(rawNew), toDollars(sellPrice), toDollars(costNew),
+                  amount, rawNew, sellPrice, costNew };
+    }
+    else {
+        double efficiency = toLine.getEfficiency();
+        double lineRoom = (to == entry.line) ? entry.supplied : toLine.getAvailCapacity();
+        double amount = min(entry.supplied, min(lineRoom, plant->getAvailCapacity() * efficiency));
+        double share = amount / entry.supplied;
+
+        double rawOld = entry.rawFromPlant * share;
+        double costOld = entry.cost * share;
+        double sellPrice = entry.sellPrice * share;
+        double rawNew = amount / efficiency;
+        double costNew = rawNew * plant->getCostPerMW();
+
+        entry.plant->releaseCapacity(rawOld);
+        fromLine.releaseLineCapacity(amount);
+        plant->reduceCapacity(rawNew);
+        toLine.allocateLineCapacity(amount);
+        demand.addPowerToLocation(0, 0, costNew - costOld);
+
+        entry.supplied -= amount;
+        entry.rawFromPlant -= rawOld;
+        entry.cost -= costOld;
+        entry.sellPrice -= sellPrice;
+
+        moved = { plant, entry.demand, to, amount, rawNew, sellPrice, costNew, 0, 0, 0, 0 };
+    }
+
+    ledger.push_back(moved);
+}
+
+
+//
+// dispatchCostLowerBound():  Cost of drawing the delivered power from the
+//      cheapest plants as if it all went over the most efficient line
+//
+double PowerGrid::dispatchCostLowerBound() const {
+    double delivered = 0;
+    for (auto& demand : demands)
+        delivered += demand.getPowerAcquired();
+
+    double bestEfficiency = 0;
+    for (auto& line : transLines) {
+        if (line.getUsableCapacity() > 0)
+            bestEfficiency = max(bestEfficiency, line.getEfficiency());
+    }
+    if (delivered <= 0 || bestEfficiency <= 0)
+        return 0;
+
+    double needed = delivered / bestEfficiency;
+    double bound = 0;
+    for (auto plant : plantViews.getView(DP_COST)) {
+        double take = min(needed, plant->getCurCapacity());
+        bound += take * plant->getCostPerMW();
+        needed -= take;
+        if (needed <= 0)
+            break;
+    }
+    return bound;
+}
@@ -0,0 +1,30 @@
+#pragma once
+// File: AnytimeDispatch.h
+//
+// Contains the result of a deadline bounded (anytime) dispatch.
+//
+// An anytime dispatch first makes the normal greedy dispatch, which is
+// feasible, then keeps lowering its cost until the deadline, which counts
+// from the end of the greedy dispatch.  Each improvement moves power that
+// a location already receives from an expensive plant or lossy line to a
+// cheaper plant over the same line, which needs no line room, or to the
+// cheapest plant and most efficient line that still have room.  The
+// locations get the same power and pay the same price, and the grid stays
+// feasible after every move.
+//
+// The quality gap compares the cost reached with a lower bound: the cost
+// of drawing the power delivered from the cheapest plants over the most
+// efficient line, ignoring line limits.
+//
+using namespace std;
+
+struct AnytimeResult {
+    double  greedyCost = 0;     // Cost of the greedy dispatch
+    double  finalCost = 0;      // Cost of the best dispatch found
+    double  lowerBound = 0;     // No dispatch of the same power costs less
+    double  gap = 0;            // (finalCost - lowerBound) / finalCost
+    double  greedyMs = 0;       // Time to the first feasible dispatch
+    double  elapsedMs = 0;      // Total time used, the greedy dispatch included
+    long    moves = 0;          // Improving moves made
+    bool    converged = false;  // No improving move was left before the deadline
+};
@@ -0,0 +1,201 @@
+// File: CarbonDispatch.cpp
+//
+// Contains the carbon capped dispatch of the PowerGrid class.  See
+// CarbonDispatch.h for how the carbon price is searched for.
+//
+#include "PowerGrid.h"
+#include <algorithm>
+using namespace std;
+
+//
+// dispatchAtCarbonPrice():  Dispatches from scratch with plants ordered by
+//      cost plus carbon price times emission rate.  With an emission
+//      budget (0 or more), fossil plants in that order may only give what
+//      the budget still covers.  Returns the emissions of the dispatch.
+//
+double PowerGrid::dispatchAtCarbonPrice(double carbonPrice, double emissionBudget) {
+    resetDispatch();
+    ledger.clear();
+
+    vector<Plant*> order = getPlantList();
+    stable_sort(order.begin(), order.end(), [carbonPrice](const Plant* a, const Plant* b) {
+        return a->getCostPerMW() + carbonPrice * a->getEmissionRate() < b->getCostPerMW() + carbonPrice * b->getEmissionRate();
+    });
+
+    // Hold back fossil capacity beyond the budget for the length of the dispatch
+    vector<pair<Plant*, double>> heldBack;
+    if (emissionBudget >= 0) {
+        for (auto plant : order) {
+            double rate = plant->getEmissionRate();
+            if (rate <= 0)
+                continue;
+
+            double allowed = min(plant->getAvailCapacity(), emissionBudget / rate);
+            double hold = plant->getAvailCapacity() - allowed;
+            emissionBudget -= allowed * rate;
+            if (hold > 0) {
+                plant->reduceCapacity(hold);
+                heldBack.push_back({ plant, hold });
+            }
+        }
+    }
+
+    auto firstWithRoom = order.cbegin();
+    forEachDemandInOrder([&](Demand& demand) {
+        if (fixedPoint ? demand.getDeficitTicks() > 0 : demand.getPowerDeficit() > 0) {
+            if (fixedPoint)
+                allocateFromPlantsFixed(demand, order, firstWithRoom);
+            else
+                allocateFromPlants(demand, order, firstWithRoom);
+        }
+    });
+
+    for (auto& held : heldBack)
+        held.first->releaseCapacity(held.second);
+    return dispatchEmissions();
+}
+
+
+//
+// MeritEntry:  What the price estimate needs to know about a plant
+//
+struct MeritEntry {
+    double  cost;
+    double  rate;
+    double  capacity;
+};
+
+
+//
+// estimateCarbonPrice():  Lowest carbon price at which drawing rawDrawn MW
+//      from the plants in priced order emits no more than target.  This
+//      models the dispatch as one merit order with no line limits, so it
+//      costs a sort per step instead of a dispatch pass.
+//
+static double estimateCarbonPrice(vector<MeritEntry>& merit, double rawDrawn, double target, double maxPrice) {
+    auto emissionsAt = [&](double price) {
+        sort(merit.begin(), merit.end(), [price](const MeritEntry& a, const MeritEntry& b) {
+            return a.cost + price * a.rate < b.cost + price * b.rate;
+        });
+
+        double needed = rawDrawn, emissions = 0;
+        for (auto& plant : merit) {
+            double take = min(needed, plant.capacity);
+            emissions += take * plant.rate;
+            needed -= take;
+            if (needed <= 0)
+                break;
+        }
+        return emissions;
+    };
+
+    double lo = 0, hi = maxPrice;
+    if (emissionsAt(0) <= target)
+        return 0;
+    for (int i = 0; i < 40; i++) {
+        double mid = (lo + hi) / 2;
+        if (emissionsAt(mid) <= target)
+            hi = mid;
+        else
+            lo = mid;
+    }
+    return hi;
+}
+
+
+//
+// distributeUnderCarbonCap():  Dispatches at a carbon price whose
+//      emissions are within cap, as close under it as the search gets
+//
+// Each pass estimates the price from the merit order, dispatches at it,
+// and scales the estimate's target by how far the real emissions missed
+// the cap.  A pass that lands within CARBON_CAP_TOLERANCE under the cap
+// ends the search.
+//
+CarbonResult PowerGrid::distributeUnderCarbonCap(double cap) {
+    CarbonResult result;
+    result.cap = cap = max(cap, 0.0);
+
+    double emissions = dispatchAtCarbonPrice(0, -1);
+    result.passes = 1;
+
+    if (emissions > cap) {
+        vector<MeritEntry> merit;
+        double minCost = 0, maxCost = 0, minRate = 0;
+        for (auto plant : plants) {
+            double rate = plant->getEmissionRate();
+            if (merit.empty())
+                minCost = maxCost = plant->getCostPerMW();
+            minCost = min(minCost, plant->getCostPerMW());
+            maxCost = max(maxCost, plant->getCostPerMW());
+            if (rate > 0)
+                minRate = (minRate > 0) ? min(minRate, rate) : rate;
+            merit.push_back({ plant->getCostPerMW(), rate, plant->getCurCapacity() });
+        }
+
+        // A price that puts every emitting plant after every clean one
+        double maxPrice = 2 * (maxCost - minCost) / minRate + 1e-12;
+
+        // The search leaves two passes for the end: the fallback dispatch
+        // at the highest price and the clamped one after it
+        double target = cap, bestPrice = -1, bestEmissions = -1, price = 0;
+        while (result.passes < CARBON_MAX_PASSES - 2) {
+            double rawDrawn = 0;
+            for (auto& entry : ledger)
+                rawDrawn += entry.rawFromPlant;
+
+            // When the estimate needs the highest price, go straight to it
+            price = estimateCarbonPrice(merit, rawDrawn, target, maxPrice);
+            if (price >= maxPrice)
+                break;
+            emissions = dispatchAtCarbonPrice(price, -1);
+            result.passes++;
+
+            if (emissions <= cap && emissions > bestEmissions) {
+                bestPrice = price;
+                bestEmissions = emissions;
+            }
+            if (emissions == 0 || (emissions <= cap && emissions >= cap * (1 - CARBON_CAP_TOLERANCE)))
+                break;
+            target *= cap / emissions;
+        }
+
+        if (bestPrice < 0) {
+            // No price found; order every emitting plant last, and hold back
+            // fossil output if that is still over the cap
+            bestPrice = maxPrice;
+            emissions = dispatchAtCarbonPrice(maxPrice, -1);
+            result.passes++;
+            if (emissions > cap) {
+                dispatchAtCarbonPrice(maxPrice, cap);
+                result.passes++;
+                result.clamped = true;
+            }
+        }
+        else if (price != bestPrice) {
+            dispatchAtCarbonPrice(bestPrice, -1);
+            result.passes++;
+        }
+        result.carbonPrice = bestPrice;
+    }
+
+    result.emissions = dispatchEmissions();
+    for (auto& demand : demands) {
+        result.cost += demand.getTotalPowerCost();
+        result.acquired += demand.getPowerAcquired();
+    }
+
+    publishDispatch();
+    return result;
+}
+
+
+//
+// dispatchEmissions():  CO2 emitted for the power drawn by the last dispatch
+//
+double PowerGrid::dispatchEmissions() const {
+    double emissions = 0;
+    for (auto& entry : ledger)
+        emissions += entry.rawFromPlant * entry.plant->getEmissionRate();
+    return emissions;
+}
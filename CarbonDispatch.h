@@ -0,0 +1,34 @@
+#pragma once
+// File: CarbonDispatch.h
+//
+// Contains the result of a dispatch under a system wide CO2 cap.
+//
+// Each plant emits CO2 in proportion to the power drawn from it (only
+// fossil plants have a nonzero rate).  The cap is met by pricing carbon:
+// plants are dispatched in order of cost + carbonPrice * emissionRate,
+// and the carbon price is searched for (a Lagrangian multiplier) until
+// the emissions of the dispatch sit just under the cap.  Each pass
+// estimates the price from the plants' merit order, as the lowest price
+// whose merit order dispatch of the power last drawn emits no more than a
+// target, then dispatches at it.  The target starts at the cap and is
+// scaled by cap / emissions after each pass, to correct the estimate by
+// how far the real dispatch missed.  The search ends at a pass within
+// CARBON_CAP_TOLERANCE under the cap, and the best pass under the cap is
+// kept.  Each pass is one run of the normal allocation loop, and with
+// the fallback below there are at most CARBON_MAX_PASSES of them.
+//
+// If even the highest useful price, which puts every fossil plant after
+// every clean one, leaves emissions over the cap, fossil output is held
+// back to what the cap allows and some locations may go short.
+//
+using namespace std;
+
+struct CarbonResult {
+    double  cap = 0;
+    double  carbonPrice = 0;    // $ per unit of CO2 added to each plant's cost when ordering
+    double  emissions = 0;      // CO2 of the final dispatch
+    double  cost = 0;           // What the power cost, without the carbon price
+    double  acquired = 0;       // MW delivered
+    int     passes = 0;         // Dispatch passes made by the search
+    bool    clamped = false;    // Fossil output was held back to meet the cap
+};
@@ -0,0 +1,455 @@
+// File: ConditionSeries.cpp
+//
+// Contains the function definitions for writing and streaming plant
+// condition time series.  See ConditionSeries.h for the file layout.
+//
+#include "ConditionSeries.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+using namespace std;
+
+const char SERIES_MAGIC[8] = { 'P', 'G', 'C', 'O', 'N', 'D', '1', 0 };
+
+static_assert(sizeof(SeriesHeader) == 64, "SeriesHeader must be 64 bytes");
+static_assert(sizeof(SeriesColumn) == 32, "SeriesColumn must be 32 bytes");
+
+//
+// roundToPage():  Rounds a size up to a whole number of pages
+//
+static uint64_t roundToPage(uint64_t size) {
+    uint64_t page = uint64_t(sysconf(_SC_PAGESIZE));
+    return max<uint64_t>(page, (size + page - 1) / page * page);
+}
+
+
+
+//********************************************************
+//*****              Writing a Series                *****
+//********************************************************
+
+//
+// writeConditionSeries():  Transposes each window of steps into columns
+//                          and writes it at its page aligned offset
+//
+int writeConditionSeries(const string& filename, const vector<SeriesColumn>& columns,
+                         uint64_t stepCount, double stepHours,
+                         const function<void(uint64_t, float*)>& fillStep) {
+    SeriesHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SERIES_MAGIC, sizeof(header.magic));
+    header.columnCount = uint32_t(columns.size());
+    header.windowSteps = CONDITION_WINDOW_STEPS;
+    header.stepCount = stepCount;
+    header.windowBytes = roundToPage(uint64_t(columns.size()) * header.windowSteps * sizeof(float));
+    header.dataOffset = roundToPage(sizeof(SeriesHeader) + columns.size() * sizeof(SeriesColumn));
+    header.stepHours = stepHours;
+
+    ofstream osSeries(filename, ios::binary | ios::trunc);
+    if (!osSeries) {
+        cerr << "Error: Unable to write file " << filename << endl;
+        return 1;
+    }
+
+    osSeries.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    osSeries.write(reinterpret_cast<const char*>(columns.data()), columns.size() * sizeof(SeriesColumn));
+    osSeries.seekp(header.dataOffset);
+
+    vector<float> window(header.windowBytes / sizeof(float), 0.0f);
+    vector<float> row(columns.size());
+
+    for (uint64_t step = 0; step < stepCount; step++) {
+        uint64_t offset = step % header.windowSteps;
+        fillStep(step, row.data());
+        for (size_t c = 0; c < columns.size(); c++)
+            window[c * header.windowSteps + offset] = row[c];
+
+        // Write each full window, and the last one padded to full size
+        if (offset == header.windowSteps - 1 || step == stepCount - 1) {
+            osSeries.write(reinterpret_cast<const char*>(window.data()), header.windowBytes);
+            fill(window.begin(), window.end(), 0.0f);
+        }
+    }
+
+    if (!osSeries) {
+        cerr << "Error: Unable to write file " << filename << endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+//
+// writeSyntheticConditions():  Varies each condition around the plant's
+//      current value with a yearly cycle and random noise
+//
+int writeSyntheticConditions(PowerGrid& grid, const string& filename, uint64_t stepCount) {
+    vector<SeriesColumn> columns;
+    vector<double> base;
+    vector<double> limit;       // Largest valid value, 0 = none
+
+    for (Plant* plant : grid.getPlantList()) {
+        int count = plant->getConditionCount();
+        if (count == 0)
+            continue;
+        if (plant->getName().size() >= sizeof(SeriesColumn::plantName)) {
+            cerr << "Error: Plant name too long for a series: " << plant->getName() << endl;
+            continue;
+        }
+
+        double values[MAX_CONDITION_PARAMS];
+        plant->getConditions(values);
+        for (int p = 0; p < count; p++) {
+            SeriesColumn column;
+            memset(&column, 0, sizeof(column));
+            strncpy(column.plantName, plant->getName().c_str(), sizeof(column.plantName) - 1);
+            column.param = uint32_t(p);
+            columns.push_back(column);
+            base.push_back(values[p]);
+            limit.push_back((plant->getType() == PT_DILITHIUM && p == 0) ? 100 : 0);
+        }
+    }
+
+    mt19937 rng(1);
+    normal_distribution<double> noise(0.0, 0.1);
+    const double HOURS_PER_YEAR = 8760;
+
+    return writeConditionSeries(filename, columns, stepCount, 1.0, [&](uint64_t step, float* values) {
+        for (size_t c = 0; c < columns.size(); c++) {
+            double season = sin(2 * M_PI * (step / HOURS_PER_YEAR + c / 7.0));
+            double value = max(0.0, base[c] * (1 + 0.25 * season + noise(rng)));
+            if (limit[c] > 0)
+                value = min(value, limit[c]);
+            values[c] = float(value);
+        }
+    });
+}
+
+
+
+//********************************************************
+//*****            Streaming a Series                *****
+//********************************************************
+
+//
+//  Constructors and Destructors
+//
+ConditionSeries::ConditionSeries() {
+    memset(&header, 0, sizeof(header));
+}
+
+ConditionSeries::~ConditionSeries() {
+    close();
+}
+
+
+//
+// Accessors
+//
+uint64_t ConditionSeries::getStepCount() const { return header.stepCount; }
+double ConditionSeries::getStepHours() const { return header.stepHours; }
+size_t ConditionSeries::getColumnCount() const { return columns.size(); }
+size_t ConditionSeries::getWindowBytes() const { return size_t(header.windowBytes); }
+uint64_t ConditionSeries::getWindowsMapped() const { return windowsMapped; }
+uint64_t ConditionSeries::getPrefetchHits() const { return prefetchHits; }
+
+
+//
+// open():  Reads and checks the header and columns, then starts the
+//          prefetch thread
+//
+int ConditionSeries::open(const string& filename) {
+    close();
+
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return 1;
+    }
+
+    struct stat info;
+    bool valid = fstat(fd, &info) == 0 &&
+        pread(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header)) &&
+        memcmp(header.magic, SERIES_MAGIC, sizeof(SERIES_MAGIC)) == 0 &&
+        header.windowSteps > 0 &&
+        header.windowBytes >= uint64_t(header.columnCount) * header.windowSteps * sizeof(float);
+
+    if (valid) {
+        windowCount = (header.stepCount + header.windowSteps - 1) / header.windowSteps;
+        columns.resize(header.columnCount);
+        size_t columnBytes = columns.size() * sizeof(SeriesColumn);
+        valid = uint64_t(info.st_size) >= header.dataOffset + windowCount * header.windowBytes &&
+            pread(fd, columns.data(), columnBytes, sizeof(header)) == ssize_t(columnBytes);
+    }
+
+    if (!valid) {
+        cerr << "Error: Not a condition series file " << filename << endl;
+        close();
+        return 1;
+    }
+
+    stopping = false;
+    prefetcher = thread(&ConditionSeries::prefetchLoop, this);
+    return 0;
+}
+
+
+//
+// close():  Stops the prefetch thread and releases the file
+//
+void ConditionSeries::close() {
+    if (prefetcher.joinable()) {
+        {
+            lock_guard<mutex> guard(prefetchLock);
+            stopping = true;
+        }
+        prefetchReady.notify_all();
+        prefetcher.join();
+    }
+
+    unmapWindow(current);
+    unmapWindow(prefetched);
+    requested = UINT64_MAX;
+
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+    columns.clear();
+    boundPlants.clear();
+    firstColumn.clear();
+    windowCount = 0;
+}
+
+
+//
+// bind():  Finds the plant for each group of columns.  Columns for plants
+//          that are missing or have a different parameter count are skipped.
+//
+int ConditionSeries::bind(PowerGrid& grid) {
+    int rc = 0;
+    boundPlants.clear();
+    firstColumn.clear();
+
+    size_t c = 0;
+    while (c < columns.size()) {
+        string name(columns[c].plantName, strnlen(columns[c].plantName, sizeof(columns[c].plantName)));
+
+        size_t count = 0;
+        while (c + count < columns.size() && name == columns[c + count].plantName &&
+               columns[c + count].param == count)
+            count++;
+
+        Plant* plant = grid.findPlant(name);
+        if (!plant || size_t(plant->getConditionCount()) != count) {
+            cerr << "Error: Series columns do not match plant " << name << endl;
+            rc = 1;
+        }
+        else {
+            boundPlants.push_back(plant);
+            firstColumn.push_back(uint32_t(c));
+        }
+        c += max<size_t>(count, 1);
+    }
+    return rc;
+}
+
+
+//
+// mapWindow():  Maps one window and asks the kernel to read it in
+//
+const float* ConditionSeries::mapWindow(uint64_t index) const {
+    void* data = mmap(nullptr, header.windowBytes, PROT_READ, MAP_SHARED, fd,
+                      off_t(header.dataOffset + index * header.windowBytes));
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    madvise(data, header.windowBytes, MADV_WILLNEED);
+    return static_cast<const float*>(data);
+}
+
+void ConditionSeries::unmapWindow(Window& window) {
+    if (window.data)
+        munmap(const_cast<float*>(window.data), header.windowBytes);
+    window = Window();
+}
+
+
+//
+// prefetchLoop():  Maps the requested window and touches every page, so the
+//                  window is resident before applyStep() reaches it
+//
+void ConditionSeries::prefetchLoop() {
+    unique_lock<mutex> guard(prefetchLock);
+    long pageFloats = sysconf(_SC_PAGESIZE) / long(sizeof(float));
+
+    while (true) {
+        prefetchReady.wait(guard, [this]() {
+            return stopping || (requested != UINT64_MAX && prefetched.index != requested);
+        });
+        if (stopping)
+            return;
+
+        uint64_t index = requested;
+        guard.unlock();
+
+        const float* data = mapWindow(index);
+        volatile float sink = 0;
+        if (data) {
+            for (uint64_t i = 0; i < header.windowBytes / sizeof(float); i += pageFloats)
+                sink = data[i];
+        }
+        (void)sink;
+
+        guard.lock();
+        unmapWindow(prefetched);
+        prefetched.index = index;
+        prefetched.data = data;
+        prefetchReady.notify_all();
+    }
+}
+
+
+//
+// enterWindow():  Makes a window current, taking it from the prefetcher
+//                 when it was requested, and requests the one after it
+//
+void ConditionSeries::enterWindow(uint64_t index) {
+    Window next;
+    {
+        unique_lock<mutex> guard(prefetchLock);
+        if (requested == index) {
+            prefetchReady.wait(guard, [&]() { return prefetched.index == index; });
+            next = prefetched;
+            prefetched = Window();
+            prefetchHits++;
+        }
+        else {
+            unmapWindow(prefetched);
+        }
+        requested = (index + 1 < windowCount) ? index + 1 : UINT64_MAX;
+    }
+    prefetchReady.notify_all();
+
+    if (!next.data) {
+        next.index = index;
+        next.data = mapWindow(index);
+    }
+
+    unmapWindow(current);
+    current = next;
+    windowsMapped++;
+}
+
+
+//
+// applyStep():  Sets every bound plant's conditions for the step, in
+//               parallel chunks of plants, then recalculates the output
+//               of the plants whose conditions moved
+//
+int ConditionSeries::applyStep(uint64_t step, PowerGrid& grid) {
+    if (fd < 0 || step >= header.stepCount) {
+        cerr << "Error: Series step " << step << " is out of range" << endl;
+        return 1;
+    }
+
+    uint64_t index = step / header.windowSteps;
+    if (index != current.index)
+        enterWindow(index);
+    if (!current.data) {
+        cerr << "Error: Unable to map series window " << index << endl;
+        return 1;
+    }
+
+    const float* row = current.data + step % header.windowSteps;
+    size_t stride = header.windowSteps;
+
+    grid.getTaskPool().parallelFor(boundPlants.size(), PLANT_UPDATE_GRAIN, [&](size_t first, size_t last) {
+        double values[MAX_CONDITION_PARAMS];
+        for (size_t i = first; i < last; i++) {
+            Plant* plant = boundPlants[i];
+            int count = plant->getConditionCount();
+            for (int p = 0; p < count; p++)
+                values[p] = row[(firstColumn[i] + p) * stride];
+
+            plant->setConditions(values);
+        }
+    });
+    grid.adjustPlantsForConditions();
+    return 0;
+}
+
+
+
+//********************************************************
+//*****            Condition Stream Run              *****
+//********************************************************
+
+//
+// runConditionStream():  Writes a synthetic series and dispatches the grid
+//                        under every step of it
+//
+int runConditionStream(PowerGrid& grid, uint64_t stepCount) {
+    const string filename = "/tmp/powergrid_conditions.pgs";
+
+    auto start = chrono::steady_clock::now();
+    if (writeSyntheticConditions(grid, filename, stepCount))
+        return 1;
+    double writeTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ConditionSeries series;
+    if (series.open(filename) || series.bind(grid))
+        return 1;
+
+    double served = 0, capacity = 0, minCapacity = 1e300, maxCapacity = 0;
+    double charged = 0, discharged = 0;
+    start = chrono::steady_clock::now();
+    for (uint64_t step = 0; step < series.getStepCount(); step++) {
+        if (series.applyStep(step, grid))
+            return 1;
+
+        grid.redispatch();
+
+        double output = grid.getCapacityTotals().curCapacity.value();
+        for (auto& demand : grid.getDemandList())
+            served += demand.getPowerAcquired();
+        capacity += output;
+        minCapacity = min(minCapacity, output);
+        maxCapacity = max(maxCapacity, output);
+
+        // Carry the batteries' charge into the next step
+        StorageStep storage = grid.stepStorage(series.getStepHours());
+        charged += storage.charged * series.getStepHours();
+        discharged += storage.discharged * series.getStepHours();
+    }
+    double runTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    struct stat info;
+    stat(filename.c_str(), &info);
+
+    cout << "\n\t--- Condition Series Stream (" << stepCount << " steps of " << series.getStepHours() << " hr) ---\n";
+    cout << std::fixed << std::setprecision(0);
+    cout << "    Condition columns:     " << series.getColumnCount() << endl;
+    cout << "    Series file size:      " << info.st_size << " bytes (written in " << setprecision(3) << writeTime << "s)" << endl;
+    cout << "    Mapped at most:        " << 2 * series.getWindowBytes() << " bytes (2 windows)" << endl;
+    cout << "    Windows mapped:        " << series.getWindowsMapped() << " (" << series.getPrefetchHits() << " prefetched)" << endl;
+    cout << "    Steps dispatched:      " << setprecision(0) << stepCount / runTime << "/sec" << endl;
+    cout << "    Plant output MW:       avg " << setprecision(1) << capacity / max<uint64_t>(stepCount, 1)
+         << ", min " << minCapacity << ", max " << maxCapacity << endl;
+    cout << "    MW supplied:           avg " << served / max<uint64_t>(stepCount, 1) << endl;
+    if (grid.getStorageBank().size())
+        cout << "    Storage MWh:           " << charged << " charged, " << discharged << " discharged, "
+             << grid.getStorageBank().getStoredEnergy() << " held at the end" << endl;
+
+    series.close();
+    remove(filename.c_str());
+    return 0;
+}
@@ -0,0 +1,127 @@
+#pragma once
+// File: ConditionSeries.h
+//
+// Contains the file format, writer, and streaming reader for plant
+// condition time series.
+//
+// A series file holds one column per plant condition parameter (sunlight
+// hours, wind speed, water flow, ...) and one row per time step.  The rows
+// are split into windows of a fixed number of steps; inside a window each
+// column is stored contiguously, and every window starts on a page
+// boundary so it can be memory mapped on its own:
+//
+//      offset 0            SeriesHeader
+//      offset 64           SeriesColumn[columnCount]
+//      dataOffset          window 0:  column 0 steps, column 1 steps, ...
+//      + windowBytes       window 1:  ...
+//
+// The reader maps only the current window and the next one, which a
+// background thread maps and pages in ahead of use, so memory use does not
+// depend on the length of the series.
+//
+#include <string>
+#include <vector>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "PowerGrid.h"
+using namespace std;
+
+// File header, 64 bytes
+struct SeriesHeader {
+    char        magic[8];           // SERIES_MAGIC
+    uint32_t    columnCount;
+    uint32_t    windowSteps;        // Steps in each window
+    uint64_t    stepCount;
+    uint64_t    windowBytes;        // Size of each window, a multiple of the page size
+    uint64_t    dataOffset;         // Start of window 0, page aligned
+    double      stepHours;          // Simulated time per step
+    char        reserved[16];
+};
+
+// Column description, 32 bytes.  A plant's parameters are in adjacent
+// columns, in the order of Plant::getConditions().
+struct SeriesColumn {
+    char        plantName[28];
+    uint32_t    param;
+};
+
+
+//
+// writeConditionSeries():  Writes a series file.  fillStep(step, values)
+//      supplies one value per column for each step.  Only one window is
+//      held in memory at a time.  Returns 1 if the file cannot be written.
+//
+int writeConditionSeries(const string& filename, const vector<SeriesColumn>& columns,
+                         uint64_t stepCount, double stepHours,
+                         const function<void(uint64_t, float*)>& fillStep);
+
+// Writes a synthetic series for every plant on the grid that has condition
+// parameters, varying each around its current value
+int writeSyntheticConditions(PowerGrid& grid, const string& filename, uint64_t stepCount);
+
+
+//
+// Class ConditionSeries
+//
+class ConditionSeries {
+private:
+    // A mapped window of the file
+    struct Window {
+        uint64_t        index = UINT64_MAX;
+        const float*    data = nullptr;
+    };
+
+    int                     fd = -1;
+    SeriesHeader            header;
+    vector<SeriesColumn>    columns;
+    uint64_t                windowCount = 0;
+    Window                  current;
+
+    // Plants the series applies to and their first column
+    vector<Plant*>          boundPlants;
+    vector<uint32_t>        firstColumn;
+
+    // Background prefetch of the next window
+    thread                  prefetcher;
+    mutex                   prefetchLock;
+    condition_variable      prefetchReady;
+    uint64_t                requested = UINT64_MAX;    // Window the prefetcher should map
+    Window                  prefetched;
+    bool                    stopping = false;
+    uint64_t                windowsMapped = 0;
+    uint64_t                prefetchHits = 0;
+
+    const float* mapWindow(uint64_t index) const;
+    void unmapWindow(Window& window);
+    void prefetchLoop();
+    void enterWindow(uint64_t index);
+
+public:
+    // Constructors & Destructors
+    ConditionSeries();
+    ~ConditionSeries();
+
+    int open(const string& filename);   // Returns 1 if the file is missing or not a series
+    void close();
+    int bind(PowerGrid& grid);          // Finds the plants; returns 1 if a plant is missing
+
+    // Sets the conditions of every bound plant for a step and recalculates
+    // the output of those whose conditions changed.  Steps are fastest in
+    // increasing order.
+    int applyStep(uint64_t step, PowerGrid& grid);
+
+    // Accessors
+    uint64_t getStepCount() const;
+    double getStepHours() const;
+    size_t getColumnCount() const;
+    size_t getWindowBytes() const;
+    uint64_t getWindowsMapped() const;
+    uint64_t getPrefetchHits() const;
+};
+
+
+// Streams a synthetic series through the grid, re-dispatching every step
+int runConditionStream(PowerGrid& grid, uint64_t stepCount);
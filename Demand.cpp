@@ -5,6 +5,7 @@
 #include "Demand.h"
 #include <iostream>
 #include <iomanip>
+#include <cmath>
 
 
 //
@@ -17,6 +18,14 @@ Demand::Demand(const string& name, double powerRequired, double mwRetailPrice)
     totalPowerPrice = 0;
     totalPowerCost = 0;
     status = "Not Met";
+    critical = false;
+
+    requiredTicks = toPowerTicks(powerRequired);
+    acquiredTicks = 0;
+    deficitTicks = requiredTicks;
+    retailPriceTicks = toMoneyTicks(mwRetailPrice);
+    totalPriceTicks = 0;
+    totalCostTicks = 0;
 }
 
 
@@ -49,7 +58,83 @@ void Demand::addPowerToLocation(double amount, double sellPrice, double powerCos
     // Add the cost of the power from the plant to total for the location
     totalPowerCost += powerCost;
 
-    // Update the demand status
+    // Keep the fixed point totals in step
+    acquiredTicks += toPowerTicks(amount);
+    deficitTicks = (powerDeficit == 0) ? 0 : requiredTicks - acquiredTicks;
+    totalPriceTicks += toMoneyTicks(sellPrice);
+    totalCostTicks += toMoneyTicks(powerCost);
+
+    updateStatus();
+}
+
+
+//
+// addPowerTicks()
+//      Fixed point version of addPowerToLocation().  The totals are exact
+//      integers, so the deficit reaches exactly zero without a tolerance.
+//
+void Demand::addPowerTicks(PowerTicks amount, MoneyTicks sellPrice, MoneyTicks powerCost) {
+    acquiredTicks += amount;
+    deficitTicks = requiredTicks - acquiredTicks;
+    totalPriceTicks += sellPrice;
+    totalCostTicks += powerCost;
+
+    // Derive the double values from the exact totals
+    powerAcquired = toMW(acquiredTicks);
+    powerDeficit = toMW(deficitTicks);
+    totalPowerPrice = toDollars(totalPriceTicks);
+    totalPowerCost = toDollars(totalCostTicks);
+
+    updateStatus();
+}
+
+
+//
+// setPowerRequired() - Changes the power the location needs
+//
+void Demand::setPowerRequired(double required) {
+    powerRequired = required;
+    requiredTicks = toPowerTicks(required);
+    calcPowerDeficit();
+    deficitTicks = (powerDeficit == 0) ? 0 : requiredTicks - acquiredTicks;
+    updateStatus();
+}
+
+
+//
+// setMwRetailPrice() - Changes the price the location pays per MW.  Power
+//                      already acquired keeps the price it was sold at.
+//
+void Demand::setMwRetailPrice(double price) {
+    mwRetailPrice = price;
+    retailPriceTicks = toMoneyTicks(price);
+}
+
+void Demand::setCritical(bool isCritical) {
+    critical = isCritical;
+}
+
+
+//
+// resetSupply() - Clears the power acquired and its price and cost
+//
+void Demand::resetSupply() {
+    powerAcquired = 0;
+    powerDeficit = powerRequired;
+    totalPowerPrice = 0;
+    totalPowerCost = 0;
+    acquiredTicks = 0;
+    deficitTicks = requiredTicks;
+    totalPriceTicks = 0;
+    totalCostTicks = 0;
+    status = "Not Met";
+}
+
+
+//
+// updateStatus() - Sets the status after power has been added
+//
+void Demand::updateStatus() {
     if (powerDeficit == 0)
         status = "Met";
     else if (powerAcquired > 0)
@@ -70,6 +155,13 @@ double Demand::getPowerRequired() const { return powerRequired; }
 double Demand::getPowerAcquired() const { return powerAcquired; }
 double Demand::getPowerDeficit() const { return powerDeficit; }
 string Demand::getStatus() const { return status; }
+bool Demand::isCritical() const { return critical; }
+PowerTicks Demand::getRequiredTicks() const { return requiredTicks; }
+PowerTicks Demand::getAcquiredTicks() const { return acquiredTicks; }
+PowerTicks Demand::getDeficitTicks() const { return deficitTicks; }
+MoneyTicks Demand::getRetailPriceTicks() const { return retailPriceTicks; }
+MoneyTicks Demand::getTotalPriceTicks() const { return totalPriceTicks; }
+MoneyTicks Demand::getTotalCostTicks() const { return totalCostTicks; }
 
 // Debug and Print functions
 void Demand::printAll() const {
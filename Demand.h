@@ -12,6 +12,7 @@
 // quickly report on the status of if their requiermends are satisfied.
 // 
 #include <string>
+#include "FixedPoint.h"
 using namespace std;
 
 class Demand {
@@ -24,8 +25,19 @@ protected:
     double      powerAcquired;
     double      powerDeficit;
     string      status;
+    bool        critical;           // Essential load, served first under DO_CRITICAL
+
+    // Fixed point copies of the power and money values, kept in step with
+    // the double values above
+    PowerTicks  requiredTicks;
+    PowerTicks  acquiredTicks;
+    PowerTicks  deficitTicks;
+    MoneyTicks  retailPriceTicks;   // Per MW
+    MoneyTicks  totalPriceTicks;
+    MoneyTicks  totalCostTicks;
 
     // Private support functions
+    void        updateStatus();      // Sets the status from the deficit and the power acquired
     void        calcPowerDeficit();  // Calculates the power deficit when required or acquired changes 
 
 public:
@@ -34,6 +46,11 @@ public:
 
     // Mutators
     void addPowerToLocation(double powerAmount, double sellPrice, double cost);
+    void addPowerTicks(PowerTicks powerAmount, MoneyTicks sellPrice, MoneyTicks cost);  // Exact fixed point version
+    void setPowerRequired(double required);     // Change the requirement, keeping the power acquired
+    void setMwRetailPrice(double price);        // Price of power allocated from now on
+    void setCritical(bool isCritical);          // Hospitals, water, and other essential loads
+    void resetSupply();                         // Remove all acquired power before a new dispatch
 
 
     // Accesors
@@ -45,6 +62,13 @@ public:
     double getPowerAcquired() const;
     double getPowerDeficit() const;
     string getStatus() const;
+    bool isCritical() const;
+    PowerTicks getRequiredTicks() const;
+    PowerTicks getAcquiredTicks() const;
+    PowerTicks getDeficitTicks() const;
+    MoneyTicks getRetailPriceTicks() const;
+    MoneyTicks getTotalPriceTicks() const;
+    MoneyTicks getTotalCostTicks() const;
 
     // Print and debug
     void printAll() const;   // Prints information for debugging
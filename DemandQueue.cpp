@@ -0,0 +1,216 @@
+// File: DemandQueue.cpp
+//
+// Contains the function definitions for the DemandQueue class and the
+// grid's demand service order.  See DemandQueue.h for a description of
+// the queue.
+//
+#include "GridDef.h"
+#include "DemandQueue.h"
+#include "PowerGrid.h"
+#include <cassert>
+using namespace std;
+
+
+//
+//  Constructors and Destructors
+//
+DemandQueue::DemandQueue()
+    : order(DO_FILE) {
+}
+
+
+//
+// keyOf():  The value the queue is ordered by, largest first
+//
+DemandKey DemandQueue::keyOf(const Demand& demand) const {
+    switch (order) {
+    case DO_PRICE:
+        return { demand.getMwRetailPrice(), 0 };
+    case DO_CRITICAL:
+        return { demand.isCritical() ? 1.0 : 0.0, demand.getMwRetailPrice() };
+    case DO_DEFICIT:
+        return { demand.getPowerRequired(), 0 };
+    default:
+        return { 0, 0 };
+    }
+}
+
+bool DemandQueue::before(uint32_t a, uint32_t b) const {
+    const DemandKey& keyA = keys[a];
+    const DemandKey& keyB = keys[b];
+
+    if (keyA.primary != keyB.primary)
+        return keyA.primary > keyB.primary;
+    if (keyA.secondary != keyB.secondary)
+        return keyA.secondary > keyB.secondary;
+    return a < b;
+}
+
+
+//
+// place(), siftUp(), siftDown():  Heap moves that keep slot in step
+//
+void DemandQueue::place(size_t pos, uint32_t demand) {
+    heap[pos] = demand;
+    slot[demand] = uint32_t(pos);
+}
+
+void DemandQueue::siftUp(size_t pos) {
+    uint32_t demand = heap[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!before(demand, heap[parent]))
+            break;
+        place(pos, heap[parent]);
+        pos = parent;
+    }
+    place(pos, demand);
+}
+
+void DemandQueue::siftDown(size_t pos) {
+    uint32_t demand = heap[pos];
+    size_t count = heap.size();
+    while (true) {
+        size_t child = 2 * pos + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count && before(heap[child + 1], heap[child]))
+            child++;
+        if (!before(heap[child], demand))
+            break;
+        place(pos, heap[child]);
+        pos = child;
+    }
+    place(pos, demand);
+}
+
+
+//
+//  Mutators
+//
+void DemandQueue::setOrder(DemandOrder newOrder, const vector<Demand>& demands) {
+    order = newOrder;
+    rebuild(demands);
+}
+
+//
+// rebuild():  Keys every demand again and heapifies from the bottom up
+//
+void DemandQueue::rebuild(const vector<Demand>& demands) {
+    clear();
+    if (order == DO_FILE)
+        return;
+
+    size_t count = demands.size();
+    heap.resize(count);
+    slot.resize(count);
+    keys.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        keys[i] = keyOf(demands[i]);
+        place(i, uint32_t(i));
+    }
+    for (size_t pos = count / 2; pos-- > 0; )
+        siftDown(pos);
+}
+
+void DemandQueue::add(const vector<Demand>& demands, uint32_t demand) {
+    if (order == DO_FILE)
+        return;
+
+    assert(demand == keys.size());
+    keys.push_back(keyOf(demands[demand]));
+    slot.push_back(0);
+    heap.push_back(demand);
+    siftUp(heap.size() - 1);
+}
+
+//
+// update():  Keys the demand again and moves it whichever way the new key
+//            sends it
+//
+void DemandQueue::update(const vector<Demand>& demands, uint32_t demand) {
+    if (order == DO_FILE)
+        return;
+
+    keys[demand] = keyOf(demands[demand]);
+    siftUp(slot[demand]);
+    siftDown(slot[demand]);
+}
+
+void DemandQueue::clear() {
+    heap.clear();
+    slot.clear();
+    keys.clear();
+}
+
+
+//
+//  Accessors
+//
+DemandOrder DemandQueue::getOrder() const { return order; }
+size_t DemandQueue::size() const { return heap.size(); }
+
+uint32_t DemandQueue::top() const {
+    assert(!heap.empty());
+    return heap[0];
+}
+
+
+//********************************************************
+//*****          The Grid's Service Order            *****
+//********************************************************
+
+//
+// setDemandOrder():  Selects the order distributePower() serves the demand
+//                    locations in.  The queue is kept as demands change,
+//                    so only switching the order rebuilds it.
+//
+void PowerGrid::setDemandOrder(DemandOrder order) {
+    demandQueue.setOrder(order, demands);
+}
+
+DemandOrder PowerGrid::getDemandOrder() const {
+    return demandQueue.getOrder();
+}
+
+const DemandQueue& PowerGrid::getDemandQueue() const {
+    return demandQueue;
+}
+
+
+//
+// setDemandRequired(), setDemandPrice(), setDemandCritical():  Change a
+//      location and move it to its new place in the service order.  The
+//      queue keeps each location's key, so every change to a requirement,
+//      price, or critical flag goes through these (or through the reloader,
+//      which updates the queue itself) rather than the Demand directly.
+//
+int PowerGrid::setDemandRequired(const string& location, double required) {
+    auto it = demandIndex.find(location);
+    if (it == demandIndex.end())
+        return 1;
+
+    demands[it->second].setPowerRequired(required);
+    demandQueue.update(demands, uint32_t(it->second));
+    return 0;
+}
+
+int PowerGrid::setDemandPrice(const string& location, double mwRetailPrice) {
+    auto it = demandIndex.find(location);
+    if (it == demandIndex.end())
+        return 1;
+
+    demands[it->second].setMwRetailPrice(mwRetailPrice);
+    demandQueue.update(demands, uint32_t(it->second));
+    return 0;
+}
+
+int PowerGrid::setDemandCritical(const string& location, bool critical) {
+    auto it = demandIndex.find(location);
+    if (it == demandIndex.end())
+        return 1;
+
+    demands[it->second].setCritical(critical);
+    demandQueue.update(demands, uint32_t(it->second));
+    return 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+// File: DemandQueue.h
+//
+// Contains class definition for the DemandQueue class, the order in which
+// dispatch serves the demand locations.
+//
+// distributePower() serves the locations one after another, and the first
+// ones take the cheapest plants and the line capacity.  In file order a
+// low priced location early in the file can leave a better paying one
+// later in it short.  The queue is an indexed binary heap over the demand
+// positions, keyed by the chosen priority, with the position of every
+// demand in the heap kept so a changed price or requirement moves just
+// that demand, in O(log n).  Dispatch takes the demands from the queue in
+// priority order without changing it, so nothing is ever sorted again.
+//
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include "Demand.h"
+using namespace std;
+
+// Order in which distributePower() serves the demand locations
+enum DemandOrder {
+    DO_FILE,            // As read from the demands file (the default)
+    DO_PRICE,           // Highest retail price first
+    DO_CRITICAL,        // Critical locations first, then by retail price
+    DO_DEFICIT,         // Largest requirement first: the deficit a dispatch starts from
+    DO_COUNT
+};
+
+// The priority of one demand, larger first.  Ties are broken by the
+// position in the file, earlier first.
+struct DemandKey {
+    double  primary;
+    double  secondary;
+};
+
+//
+// Class DemandQueue
+//
+// Indexes into the grid's demand vector.  The grid tells it when a demand
+// is added, removed, or has its key changed.  In file order the queue is
+// empty and dispatch walks the vector instead.
+//
+class DemandQueue {
+private:
+    DemandOrder         order;
+    vector<uint32_t>    heap;       // Demand positions, the highest priority at 0
+    vector<uint32_t>    slot;       // Where each demand is in heap
+    vector<DemandKey>   keys;       // Per demand
+    mutable vector<uint32_t> frontier;  // Heap positions still to visit, see forEach()
+
+    DemandKey keyOf(const Demand& demand) const;
+    bool before(uint32_t a, uint32_t b) const;     // Demand a is served before demand b
+    void place(size_t pos, uint32_t demand);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+
+public:
+    DemandQueue();
+
+    // Mutators - keep the heap consistent with the demand vector
+    void setOrder(DemandOrder newOrder, const vector<Demand>& demands);    // Rebuilds, O(n)
+    void rebuild(const vector<Demand>& demands);    // After positions shift, O(n)
+    void add(const vector<Demand>& demands, uint32_t demand);      // Appended at the end, O(log n)
+    void update(const vector<Demand>& demands, uint32_t demand);   // Its key changed, O(log n)
+    void clear();
+
+    // Accessors
+    DemandOrder getOrder() const;
+    size_t size() const;
+    uint32_t top() const;
+
+    // Calls visit with every demand position in priority order.  The
+    // queue is not changed, so visit may not change the demands' keys.
+    template<typename Visit>
+    void forEach(Visit visit) const;
+};
+
+
+//
+// forEach():  Pops the heap positions from a second, small heap that
+//             starts with the root and takes the children of every
+//             position visited.  The next demand in order is always the
+//             best of those, so n demands take O(n log n) without moving
+//             anything in the queue itself.
+//
+template<typename Visit>
+void DemandQueue::forEach(Visit visit) const {
+    auto later = [this](uint32_t a, uint32_t b) { return before(heap[b], heap[a]); };
+
+    frontier.clear();
+    if (!heap.empty())
+        frontier.push_back(0);
+
+    while (!frontier.empty()) {
+        std::pop_heap(frontier.begin(), frontier.end(), later);
+        uint32_t pos = frontier.back();
+        frontier.pop_back();
+
+        for (uint32_t child = 2 * pos + 1; child <= 2 * pos + 2 && child < heap.size(); child++) {
+            frontier.push_back(child);
+            std::push_heap(frontier.begin(), frontier.end(), later);
+        }
+        visit(heap[pos]);
+    }
+}
@@ -0,0 +1,291 @@
+// File: DispatchCache.cpp
+//
+// Contains the function definitions for the dispatch result cache, the
+// grid state fingerprint, and ledger playback.  See DispatchCache.h.
+//
+#include "DispatchCache.h"
+#include "PowerGrid.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <cstring>
+using namespace std;
+
+
+//********************************************************
+//*****              State Hashing                   *****
+//********************************************************
+
+//
+// add():  Mixes one word into both halves of the fingerprint with
+//         different multipliers, so a collision needs both to collide
+//
+void StateHasher::add(uint64_t word) {
+    high = (high ^ word) * 0xbf58476d1ce4e5b9ULL;
+    high ^= high >> 29;
+    low = (low + word) * 0x94d049bb133111ebULL;
+    low ^= low >> 31;
+}
+
+void StateHasher::add(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    add(bits);
+}
+
+DispatchKey StateHasher::finish() const {
+    DispatchKey key;
+    key.high = (high ^ (high >> 33)) * 0xff51afd7ed558ccdULL;
+    key.low = (low ^ (low >> 33)) * 0xc4ceb9fe1a85ec53ULL;
+    return key;
+}
+
+
+
+//********************************************************
+//*****              Dispatch Cache                  *****
+//********************************************************
+
+bool DispatchCache::isEnabled() const { return budget > 0; }
+size_t DispatchCache::getBudget() const { return budget; }
+size_t DispatchCache::getBytesUsed() const { return bytesUsed; }
+size_t DispatchCache::getEntryCount() const { return entries.size(); }
+uint64_t DispatchCache::getHits() const { return hits; }
+uint64_t DispatchCache::getMisses() const { return misses; }
+uint64_t DispatchCache::getEvictions() const { return evictions; }
+
+
+void DispatchCache::setBudget(size_t bytes) {
+    budget = bytes;
+    evictTo(budget);
+}
+
+void DispatchCache::clear() {
+    entries.clear();
+    index.clear();
+    bytesUsed = 0;
+}
+
+
+//
+// evictTo():  Drops least recently used ledgers until limit bytes are used
+//
+void DispatchCache::evictTo(size_t limit) {
+    while (bytesUsed > limit && !entries.empty()) {
+        bytesUsed -= entries.back().bytes;
+        index.erase(entries.back().key);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+
+//
+// find():  Looks up a fingerprint and moves a hit to the front
+//
+const AllocationLedger* DispatchCache::find(const DispatchKey& key) {
+    auto it = index.find(key);
+    if (it == index.end()) {
+        misses++;
+        return nullptr;
+    }
+
+    hits++;
+    entries.splice(entries.begin(), entries, it->second);
+    return &it->second->ledger;
+}
+
+
+//
+// insert():  Stores a copy of a ledger, evicting older ledgers to make room.
+//            A ledger larger than the whole budget is not stored.
+//
+void DispatchCache::insert(const DispatchKey& key, const AllocationLedger& ledger) {
+    size_t bytes = sizeof(Entry) + ledger.size() * sizeof(Allocation) + 4 * sizeof(void*);
+    if (bytes > budget || index.count(key))
+        return;
+
+    evictTo(budget - bytes);
+    entries.push_front({ key, ledger, bytes });
+    index[key] = entries.begin();
+    bytesUsed += bytes;
+}
+
+
+
+//********************************************************
+//*****        PowerGrid dispatch caching            *****
+//********************************************************
+
+//
+// fingerprintDispatch():  Hashes every value distributePower() reads, in
+//                         the order it reads them
+//
+DispatchKey PowerGrid::fingerprintDispatch() const {
+    StateHasher hasher;
+    DispatchPolicy policy = plantViews.getPolicy();
+
+    hasher.add(uint64_t(policy));
+    hasher.add(uint64_t(demandQueue.getOrder()));
+    hasher.add(uint64_t(fixedPoint));
+
+    auto addPlant = [&hasher](const Plant* plant) {
+        hasher.add(uint64_t(reinterpret_cast<uintptr_t>(plant)));
+        hasher.add(plant->getAvailCapacity());
+        hasher.add(uint64_t(plant->getAvailTicks()));
+        hasher.add(plant->getCostPerMW());
+    };
+    if (policy == DP_SUSTAIN) {
+        for (auto plant : plants)
+            addPlant(plant);
+    }
+    else {
+        for (auto plant : plantViews.getView(policy))
+            addPlant(plant);
+    }
+
+    hasher.add(uint64_t(transLines.size()));
+    for (auto& line : transLines) {
+        hasher.add(line.getAvailCapacity());
+        hasher.add(uint64_t(line.getAvailTicks()));
+        hasher.add(line.getEfficiency());
+    }
+
+    hasher.add(uint64_t(demands.size()));
+    for (auto& demand : demands) {
+        hasher.add(demand.getPowerRequired());
+        hasher.add(demand.getPowerAcquired());
+        hasher.add(demand.getPowerDeficit());
+        hasher.add(uint64_t(demand.getAcquiredTicks()));
+        hasher.add(demand.getMwRetailPrice());
+        hasher.add(uint64_t(demand.isCritical()));
+        hasher.add(demand.getTotalPowerPrice());
+        hasher.add(demand.getTotalPowerCost());
+    }
+
+    return hasher.finish();
+}
+
+
+//
+// replayLedger():  Performs the recorded allocations again and makes them
+//                  the last dispatch's ledger
+//
+void PowerGrid::replayLedger(const AllocationLedger& entries) {
+    for (auto& entry : entries) {
+        Demand& demand = demands[entry.demand];
+        TransLine& line = transLines[entry.line];
+
+        if (fixedPoint) {
+            entry.plant->reduceCapacityTicks(entry.rawTicks);
+            line.allocateLineTicks(entry.suppliedTicks);
+            demand.addPowerTicks(entry.suppliedTicks, entry.sellTicks, entry.costTicks);
+        }
+        else {
+            entry.plant->reduceCapacity(entry.rawFromPlant);
+            line.allocateLineCapacity(entry.supplied);
+            demand.addPowerToLocation(entry.supplied, entry.sellPrice, entry.cost);
+        }
+        logAllocation(demand, entry.plant, line, entry.supplied, entry.rawFromPlant, entry.sellPrice, entry.cost);
+    }
+
+    if (&entries != &ledger)
+        ledger = entries;
+}
+
+
+void PowerGrid::setDispatchCacheBudget(size_t bytes) {
+    dispatchCache.setBudget(bytes);
+}
+
+const DispatchCache& PowerGrid::getDispatchCache() const { return dispatchCache; }
+const AllocationLedger& PowerGrid::getLastLedger() const { return ledger; }
+
+
+
+//********************************************************
+//*****             Cache Benchmark                  *****
+//********************************************************
+
+//
+// sweepScenarios():  Dispatches a random sequence of demand scenarios and
+//      returns a fingerprint of each step's results
+//
+static vector<DispatchKey> sweepScenarios(PowerGrid& grid, const vector<Demand*>& demands,
+                                          const vector<vector<double>>& scenarios, uint64_t stepCount) {
+    vector<DispatchKey> results;
+    vector<int64_t> row;
+    mt19937 rng(1);
+
+    for (uint64_t step = 0; step < stepCount; step++) {
+        const vector<double>& scenario = scenarios[rng() % scenarios.size()];
+        for (size_t d = 0; d < demands.size(); d++)
+            grid.setDemandRequired(demands[d]->getLocation(), scenario[d]);
+
+        grid.resetDispatch();
+        grid.distributePower();
+
+        grid.captureResults(row);
+        StateHasher hasher;
+        for (int64_t value : row)
+            hasher.add(uint64_t(value));
+        results.push_back(hasher.finish());
+    }
+    return results;
+}
+
+
+//
+// runCacheBenchmark():  Sweeps the same scenario sequence with the cache
+//                       off and on, and compares the results step by step
+//
+int runCacheBenchmark(PowerGrid& grid, uint64_t stepCount, int scenarioCount) {
+    vector<Demand*> demands;
+    vector<double> required;
+    {
+        unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+        for (auto& demand : state->demands) {
+            demands.push_back(grid.findDemand(demand.location));
+            required.push_back(demand.required);
+        }
+    }
+
+    mt19937 rng(2);
+    uniform_real_distribution<double> unit(0.8, 1.2);
+    vector<vector<double>> scenarios(max(1, scenarioCount));
+    for (auto& scenario : scenarios) {
+        for (double r : required)
+            scenario.push_back(r * unit(rng));
+    }
+
+    auto timeSweep = [&](vector<DispatchKey>& results) {
+        auto start = chrono::steady_clock::now();
+        results = sweepScenarios(grid, demands, scenarios, stepCount);
+        return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    };
+
+    vector<DispatchKey> uncached, cached;
+    grid.setDispatchCacheBudget(0);
+    double uncachedTime = timeSweep(uncached);
+    grid.setDispatchCacheBudget(DISPATCH_CACHE_BUDGET);
+    double cachedTime = timeSweep(cached);
+
+    const DispatchCache& cache = grid.getDispatchCache();
+    bool match = (uncached == cached);
+
+    cout << "\n\t--- Dispatch Cache (" << stepCount << " steps over " << scenarios.size() << " scenarios) ---\n";
+    cout << std::fixed << std::setprecision(0);
+    cout << "    Without cache:         " << stepCount / uncachedTime << " dispatches/sec" << endl;
+    cout << "    With cache:            " << stepCount / cachedTime << " dispatches/sec ("
+         << setprecision(2) << uncachedTime / cachedTime << "x)" << endl;
+    cout << "    Hits / misses:         " << cache.getHits() << " / " << cache.getMisses() << endl;
+    cout << "    Entries / bytes:       " << cache.getEntryCount() << " / " << cache.getBytesUsed()
+         << " (evictions " << cache.getEvictions() << ")" << endl;
+    cout << "    Results match:         " << (match ? "yes" : "NO") << endl;
+
+    grid.setDispatchCacheBudget(0);
+    for (size_t d = 0; d < demands.size(); d++)
+        grid.setDemandRequired(demands[d]->getLocation(), required[d]);
+    return match ? 0 : 1;
+}
@@ -0,0 +1,121 @@
+#pragma once
+// File: DispatchCache.h
+//
+// Contains the allocation ledger recorded by dispatch and the cache of
+// dispatch results keyed by a fingerprint of the grid state.
+//
+// Every allocation distributePower() makes is recorded in a ledger: the
+// plant, the line, the demand location, and the power, price, and cost
+// moved.  Playing a ledger back performs the same updates in the same
+// order, so it leaves the grid exactly as the dispatch did.
+//
+// The fingerprint hashes everything dispatch reads: the dispatch mode, the
+// plants in dispatch order with their available capacity and cost, the
+// lines with their available capacity and efficiency, and the demand
+// locations with their requirement, supply, and prices.  Grids with the
+// same fingerprint dispatch identically, so a cached ledger can be played
+// back instead.  The cache keeps the most recently used ledgers within a
+// memory budget.
+//
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+#include "Plant.h"
+using namespace std;
+
+//
+// Allocation:  One move of power from a plant over a line to a demand
+//
+struct Allocation {
+    Plant*      plant;
+    uint32_t    demand;             // Index into the grid's demands
+    uint32_t    line;               // Index into the grid's lines
+    double      supplied;           // MW delivered to the location
+    double      rawFromPlant;       // MW drawn from the plant
+    double      sellPrice;
+    double      cost;
+    PowerTicks  suppliedTicks;      // Fixed point dispatch only
+    PowerTicks  rawTicks;
+    MoneyTicks  sellTicks;
+    MoneyTicks  costTicks;
+};
+
+typedef vector<Allocation> AllocationLedger;
+
+
+//
+// DispatchKey:  128 bit fingerprint of the state dispatch reads
+//
+struct DispatchKey {
+    uint64_t    high = 0;
+    uint64_t    low = 0;
+
+    bool operator==(const DispatchKey& other) const { return high == other.high && low == other.low; }
+};
+
+struct DispatchKeyHash {
+    size_t operator()(const DispatchKey& key) const { return size_t(key.low); }
+};
+
+//
+// StateHasher:  Builds a DispatchKey from a stream of 64 bit words
+//
+class StateHasher {
+private:
+    uint64_t    high = 0x9e3779b97f4a7c15ULL;
+    uint64_t    low = 0x6a09e667f3bcc909ULL;
+
+public:
+    void add(uint64_t word);
+    void add(double value);
+    DispatchKey finish() const;
+};
+
+
+//
+// Class DispatchCache
+//
+class DispatchCache {
+private:
+    struct Entry {
+        DispatchKey         key;
+        AllocationLedger    ledger;
+        size_t              bytes;
+    };
+
+    list<Entry>     entries;        // Most recently used first
+    unordered_map<DispatchKey, list<Entry>::iterator, DispatchKeyHash> index;
+    size_t          budget = 0;     // 0 = cache off
+    size_t          bytesUsed = 0;
+
+    // Counters
+    uint64_t        hits = 0;
+    uint64_t        misses = 0;
+    uint64_t        evictions = 0;
+
+    void evictTo(size_t limit);
+
+public:
+    void setBudget(size_t bytes);   // Evicts down to the new budget
+    bool isEnabled() const;
+    void clear();
+
+    // Returns the cached ledger and marks it most recently used, or nullptr
+    const AllocationLedger* find(const DispatchKey& key);
+    void insert(const DispatchKey& key, const AllocationLedger& ledger);
+
+    // Accessors
+    size_t getBudget() const;
+    size_t getBytesUsed() const;
+    size_t getEntryCount() const;
+    uint64_t getHits() const;
+    uint64_t getMisses() const;
+    uint64_t getEvictions() const;
+};
+
+
+// Sweeps repeating demand scenarios with and without the cache and checks
+// the results match : in file DispatchCache.cpp
+class PowerGrid;
+int runCacheBenchmark(PowerGrid& grid, uint64_t stepCount, int scenarioCount);
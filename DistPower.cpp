@@ -16,24 +16,252 @@ using namespace std;
 // has outstanding power requiemennts and calls the allocateToDemand 
 // function to allocate power to it.
 //
+// When the dispatch cache is on and the grid is in a state that has been
+// dispatched before, the recorded allocations are played back instead.
+//
 void PowerGrid::distributePower() {
+    DispatchKey key;
+    if (dispatchCache.isEnabled()) {
+        key = fingerprintDispatch();
+        const AllocationLedger* cached = dispatchCache.find(key);
+        if (cached) {
+            replayLedger(*cached);
+            publishDispatch();
+            return;
+        }
+    }
+    ledger.clear();
 
     // Process the demand for each location
-    for (auto& demand : demands) {
+    allocateDeficits();
+
+    if (dispatchCache.isEnabled())
+        dispatchCache.insert(key, ledger);
+
+    // Let snapshot readers and monitors see the new allocations
+    publishDispatch();
+}
+
+
+//
+// allocateDeficits(): Allocates power to each location with outstanding demand
+//
+void PowerGrid::allocateDeficits() {
+    DispatchPolicy policy = plantViews.getPolicy();
+
+    if (policy == DP_SUSTAIN)
+        allocateDeficitsFrom(plants);
+    else
+        allocateDeficitsFrom(plantViews.getView(policy));
+}
+
+
+//
+// allocateDeficitsFrom():  allocateDeficits() for one plant order.  Plants
+//      only lose power while a dispatch runs, so the locations share one
+//      cursor past the plants that have none left.
+//
+template<typename PlantRange>
+void PowerGrid::allocateDeficitsFrom(const PlantRange& plantOrder) {
+    auto firstWithRoom = plantOrder.begin();
+
+    forEachDemandInOrder([&](Demand& demand) {
 
         // Check if this location has outstanding demand and allocate power to it
         if (demand.getPowerDeficit() > 0) {
             // cout << demand.getLocation() << " requesting " << demand.getPowerRequired() << "MW" << endl;
-            allocateToDemand(demand);
+            if (fixedPoint)
+                allocateFromPlantsFixed(demand, plantOrder, firstWithRoom);
+            else
+                allocateFromPlants(demand, plantOrder, firstWithRoom);
         }
+    });
+}
+
+
+//
+// redispatch(): Distributes power again after plants, lines, or demands
+//               have changed.  A cold dispatch releases everything and
+//               starts over; a warm start repairs the last dispatch.
+//
+void PowerGrid::redispatch() {
+    if (warmStart && !ledger.empty()) {
+        warmStartDispatch();
+        return;
     }
+
+    resetDispatch();
+    distributePower();
+}
+
+void PowerGrid::setWarmStartDispatch(bool enable) {
+    warmStart = enable;
+}
+
+
+//
+// warmStartDispatch(): Re-makes the last dispatch's allocations, each
+//      clamped to what the plant, line, and demand location can now take,
+//      then allocates the remaining deficits as a normal dispatch would.
+//
+// When conditions change a little, most allocations carry over unchanged
+// and only the few locations left short go through the plant search.
+//
+void PowerGrid::warmStartDispatch() {
+    AllocationLedger previous;
+    previous.swap(ledger);
+    resetDispatch();
+
+    for (auto& entry : previous) {
+        Plant* plant = entry.plant;
+        Demand& demand = demands[entry.demand];
+        TransLine& line = transLines[entry.line];
+
+        if (fixedPoint) {
+            int64_t lineEfficiency = line.getEfficiencyPPM();
+            if (lineEfficiency <= 0) continue;
+
+            PowerTicks maxScaledPowerAvail = plant->getAvailTicks() * lineEfficiency / EFFICIENCY_SCALE;
+            PowerTicks supplied = min(entry.suppliedTicks, min(demand.getDeficitTicks(), min(maxScaledPowerAvail, line.getAvailTicks())));
+            if (supplied <= 0) continue;
+
+            PowerTicks raw = (supplied * EFFICIENCY_SCALE + lineEfficiency - 1) / lineEfficiency;
+            plant->reduceCapacityTicks(raw);
+            line.allocateLineTicks(supplied);
+
+            MoneyTicks cost = priceOfPower(raw, plant->getCostTicks());
+            MoneyTicks sellPrice = priceOfPower(supplied, demand.getRetailPriceTicks());
+            demand.addPowerTicks(supplied, sellPrice, cost);
+
+            logAllocation(demand, plant, line, toMW(supplied), toMW(raw), toDollars(sellPrice), toDollars(cost));
+            ledger.push_back({ plant, entry.demand, entry.line, toMW(supplied), toMW(raw), toDollars(sellPrice), toDollars(cost),
+                supplied, raw, sellPrice, cost });
+        }
+        else {
+            double lineEfficiency = line.getEfficiency();
+            double supplied = min(entry.supplied, min(demand.getPowerDeficit(),
+                                  min(plant->getAvailCapacity() * lineEfficiency, line.getAvailCapacity())));
+            if (supplied <= 0) continue;
+
+            double raw = supplied / lineEfficiency;
+            plant->reduceCapacity(raw);
+            line.allocateLineCapacity(supplied);
+
+            double cost = raw * plant->getCostPerMW();
+            double sellPrice = supplied * demand.getMwRetailPrice();
+            demand.addPowerToLocation(supplied, sellPrice, cost);
+
+            logAllocation(demand, plant, line, supplied, raw, sellPrice, cost);
+            ledger.push_back({ plant, entry.demand, entry.line, supplied, raw, sellPrice, cost, 0, 0, 0, 0 });
+        }
+    }
+
+    // Repair: fill whatever the carried over allocations no longer cover
+    allocateDeficits();
+
+    publishDispatch();
+}
+
+
+//
+// resetDispatch(): Returns the grid to its state before distributePower()
+//
+// Plants get back their current capacity, lines their maximum capacity,
+// and demand locations lose the power and charges they were given.
+//
+void PowerGrid::resetDispatch() {
+    for (auto plant : plants)
+        plant->resetAvailCapacity();
+
+    for (auto& line : transLines)
+        line.resetCapacity();
+
+    for (auto& demand : demands)
+        demand.resetSupply();
+}
+
+
+//
+// setAllocationLog(): Turns the per allocation console output on or off.
+//                     Services that re-dispatch often turn it off.
+//
+void PowerGrid::setAllocationLog(bool enable) {
+    allocationLog = enable;
+}
+
+
+//
+// setDispatchPolicy():  Selects which plant view allocateToDemand() draws
+//                       from.  The views are maintained as plants change,
+//                       so switching does not reorder anything.
+//
+void PowerGrid::setDispatchPolicy(DispatchPolicy policy) {
+    plantViews.setPolicy(policy);
+}
+
+DispatchPolicy PowerGrid::getDispatchPolicy() const {
+    return plantViews.getPolicy();
+}
+
+void PowerGrid::setHybridWeight(double weight) {
+    plantViews.setHybridWeight(weight);
 }
 
 
 //
-// Allocates power and line capacity to a demand location
+// setFixedPointDispatch():  Selects exact integer accounting for dispatch.
+//      Capacities, deficits, costs and prices are tracked in kW and
+//      milli-cent ticks, so no rounding tolerances are needed and totals
+//      are identical whatever order they are summed in.
+//
+void PowerGrid::setFixedPointDispatch(bool enable) {
+    fixedPoint = enable;
+}
+
+bool PowerGrid::isFixedPointDispatch() const {
+    return fixedPoint;
+}
+
+
+//
+// Allocates power and line capacity to a demand location using the plant
+// order of the active dispatch policy
 //
 void PowerGrid::allocateToDemand(Demand& demand) {
+    DispatchPolicy policy = plantViews.getPolicy();
+
+    if (fixedPoint) {
+        if (policy == DP_SUSTAIN)
+            allocateFromPlantsFixed(demand, plants);
+        else
+            allocateFromPlantsFixed(demand, plantViews.getView(policy));
+    }
+    else {
+        if (policy == DP_SUSTAIN)
+            allocateFromPlants(demand, plants);
+        else
+            allocateFromPlants(demand, plantViews.getView(policy));
+    }
+}
+
+
+//
+// allocateFromPlants():  Allocates power and line capacity to a demand
+//                        location, visiting plants in plantOrder
+//
+template<typename PlantRange>
+void PowerGrid::allocateFromPlants(Demand& demand, const PlantRange& plantOrder) {
+    auto firstWithRoom = plantOrder.begin();
+    allocateFromPlants(demand, plantOrder, firstWithRoom);
+}
+
+//
+// The cursor firstWithRoom is moved past the plants with no power left, so
+// a dispatch that passes the same cursor for every location looks at each
+// empty plant once instead of once per location and line.
+//
+template<typename PlantRange, typename PlantIter>
+void PowerGrid::allocateFromPlants(Demand& demand, const PlantRange& plantOrder, PlantIter& firstWithRoom) {
 
     // Check every line to see if it has capacity left to supply power for the demand location
     for (auto& line : transLines) {
@@ -44,8 +272,16 @@ void PowerGrid::allocateToDemand(Demand& demand) {
         // Stop checking if the full demand has been met
         if (demand.getPowerDeficit() == 0) break;
 
+        while (firstWithRoom != plantOrder.end() && !((*firstWithRoom)->getAvailCapacity() > 0))
+            ++firstWithRoom;
+
+        // A nearly full line is given up at the first plant checked, even an empty one
+        if (firstWithRoom != plantOrder.begin() && line.getAvailCapacity() <= 0.5)
+            continue;
+
         // Search the plants to see which plants have power to provide
-        for (auto plant : plants) {
+        for (auto it = firstWithRoom; it != plantOrder.end(); ++it) {
+            Plant* plant = *it;
 
             // Stop checking other plants if the full demand is met
             if (demand.getPowerDeficit() == 0) break;
@@ -79,16 +315,10 @@ void PowerGrid::allocateToDemand(Demand& demand) {
                 // Add the capacity to the demand location with the cost of the power
                 demand.addPowerToLocation(powerSuppliedToLocation, sellPriceOfPower, costOfPower);
 
-                // Print the allocation
-                cout << "Allocating: "
-                    << std::fixed << std::setprecision(2) << std::setw(6) << powerSuppliedToLocation
-                    << " for " << std::setw(10) << std::left << demand.getLocation()
-                    << " Using: " << std::setprecision(2) << std::setw(6) << rawPowerFromPlant
-                    << " From " << std::setw(12) << std::left << plant->getName()
-                    << " On " << line.getLineID()
-                    << ", Sell: $" << std::setprecision(2) << std::setw(11) << sellPriceOfPower
-                    << " Cost: $" << std::setprecision(2) << std::setw(11) << costOfPower
-                    << endl;
+                // Print and record the allocation
+                logAllocation(demand, plant, line, powerSuppliedToLocation, rawPowerFromPlant, sellPriceOfPower, costOfPower);
+                ledger.push_back({ plant, uint32_t(&demand - demands.data()), uint32_t(&line - transLines.data()),
+                    powerSuppliedToLocation, rawPowerFromPlant, sellPriceOfPower, costOfPower, 0, 0, 0, 0 });
             }
 
             // Check if Line capacity has been reached and we need to move to the next line.
@@ -102,14 +332,106 @@ void PowerGrid::allocateToDemand(Demand& demand) {
 
 
 
+//
+// allocateFromPlantsFixed():  Fixed point version of allocateFromPlants().
+//
+// Power is moved in whole kW ticks.  The power delivered is rounded down
+// and the power drawn from the plant is rounded up, so a plant is never
+// asked for more than it has and a line is filled exactly to zero.
+//
+template<typename PlantRange>
+void PowerGrid::allocateFromPlantsFixed(Demand& demand, const PlantRange& plantOrder) {
+    auto firstWithRoom = plantOrder.begin();
+    allocateFromPlantsFixed(demand, plantOrder, firstWithRoom);
+}
+
+template<typename PlantRange, typename PlantIter>
+void PowerGrid::allocateFromPlantsFixed(Demand& demand, const PlantRange& plantOrder, PlantIter& firstWithRoom) {
+
+    for (auto& line : transLines) {
+
+        // Skip lines that are full or carry no power at all
+        int64_t lineEfficiency = line.getEfficiencyPPM();
+        if (line.getAvailTicks() <= 0 || lineEfficiency <= 0) continue;
+
+        // Stop checking if the full demand has been met
+        if (demand.getDeficitTicks() == 0) break;
+
+        while (firstWithRoom != plantOrder.end() && (*firstWithRoom)->getAvailTicks() <= 0)
+            ++firstWithRoom;
+
+        for (auto it = firstWithRoom; it != plantOrder.end(); ++it) {
+            Plant* plant = *it;
+
+            if (demand.getDeficitTicks() == 0) break;
+
+            PowerTicks rawPlantPowerAvail = plant->getAvailTicks();
+            if (rawPlantPowerAvail > 0) {
+
+                // Power that can reach the location, limited by the deficit and the line
+                PowerTicks maxScaledPowerAvail = rawPlantPowerAvail * lineEfficiency / EFFICIENCY_SCALE;
+                PowerTicks powerSuppliedToLocation = min(demand.getDeficitTicks(), min(maxScaledPowerAvail, line.getAvailTicks()));
+                if (powerSuppliedToLocation == 0) continue;
+
+                // Power drawn from the plant to cover the line loss
+                PowerTicks rawPowerFromPlant = (powerSuppliedToLocation * EFFICIENCY_SCALE + lineEfficiency - 1) / lineEfficiency;
+                plant->reduceCapacityTicks(rawPowerFromPlant);
+                line.allocateLineTicks(powerSuppliedToLocation);
+
+                MoneyTicks costOfPower = priceOfPower(rawPowerFromPlant, plant->getCostTicks());
+                MoneyTicks sellPriceOfPower = priceOfPower(powerSuppliedToLocation, demand.getRetailPriceTicks());
+                demand.addPowerTicks(powerSuppliedToLocation, sellPriceOfPower, costOfPower);
+
+                logAllocation(demand, plant, line, toMW(powerSuppliedToLocation), toMW(rawPowerFromPlant),
+                    toDollars(sellPriceOfPower), toDollars(costOfPower));
+                ledger.push_back({ plant, uint32_t(&demand - demands.data()), uint32_t(&line - transLines.data()),
+                    toMW(powerSuppliedToLocation), toMW(rawPowerFromPlant), toDollars(sellPriceOfPower), toDollars(costOfPower),
+                    powerSuppliedToLocation, rawPowerFromPlant, sellPriceOfPower, costOfPower });
+            }
+
+            // Move to the next line once this one is exactly full
+            if (line.getAvailTicks() == 0)
+                break;
+
+        } // for Plants
+
+    } // for TransLine
+}
+
+
+// Plant orders built outside this file, such as the carbon priced order
+template void PowerGrid::allocateFromPlants(Demand& demand, const vector<Plant*>& plantOrder,
+                                            vector<Plant*>::const_iterator& firstWithRoom);
+template void PowerGrid::allocateFromPlantsFixed(Demand& demand, const vector<Plant*>& plantOrder,
+                                                 vector<Plant*>::const_iterator& firstWithRoom);
+
+
+//
+// logAllocation():  Prints one allocation of power to a demand location
+//
+void PowerGrid::logAllocation(const Demand& demand, const Plant* plant, const TransLine& line,
+                              double supplied, double rawFromPlant, double sellPrice, double cost) const {
+    if (!allocationLog)
+        return;
+
+    cout << "Allocating: "
+        << std::fixed << std::setprecision(2) << std::setw(6) << supplied
+        << " for " << std::setw(10) << std::left << demand.getLocation()
+        << " Using: " << std::setprecision(2) << std::setw(6) << rawFromPlant
+        << " From " << std::setw(12) << std::left << plant->getName()
+        << " On " << line.getLineID()
+        << ", Sell: $" << std::setprecision(2) << std::setw(11) << sellPrice
+        << " Cost: $" << std::setprecision(2) << std::setw(11) << cost
+        << endl;
+}
+
+
+
 //
 // generateUsageReport(): Print the final simulation report
 //
 void PowerGrid::generateUsageReport(string companyName) {
-    double totalDemandRequested = 0;
-    double totalDemandSupplied = 0;
-    double totalCost = 0;
-    double totalPrice = 0;
+    GridStats stats = computeStats();
     double curCost, curPrice, curProfit;   // Cost, Sell, and Profit of the current demand location
 
     // Print Headings
@@ -136,32 +458,18 @@ void PowerGrid::generateUsageReport(string companyName) {
             << std::setprecision(2) << std::setw(11) << std::right << curCost << " |"
             << std::setprecision(2) << std::setw(11) << std::right << curProfit << " |"
             << endl;
-
-        // Adjust the running totals 
-        totalCost += curCost;
-        totalPrice += curPrice;
-
-        // Collect the total requested and supplied Demand
-        totalDemandRequested += demand.getPowerRequired();
-        totalDemandSupplied += demand.getPowerAcquired();
-    }
-
-    // Loop through the plants and total how much capacity was used.
-    double totalPlantUsage = 0;
-    for (auto plant : plants) {
-        double plantUsage = plant->getMaxCapacity() - plant->getAvailCapacity();
-        totalPlantUsage += plantUsage;
     }
 
+    // The totals come from the aggregated grid statistics
     cout << endl << endl << "Overall Grid Performance:" << endl;
-    cout << "    Total Demand Request:  " << totalDemandRequested << " MW" << endl;
-    cout << "    Total Demand supplied: " << totalDemandSupplied << " MW" << endl;
-    cout << "    Percent of demand met: " << ((totalDemandSupplied / totalDemandRequested) * 100) << "%" << endl;
+    cout << "    Total Demand Request:  " << stats.demands.required.sum() << " MW" << endl;
+    cout << "    Total Demand supplied: " << stats.demands.acquired.sum() << " MW" << endl;
+    cout << "    Percent of demand met: " << stats.demands.percentMet() << "%" << endl;
     cout << endl;
-    cout << "    Plant Capacity used:   " << totalPlantUsage << " MW" << endl;
-    cout << "    Efficiency percentage: " << (totalDemandSupplied / totalPlantUsage) << endl << endl;
-    cout << "    Total Revenue (Price): " << totalPrice << endl;
-    cout << "    Total cost of Power:   " << totalCost << endl;
-    cout << "             Total Profit: " << totalPrice - totalCost << endl;
+    cout << "    Plant Capacity used:   " << stats.plants.usedCapacity.sum() << " MW" << endl;
+    cout << "    Efficiency percentage: " << stats.efficiency() << endl << endl;
+    cout << "    Total Revenue (Price): " << stats.demands.price.sum() << endl;
+    cout << "    Total cost of Power:   " << stats.demands.cost.sum() << endl;
+    cout << "             Total Profit: " << stats.profit() << endl;
 
 }
\ No newline at end of file
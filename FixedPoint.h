@@ -0,0 +1,37 @@
+#pragma once
+// File: FixedPoint.h
+//
+// Contains the integer units used for fixed point accounting of power
+// and money on the grid.
+//
+// Power is counted in kW ticks (0.001 MW) and money in milli-cents
+// (0.00001 dollars).  Line efficiency is held in parts per million.
+// Integer sums are exact and associative, so totals do not depend on the
+// order in which allocations are made or added up.
+//
+#include <cstdint>
+#include <cmath>
+
+typedef int64_t PowerTicks;     // 1 tick = 1 kW
+typedef int64_t MoneyTicks;     // 1 tick = 1 milli-cent
+
+const int64_t POWER_TICKS_PER_MW = 1000;
+const int64_t MONEY_TICKS_PER_DOLLAR = 100000;
+const int64_t EFFICIENCY_SCALE = 1000000;
+
+
+// Conversions between floating point and fixed point units
+inline PowerTicks toPowerTicks(double mw) { return llround(mw * POWER_TICKS_PER_MW); }
+inline MoneyTicks toMoneyTicks(double dollars) { return llround(dollars * MONEY_TICKS_PER_DOLLAR); }
+inline int64_t toEfficiencyPPM(double efficiency) { return llround(efficiency * EFFICIENCY_SCALE); }
+inline double toMW(PowerTicks ticks) { return double(ticks) / POWER_TICKS_PER_MW; }
+inline double toDollars(MoneyTicks ticks) { return double(ticks) / MONEY_TICKS_PER_DOLLAR; }
+
+
+//
+// priceOfPower():  Money for an amount of power at a per MW rate, rounded
+//                  half up to the nearest milli-cent.  Both are non-negative.
+//
+inline MoneyTicks priceOfPower(PowerTicks power, MoneyTicks perMW) {
+    return (power * perMW + POWER_TICKS_PER_MW / 2) / POWER_TICKS_PER_MW;
+}
@@ -0,0 +1,527 @@
+// File: GridDaemon.cpp
+//
+// Contains the function definitions for the grid daemon, its client, and
+// the local latency benchmark.  See GridDaemon.h and GridProtocol.h.
+//
+#include "GridDef.h"
+#include "GridDaemon.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+using namespace std;
+
+const int MAX_EPOLL_EVENTS = 64;
+
+
+//********************************************************
+//*****               Grid Daemon                    *****
+//********************************************************
+
+//
+//  Constructors and Destructors
+//
+GridDaemon::GridDaemon(PowerGrid& grid, const string& socketPath)
+    : grid(grid), socketPath(socketPath), listenFd(-1), epollFd(-1), wakeFd(-1), running(false), readerSlot(-1) {
+}
+
+GridDaemon::~GridDaemon() {
+    if (readerSlot >= 0)
+        grid.getSnapshots().unregisterReader(readerSlot);
+
+    for (auto& conn : connections)
+        close(conn.first);
+
+    if (listenFd >= 0) {
+        close(listenFd);
+        unlink(socketPath.c_str());
+    }
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+
+//
+// start():  Creates the listening socket and the epoll set
+//
+int GridDaemon::start() {
+    sockaddr_un addr = {};
+
+    if (socketPath.size() >= sizeof(addr.sun_path)) {
+        cerr << "Error: Socket path too long " << socketPath << endl;
+        return 1;
+    }
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) {
+        cerr << "Error: Unable to create socket: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // Remove a socket left behind by an earlier run
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(listenFd, SOMAXCONN) < 0) {
+        cerr << "Error: Unable to listen on " << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0) {
+        cerr << "Error: Unable to create epoll set: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    // Queries read the published snapshot, which re-dispatch keeps current
+    readerSlot = grid.getSnapshots().registerReader();
+    if (readerSlot < 0) {
+        cerr << "Error: No snapshot reader slot available" << endl;
+        return 1;
+    }
+    grid.setSnapshotPublishing(true);
+
+    running = true;
+    return 0;
+}
+
+
+//
+// run():  The event loop.  Waits for socket events and handles each one
+//         until the daemon is stopped.
+//
+int GridDaemon::run() {
+    epoll_event events[MAX_EPOLL_EVENTS];
+
+    while (running) {
+        int count = epoll_wait(epollFd, events, MAX_EPOLL_EVENTS, -1);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Error: epoll_wait failed: " << strerror(errno) << endl;
+            return 1;
+        }
+
+        for (int i = 0; i < count && running; i++) {
+            int fd = events[i].data.fd;
+
+            if (fd == wakeFd) {
+                running = false;
+            }
+            else if (fd == listenFd) {
+                acceptConnections();
+            }
+            else {
+                if (events[i].events & EPOLLERR) {
+                    closeClient(fd);
+                    continue;
+                }
+                // A client that hung up may have left requests unread, so
+                // readFromClient() handles those before it closes
+                if (events[i].events & (EPOLLIN | EPOLLHUP))
+                    readFromClient(fd);
+                if (connections.count(fd) && (events[i].events & EPOLLOUT))
+                    writeToClient(fd);
+            }
+        }
+    }
+
+    return 0;
+}
+
+
+//
+// stop():  Wakes the event loop so it exits.  Only writes to the eventfd,
+//          so it can be called from a signal handler.
+//
+void GridDaemon::stop() {
+    uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0) {
+        // Nothing to do - the loop is already being woken
+    }
+}
+
+
+//
+// acceptConnections():  Accepts every pending client
+//
+void GridDaemon::acceptConnections() {
+    int fd;
+
+    while ((fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev);
+        connections[fd] = Connection();
+    }
+}
+
+
+//
+// readFromClient():  Reads what is available, handles every complete
+//                    request, and starts writing the responses.  If the
+//                    client has hung up, the requests it sent are still
+//                    handled, and then the connection is closed without
+//                    answering.
+//
+void GridDaemon::readFromClient(int fd) {
+    Connection& conn = connections[fd];
+    char buffer[4096];
+    ssize_t n;
+
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        conn.input.append(buffer, n);
+
+    bool hungUp = n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+
+    // Handle each complete request in the buffer
+    size_t pos = 0;
+    while (conn.input.size() - pos >= sizeof(RequestHeader)) {
+        RequestHeader request;
+        memcpy(&request, conn.input.data() + pos, sizeof(request));
+
+        size_t frameSize = sizeof(request.length) + request.length;
+        if (request.length < sizeof(RequestHeader) - sizeof(request.length) ||
+            frameSize != sizeof(RequestHeader) + request.nameLength) {
+            appendResponse(conn, GS_BAD_REQUEST, {});
+            conn.closeAfterWrite = true;
+            pos = conn.input.size();
+            break;
+        }
+        if (conn.input.size() - pos < frameSize)
+            break;
+
+        string name(conn.input.data() + pos + sizeof(RequestHeader), request.nameLength);
+        handleRequest(request, name, conn);
+        pos += frameSize;
+    }
+    conn.input.erase(0, pos);
+
+    if (hungUp) {
+        closeClient(fd);
+        return;
+    }
+    writeToClient(fd);
+}
+
+
+//
+// writeToClient():  Writes pending responses.  If the socket is full the
+//                   connection also waits for EPOLLOUT.  A client that
+//                   has gone (EPIPE, ECONNRESET) is closed; send() with
+//                   MSG_NOSIGNAL keeps that from raising SIGPIPE.
+//
+void GridDaemon::writeToClient(int fd) {
+    Connection& conn = connections[fd];
+
+    while (conn.outputSent < conn.output.size()) {
+        ssize_t n = send(fd, conn.output.data() + conn.outputSent, conn.output.size() - conn.outputSent,
+                         MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            closeClient(fd);
+            return;
+        }
+        conn.outputSent += n;
+    }
+
+    // Drop what was written once all of it is, or once it is most of the
+    // buffer, so a large response is not shifted down on every write
+    bool done = conn.outputSent == conn.output.size();
+    if (done || conn.outputSent > conn.output.size() / 2) {
+        conn.output.erase(0, conn.outputSent);
+        conn.outputSent = 0;
+    }
+
+    if (done && conn.closeAfterWrite) {
+        closeClient(fd);
+        return;
+    }
+
+    epoll_event ev = {};
+    ev.events = done ? EPOLLIN : (EPOLLIN | EPOLLOUT);
+    ev.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+
+//
+// closeClient():  Forgets and closes a client connection
+//
+void GridDaemon::closeClient(int fd) {
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections.erase(fd);
+}
+
+
+//
+// handleRequest():  Carries out one request against the grid
+//
+void GridDaemon::handleRequest(const RequestHeader& request, const string& name, Connection& conn) {
+    switch (request.opcode) {
+
+    case OP_PLANT_STATE: {
+        SnapshotGuard snapshot(grid.getSnapshots(), readerSlot);
+        const PlantState* plant = snapshot->findPlant(name);
+        if (!plant) {
+            appendResponse(conn, GS_NOT_FOUND, {});
+            break;
+        }
+        appendResponse(conn, GS_OK, { plant->maxCapacity, plant->curCapacity,
+            plant->availCapacity, plant->costPerMW });
+        break;
+    }
+
+    case OP_DEMAND_STATE: {
+        SnapshotGuard snapshot(grid.getSnapshots(), readerSlot);
+        const DemandState* demand = snapshot->findDemand(name);
+        if (!demand) {
+            appendResponse(conn, GS_NOT_FOUND, {});
+            break;
+        }
+        appendResponse(conn, GS_OK, { demand->required, demand->acquired,
+            demand->deficit, demand->price, demand->cost });
+        break;
+    }
+
+    case OP_UPDATE_DEMAND: {
+        if (!isfinite(request.value) || request.value < 0) {
+            appendResponse(conn, GS_BAD_REQUEST, {});
+            break;
+        }
+        if (grid.setDemandRequired(name, request.value)) {
+            appendResponse(conn, GS_NOT_FOUND, {});
+            break;
+        }
+        appendResponse(conn, GS_OK, {});
+        break;
+    }
+
+    case OP_REDISPATCH:
+        grid.redispatch();
+        appendResponse(conn, GS_OK, {});
+        break;
+
+    case OP_REPORT_TOTALS: {
+        SnapshotGuard snapshot(grid.getSnapshots(), readerSlot);
+        const GridStats& stats = snapshot->stats;
+        appendResponse(conn, GS_OK, { stats.demands.required.sum(), stats.demands.acquired.sum(),
+            stats.demands.percentMet(), stats.plants.usedCapacity.sum(),
+            stats.demands.price.sum(), stats.demands.cost.sum(), stats.profit() });
+        break;
+    }
+
+    case OP_SHUTDOWN:
+        appendResponse(conn, GS_OK, {});
+        conn.closeAfterWrite = true;
+        stop();
+        break;
+
+    default:
+        appendResponse(conn, GS_BAD_REQUEST, {});
+        break;
+    }
+}
+
+
+//
+// appendResponse():  Encodes a response onto the connection's output
+//
+void GridDaemon::appendResponse(Connection& conn, uint8_t status, const vector<double>& values) {
+    ResponseHeader header;
+    header.status = status;
+    header.valueCount = uint8_t(values.size());
+    header.length = uint16_t(sizeof(ResponseHeader) - sizeof(header.length) + values.size() * sizeof(double));
+
+    conn.output.append((const char*)&header, sizeof(header));
+    conn.output.append((const char*)values.data(), values.size() * sizeof(double));
+}
+
+
+
+//********************************************************
+//*****               Grid Client                    *****
+//********************************************************
+
+GridClient::GridClient() : fd(-1) {}
+
+GridClient::~GridClient() {
+    if (fd >= 0) close(fd);
+}
+
+
+//
+// connectTo():  Connects to a daemon's socket
+//
+int GridClient::connectTo(const string& socketPath) {
+    sockaddr_un addr = {};
+
+    if (socketPath.size() >= sizeof(addr.sun_path))
+        return 1;
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socketPath.c_str());
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        cerr << "Error: Unable to connect to " << socketPath << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+//
+// Support functions for blocking I/O of a whole buffer
+//
+static bool writeAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, char* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, data, size);
+        if (n <= 0) {
+            if (n < 0 && errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+
+//
+// request():  Sends one request and reads its response
+//
+int GridClient::request(uint8_t opcode, const string& name, double value, vector<double>& values) {
+    char frame[sizeof(RequestHeader) + MAX_NAME_LENGTH];
+    RequestHeader header;
+    size_t nameLength = min(name.size(), MAX_NAME_LENGTH);
+
+    header.opcode = opcode;
+    header.nameLength = uint8_t(nameLength);
+    header.value = value;
+    header.length = uint16_t(sizeof(RequestHeader) - sizeof(header.length) + nameLength);
+    memcpy(frame, &header, sizeof(header));
+    memcpy(frame + sizeof(header), name.data(), nameLength);
+
+    if (!writeAll(fd, frame, sizeof(header) + nameLength))
+        return -1;
+
+    ResponseHeader response;
+    if (!readAll(fd, (char*)&response, sizeof(response)) || response.valueCount > MAX_RESPONSE_VALUES)
+        return -1;
+
+    values.resize(response.valueCount);
+    if (!readAll(fd, (char*)values.data(), values.size() * sizeof(double)))
+        return -1;
+
+    return response.status;
+}
+
+
+
+//********************************************************
+//*****            Latency Benchmark                 *****
+//********************************************************
+
+//
+// runDaemonBenchmark():  Serves the grid from a daemon thread and times a
+//      mix of requests from a client in this process.  Most requests are
+//      state queries; every 100th request changes a demand and every
+//      1000th re-dispatches the grid.
+//
+int runDaemonBenchmark(PowerGrid& grid, int requestCount) {
+    string socketPath = "/tmp/powergrid_bench_" + to_string(getpid()) + ".sock";
+
+    GridDaemon daemon(grid, socketPath);
+    if (daemon.start())
+        return 1;
+    thread server([&daemon]() { daemon.run(); });
+
+    GridClient client;
+    if (client.connectTo(socketPath)) {
+        daemon.stop();
+        server.join();
+        return 1;
+    }
+
+    vector<Plant*> plantList = grid.getPlantList();
+    GridStats stats = grid.computeStats();
+    vector<double> values;
+    vector<double> latency;
+    latency.reserve(requestCount);
+
+    for (int i = 0; i < requestCount; i++) {
+        auto begin = chrono::steady_clock::now();
+
+        int rc;
+        if (i % 1000 == 999)
+            rc = client.request(OP_REDISPATCH, "", 0, values);
+        else if (i % 100 == 99)
+            rc = client.request(OP_UPDATE_DEMAND, "Detroit", 1400 + (i % 200), values);
+        else if (i % 10 == 9)
+            rc = client.request(OP_REPORT_TOTALS, "", 0, values);
+        else
+            rc = client.request(OP_PLANT_STATE, plantList[i % plantList.size()]->getName(), 0, values);
+
+        latency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count());
+        if (rc < 0) {
+            cerr << "Error: Request " << i << " failed" << endl;
+            break;
+        }
+    }
+
+    client.request(OP_SHUTDOWN, "", 0, values);
+    server.join();
+
+    if (latency.empty())
+        return 1;
+
+    // Print the latency distribution
+    double total = 0;
+    for (double l : latency) total += l;
+    sort(latency.begin(), latency.end());
+
+    cout << "\n\t--- Daemon Latency Benchmark (" << latency.size() << " requests, "
+         << stats.plants.count << " plants) ---\n";
+    cout << std::fixed << std::setprecision(2);
+    cout << "    Mean:   " << setw(10) << total / latency.size() << " us" << endl;
+    cout << "    Min:    " << setw(10) << latency.front() << " us" << endl;
+    cout << "    p50:    " << setw(10) << latency[latency.size() / 2] << " us" << endl;
+    cout << "    p99:    " << setw(10) << latency[latency.size() * 99 / 100] << " us" << endl;
+    cout << "    Max:    " << setw(10) << latency.back() << " us" << endl;
+    cout << "    Rate:   " << setw(10) << latency.size() / (total / 1e6) << " requests/sec" << endl;
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+#pragma once
+// File: GridDaemon.h
+//
+// Contains class definitions for the grid daemon and its client.
+//
+// The daemon keeps a loaded PowerGrid resident and answers requests on a
+// Unix domain socket using the binary protocol in GridProtocol.h.  Socket
+// I/O is event driven: one thread waits on epoll for new connections,
+// readable requests, and writable responses, and never blocks on a single
+// client.  Queries are answered from the grid's last published snapshot,
+// so they see the state of the last complete dispatch.
+//
+// GridClient is a small blocking client used by tools and by the latency
+// benchmark, which runs the daemon and the client in the same process.
+//
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include "PowerGrid.h"
+#include "GridProtocol.h"
+using namespace std;
+
+//
+// Class GridDaemon
+//
+class GridDaemon {
+private:
+    // Buffered I/O for one client connection
+    struct Connection {
+        string  input;          // Bytes received but not yet processed
+        string  output;         // Responses, written up to outputSent
+        size_t  outputSent = 0;
+        bool    closeAfterWrite = false;
+    };
+
+    PowerGrid&          grid;
+    string              socketPath;
+    int                 listenFd;
+    int                 epollFd;
+    int                 wakeFd;         // eventfd used by stop() to wake the loop
+    atomic<bool>        running;
+    int                 readerSlot;     // Slot in the grid's snapshot domain
+    map<int, Connection> connections;
+
+    // Support functions for the event loop
+    void acceptConnections();
+    void readFromClient(int fd);
+    void writeToClient(int fd);
+    void closeClient(int fd);
+    void handleRequest(const RequestHeader& request, const string& name, Connection& conn);
+    void appendResponse(Connection& conn, uint8_t status, const vector<double>& values);
+
+public:
+    // Constructors & Destructors
+    GridDaemon(PowerGrid& grid, const string& socketPath);
+    ~GridDaemon();
+
+    int start();            // Creates the socket; returns 1 on failure
+    int run();              // Serves requests until stop() or OP_SHUTDOWN
+    void stop();            // Safe to call from another thread or a signal handler
+};
+
+
+//
+// Class GridClient
+//
+class GridClient {
+private:
+    int fd;
+
+public:
+    GridClient();
+    ~GridClient();
+
+    int connectTo(const string& socketPath);    // Returns 1 on failure
+
+    // Sends one request and waits for its response.  Returns the response
+    // status, or -1 if the connection failed.
+    int request(uint8_t opcode, const string& name, double value, vector<double>& values);
+};
+
+
+// Starts a daemon on a private socket, sends requestCount requests to it,
+// and prints the latency distribution.
+int runDaemonBenchmark(PowerGrid& grid, int requestCount);
@@ -4,6 +4,7 @@
 //
 // This file contains the constants and sizing parameters for the PowerGrid 
 #include <string>
+#include <cstdint>
 using namespace std;
 
 
@@ -14,6 +15,8 @@ const string GRID_NAME = "Energy Grid";
 const string PLANTS_FILE = "Plants.txt";
 const string DEMANDS_FILE = "Demands.txt";
 const string TRANSLINES_FILE = "TransLines.dat";
+const string TOPOLOGY_FILE = "Topology.txt";     // Optional, for DC power flow
+const string AREAS_FILE = "Areas.txt";           // Optional, for multi-area dispatch
 const string REPORT_FILE = "PowerGrid_Report.txt";
 
 // Plant information - used to determine plant type and read plant data file
@@ -25,9 +28,135 @@ const string PT_NUCLEAR = "Nuclear";
 const string PT_GEO_THERMAL = "GeoTherm";
 const string PT_FUSION = "Fusion";
 const string PT_DILITHIUM = "Dilithium";
+const string PT_STORAGE = "Storage";    // Battery: energy MWh and round trip % as the specific fields
+const string PT_TIE = "Tie";            // Import from another area, never in the plants file
 
 
 // Constansts used by Transmission line
 const int	MAX_LINE_CONNECTIONS = 4;
 
 
+// Sorting thresholds used by GridOrder: collections at least this large are
+// radix sorted, and the largest are radix sorted in parallel chunks.
+const size_t RADIX_SORT_THRESHOLD = 4096;
+const size_t PARALLEL_SORT_THRESHOLD = 1 << 20;
+
+
+// Default weight for the hybrid dispatch score.  A plant's cost per MW is
+// scaled by (1 + weight * (100 - sustain) / 100).
+const double HYBRID_SUSTAIN_WEIGHT = 1.0;
+
+
+// Collections smaller than this are summarized on one thread by GridStats
+const size_t STATS_PARALLEL_THRESHOLD = 65536;
+
+
+// Default Unix domain socket for the grid daemon
+const string DAEMON_SOCKET = "/tmp/powergrid.sock";
+
+
+// Snapshot publication: reader threads that can hold a snapshot at once,
+// and retired snapshots the writer may keep before waiting for readers.
+const int    MAX_SNAPSHOT_READERS = 64;
+const size_t MAX_RETIRED_SNAPSHOTS = 8;
+
+
+// Plants updated per task when conditions are applied in parallel
+const size_t PLANT_UPDATE_GRAIN = 4096;
+
+
+// Events the discrete event engine reserves room for when it is created
+const size_t EVENT_POOL_RESERVE = 1 << 16;
+
+
+// Condition time series: the most condition parameters a plant type has,
+// and the steps held in each memory mapped window of a series file
+const int    MAX_CONDITION_PARAMS = 2;
+const uint32_t CONDITION_WINDOW_STEPS = 1024;
+
+
+// Battery storage: the fraction of its energy capacity a storage plant
+// holds when it is read, and the step its output is for until the first
+// PowerGrid::stepStorage()
+const double STORAGE_INITIAL_CHARGE = 0.5;
+const double STORAGE_STEP_HOURS = 1.0;
+
+
+// Results files: steps encoded together in one block, and full blocks the
+// simulation may queue before it waits for the writer thread
+const uint32_t RESULTS_BLOCK_STEPS = 4096;
+const size_t   RESULTS_MAX_PENDING_BLOCKS = 2;
+
+
+// Memory the daemon gives its dispatch result cache
+const size_t DISPATCH_CACHE_BUDGET = 64 << 20;
+
+
+// Zone level dispatch: width in $ per MW hour of the retail price bands
+// that group demand locations, and the most locations in one zone
+const double ZONE_PRICE_BAND = 10.0;
+const size_t ZONE_MAX_LOCATIONS = 1024;
+
+
+// Carbon capped dispatch: the most dispatch passes the carbon price search
+// makes, and how far under the cap its emissions may settle
+const int    CARBON_MAX_PASSES = 8;
+const double CARBON_CAP_TOLERANCE = 0.01;
+
+
+// Multi-area dispatch: the most price exchange rounds between the areas,
+// the tie flow change (MW) below which the exchange has converged, and how
+// much a tie's step grows while its flow keeps moving the same way
+const int    AREA_MAX_ROUNDS = 100;
+const double AREA_FLOW_TOLERANCE = 0.5;
+const double AREA_STEP_GROWTH = 1.5;
+
+
+// Sharded trials: the chance a plant is forced out in a trial, how far a
+// location's requirement may stray from its base, result slots in each
+// worker's ring, how long an idle coordinator or a worker with a full ring
+// sleeps (microseconds), and trials the benchmark repeats in process
+const double   SHARD_OUTAGE_RATE = 0.05;
+const double   SHARD_DEMAND_SPREAD = 0.1;
+const uint32_t SHARD_RING_SLOTS = 1024;
+const int      SHARD_POLL_US = 50;
+const uint64_t SHARD_CHECK_TRIALS = 16;
+
+
+// Monitor export: the shared memory segment the daemon exports its live
+// state to, and the copies a reader tries before giving up on a frame
+const string MONITOR_SEGMENT = "/powergrid-monitor";
+const int    MONITOR_READ_RETRIES = 1000;
+
+
+// Hot reload: how long the watch waits for a file to stop changing before
+// it reloads it (milliseconds)
+const int    RELOAD_SETTLE_MS = 50;
+
+
+// Unit commitment of thermal plants.  For fossil and nuclear plants: the
+// lowest stable output and the ramp rate per hour as fractions of
+// capacity, the fewest hours on once started and off once stopped, and
+// the cost of a start per MW of capacity.
+const double UC_FOSSIL_MIN_OUTPUT = 0.30;
+const double UC_FOSSIL_RAMP = 0.25;
+const int    UC_FOSSIL_MIN_UP = 4;
+const int    UC_FOSSIL_MIN_DOWN = 4;
+const double UC_FOSSIL_STARTUP_COST = 60.0;
+const double UC_NUCLEAR_MIN_OUTPUT = 0.50;
+const double UC_NUCLEAR_RAMP = 0.05;
+const int    UC_NUCLEAR_MIN_UP = 24;
+const int    UC_NUCLEAR_MIN_DOWN = 48;
+const double UC_NUCLEAR_STARTUP_COST = 400.0;
+
+// Rolling horizon: hours committed by each window and hours it looks
+// ahead past them, the capacity held above the load, the cost of load
+// that cannot be served ($ per MWh), improvement passes over a window,
+// and the most rounds the parallel solve re-solves windows whose start
+// state moved
+const size_t UC_COMMIT_HOURS = 24;
+const size_t UC_LOOKAHEAD_HOURS = 24;
+const double UC_RESERVE_MARGIN = 0.05;
+const double UC_UNSERVED_COST = 10000.0;
+const int    UC_MAX_PASSES = 4;
+const int    UC_MAX_ROUNDS = 4;
@@ -0,0 +1,367 @@
+// File: GridEvents.cpp
+//
+// Contains the function definitions for the discrete event engine and its
+// benchmark.  See GridEvents.h.
+//
+#include "GridEvents.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+using namespace std;
+
+
+//
+//  Constructors and Destructors
+//
+GridEvents::GridEvents(PowerGrid& grid, size_t reserve) : grid(grid) {
+    pool.reserve(reserve);
+    freeSlots.reserve(reserve);
+    calendar.reserve(reserve);
+}
+
+
+//
+// Accessors
+//
+double GridEvents::getTime() const { return currentTime; }
+size_t GridEvents::getPendingCount() const { return calendar.size(); }
+uint64_t GridEvents::getEventsApplied() const { return eventsApplied; }
+uint64_t GridEvents::getEventsChanged() const { return eventsChanged; }
+uint64_t GridEvents::getTimestamps() const { return timestamps; }
+uint64_t GridEvents::getDispatches() const { return dispatches; }
+
+
+
+//********************************************************
+//*****              Event Calendar                  *****
+//********************************************************
+
+//
+// earlier():  Orders events by time, then by the order they were scheduled
+//
+bool GridEvents::earlier(const CalendarEntry& a, const CalendarEntry& b) {
+    if (a.time != b.time)
+        return a.time < b.time;
+    return a.sequence < b.sequence;
+}
+
+void GridEvents::siftUp(size_t pos) {
+    CalendarEntry item = calendar[pos];
+    while (pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if (!earlier(item, calendar[parent]))
+            break;
+        calendar[pos] = calendar[parent];
+        pos = parent;
+    }
+    calendar[pos] = item;
+}
+
+void GridEvents::siftDown(size_t pos) {
+    CalendarEntry item = calendar[pos];
+    size_t count = calendar.size();
+
+    while (true) {
+        size_t child = 2 * pos + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count && earlier(calendar[child + 1], calendar[child]))
+            child++;
+        if (!earlier(calendar[child], item))
+            break;
+        calendar[pos] = calendar[child];
+        pos = child;
+    }
+    calendar[pos] = item;
+}
+
+
+//
+// allocateEvent():  Reuses a free pool entry, growing the pool only when
+//                   every entry is pending
+//
+uint32_t GridEvents::allocateEvent() {
+    if (!freeSlots.empty()) {
+        uint32_t slot = freeSlots.back();
+        freeSlots.pop_back();
+        return slot;
+    }
+
+    pool.emplace_back();
+    if (freeSlots.capacity() < pool.size())
+        freeSlots.reserve(pool.capacity());
+    return uint32_t(pool.size() - 1);
+}
+
+void GridEvents::push(const GridEvent& event) {
+    uint32_t slot = allocateEvent();
+    pool[slot] = event;
+
+    calendar.push_back({ event.time, nextSequence++, slot });
+    siftUp(calendar.size() - 1);
+}
+
+uint32_t GridEvents::popEarliest() {
+    uint32_t slot = calendar.front().slot;
+    calendar.front() = calendar.back();
+    calendar.pop_back();
+    if (!calendar.empty())
+        siftDown(0);
+    return slot;
+}
+
+
+
+//********************************************************
+//*****              Scheduling Events               *****
+//********************************************************
+
+//
+// schedule():  Resolves the target by name and schedules the event
+//
+int GridEvents::schedule(double time, EventKind kind, const string& target, double value) {
+    switch (kind) {
+    case EV_PLANT_TRIP:
+    case EV_PLANT_RESTORE:
+    case EV_WEATHER: {
+        Plant* plant = grid.findPlant(target);
+        if (plant) return schedule(time, kind, plant, value);
+        break;
+    }
+    case EV_DEMAND_STEP: {
+        Demand* demand = grid.findDemand(target);
+        if (demand) return schedule(time, kind, demand, value);
+        break;
+    }
+    case EV_LINE_DERATE: {
+        TransLine* line = grid.findTransLine(target);
+        if (line) return schedule(time, kind, line, value);
+        break;
+    }
+    default:
+        break;
+    }
+
+    cerr << "Error: No target " << target << " for event" << endl;
+    return 1;
+}
+
+int GridEvents::schedule(double time, EventKind kind, Plant* plant, double value) {
+    if (time < currentTime || (kind != EV_PLANT_TRIP && kind != EV_PLANT_RESTORE && kind != EV_WEATHER)) {
+        cerr << "Error: Invalid plant event" << endl;
+        return 1;
+    }
+
+    GridEvent event;
+    event.time = time;
+    event.kind = kind;
+    event.value = value;
+    event.plant = plant;
+    push(event);
+    return 0;
+}
+
+int GridEvents::schedule(double time, EventKind kind, Demand* demand, double value) {
+    if (time < currentTime || kind != EV_DEMAND_STEP || value < 0) {
+        cerr << "Error: Invalid demand event" << endl;
+        return 1;
+    }
+
+    GridEvent event;
+    event.time = time;
+    event.kind = kind;
+    event.value = value;
+    event.demand = demand;
+    push(event);
+    return 0;
+}
+
+int GridEvents::schedule(double time, EventKind kind, TransLine* line, double value) {
+    if (time < currentTime || kind != EV_LINE_DERATE || value < 0 || value > 1) {
+        cerr << "Error: Invalid line event" << endl;
+        return 1;
+    }
+
+    GridEvent event;
+    event.time = time;
+    event.kind = kind;
+    event.value = value;
+    event.line = line;
+    push(event);
+    return 0;
+}
+
+
+
+//********************************************************
+//*****              Running Events                  *****
+//********************************************************
+
+//
+// apply():  Changes the target of an event.  Returns false when the event
+//           leaves the grid as it was, so no re-dispatch is needed for it.
+//
+bool GridEvents::apply(const GridEvent& event) {
+    switch (event.kind) {
+    case EV_PLANT_TRIP:
+        if (!event.plant->isOnline())
+            return false;
+        event.plant->setOnline(false);
+        event.plant->calculateOutput();
+        return true;
+
+    case EV_PLANT_RESTORE:
+        if (event.plant->isOnline())
+            return false;
+        event.plant->setOnline(true);
+        event.plant->calculateOutput();
+        return true;
+
+    case EV_WEATHER:
+        // A tripped plant picks up the new conditions when it is restored
+        if (event.plant->getUptimePercent() == event.value)
+            return false;
+        event.plant->setUptimePercent(event.value);
+        if (!event.plant->isOnline())
+            return false;
+        event.plant->calculateOutput();
+        return true;
+
+    case EV_LINE_DERATE:
+        if (event.line->getDerateFactor() == event.value)
+            return false;
+        event.line->derate(event.value);
+        return true;
+
+    case EV_DEMAND_STEP:
+        if (event.demand->getPowerRequired() == event.value)
+            return false;
+        grid.setDemandRequired(event.demand->getLocation(), event.value);
+        return true;
+
+    default:
+        assert(0);
+        return false;
+    }
+}
+
+
+//
+// runUntil():  Runs the calendar one timestamp at a time.  Every event at
+//              a timestamp is applied before the single re-dispatch.
+//
+size_t GridEvents::runUntil(double endTime) {
+    size_t count = 0;
+
+    while (!calendar.empty() && calendar.front().time <= endTime) {
+        currentTime = calendar.front().time;
+        timestamps++;
+
+        bool changed = false;
+        while (!calendar.empty() && calendar.front().time == currentTime) {
+            uint32_t slot = popEarliest();
+            if (apply(pool[slot])) {
+                changed = true;
+                eventsChanged++;
+            }
+            freeSlots.push_back(slot);
+            count++;
+        }
+
+        if (changed) {
+            grid.redispatch();
+            dispatches++;
+        }
+    }
+
+    if (endTime > currentTime)
+        currentTime = endTime;
+    eventsApplied += count;
+    return count;
+}
+
+size_t GridEvents::runAll() {
+    size_t count = 0;
+    while (!calendar.empty())
+        count += runUntil(calendar.front().time);
+    return count;
+}
+
+
+
+//********************************************************
+//*****              Event Benchmark                 *****
+//********************************************************
+
+//
+// runEventBenchmark():  Schedules a random mix of every event kind over
+//      one timestamp per thousand events, then runs the calendar
+//
+int runEventBenchmark(PowerGrid& grid, size_t eventCount) {
+    // Resolve the components once so scheduling does no name lookups
+    vector<Plant*> plants = grid.getPlantList();
+    vector<Demand*> demands;
+    vector<double> required;
+    vector<TransLine*> lines;
+    {
+        unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+        for (auto& demand : state->demands) {
+            demands.push_back(grid.findDemand(demand.location));
+            required.push_back(demand.required);
+        }
+        for (auto& line : state->lines)
+            lines.push_back(grid.findTransLine(line.lineID));
+    }
+    if (plants.empty() || demands.empty() || lines.empty()) {
+        cerr << "Error: The event benchmark needs plants, demands, and lines" << endl;
+        return 1;
+    }
+
+    GridEvents events(grid, eventCount);
+    mt19937 rng(1);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    size_t timestampCount = max<size_t>(1, eventCount / 1000);
+
+    auto start = chrono::steady_clock::now();
+    for (size_t i = 0; i < eventCount; i++) {
+        double time = double(rng() % timestampCount);
+        size_t pick = rng();
+
+        switch (i % EV_COUNT) {
+        case EV_PLANT_TRIP:
+            events.schedule(time, EV_PLANT_TRIP, plants[pick % plants.size()]);
+            break;
+        case EV_PLANT_RESTORE:
+            events.schedule(time, EV_PLANT_RESTORE, plants[pick % plants.size()]);
+            break;
+        case EV_WEATHER:
+            events.schedule(time, EV_WEATHER, plants[pick % plants.size()], 80 + 20 * unit(rng));
+            break;
+        case EV_LINE_DERATE:
+            events.schedule(time, EV_LINE_DERATE, lines[pick % lines.size()], 0.5 + 0.5 * unit(rng));
+            break;
+        case EV_DEMAND_STEP:
+            pick %= demands.size();
+            events.schedule(time, EV_DEMAND_STEP, demands[pick], required[pick] * (0.8 + 0.4 * unit(rng)));
+            break;
+        default:
+            break;
+        }
+    }
+    double scheduleTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    size_t run = events.runAll();
+    double runTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "\n\t--- Event Engine Benchmark ---\n";
+    cout << std::fixed << std::setprecision(0);
+    cout << "    Events scheduled:    " << eventCount << " (" << eventCount / scheduleTime << "/sec)" << endl;
+    cout << "    Events run:          " << run << " (" << run / runTime << "/sec, re-dispatch included)" << endl;
+    cout << "    Events that changed: " << events.getEventsChanged() << endl;
+    cout << "    Timestamps:          " << events.getTimestamps() << endl;
+    cout << "    Re-dispatches:       " << events.getDispatches() << endl;
+
+    return (run == eventCount) ? 0 : 1;
+}
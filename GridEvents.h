@@ -0,0 +1,109 @@
+#pragma once
+// File: GridEvents.h
+//
+// Contains class definition for GridEvents, a discrete event engine that
+// changes the grid over simulated time.
+//
+// Events are kept on a calendar ordered by timestamp; events with the same
+// timestamp run in the order they were scheduled.  All events at one
+// timestamp are applied together and the grid is re-dispatched once
+// afterwards, and only if one of them actually changed the grid.
+//
+// Events are plain records held in a pool and reused through a free list.
+// The calendar is a binary heap of (time, order, pool index) entries, so
+// ordering never touches the pool, and once the pool has grown to the
+// largest number of pending events no event allocates memory.
+//
+// The engine refers to plants, demands, and lines directly.  Components
+// must not be added, removed, or sorted while events are pending.
+//
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "PowerGrid.h"
+using namespace std;
+
+// Kinds of events and the meaning of their value
+enum EventKind : uint8_t {
+    EV_PLANT_TRIP,          // Plant goes offline
+    EV_PLANT_RESTORE,       // Plant comes back online
+    EV_WEATHER,             // Plant operating conditions; value = uptime percent
+    EV_LINE_DERATE,         // Line limit; value = fraction of rated capacity
+    EV_DEMAND_STEP,         // Demand requirement; value = MW required
+    EV_COUNT
+};
+
+
+//
+// Class GridEvents
+//
+class GridEvents {
+private:
+    // One scheduled event.  The target type follows from the kind.
+    struct GridEvent {
+        double      time;
+        double      value;
+        union {
+            Plant*      plant;
+            Demand*     demand;
+            TransLine*  line;
+        };
+        EventKind   kind;
+    };
+
+    // Calendar entry for one pending event
+    struct CalendarEntry {
+        double      time;
+        uint64_t    sequence;       // Scheduling order, breaks timestamp ties
+        uint32_t    slot;           // Event in the pool
+    };
+
+    PowerGrid&              grid;
+    vector<GridEvent>       pool;
+    vector<uint32_t>        freeSlots;      // Pool entries not in use
+    vector<CalendarEntry>   calendar;       // Heap, earliest first
+    uint64_t            nextSequence = 0;
+    double              currentTime = 0;
+
+    // Counters
+    uint64_t            eventsApplied = 0;
+    uint64_t            eventsChanged = 0;  // Events that changed the grid
+    uint64_t            timestamps = 0;
+    uint64_t            dispatches = 0;
+
+    // Support functions for the calendar
+    static bool earlier(const CalendarEntry& a, const CalendarEntry& b);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    uint32_t allocateEvent();
+    void push(const GridEvent& event);
+    uint32_t popEarliest();
+    bool apply(const GridEvent& event);    // Returns true if the grid changed
+
+public:
+    // Constructors & Destructors
+    GridEvents(PowerGrid& grid, size_t reserve = EVENT_POOL_RESERVE);
+
+    // Schedules an event for the named plant, demand location, or line.
+    // Returns 1 if the target does not exist or the time is in the past.
+    int schedule(double time, EventKind kind, const string& target, double value = 0);
+    int schedule(double time, EventKind kind, Plant* plant, double value = 0);
+    int schedule(double time, EventKind kind, Demand* demand, double value = 0);
+    int schedule(double time, EventKind kind, TransLine* line, double value = 0);
+
+    // Runs every event up to and including endTime and returns the number run
+    size_t runUntil(double endTime);
+    size_t runAll();
+
+    // Accessors
+    double getTime() const;
+    size_t getPendingCount() const;
+    uint64_t getEventsApplied() const;
+    uint64_t getEventsChanged() const;
+    uint64_t getTimestamps() const;
+    uint64_t getDispatches() const;
+};
+
+
+// Schedules eventCount random events against the grid and times the run
+int runEventBenchmark(PowerGrid& grid, size_t eventCount);
@@ -0,0 +1,598 @@
+// File: GridMonitor.cpp
+//
+// Contains the function definitions for the monitor export, the monitor
+// reader, the grid's publication to monitors, and the demo reader and
+// benchmark.  See GridMonitor.h.
+//
+#include "GridMonitor.h"
+#include "PowerGrid.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+using namespace std;
+
+const char MONITOR_MAGIC[8] = { 'P', 'G', 'M', 'O', 'N', '1', 0, 0 };
+
+// Deficit (MW) below which a location counts as served
+const double MONITOR_SHORT_TOLERANCE = 1e-6;
+
+
+//********************************************************
+//*****              Monitor Export                  *****
+//********************************************************
+
+MonitorExport::~MonitorExport() {
+    close();
+}
+
+
+//
+// Accessors
+//
+MonitorHeader& MonitorExport::header() { return *reinterpret_cast<MonitorHeader*>(base); }
+MonitorPlant* MonitorExport::getPlants() { return reinterpret_cast<MonitorPlant*>(base + header().plantOffset); }
+MonitorDemand* MonitorExport::getDemands() { return reinterpret_cast<MonitorDemand*>(base + header().demandOffset); }
+MonitorLine* MonitorExport::getLines() { return reinterpret_cast<MonitorLine*>(base + header().lineOffset); }
+bool MonitorExport::isOpen() const { return base != nullptr; }
+const string& MonitorExport::getName() const { return segmentName; }
+uint64_t MonitorExport::getPublishCount() const { return publishCount; }
+
+
+//
+// create():  Lays out the records and names in a new segment.  The old
+//            segment, if any, is marked moved only once the new one is
+//            complete, so a reader that follows it finds a valid segment.
+//
+int MonitorExport::create(const string& name, const vector<string>& plantNames,
+                          const vector<string>& demandLocations, const vector<string>& lineIDs) {
+    MonitorHeader head;
+    memset(static_cast<void*>(&head), 0, sizeof(head));
+    head.layoutVersion = MONITOR_LAYOUT_VERSION;
+    head.plantCount = uint32_t(plantNames.size());
+    head.demandCount = uint32_t(demandLocations.size());
+    head.lineCount = uint32_t(lineIDs.size());
+    head.generation = generation + 1;
+    head.plantOffset = sizeof(MonitorHeader);
+    head.demandOffset = head.plantOffset + plantNames.size() * sizeof(MonitorPlant);
+    head.lineOffset = head.demandOffset + demandLocations.size() * sizeof(MonitorDemand);
+    head.stringOffset = head.lineOffset + lineIDs.size() * sizeof(MonitorLine);
+
+    string names;
+    auto addText = [&](const string& value) {
+        uint64_t offset = head.stringOffset + names.size();
+        names += value;
+        names += '\0';
+        return offset;
+    };
+
+    vector<uint64_t> plantText, demandText, lineText;
+    for (auto& plantName : plantNames)
+        plantText.push_back(addText(plantName));
+    for (auto& location : demandLocations)
+        demandText.push_back(addText(location));
+    for (auto& lineName : lineIDs)
+        lineText.push_back(addText(lineName));
+    head.totalBytes = head.stringOffset + names.size();
+
+    // Readers of the old segment keep their mapping after the unlink
+    shm_unlink(name.c_str());
+    int newFd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (newFd < 0 || ftruncate(newFd, off_t(head.totalBytes)) < 0) {
+        cerr << "Error: Unable to create shared memory " << name << ": " << strerror(errno) << endl;
+        if (newFd >= 0) {
+            ::close(newFd);
+            shm_unlink(name.c_str());
+        }
+        return 1;
+    }
+
+    size_t newBytes = size_t(head.totalBytes);
+    void* data = mmap(nullptr, newBytes, PROT_READ | PROT_WRITE, MAP_SHARED, newFd, 0);
+    if (data == MAP_FAILED) {
+        cerr << "Error: Unable to map shared memory " << name << ": " << strerror(errno) << endl;
+        ::close(newFd);
+        shm_unlink(name.c_str());
+        return 1;
+    }
+
+    // The segment is zero filled, so readers reject it until the magic is set
+    char* image = static_cast<char*>(data);
+    memcpy(image + sizeof(head.magic), reinterpret_cast<const char*>(&head) + sizeof(head.magic),
+           sizeof(head) - sizeof(head.magic));
+    memcpy(image + head.stringOffset, names.data(), names.size());
+
+    auto plants = reinterpret_cast<MonitorPlant*>(image + head.plantOffset);
+    for (size_t p = 0; p < plantText.size(); p++)
+        plants[p].nameOffset = plantText[p];
+    auto demands = reinterpret_cast<MonitorDemand*>(image + head.demandOffset);
+    for (size_t d = 0; d < demandText.size(); d++)
+        demands[d].locationOffset = demandText[d];
+    auto lines = reinterpret_cast<MonitorLine*>(image + head.lineOffset);
+    for (size_t l = 0; l < lineText.size(); l++)
+        lines[l].lineIDOffset = lineText[l];
+
+    atomic_thread_fence(memory_order_release);
+    memcpy(image, MONITOR_MAGIC, sizeof(MONITOR_MAGIC));
+
+    // The old segment's readers can now follow the name to this one
+    if (base) {
+        segmentName.clear();
+        closeSegment(MONITOR_MOVED);
+    }
+
+    segmentName = name;
+    fd = newFd;
+    base = image;
+    bytes = newBytes;
+    generation = head.generation;
+    return 0;
+}
+
+
+//
+// beginPublish():  Makes the sequence odd, so readers discard anything
+//                  they copy until endPublish()
+//
+void MonitorExport::beginPublish() {
+    MonitorHeader& head = header();
+    uint64_t sequence = head.sequence.load(memory_order_relaxed);
+    head.sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+//
+// endPublish():  Writes the totals and makes the sequence even again
+//
+void MonitorExport::endPublish(const MonitorTotals& totals) {
+    MonitorHeader& head = header();
+    head.totals = totals;
+    head.publishCount = ++publishCount;
+    head.sequence.store(head.sequence.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+
+//
+// closeSegment():  Tells readers why the segment is going away and unmaps it
+//
+void MonitorExport::closeSegment(MonitorStatus status) {
+    if (base) {
+        header().status.store(status, memory_order_release);
+        munmap(base, bytes);
+    }
+    if (fd >= 0)
+        ::close(fd);
+    if (!segmentName.empty())
+        shm_unlink(segmentName.c_str());
+
+    base = nullptr;
+    bytes = 0;
+    fd = -1;
+}
+
+
+void MonitorExport::close() {
+    closeSegment(MONITOR_CLOSED);
+    segmentName.clear();
+}
+
+
+
+//********************************************************
+//*****              Monitor Reader                  *****
+//********************************************************
+
+MonitorReader::~MonitorReader() {
+    close();
+}
+
+
+//
+// Accessors
+//
+const MonitorHeader& MonitorReader::header() const { return *reinterpret_cast<const MonitorHeader*>(base); }
+const char* MonitorReader::plantName(const MonitorPlant& plant) const { return base + plant.nameOffset; }
+const char* MonitorReader::demandLocation(const MonitorDemand& demand) const { return base + demand.locationOffset; }
+const char* MonitorReader::lineID(const MonitorLine& line) const { return base + line.lineIDOffset; }
+uint64_t MonitorReader::getRetries() const { return retries; }
+
+
+int MonitorReader::open(const string& name) {
+    close();
+    segmentName = name;
+    return mapSegment();
+}
+
+
+void MonitorReader::close() {
+    unmapSegment();
+    segmentName.clear();
+}
+
+
+//
+// mapSegment():  Maps the segment now under the name and checks its layout
+//
+int MonitorReader::mapSegment() {
+    fd = shm_open(segmentName.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return 1;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(MonitorHeader)) {
+        bytes = size_t(info.st_size);
+        void* data = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        base = (data == MAP_FAILED) ? nullptr : static_cast<const char*>(data);
+    }
+
+    bool valid = base && memcmp(header().magic, MONITOR_MAGIC, sizeof(MONITOR_MAGIC)) == 0;
+    atomic_thread_fence(memory_order_acquire);
+    valid = valid &&
+        header().layoutVersion == MONITOR_LAYOUT_VERSION &&
+        header().totalBytes <= bytes &&
+        header().plantOffset + uint64_t(header().plantCount) * sizeof(MonitorPlant) <= header().demandOffset &&
+        header().demandOffset + uint64_t(header().demandCount) * sizeof(MonitorDemand) <= header().lineOffset &&
+        header().lineOffset + uint64_t(header().lineCount) * sizeof(MonitorLine) <= header().stringOffset &&
+        header().stringOffset <= header().totalBytes;
+
+    if (!valid) {
+        unmapSegment();
+        return 1;
+    }
+    return 0;
+}
+
+
+void MonitorReader::unmapSegment() {
+    if (base)
+        munmap(const_cast<char*>(base), bytes);
+    if (fd >= 0)
+        ::close(fd);
+    base = nullptr;
+    bytes = 0;
+    fd = -1;
+}
+
+
+//
+// read():  Copies the records out and keeps the copy only if the sequence
+//          was even and unchanged across it.  The writer is never held up.
+//
+int MonitorReader::read(MonitorFrame& frame) {
+    for (int attempt = 0; attempt < MONITOR_READ_RETRIES; attempt++) {
+        if (!base && mapSegment()) {
+            this_thread::yield();
+            continue;
+        }
+
+        uint32_t status = header().status.load(memory_order_acquire);
+        if (status == MONITOR_CLOSED)
+            return 1;
+        if (status == MONITOR_MOVED) {
+            unmapSegment();
+            continue;
+        }
+
+        const MonitorHeader& head = header();
+        uint64_t before = head.sequence.load(memory_order_acquire);
+        if (before & 1) {
+            retries++;
+            this_thread::yield();
+            continue;
+        }
+
+        frame.plants.resize(head.plantCount);
+        frame.demands.resize(head.demandCount);
+        frame.lines.resize(head.lineCount);
+        memcpy(frame.plants.data(), base + head.plantOffset, head.plantCount * sizeof(MonitorPlant));
+        memcpy(frame.demands.data(), base + head.demandOffset, head.demandCount * sizeof(MonitorDemand));
+        memcpy(frame.lines.data(), base + head.lineOffset, head.lineCount * sizeof(MonitorLine));
+        frame.totals = head.totals;
+        frame.publishCount = head.publishCount;
+        frame.generation = head.generation;
+
+        atomic_thread_fence(memory_order_acquire);
+        if (head.sequence.load(memory_order_relaxed) == before)
+            return 0;
+        retries++;
+    }
+    return 1;
+}
+
+
+
+//********************************************************
+//*****        PowerGrid monitor publication         *****
+//********************************************************
+
+//
+// setMonitorExport():  Exports the grid's state to the named segment after
+//                      every dispatch.  An empty name turns the export off.
+//
+int PowerGrid::setMonitorExport(const string& name) {
+    if (name.empty()) {
+        monitorExport.reset();
+        return 0;
+    }
+
+    monitorExport.reset(new MonitorExport);
+    monitorPlantsValid = false;
+    monitorDemandsValid = false;
+    monitorLinesValid = false;
+    monitorName = name;
+    if (layoutMonitor()) {
+        monitorExport.reset();
+        return 1;
+    }
+    publishMonitor();
+    return 0;
+}
+
+
+//
+// layoutMonitor():  Creates a segment for the grid's current components
+//
+int PowerGrid::layoutMonitor() {
+    vector<string> plantNames, demandLocations, lineIDs;
+    plantNames.reserve(plants.size());
+    for (auto plant : plants)
+        plantNames.push_back(plant->getName());
+    demandLocations.reserve(demands.size());
+    for (auto& demand : demands)
+        demandLocations.push_back(demand.getLocation());
+    lineIDs.reserve(transLines.size());
+    for (auto& line : transLines)
+        lineIDs.push_back(line.getLineID());
+
+    if (monitorExport->create(monitorName, plantNames, demandLocations, lineIDs))
+        return 1;
+    monitorPlantsValid = true;
+    monitorDemandsValid = true;
+    monitorLinesValid = true;
+    return 0;
+}
+
+
+//
+// publishMonitor():  Writes the current state into the monitor segment in
+//                    one pass, summing the totals as it goes
+//
+void PowerGrid::publishMonitor() {
+    if (!monitorExport)
+        return;
+    if (!(monitorPlantsValid && monitorDemandsValid && monitorLinesValid) && layoutMonitor())
+        return;
+
+    MonitorTotals totals = {};
+    monitorExport->beginPublish();
+
+    MonitorPlant* plantRecord = monitorExport->getPlants();
+    for (auto plant : plants) {
+        plantRecord->online = plant->isOnline();
+        plantRecord->maxCapacity = plant->getMaxCapacity();
+        plantRecord->curCapacity = plant->getCurCapacity();
+        plantRecord->availCapacity = plant->getAvailCapacity();
+        plantRecord->costPerMW = plant->getCostPerMW();
+        totals.availCapacity += plantRecord->availCapacity;
+        plantRecord++;
+    }
+
+    MonitorDemand* demandRecord = monitorExport->getDemands();
+    for (auto& demand : demands) {
+        demandRecord->required = demand.getPowerRequired();
+        demandRecord->acquired = demand.getPowerAcquired();
+        demandRecord->deficit = demand.getPowerDeficit();
+        demandRecord->price = demand.getTotalPowerPrice();
+        demandRecord->cost = demand.getTotalPowerCost();
+        totals.acquired += demandRecord->acquired;
+        totals.deficit += demandRecord->deficit;
+        totals.price += demandRecord->price;
+        totals.cost += demandRecord->cost;
+        if (demandRecord->deficit > MONITOR_SHORT_TOLERANCE)
+            totals.shortLocations++;
+        demandRecord++;
+    }
+
+    MonitorLine* lineRecord = monitorExport->getLines();
+    for (auto& line : transLines) {
+        lineRecord->maxCapacity = line.getMaxCapacity();
+        lineRecord->availCapacity = line.getAvailCapacity();
+        lineRecord->efficiency = line.getEfficiency();
+        lineRecord++;
+    }
+
+    monitorExport->endPublish(totals);
+}
+
+MonitorExport* PowerGrid::getMonitorExport() { return monitorExport.get(); }
+
+
+
+//********************************************************
+//*****         Demo Reader and Benchmark            *****
+//********************************************************
+
+//
+// runMonitorReader():  Prints one line of totals per interval, then the
+//                      demand locations of the last frame
+//
+int runMonitorReader(const string& name, int intervalMs, int count) {
+    MonitorReader reader;
+    if (reader.open(name)) {
+        cerr << "Error: No grid monitor segment " << name << endl;
+        return 1;
+    }
+
+    MonitorFrame frame;
+    cout << std::fixed << std::setprecision(2);
+    cout << "\n\t--- Grid Monitor " << name << " ---\n";
+    cout << "   Publish   Plant Avail      Acquired       Deficit   Short          Cost       Revenue\n";
+    cout << "----------  ------------  ------------  ------------  ------  ------------  ------------\n";
+    for (int i = 0; i < count; i++) {
+        if (i > 0)
+            this_thread::sleep_for(chrono::milliseconds(intervalMs));
+        if (reader.read(frame)) {
+            cerr << "Error: The grid stopped exporting to " << name << endl;
+            return 1;
+        }
+        cout << setw(10) << frame.publishCount << setw(14) << frame.totals.availCapacity
+             << setw(14) << frame.totals.acquired << setw(14) << frame.totals.deficit
+             << setw(8) << frame.totals.shortLocations << setw(14) << frame.totals.cost
+             << setw(14) << frame.totals.price << endl;
+    }
+
+    cout << "\n    Location          Required    Acquired     Deficit\n";
+    cout << "---------------     --------    --------    --------\n";
+    for (auto& demand : frame.demands)
+        cout << setw(18) << left << reader.demandLocation(demand) << right << setw(10) << demand.required
+             << setw(12) << demand.acquired << setw(12) << demand.deficit << endl;
+    return 0;
+}
+
+
+// Counters the benchmark's reader process shares with the writer
+struct MonitorReaderCounts {
+    atomic<uint64_t>    reads;
+    atomic<uint64_t>    retries;
+    atomic<uint64_t>    errors;
+    atomic<uint64_t>    generations;
+};
+
+
+//
+// checkFrame():  Returns the number of inconsistencies in a frame.  Every
+//                value comes from one publish, so the totals must agree
+//                with the records, summed in the same order.
+//
+static int checkFrame(const MonitorFrame& frame) {
+    int errors = 0;
+    double acquired = 0;
+    for (auto& demand : frame.demands) {
+        acquired += demand.acquired;
+        if (demand.acquired > demand.required + 0.01)
+            errors++;
+    }
+    if (acquired != frame.totals.acquired)
+        errors++;
+
+    double availCapacity = 0;
+    for (auto& plant : frame.plants) {
+        availCapacity += plant.availCapacity;
+        if (plant.availCapacity > plant.curCapacity + 1e-6)
+            errors++;
+    }
+    if (availCapacity != frame.totals.availCapacity)
+        errors++;
+    return errors;
+}
+
+
+//
+// runMonitorBenchmark():  Times re-dispatch without the export, then with
+//      it while a forked reader process reads and checks frames as fast as
+//      it can.  Returns 1 if the reader saw an inconsistent frame.
+//
+int runMonitorBenchmark(PowerGrid& grid, double seconds) {
+    grid.setAllocationLog(false);
+    string location = grid.getDemandList().empty() ? "" : grid.getDemandList()[0].getLocation();
+
+    // Vary the first demand and re-dispatch until the time is up
+    auto dispatchFor = [&](double runSeconds) {
+        long dispatches = 0;
+        auto start = chrono::steady_clock::now();
+        double elapsed = 0;
+        while (elapsed < runSeconds) {
+            grid.setDemandRequired(location, 1000 + (dispatches % 1000));
+            grid.resetDispatch();
+            grid.distributePower();
+            dispatches++;
+            elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        }
+        return 1000 * elapsed / max(1L, dispatches);
+    };
+
+    double plainMs = dispatchFor(seconds / 2);
+
+    string name = MONITOR_SEGMENT + "-" + to_string(getpid());
+    if (grid.setMonitorExport(name))
+        return 1;
+
+    void* shared = mmap(nullptr, sizeof(MonitorReaderCounts), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+        cerr << "Error: Unable to map reader counters: " << strerror(errno) << endl;
+        grid.setMonitorExport("");
+        return 1;
+    }
+    MonitorReaderCounts* counts = new (shared) MonitorReaderCounts;
+    counts->reads = counts->retries = counts->errors = counts->generations = 0;
+
+    cout.flush();
+    cerr.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        // Reader process: read until the writer closes the segment
+        MonitorReader reader;
+        MonitorFrame frame;
+        uint64_t lastPublish = 0, lastGeneration = 0;
+        if (reader.open(name))
+            _exit(1);
+        while (reader.read(frame) == 0) {
+            if (frame.publishCount < lastPublish)
+                counts->errors++;
+            if (frame.generation != lastGeneration)
+                counts->generations++;
+            lastPublish = frame.publishCount;
+            lastGeneration = frame.generation;
+            counts->errors += checkFrame(frame);
+            counts->reads.fetch_add(1, memory_order_relaxed);
+        }
+        counts->retries = reader.getRetries();
+        _exit(0);
+    }
+    if (pid < 0) {
+        cerr << "Error: Unable to start reader: " << strerror(errno) << endl;
+        grid.setMonitorExport("");
+        munmap(shared, sizeof(MonitorReaderCounts));
+        return 1;
+    }
+
+    // Let the reader map the segment before the clock starts
+    while (counts->reads.load() == 0 && waitpid(pid, nullptr, WNOHANG) == 0)
+        this_thread::sleep_for(chrono::milliseconds(1));
+
+    // One structural change part way through sends the reader to a new segment
+    double exportMs = dispatchFor(seconds / 4);
+    grid.sortTransLines();
+    exportMs = (exportMs + dispatchFor(seconds / 4)) / 2;
+    uint64_t published = grid.getMonitorExport()->getPublishCount();
+
+    grid.setMonitorExport("");
+    int status = 0;
+    waitpid(pid, &status, 0);
+
+    cout << "\n\t--- Monitor Export Benchmark (" << grid.getPlantList().size() << " plants, "
+         << grid.getDemandList().size() << " locations) ---\n";
+    cout << std::fixed << std::setprecision(4);
+    cout << "    Dispatch, no export:   " << plainMs << " ms" << endl;
+    cout << "    Dispatch, exported:    " << exportMs << " ms (one reader process)" << endl;
+    cout << std::setprecision(0);
+    cout << "    Frames published:      " << published << endl;
+    cout << "    Frames read:           " << counts->reads.load() << " ("
+         << counts->reads.load() / (seconds / 2) << "/sec)" << endl;
+    cout << "    Copies retried:        " << counts->retries.load() << endl;
+    cout << "    Segments followed:     " << counts->generations.load() << endl;
+    cout << "    Inconsistencies:       " << counts->errors.load() << endl;
+
+    int rc = (counts->errors.load() || !WIFEXITED(status) || WEXITSTATUS(status)) ? 1 : 0;
+    munmap(shared, sizeof(MonitorReaderCounts));
+    return rc;
+}
@@ -0,0 +1,197 @@
+#pragma once
+// File: GridMonitor.h
+//
+// Contains the live state export for external monitors and the small
+// library monitors use to read it.
+//
+// The dispatch thread copies the numeric state of every plant, demand
+// location, and line into a POSIX shared memory segment after each
+// dispatch.  Monitors in other processes map the segment read only and
+// copy the records out under a sequence lock: the writer makes the
+// sequence odd while it writes and even again when it is done, and a
+// reader keeps its copy only if it saw the same even sequence before and
+// after.  The writer never waits for a reader and never takes a lock.
+//
+//      offset 0            MonitorHeader
+//      plantOffset         MonitorPlant[plantCount]
+//      demandOffset        MonitorDemand[demandCount]
+//      lineOffset          MonitorLine[lineCount]
+//      stringOffset        names, each null terminated
+//
+// Names and counts are fixed for the life of a segment.  When plants,
+// demands, or lines are added, removed, or reordered, the writer creates
+// a new segment under the same name and marks the old one MONITOR_MOVED;
+// readers then open the new one.
+//
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "GridDef.h"
+using namespace std;
+
+class PowerGrid;
+
+// Bumped whenever the records below change
+const uint32_t MONITOR_LAYOUT_VERSION = 1;
+
+enum MonitorStatus : uint32_t {
+    MONITOR_LIVE = 0,
+    MONITOR_MOVED,          // A newer segment replaced this one
+    MONITOR_CLOSED          // The writer has stopped
+};
+
+struct MonitorPlant {
+    uint64_t    nameOffset;
+    uint32_t    online;
+    uint32_t    reserved;
+    double      maxCapacity;
+    double      curCapacity;
+    double      availCapacity;
+    double      costPerMW;
+};
+
+struct MonitorDemand {
+    uint64_t    locationOffset;
+    double      required;
+    double      acquired;
+    double      deficit;
+    double      price;          // What the location paid
+    double      cost;           // What its power cost to generate
+};
+
+struct MonitorLine {
+    uint64_t    lineIDOffset;
+    double      maxCapacity;
+    double      availCapacity;
+    double      efficiency;
+};
+
+// Grid wide totals, written with the records
+struct MonitorTotals {
+    double      availCapacity;  // Plants
+    double      acquired;       // Demands
+    double      deficit;
+    double      price;
+    double      cost;
+    uint64_t    shortLocations;
+};
+
+//
+// MonitorHeader:  The layout is fixed when the segment is created.  The
+//                 sequence, publish count, and totals change with every
+//                 publish.
+//
+struct MonitorHeader {
+    char                    magic[8];           // MONITOR_MAGIC
+    uint32_t                layoutVersion;      // MONITOR_LAYOUT_VERSION
+    atomic<uint32_t>        status;             // MonitorStatus
+    uint32_t                plantCount;
+    uint32_t                demandCount;
+    uint32_t                lineCount;
+    uint32_t                generation;         // Segments the writer has created
+    uint64_t                plantOffset;
+    uint64_t                demandOffset;
+    uint64_t                lineOffset;
+    uint64_t                stringOffset;
+    uint64_t                totalBytes;
+    alignas(64) atomic<uint64_t> sequence;      // Odd while the writer is writing
+    uint64_t                publishCount;       // Dispatches published
+    MonitorTotals           totals;
+};
+
+
+//
+// MonitorFrame:  One consistent copy of the exported state
+//
+struct MonitorFrame {
+    uint64_t                publishCount = 0;
+    uint32_t                generation = 0;
+    MonitorTotals           totals = {};
+    vector<MonitorPlant>    plants;
+    vector<MonitorDemand>   demands;
+    vector<MonitorLine>     lines;
+};
+
+
+//
+// Class MonitorExport:  Writer side, owned by the grid
+//
+class MonitorExport {
+private:
+    string          segmentName;
+    int             fd = -1;
+    char*           base = nullptr;
+    size_t          bytes = 0;
+    uint32_t        generation = 0;
+    uint64_t        publishCount = 0;
+
+    MonitorHeader& header();
+    void closeSegment(MonitorStatus status);
+
+public:
+    ~MonitorExport();
+
+    // Creates a segment for these names, replacing the one this export
+    // had open.  Returns 1 if the segment cannot be created.
+    int create(const string& name, const vector<string>& plantNames,
+               const vector<string>& demandLocations, const vector<string>& lineIDs);
+    void close();                           // Marks the segment closed and removes it
+
+    // Writer side of the sequence lock.  Between the two calls the records
+    // may be written in place.  One writer at a time.
+    void beginPublish();
+    void endPublish(const MonitorTotals& totals);
+    MonitorPlant* getPlants();
+    MonitorDemand* getDemands();
+    MonitorLine* getLines();
+
+    bool isOpen() const;
+    const string& getName() const;
+    uint64_t getPublishCount() const;
+};
+
+
+//
+// Class MonitorReader:  Reader side, for use in any process
+//
+class MonitorReader {
+private:
+    string          segmentName;
+    int             fd = -1;
+    const char*     base = nullptr;
+    size_t          bytes = 0;
+    uint64_t        retries = 0;
+
+    const MonitorHeader& header() const;
+    int mapSegment();
+    void unmapSegment();
+
+public:
+    ~MonitorReader();
+
+    int open(const string& name);   // Returns 1 if no valid segment has that name
+    void close();
+
+    // Copies the state into frame, retrying while the writer is mid write,
+    // and follows the writer to a new segment.  frame's vectors are reused,
+    // so repeated reads do not allocate.  Returns 1 if the writer closed the
+    // segment, or no consistent copy was seen in MONITOR_READ_RETRIES tries.
+    int read(MonitorFrame& frame);
+
+    // Names of the records of the mapped segment, valid until the next read()
+    const char* plantName(const MonitorPlant& plant) const;
+    const char* demandLocation(const MonitorDemand& demand) const;
+    const char* lineID(const MonitorLine& line) const;
+
+    uint64_t getRetries() const;    // Copies thrown away because the writer was writing
+};
+
+
+// Prints the monitor segment's state every intervalMs, count times
+int runMonitorReader(const string& name, int intervalMs, int count);
+
+// Re-dispatches a loaded grid for seconds with the export on while a
+// reader process checks every frame it reads.  Prints the dispatch time
+// with and without the export and the reader's rate.
+int runMonitorBenchmark(PowerGrid& grid, double seconds);
@@ -0,0 +1,241 @@
+// File: GridOrder.cpp
+//
+// Contains the sorting routines used to order plants and transmission
+// lines.  See GridOrder.h for a description of the orderings.
+//
+#include "GridDef.h"
+#include "GridOrder.h"
+#include "PowerGrid.h"
+#include <algorithm>
+#include <cstring>
+#include <thread>
+using namespace std;
+
+
+//
+// orderKey():  Maps a double onto an unsigned integer with the same order.
+//              Positive values have the sign bit set, negative values have
+//              all bits flipped so that more negative values sort first.
+//
+uint64_t orderKey(double value, bool descending) {
+    uint64_t bits;
+
+    value += 0.0;                       // Fold -0.0 into 0.0
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (bits & 0x8000000000000000ULL)
+        bits = ~bits;
+    else
+        bits |= 0x8000000000000000ULL;
+
+    return descending ? ~bits : bits;
+}
+
+
+//
+// radixSortRange():  Stable LSD radix sort of count entries of perm by keys.
+//                    Uses 16 bit digits and skips digits that are the same
+//                    for every entry.
+//
+static void radixSortRange(uint32_t* perm, size_t count, const vector<uint64_t>& keys) {
+    if (count < 2)
+        return;
+
+    const int DIGIT_BITS = 16;
+    const size_t BUCKETS = size_t(1) << DIGIT_BITS;
+
+    vector<uint32_t> scratch(count);
+    vector<size_t>   bucketStart(BUCKETS);
+    uint32_t* src = perm;
+    uint32_t* dst = scratch.data();
+
+    for (int shift = 0; shift < 64; shift += DIGIT_BITS) {
+
+        // Count the entries that fall in each bucket for this digit
+        fill(bucketStart.begin(), bucketStart.end(), 0);
+        for (size_t i = 0; i < count; i++)
+            bucketStart[(keys[src[i]] >> shift) & (BUCKETS - 1)]++;
+
+        // Every entry has the same digit, so this pass would not move anything
+        if (bucketStart[(keys[src[0]] >> shift) & (BUCKETS - 1)] == count)
+            continue;
+
+        // Turn the counts into starting positions and scatter
+        size_t pos = 0;
+        for (size_t b = 0; b < BUCKETS; b++) {
+            size_t n = bucketStart[b];
+            bucketStart[b] = pos;
+            pos += n;
+        }
+        for (size_t i = 0; i < count; i++)
+            dst[bucketStart[(keys[src[i]] >> shift) & (BUCKETS - 1)]++] = src[i];
+
+        swap(src, dst);
+    }
+
+    // Copy back if the final pass left the result in the scratch buffer
+    if (src != perm)
+        copy(src, src + count, perm);
+}
+
+
+//
+// sortByKeys():  Fills perm with 0..n-1 and stable sorts it by keys
+//
+void sortByKeys(OrderIndex& perm, const vector<uint64_t>& keys) {
+    size_t count = keys.size();
+
+    perm.resize(count);
+    for (size_t i = 0; i < count; i++)
+        perm[i] = uint32_t(i);
+
+    if (count < 2)
+        return;
+
+    // Entries are ordered by key, and by original position for equal keys
+    auto keyLess = [&keys](uint32_t a, uint32_t b) {
+        return keys[a] < keys[b] || (keys[a] == keys[b] && a < b);
+    };
+
+    // Small collections - comparison sort
+    if (count < RADIX_SORT_THRESHOLD) {
+        stable_sort(perm.begin(), perm.end(),
+            [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+        return;
+    }
+
+    // Large collections - single threaded radix sort
+    size_t threadCount = thread::hardware_concurrency();
+    if (count < PARALLEL_SORT_THRESHOLD || threadCount < 2) {
+        radixSortRange(perm.data(), count, keys);
+        return;
+    }
+
+    // Very large collections - radix sort chunks in parallel then merge
+    // neighbouring runs until one run is left.
+    vector<size_t> bounds;
+    for (size_t t = 0; t <= threadCount; t++)
+        bounds.push_back(count * t / threadCount);
+
+    vector<thread> workers;
+    for (size_t t = 0; t < threadCount; t++) {
+        workers.emplace_back(radixSortRange, perm.data() + bounds[t],
+            bounds[t + 1] - bounds[t], cref(keys));
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    while (bounds.size() > 2) {
+        vector<size_t> merged;
+        workers.clear();
+
+        for (size_t r = 0; r + 2 < bounds.size(); r += 2) {
+            uint32_t* base = perm.data();
+            size_t lo = bounds[r], mid = bounds[r + 1], hi = bounds[r + 2];
+            workers.emplace_back([=, &keyLess]() {
+                inplace_merge(base + lo, base + mid, base + hi, keyLess);
+            });
+            merged.push_back(lo);
+        }
+        if (bounds.size() % 2 == 0)
+            merged.push_back(bounds[bounds.size() - 2]);   // Odd run carried to the next round
+        merged.push_back(count);
+
+        for (auto& worker : workers)
+            worker.join();
+        bounds = merged;
+    }
+}
+
+
+//
+// orderTransLines():  Returns the permutation of lines ordered by key
+//
+OrderIndex orderTransLines(const vector<TransLine>& lines, LineKey key) {
+    vector<uint64_t> keys(lines.size());
+
+    for (size_t i = 0; i < lines.size(); i++) {
+        switch (key) {
+        case LK_EFFICIENCY: keys[i] = orderKey(lines[i].getEfficiency(), true);  break;
+        case LK_CAPACITY:   keys[i] = orderKey(lines[i].getMaxCapacity(), true); break;
+        default:            keys[i] = 0; break;
+        }
+    }
+
+    OrderIndex perm;
+    sortByKeys(perm, keys);
+    return perm;
+}
+
+
+//
+// orderPlants():  Returns the permutation of plants ordered by key
+//
+OrderIndex orderPlants(const vector<Plant*>& plants, PlantKey key) {
+    vector<uint64_t> keys(plants.size());
+
+    for (size_t i = 0; i < plants.size(); i++) {
+        switch (key) {
+        case PK_SUSTAIN:  keys[i] = orderKey(plants[i]->getSustainScore(), true); break;
+        case PK_CAPACITY: keys[i] = orderKey(plants[i]->getMaxCapacity(), true);  break;
+        case PK_COST:     keys[i] = orderKey(plants[i]->getCostPerMW(), false);   break;
+        default:          keys[i] = 0; break;
+        }
+    }
+
+    OrderIndex perm;
+    sortByKeys(perm, keys);
+    return perm;
+}
+
+
+//********************************************************
+//*****      PowerGrid precomputed orderings         *****
+//********************************************************
+
+//
+// buildLineOrders():  Computes the line ordering for every key
+//
+void PowerGrid::buildLineOrders() {
+    for (int key = 0; key < LK_COUNT; key++)
+        lineOrders[key] = orderTransLines(transLines, LineKey(key));
+    lineOrdersValid = true;
+}
+
+
+//
+// buildPlantOrders():  Snapshots the plant list and computes the ordering
+//                      for every key
+//
+void PowerGrid::buildPlantOrders() {
+    plantTable = getPlantList();
+
+    for (int key = 0; key < PK_COUNT; key++)
+        plantOrders[key] = orderPlants(plantTable, PlantKey(key));
+    plantOrdersValid = true;
+}
+
+
+//
+// getLineOrder():  Returns the indexes of the lines ordered by key
+//
+const OrderIndex& PowerGrid::getLineOrder(LineKey key) {
+    if (!lineOrdersValid)
+        buildLineOrders();
+    return lineOrders[key];
+}
+
+
+//
+// getPlantOrder():  Returns the plants ordered by key
+//
+vector<Plant*> PowerGrid::getPlantOrder(PlantKey key) {
+    if (!plantOrdersValid)
+        buildPlantOrders();
+
+    vector<Plant*> ordered;
+    ordered.reserve(plantTable.size());
+    for (uint32_t i : plantOrders[key])
+        ordered.push_back(plantTable[i]);
+    return ordered;
+}
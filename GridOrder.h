@@ -0,0 +1,51 @@
+#pragma once
+// File: GridOrder.h
+//
+// Contains the ordering functions used to rank transmission lines and
+// plants by their attributes.
+//
+// Orderings are returned as permutation vectors (indexes into the
+// original collection) so the objects themselves never have to move and
+// several orderings can be kept at the same time.  Sorting is exact and
+// stable: values are compared as full doubles and equal values keep
+// their original relative order.
+//
+// Small collections use std::stable_sort.  Large collections switch to an
+// LSD radix sort on an order-preserving integer form of the key, and very
+// large collections radix sort chunks in parallel and merge them.
+//
+#include <vector>
+#include <cstdint>
+#include "Plant.h"
+#include "TransLine.h"
+using namespace std;
+
+// Attributes that transmission lines can be ordered by
+enum LineKey {
+    LK_EFFICIENCY,      // Most efficient first
+    LK_CAPACITY,        // Largest maximum capacity first
+    LK_COUNT
+};
+
+// Attributes that plants can be ordered by
+enum PlantKey {
+    PK_SUSTAIN,         // Highest sustainability score first
+    PK_CAPACITY,        // Largest maximum capacity first
+    PK_COST,            // Cheapest cost per MW first
+    PK_COUNT
+};
+
+// A permutation of a collection, element 0 is the index of the first entry
+typedef vector<uint32_t> OrderIndex;
+
+// Converts a double to an unsigned key that sorts the same way.  When
+// descending is set, larger values produce smaller keys.
+uint64_t orderKey(double value, bool descending);
+
+// Stable sort of the permutation so that keys[perm[i]] is non-decreasing.
+// perm is filled with 0..n-1 before sorting.
+void sortByKeys(OrderIndex& perm, const vector<uint64_t>& keys);
+
+// Orderings over the grid components
+OrderIndex orderTransLines(const vector<TransLine>& lines, LineKey key);
+OrderIndex orderPlants(const vector<Plant*>& plants, PlantKey key);
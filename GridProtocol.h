@@ -0,0 +1,52 @@
+#pragma once
+// File: GridProtocol.h
+//
+// Contains the binary message formats used between the grid daemon and
+// its clients over a Unix domain socket.
+//
+// Every message starts with a 16 bit length giving the number of bytes
+// that follow it.  A request then holds an opcode, a numeric argument, and
+// the name of the plant or demand it refers to.  A response holds a
+// status code and a short list of doubles.  Both ends run on the same
+// machine, so values are sent in host byte order.
+//
+#include <cstdint>
+
+// Request opcodes
+enum GridOpcode : uint8_t {
+    OP_PLANT_STATE = 1,     // name = plant      -> max, cur, avail capacity, cost per MW
+    OP_DEMAND_STATE,        // name = location   -> required, acquired, deficit, price, cost
+    OP_UPDATE_DEMAND,       // name = location, value = new MW required (finite, not negative)
+    OP_REDISPATCH,          // Release all allocations and distribute power again
+    OP_REPORT_TOTALS,       // -> required, supplied, % met, plant used, revenue, cost, profit
+    OP_SHUTDOWN             // Stop the daemon
+};
+
+// Response status codes
+enum GridStatus : uint8_t {
+    GS_OK = 0,
+    GS_NOT_FOUND,           // No plant or demand with that name
+    GS_BAD_REQUEST          // Unknown opcode, malformed message, or bad value
+};
+
+const size_t MAX_NAME_LENGTH = 255;
+const size_t MAX_RESPONSE_VALUES = 8;
+
+#pragma pack(push, 1)
+
+struct RequestHeader {
+    uint16_t    length;     // Bytes after this field: sizeof(RequestHeader) - 2 + nameLength
+    uint8_t     opcode;
+    uint8_t     nameLength;
+    double      value;
+    // Followed by nameLength bytes of name, not null terminated
+};
+
+struct ResponseHeader {
+    uint16_t    length;     // Bytes after this field: 2 + 8 * valueCount
+    uint8_t     status;
+    uint8_t     valueCount;
+    // Followed by valueCount doubles
+};
+
+#pragma pack(pop)
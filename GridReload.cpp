@@ -0,0 +1,773 @@
+// File: GridReload.cpp
+//
+// Contains the function definitions for the input file reloader and the
+// grid's application of file differences.  See GridReload.h.
+//
+#include "GridReload.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <string_view>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+using namespace std;
+
+// Binary layout of TransLines.dat (see readTransLineData)
+const off_t RELOAD_RECORD_COUNT_POS = 128;
+const off_t RELOAD_FIRST_RECORD_POS = 1024;
+const off_t RELOAD_RECORD_SPACING = 512;
+
+// Marks a removed entry when indexes are renumbered
+const uint32_t NO_INDEX = UINT32_MAX;
+
+
+//********************************************************
+//*****                 Grid Diff                    *****
+//********************************************************
+
+bool GridDiff::empty() const { return added() + removed() + changed() == 0; }
+
+size_t GridDiff::added() const { return addedPlants.size() + addedDemands.size() + addedLines.size(); }
+size_t GridDiff::removed() const { return removedPlants.size() + removedDemands.size() + removedLines.size(); }
+size_t GridDiff::changed() const { return changedPlants.size() + changedDemands.size() + changedLines.size(); }
+
+
+//
+// applyGridDiff():  Applies the differences in place.  Indexes of the
+//      remaining demands and lines are renumbered only when some were
+//      removed or moved, and the ledger follows them, so redispatch() can
+//      warm start from it.
+//
+void PowerGrid::applyGridDiff(GridDiff& diff) {
+    // Unlinked plants are deleted once the ledger no longer refers to them
+    unordered_set<Plant*> droppedPlants;
+
+    // Plants: a changed plant replaces the old one, keeping its online state
+    auto dropPlant = [&](const string& name) -> Plant* {
+        auto it = plantIndex.find(name);
+        if (it == plantIndex.end())
+            return nullptr;
+
+        Node<Plant*>* node = it->second;
+        Plant* plant = node->data;
+        droppedPlants.insert(plant);
+        plantIndex.erase(it);
+        plantViews.remove(plant);
+        plantTracker.remove(plant);
+        plants.unlink(node);
+        plantOrdersValid = false;
+        storageBankValid = false;
+        monitorPlantsValid = false;
+        return plant;
+    };
+
+    for (auto& name : diff.removedPlants)
+        dropPlant(name);
+
+    for (auto plant : diff.changedPlants) {
+        Plant* old = dropPlant(plant->getName());
+        if (old)
+            plant->setOnline(old->isOnline());
+
+        // A battery keeps its charge, up to what it can now hold
+        StoragePlant* oldUnit = dynamic_cast<StoragePlant*>(old);
+        StoragePlant* unit = dynamic_cast<StoragePlant*>(plant);
+        if (oldUnit && unit)
+            unit->setStorageState(min(oldUnit->getStoredEnergy(), unit->getEnergyCapacity()), oldUnit->getStepHours(), 0);
+    }
+
+    for (auto plantList : { &diff.addedPlants, &diff.changedPlants }) {
+        for (auto plant : *plantList) {
+            plant->calculateOutput();
+            if (addPlantToGrid(plant))
+                delete plant;
+        }
+        plantList->clear();
+    }
+
+    // Demands: changes in place, removals closed up, additions at the end
+    for (auto& changed : diff.changedDemands) {
+        Demand* demand = findDemand(changed.getLocation());
+        if (!demand) {
+            diff.addedDemands.push_back(changed);
+            continue;
+        }
+        demand->setPowerRequired(changed.getPowerRequired());
+        demand->setMwRetailPrice(changed.getMwRetailPrice());
+        demandQueue.update(demands, uint32_t(demand - demands.data()));
+    }
+
+    vector<uint32_t> demandRemap;
+    size_t firstRemoved = demands.size();
+    vector<char> removedDemand(demands.size(), 0);
+    for (auto& location : diff.removedDemands) {
+        auto it = demandIndex.find(location);
+        if (it == demandIndex.end())
+            continue;
+        removedDemand[it->second] = 1;
+        firstRemoved = min(firstRemoved, it->second);
+        demandIndex.erase(it);
+    }
+
+    if (firstRemoved < demands.size()) {
+        demandRemap.resize(demands.size());
+        size_t kept = 0;
+        for (size_t i = 0; i < demands.size(); i++) {
+            if (removedDemand[i]) {
+                demandRemap[i] = NO_INDEX;
+                continue;
+            }
+            demandRemap[i] = uint32_t(kept);
+            if (kept != i)
+                demands[kept] = std::move(demands[i]);
+            kept++;
+        }
+        demands.erase(demands.begin() + kept, demands.end());
+        reindexDemands(firstRemoved);
+        demandQueue.rebuild(demands);
+        monitorDemandsValid = false;
+    }
+
+    for (auto& demand : diff.addedDemands)
+        addDemand(demand);
+
+    // Lines: a capacity change is made in place.  Lines that are added, or
+    // whose efficiency changes while the lines are in efficiency order, are
+    // merged into place; insertFrom remembers where a moved line was.
+    vector<TransLine> inserts;
+    vector<uint32_t> insertFrom;
+    vector<char> lineOut(transLines.size(), 0);
+    bool rebuildLines = false;
+
+    for (auto& lineID : diff.removedLines) {
+        auto it = lineIndex.find(lineID);
+        if (it == lineIndex.end())
+            continue;
+        lineOut[it->second] = 1;
+        lineIndex.erase(it);
+        rebuildLines = true;
+    }
+
+    for (auto& changed : diff.changedLines) {
+        auto it = lineIndex.find(changed.getLineID());
+        if (it == lineIndex.end()) {
+            diff.addedLines.push_back(changed);
+            continue;
+        }
+
+        TransLine& line = transLines[it->second];
+        TransLine replacement = changed;
+        if (line.getDerateFactor() != 1)
+            replacement.derate(line.getDerateFactor());
+
+        if (transLinesSorted && replacement.getEfficiency() != line.getEfficiency()) {
+            lineOut[it->second] = 1;
+            inserts.push_back(replacement);
+            insertFrom.push_back(uint32_t(it->second));
+            rebuildLines = true;
+        }
+        else {
+            line = replacement;
+        }
+        lineOrdersValid = false;
+    }
+
+    for (auto& line : diff.addedLines) {
+        if (lineIndex.count(line.getLineID())) {
+            cerr << "Error: Duplicate transmission line " << line.getLineID() << endl;
+            continue;
+        }
+        inserts.push_back(line);
+        insertFrom.push_back(NO_INDEX);
+        rebuildLines = true;
+    }
+
+    vector<uint32_t> lineRemap;
+    if (rebuildLines) {
+        // Inserted lines go before the first line of lower efficiency
+        vector<uint32_t> order(inserts.size());
+        for (uint32_t i = 0; i < order.size(); i++)
+            order[i] = i;
+        if (transLinesSorted) {
+            stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return inserts[a].getEfficiency() > inserts[b].getEfficiency();
+            });
+        }
+
+        vector<TransLine> merged;
+        merged.reserve(transLines.size() + inserts.size());
+        lineRemap.assign(transLines.size(), NO_INDEX);
+        size_t firstChanged = SIZE_MAX;
+        size_t next = 0;
+
+        auto emitInsert = [&]() {
+            uint32_t i = order[next++];
+            if (insertFrom[i] != NO_INDEX)
+                lineRemap[insertFrom[i]] = uint32_t(merged.size());
+            firstChanged = min(firstChanged, merged.size());
+            merged.push_back(std::move(inserts[i]));
+        };
+
+        for (size_t i = 0; i < transLines.size(); i++) {
+            if (lineOut[i]) {
+                firstChanged = min(firstChanged, merged.size());
+                continue;
+            }
+            while (transLinesSorted && next < order.size() &&
+                   inserts[order[next]].getEfficiency() > transLines[i].getEfficiency())
+                emitInsert();
+            lineRemap[i] = uint32_t(merged.size());
+            merged.push_back(std::move(transLines[i]));
+        }
+        while (next < order.size())
+            emitInsert();
+
+        transLines.swap(merged);
+        for (size_t i = firstChanged; i < transLines.size(); i++)
+            lineIndex[transLines[i].getLineID()] = i;
+        lineOrdersValid = false;
+        monitorLinesValid = false;
+    }
+
+    // The ledger keeps every allocation whose plant, demand, and line remain
+    if (!droppedPlants.empty() || !demandRemap.empty() || !lineRemap.empty()) {
+        size_t kept = 0;
+        for (auto& entry : ledger) {
+            if (droppedPlants.count(entry.plant))
+                continue;
+            if (!demandRemap.empty()) {
+                if (demandRemap[entry.demand] == NO_INDEX)
+                    continue;
+                entry.demand = demandRemap[entry.demand];
+            }
+            if (!lineRemap.empty()) {
+                if (lineRemap[entry.line] == NO_INDEX)
+                    continue;
+                entry.line = lineRemap[entry.line];
+            }
+            ledger[kept++] = entry;
+        }
+        ledger.resize(kept);
+
+        // Cached ledgers may refer to the old plants and positions
+        dispatchCache.clear();
+    }
+
+    for (auto plant : droppedPlants)
+        delete plant;
+}
+
+
+
+//********************************************************
+//*****               File Diffing                   *****
+//********************************************************
+
+//
+// readText():  Reads a whole file into text
+//
+static int readText(const string& filename, string& text) {
+    ifstream is(filename, ios::binary);
+    if (!is) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return 1;
+    }
+    is.seekg(0, ios::end);
+    text.resize(size_t(is.tellg()));
+    is.seekg(0);
+    is.read(&text[0], streamsize(text.size()));
+    return is ? 0 : 1;
+}
+
+
+//
+// readLineRecords():  Maps a lines file and copies out its records
+//
+static int readLineRecords(const string& filename, vector<ReloadLineRecord>& records) {
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return 1;
+    }
+
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size >= RELOAD_RECORD_COUNT_POS + off_t(sizeof(int32_t)))
+        data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        cerr << "Error: Unable to read file " << filename << endl;
+        return 1;
+    }
+
+    const char* file = static_cast<const char*>(data);
+    int32_t count;
+    memcpy(&count, file + RELOAD_RECORD_COUNT_POS, sizeof(count));
+
+    int rc = 0;
+    records.clear();
+    if (count > 0 && RELOAD_FIRST_RECORD_POS + (count - 1) * RELOAD_RECORD_SPACING +
+                     off_t(sizeof(ReloadLineRecord)) > info.st_size) {
+        cerr << "Error: File " << filename << " is shorter than its " << count << " records" << endl;
+        rc = 1;
+    }
+    else if (count > 0) {
+        records.resize(size_t(count));
+        for (int32_t i = 0; i < count; i++)
+            memcpy(&records[i], file + RELOAD_FIRST_RECORD_POS + i * RELOAD_RECORD_SPACING, sizeof(ReloadLineRecord));
+    }
+
+    munmap(data, size_t(info.st_size));
+    return rc;
+}
+
+
+//
+// recordsStart():  Offset of the first record, after the two header lines
+//
+static size_t recordsStart(const string& text) {
+    size_t pos = 0;
+    for (int line = 0; line < 2 && pos < text.size(); line++) {
+        size_t end = text.find('\n', pos);
+        pos = (end == string::npos) ? text.size() : end + 1;
+    }
+    return pos;
+}
+
+
+//
+// TextRegion:  The whole lines of the old and new text that differ.  The
+//              text before and after is the same in both.
+//
+struct TextRegion {
+    size_t  oldBegin, oldEnd;
+    size_t  newBegin, newEnd;
+};
+
+static TextRegion changedRegion(const string& oldText, const string& newText) {
+    size_t shorter = min(oldText.size(), newText.size());
+    size_t prefix = size_t(mismatch(oldText.begin(), oldText.begin() + shorter, newText.begin()).first - oldText.begin());
+    size_t suffix = 0;
+    while (suffix < shorter - prefix &&
+           oldText[oldText.size() - 1 - suffix] == newText[newText.size() - 1 - suffix])
+        suffix++;
+
+    // Widen to whole lines; the bytes on either side are the same in both
+    size_t begin = prefix;
+    while (begin > 0 && oldText[begin - 1] != '\n')
+        begin--;
+    size_t oldEnd = oldText.size() - suffix;
+    size_t newEnd = newText.size() - suffix;
+    while (oldEnd < oldText.size() && ((oldEnd > begin && oldText[oldEnd - 1] != '\n') ||
+                                       (newEnd > begin && newText[newEnd - 1] != '\n'))) {
+        oldEnd++;
+        newEnd++;
+    }
+
+    // Header lines are never records
+    TextRegion region;
+    region.oldBegin = max(begin, recordsStart(oldText));
+    region.newBegin = max(begin, recordsStart(newText));
+    region.oldEnd = max(oldEnd, region.oldBegin);
+    region.newEnd = max(newEnd, region.newBegin);
+    return region;
+}
+
+
+//
+// regionRecords():  Maps the first word of each line in [begin, end) to the line
+//
+static unordered_map<string_view, string_view> regionRecords(const string& text, size_t begin, size_t end) {
+    unordered_map<string_view, string_view> records;
+    string_view region(text.data() + begin, end - begin);
+
+    while (!region.empty()) {
+        size_t lineEnd = region.find('\n');
+        string_view line = region.substr(0, lineEnd);
+        region = (lineEnd == string_view::npos) ? string_view() : region.substr(lineEnd + 1);
+
+        size_t nameBegin = line.find_first_not_of(" \t\r");
+        if (nameBegin == string_view::npos)
+            continue;
+        size_t nameEnd = line.find_first_of(" \t\r", nameBegin);
+        string_view name = line.substr(nameBegin, nameEnd == string_view::npos ? string_view::npos : nameEnd - nameBegin);
+        records[name] = line;
+    }
+    return records;
+}
+
+
+//
+// TextDiff:  Records by name that were added, removed, or changed
+//
+struct TextDiff {
+    vector<string_view> added;          // New lines
+    vector<string_view> changed;        // New lines
+    vector<string>      removed;        // Names
+    size_t              bytesParsed = 0;
+};
+
+static TextDiff diffText(const string& oldText, const string& newText) {
+    TextRegion region = changedRegion(oldText, newText);
+    auto oldRecords = regionRecords(oldText, region.oldBegin, region.oldEnd);
+    auto newRecords = regionRecords(newText, region.newBegin, region.newEnd);
+
+    TextDiff diff;
+    diff.bytesParsed = (region.oldEnd - region.oldBegin) + (region.newEnd - region.newBegin);
+    for (auto& record : newRecords) {
+        auto old = oldRecords.find(record.first);
+        if (old == oldRecords.end())
+            diff.added.push_back(record.second);
+        else if (old->second != record.second)
+            diff.changed.push_back(record.second);
+    }
+    for (auto& record : oldRecords) {
+        if (!newRecords.count(record.first))
+            diff.removed.push_back(string(record.first));
+    }
+    return diff;
+}
+
+
+//
+// parsePlant():  Creates the plant a record describes, or returns nullptr
+//                if the record is not a valid plant
+//
+static Plant* parsePlant(string_view line) {
+    istringstream is{ string(line) };
+    Plant* plant = readPlantRecord(is);     // The same types the plants file is read with
+    if (!plant || is.fail())
+        cerr << "Error: Bad plant record: " << line << endl;
+    if (plant && is.fail()) {
+        delete plant;
+        plant = nullptr;
+    }
+    return plant;
+}
+
+
+static bool parseDemand(string_view line, vector<Demand>& demands) {
+    istringstream is{ string(line) };
+    string location;
+    double required, price;
+    if (!(is >> location >> required >> price)) {
+        cerr << "Error: Bad demand record: " << line << endl;
+        return false;
+    }
+    demands.push_back(Demand(location, required, price));
+    return true;
+}
+
+
+
+//********************************************************
+//*****               Grid Reloader                  *****
+//********************************************************
+
+//
+//  Constructors and Destructors
+//
+GridReloader::GridReloader(PowerGrid& grid, const string& plantsFile, const string& demandsFile, const string& linesFile)
+    : grid(grid), running(false) {
+    files[RF_PLANTS] = plantsFile;
+    files[RF_DEMANDS] = demandsFile;
+    files[RF_LINES] = linesFile;
+}
+
+GridReloader::~GridReloader() {
+    if (inotifyFd >= 0) close(inotifyFd);
+    if (wakeFd >= 0) close(wakeFd);
+}
+
+
+//
+// prime():  Reads the base contents of each file
+//
+int GridReloader::prime() {
+    primed = !readText(files[RF_PLANTS], plantText) &&
+             !readText(files[RF_DEMANDS], demandText) &&
+             !readLineRecords(files[RF_LINES], lineRecords);
+    return primed ? 0 : 1;
+}
+
+
+//
+// diffPlants(), diffDemands():  Parse only the changed lines of the text.
+//      Every changed line is parsed so each bad record is reported; if any
+//      is bad the diff is emptied and 1 is returned.
+//
+int GridReloader::diffPlants(const string& text, GridDiff& diff, size_t& bytesParsed) {
+    TextDiff textDiff = diffText(plantText, text);
+    bytesParsed = textDiff.bytesParsed;
+
+    bool bad = false;
+    for (auto line : textDiff.added) {
+        Plant* plant = parsePlant(line);
+        if (plant)
+            diff.addedPlants.push_back(plant);
+        bad |= !plant;
+    }
+    for (auto line : textDiff.changed) {
+        Plant* plant = parsePlant(line);
+        if (plant)
+            diff.changedPlants.push_back(plant);
+        bad |= !plant;
+    }
+    diff.removedPlants = std::move(textDiff.removed);
+
+    if (bad) {
+        for (auto plantList : { &diff.addedPlants, &diff.changedPlants }) {
+            for (auto plant : *plantList)
+                delete plant;
+        }
+        diff = GridDiff();
+        return 1;
+    }
+    return 0;
+}
+
+int GridReloader::diffDemands(const string& text, GridDiff& diff, size_t& bytesParsed) {
+    TextDiff textDiff = diffText(demandText, text);
+    bytesParsed = textDiff.bytesParsed;
+
+    bool bad = false;
+    for (auto line : textDiff.added)
+        bad |= !parseDemand(line, diff.addedDemands);
+    for (auto line : textDiff.changed)
+        bad |= !parseDemand(line, diff.changedDemands);
+    diff.removedDemands = std::move(textDiff.removed);
+
+    if (bad) {
+        diff = GridDiff();
+        return 1;
+    }
+    return 0;
+}
+
+
+//
+// diffLines():  Compares the records slot by slot, then matches the
+//               differing slots by line ID
+//
+int GridReloader::diffLines(vector<ReloadLineRecord>& records, GridDiff& diff) {
+    auto lineName = [](const ReloadLineRecord& record) {
+        return string(record.lineName, strnlen(record.lineName, sizeof(record.lineName)));
+    };
+
+    unordered_map<string, const ReloadLineRecord*> oldSlots, newSlots;
+    size_t common = min(records.size(), lineRecords.size());
+    for (size_t i = 0; i < common; i++) {
+        if (memcmp(&records[i], &lineRecords[i], sizeof(ReloadLineRecord)) != 0) {
+            oldSlots[lineName(lineRecords[i])] = &lineRecords[i];
+            newSlots[lineName(records[i])] = &records[i];
+        }
+    }
+    for (size_t i = common; i < lineRecords.size(); i++)
+        oldSlots[lineName(lineRecords[i])] = &lineRecords[i];
+    for (size_t i = common; i < records.size(); i++)
+        newSlots[lineName(records[i])] = &records[i];
+
+    for (auto& slot : newSlots) {
+        TransLine line(slot.first, slot.second->lineCapacity, slot.second->lineEfficiency);
+        auto old = oldSlots.find(slot.first);
+        if (old == oldSlots.end())
+            diff.addedLines.push_back(line);
+        else if (old->second->lineCapacity != slot.second->lineCapacity ||
+                 old->second->lineEfficiency != slot.second->lineEfficiency)
+            diff.changedLines.push_back(line);
+    }
+    for (auto& slot : oldSlots) {
+        if (!newSlots.count(slot.first))
+            diff.removedLines.push_back(slot.first);
+    }
+    return 0;
+}
+
+
+//
+// reload():  Reads and diffs one file, applies it, and re-dispatches.
+//            Returns 1, changing nothing, if the file has a bad record.
+//
+int GridReloader::reload(int kind, ReloadResult& result) {
+    if (!primed && prime())
+        return 1;
+
+    result = ReloadResult();
+    result.file = files[kind];
+    auto start = chrono::steady_clock::now();
+    auto lap = [&]() {
+        auto now = chrono::steady_clock::now();
+        double ms = chrono::duration<double, milli>(now - start).count();
+        start = now;
+        return ms;
+    };
+
+    GridDiff diff;
+    string text;
+    vector<ReloadLineRecord> records;
+    if (kind == RF_LINES) {
+        if (readLineRecords(files[kind], records))
+            return 1;
+        diffLines(records, diff);
+        result.bytesParsed = (diff.added() + diff.changed()) * sizeof(ReloadLineRecord);
+    }
+    else {
+        if (readText(files[kind], text))
+            return 1;
+
+        // A file with a bad record is not applied at all, and the last
+        // applied text stays the base, so the next save is diffed in full
+        int bad = (kind == RF_PLANTS) ? diffPlants(text, diff, result.bytesParsed)
+                                      : diffDemands(text, diff, result.bytesParsed);
+        if (bad) {
+            cerr << "Error: " << files[kind] << " not applied until its bad records are fixed" << endl;
+            return 1;
+        }
+    }
+    result.added = diff.added();
+    result.removed = diff.removed();
+    result.changed = diff.changed();
+    result.readMs = lap();
+
+    bool changed = !diff.empty();
+    grid.applyGridDiff(diff);
+    if (kind == RF_PLANTS)
+        plantText.swap(text);
+    else if (kind == RF_DEMANDS)
+        demandText.swap(text);
+    else
+        lineRecords.swap(records);
+    result.applyMs = lap();
+
+    if (changed) {
+        grid.redispatch();
+        result.dispatchMs = lap();
+    }
+    return 0;
+}
+
+
+//
+// reloadFile():  Reloads the grid input file with the given name
+//
+int GridReloader::reloadFile(const string& filename, ReloadResult& result) {
+    for (int kind = 0; kind < RF_COUNT; kind++) {
+        if (files[kind] == filename)
+            return reload(kind, result);
+    }
+    cerr << "Error: " << filename << " is not an input file of the grid" << endl;
+    return 1;
+}
+
+
+//
+// watch():  Waits for the files to be written or replaced.  Once a file
+//           has been quiet for RELOAD_SETTLE_MS it is reloaded.
+//
+int GridReloader::watch() {
+    if (!primed && prime())
+        return 1;
+
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (inotifyFd < 0 || wakeFd < 0) {
+        cerr << "Error: Unable to watch files: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    // Watch each file's directory, so a replaced file is seen too
+    struct WatchedFile {
+        int     wd;
+        string  name;
+    };
+    vector<WatchedFile> watched;
+    for (int kind = 0; kind < RF_COUNT; kind++) {
+        size_t slash = files[kind].rfind('/');
+        string dir = (slash == string::npos) ? "." : files[kind].substr(0, max<size_t>(slash, 1));
+        string name = (slash == string::npos) ? files[kind] : files[kind].substr(slash + 1);
+        int wd = inotify_add_watch(inotifyFd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (wd < 0) {
+            cerr << "Error: Unable to watch " << dir << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        watched.push_back({ wd, name });
+    }
+
+    running = true;
+    bool pending[RF_COUNT] = {};
+    int timeout = -1;
+    alignas(inotify_event) char buffer[4096];
+
+    while (running) {
+        pollfd fds[2] = { { inotifyFd, POLLIN, 0 }, { wakeFd, POLLIN, 0 } };
+        int count = poll(fds, 2, timeout);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            cerr << "Error: poll failed: " << strerror(errno) << endl;
+            return 1;
+        }
+        if (fds[1].revents & POLLIN)
+            break;
+
+        // Quiet for the settle time: reload what changed
+        if (count == 0) {
+            for (int kind = 0; kind < RF_COUNT; kind++) {
+                if (!pending[kind])
+                    continue;
+                pending[kind] = false;
+
+                ReloadResult result;
+                if (reload(kind, result))
+                    continue;
+                cout << std::fixed << setprecision(2)
+                     << "Reloaded " << result.file << ": " << result.added << " added, " << result.removed
+                     << " removed, " << result.changed << " changed (read " << result.readMs << " ms, apply "
+                     << result.applyMs << " ms, dispatch " << result.dispatchMs << " ms)" << endl;
+            }
+            timeout = -1;
+            continue;
+        }
+
+        ssize_t length;
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len) {
+                const inotify_event* event = reinterpret_cast<inotify_event*>(p);
+                if (event->len == 0)
+                    continue;
+                for (int kind = 0; kind < RF_COUNT; kind++) {
+                    if (watched[kind].wd == event->wd && watched[kind].name == event->name) {
+                        pending[kind] = true;
+                        timeout = RELOAD_SETTLE_MS;
+                    }
+                }
+            }
+        }
+    }
+
+    running = false;
+    return 0;
+}
+
+
+//
+// stop():  Wakes the watch loop and ends it
+//
+void GridReloader::stop() {
+    running = false;
+    uint64_t one = 1;
+    if (wakeFd >= 0 && write(wakeFd, &one, sizeof(one)) < 0) {
+        // Nothing more can be done from a signal handler
+    }
+}
@@ -0,0 +1,114 @@
+#pragma once
+// File: GridReload.h
+//
+// Contains the hot reload of the grid's input files.
+//
+// The reloader keeps the contents of each input file as it last applied
+// them.  When a file changes it reads the new contents and finds the
+// region that differs from the old: for Plants.txt and Demands.txt the
+// lines between the longest common prefix and suffix, for TransLines.dat
+// the record slots whose bytes differ.  Only the records in that region
+// are parsed and compared by name, so a one line edit parses one line.
+//
+// The differences are applied to the grid in place: added, removed, and
+// changed plants, demands, and lines, keeping the last dispatch's
+// allocations for every component that is still there.  The grid is then
+// re-dispatched, warm started from those allocations.
+//
+// Text records are read one per line, as the input files are written.
+// A change that only moves a record within its file is not applied.
+//
+// Watch mode waits on inotify for the files' directories, so both
+// editors that rewrite a file and editors that replace it are seen.
+//
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "GridDef.h"
+#include "PowerGrid.h"
+using namespace std;
+
+//
+// GridDiff:  Changes to apply to the grid.  The grid takes ownership of
+//            the plants in addedPlants and changedPlants.
+//
+struct GridDiff {
+    vector<Plant*>      addedPlants;
+    vector<Plant*>      changedPlants;      // Replace the plant with the same name
+    vector<string>      removedPlants;
+    vector<Demand>      addedDemands;
+    vector<Demand>      changedDemands;     // New requirement or price for the location
+    vector<string>      removedDemands;
+    vector<TransLine>   addedLines;
+    vector<TransLine>   changedLines;       // New capacity or efficiency for the line
+    vector<string>      removedLines;
+
+    bool empty() const;
+    size_t added() const;
+    size_t removed() const;
+    size_t changed() const;
+};
+
+// What one reload found and the time each stage took
+struct ReloadResult {
+    string      file;
+    size_t      added = 0;
+    size_t      removed = 0;
+    size_t      changed = 0;
+    size_t      bytesParsed = 0;    // Of the changed region
+    double      readMs = 0;         // Reading and diffing the file
+    double      applyMs = 0;
+    double      dispatchMs = 0;
+};
+
+// Binary layout of TransLines.dat (see readTransLineData)
+struct ReloadLineRecord {
+    char    lineName[20];
+    double  lineCapacity;
+    double  lineEfficiency;
+};
+
+
+//
+// Class GridReloader
+//
+class GridReloader {
+private:
+    enum FileKind { RF_PLANTS = 0, RF_DEMANDS, RF_LINES, RF_COUNT };
+
+    PowerGrid&                  grid;
+    string                      files[RF_COUNT];
+    string                      plantText;          // Contents last applied
+    string                      demandText;
+    vector<ReloadLineRecord>    lineRecords;
+    bool                        primed = false;
+
+    int                         inotifyFd = -1;
+    int                         wakeFd = -1;        // eventfd used by stop() to wake the watch
+    atomic<bool>                running;
+
+    int diffPlants(const string& text, GridDiff& diff, size_t& bytesParsed);
+    int diffDemands(const string& text, GridDiff& diff, size_t& bytesParsed);
+    int diffLines(vector<ReloadLineRecord>& records, GridDiff& diff);
+    int reload(int kind, ReloadResult& result);
+
+public:
+    GridReloader(PowerGrid& grid, const string& plantsFile, const string& demandsFile, const string& linesFile);
+    ~GridReloader();
+
+    // Reads the files the grid was loaded from as the base for later
+    // diffs.  Returns 1 if a file cannot be read.
+    int prime();
+
+    // Diffs the named input file against what was last applied, applies
+    // the changes, and re-dispatches.  Returns 1 if the file is not one of
+    // the grid's, cannot be read, or has a bad record; a file with a bad
+    // record is not applied, and is diffed again in full when next saved.
+    int reloadFile(const string& filename, ReloadResult& result);
+
+    // Applies changes to the files as they are written, printing a line
+    // for each, until stop().  Returns 1 if the files cannot be watched.
+    int watch();
+    void stop();            // Safe to call from another thread or a signal handler
+};
@@ -0,0 +1,609 @@
+// File: GridShards.cpp
+//
+// Contains the function definitions for the shared memory grid image, the
+// sharded trial coordinator, and its worker processes.  See GridShards.h.
+//
+#include "GridDef.h"
+#include "GridShards.h"
+#include <iostream>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <thread>
+#include <new>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+using namespace std;
+
+const char IMAGE_MAGIC[8] = { 'P', 'G', 'I', 'M', 'G', '1', 0, 0 };
+
+// Seeds each trial's random draws from its number
+const uint64_t SHARD_TRIAL_SEED = 0x5eed5eed5eed5eedULL;
+
+// Deficit (MW) below which a location counts as served
+const double SHORT_TOLERANCE = 1e-6;
+
+
+//********************************************************
+//*****                 Trials                       *****
+//********************************************************
+
+//
+// TrialGrid:  The plants and demands a trial changes, in image order, with
+//             their base state
+//
+struct TrialGrid {
+    vector<Plant*>  plants;
+    vector<bool>    online;
+    vector<Demand*> demands;
+    vector<double>  required;
+};
+
+static TrialGrid getTrialGrid(PowerGrid& grid, const vector<Plant*>& plantOrder) {
+    TrialGrid trialGrid;
+    trialGrid.plants = plantOrder;
+    for (auto plant : plantOrder)
+        trialGrid.online.push_back(plant->isOnline());
+
+    for (auto& demand : grid.getDemandList()) {
+        trialGrid.demands.push_back(grid.findDemand(demand.getLocation()));
+        trialGrid.required.push_back(demand.getPowerRequired());
+    }
+    return trialGrid;
+}
+
+
+//
+// runTrial():  Forces plants out and scales the requirements for one trial,
+//              dispatches in merit order, and measures the outcome
+//
+static TrialResult runTrial(PowerGrid& grid, const TrialGrid& trialGrid, uint64_t trial) {
+    TrialResult result = {};
+    result.trial = trial;
+
+    mt19937_64 rng(SHARD_TRIAL_SEED + trial * 0x9e3779b97f4a7c15ULL);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+
+    for (size_t p = 0; p < trialGrid.plants.size(); p++) {
+        bool forcedOut = trialGrid.online[p] && unit(rng) < SHARD_OUTAGE_RATE;
+        trialGrid.plants[p]->setOnline(trialGrid.online[p] && !forcedOut);
+        trialGrid.plants[p]->calculateOutput();
+        if (forcedOut)
+            result.plantsOut++;
+    }
+    for (size_t d = 0; d < trialGrid.demands.size(); d++) {
+        double scale = 1 + SHARD_DEMAND_SPREAD * (2 * unit(rng) - 1);
+        grid.setDemandRequired(trialGrid.demands[d]->getLocation(), trialGrid.required[d] * scale);
+    }
+
+    grid.resetDispatch();
+    grid.distributePower();
+
+    for (auto demand : trialGrid.demands) {
+        result.supplied += demand->getPowerAcquired();
+        result.unserved += demand->getPowerDeficit();
+        result.cost += demand->getTotalPowerCost();
+        result.revenue += demand->getTotalPowerPrice();
+        if (demand->getPowerDeficit() > SHORT_TOLERANCE)
+            result.shortLocations++;
+    }
+    return result;
+}
+
+
+//
+// restoreTrialGrid():  Puts the plants and demands back to their base state
+//
+static void restoreTrialGrid(PowerGrid& grid, const TrialGrid& trialGrid) {
+    for (size_t p = 0; p < trialGrid.plants.size(); p++) {
+        trialGrid.plants[p]->setOnline(trialGrid.online[p]);
+        trialGrid.plants[p]->calculateOutput();
+    }
+    for (size_t d = 0; d < trialGrid.demands.size(); d++)
+        grid.setDemandRequired(trialGrid.demands[d]->getLocation(), trialGrid.required[d]);
+}
+
+
+bool TrialResult::operator==(const TrialResult& other) const {
+    return trial == other.trial && supplied == other.supplied && unserved == other.unserved &&
+        cost == other.cost && revenue == other.revenue && plantsOut == other.plantsOut &&
+        shortLocations == other.shortLocations;
+}
+
+
+//
+// runTrialsInProcess():  Runs a range of trials on this process's grid
+//
+vector<TrialResult> runTrialsInProcess(PowerGrid& grid, uint64_t first, uint64_t count) {
+    DispatchPolicy policy = grid.getDispatchPolicy();
+    grid.setDispatchPolicy(DP_COST);
+
+    TrialGrid trialGrid = getTrialGrid(grid, grid.getPlantList());
+    vector<TrialResult> results;
+    for (uint64_t trial = first; trial < first + count; trial++)
+        results.push_back(runTrial(grid, trialGrid, trial));
+
+    restoreTrialGrid(grid, trialGrid);
+    grid.setDispatchPolicy(policy);
+    grid.resetDispatch();
+    grid.distributePower();
+    return results;
+}
+
+
+//
+// summarizeTrials():  Averages the results, summed in trial order
+//
+ShardSummary summarizeTrials(const vector<TrialResult>& results) {
+    ShardSummary summary;
+    summary.trials = results.size();
+    if (results.empty())
+        return summary;
+
+    for (auto& result : results) {
+        summary.supplied += result.supplied;
+        summary.unserved += result.unserved;
+        summary.cost += result.cost;
+        summary.revenue += result.revenue;
+        summary.plantsOut += result.plantsOut;
+        if (result.shortLocations > 0)
+            summary.lossOfLoad++;
+    }
+
+    double count = double(results.size());
+    summary.supplied /= count;
+    summary.unserved /= count;
+    summary.cost /= count;
+    summary.revenue /= count;
+    summary.plantsOut /= count;
+    summary.lossOfLoad /= count;
+    return summary;
+}
+
+
+//********************************************************
+//*****               Grid Image                     *****
+//********************************************************
+
+GridImage::~GridImage() {
+    close();
+}
+
+
+//
+// Accessors
+//
+const GridImageHeader& GridImage::header() const { return *static_cast<const GridImageHeader*>(base); }
+const char* GridImage::text(uint64_t offset) const { return static_cast<const char*>(base) + offset; }
+const string& GridImage::getName() const { return segmentName; }
+size_t GridImage::getBytes() const { return bytes; }
+uint32_t GridImage::getPlantCount() const { return base ? header().plantCount : 0; }
+uint32_t GridImage::getDemandCount() const { return base ? header().demandCount : 0; }
+uint32_t GridImage::getLineCount() const { return base ? header().lineCount : 0; }
+
+
+//
+// create():  Lays out the records and names, then copies them into a new
+//            segment and makes it read only
+//
+int GridImage::create(PowerGrid& grid, const string& name) {
+    close();
+
+    vector<Plant*> plantList = grid.getPlantList();
+    const vector<Demand>& demandList = grid.getDemandList();
+    const vector<TransLine>& lineList = grid.getLineList();
+
+    GridImageHeader head = {};
+    memcpy(head.magic, IMAGE_MAGIC, sizeof(head.magic));
+    head.plantCount = uint32_t(plantList.size());
+    head.demandCount = uint32_t(demandList.size());
+    head.lineCount = uint32_t(lineList.size());
+    head.plantOffset = sizeof(GridImageHeader);
+    head.demandOffset = head.plantOffset + plantList.size() * sizeof(GridImagePlant);
+    head.lineOffset = head.demandOffset + demandList.size() * sizeof(GridImageDemand);
+    head.stringOffset = head.lineOffset + lineList.size() * sizeof(GridImageLine);
+
+    // Names are stored once each, after the records
+    string names;
+    auto addText = [&](const string& value) {
+        uint64_t offset = head.stringOffset + names.size();
+        names += value;
+        names += '\0';
+        return offset;
+    };
+
+    vector<GridImagePlant> plantRecords;
+    for (auto plant : plantList) {
+        GridImagePlant record = {};
+        record.nameOffset = addText(plant->getName());
+        record.typeOffset = addText(plant->getType());
+        record.sustainScore = plant->getSustainScore();
+        record.online = plant->isOnline();
+        record.maxCapacity = plant->getMaxCapacity();
+        record.curCapacity = plant->getCurCapacity();
+        record.costPerMW = plant->getCostPerMW();
+        record.uptime = plant->getUptimePercent();
+        record.emissionRate = plant->getEmissionRate();
+        plantRecords.push_back(record);
+    }
+
+    vector<GridImageDemand> demandRecords;
+    for (auto& demand : demandList)
+        demandRecords.push_back({ addText(demand.getLocation()), demand.getPowerRequired(), demand.getMwRetailPrice() });
+
+    vector<GridImageLine> lineRecords;
+    for (auto& line : lineList)
+        lineRecords.push_back({ addText(line.getLineID()), line.getEfficiency(), line.getMaxCapacity(), line.getDerateFactor() });
+
+    head.totalBytes = head.stringOffset + names.size();
+
+    // Replace a segment left behind by an earlier run
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, off_t(head.totalBytes)) < 0) {
+        cerr << "Error: Unable to create shared memory " << name << ": " << strerror(errno) << endl;
+        if (fd >= 0) shm_unlink(name.c_str());
+        close();
+        return 1;
+    }
+    segmentName = name;
+    owner = true;
+
+    bytes = size_t(head.totalBytes);
+    base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        cerr << "Error: Unable to map shared memory " << name << ": " << strerror(errno) << endl;
+        base = nullptr;
+        close();
+        return 1;
+    }
+
+    char* image = static_cast<char*>(base);
+    memcpy(image, &head, sizeof(head));
+    memcpy(image + head.plantOffset, plantRecords.data(), plantRecords.size() * sizeof(GridImagePlant));
+    memcpy(image + head.demandOffset, demandRecords.data(), demandRecords.size() * sizeof(GridImageDemand));
+    memcpy(image + head.lineOffset, lineRecords.data(), lineRecords.size() * sizeof(GridImageLine));
+    memcpy(image + head.stringOffset, names.data(), names.size());
+
+    // Nothing writes the image from here on
+    mprotect(base, bytes, PROT_READ);
+    return 0;
+}
+
+
+//
+// open():  Maps an image another process created and checks its layout
+//
+int GridImage::open(const string& name) {
+    close();
+
+    fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        cerr << "Error: Unable to open shared memory " << name << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    segmentName = name;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && size_t(info.st_size) >= sizeof(GridImageHeader)) {
+        bytes = size_t(info.st_size);
+        base = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED)
+            base = nullptr;
+    }
+
+    bool valid = base &&
+        memcmp(header().magic, IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0 &&
+        header().totalBytes <= bytes &&
+        header().plantOffset + uint64_t(header().plantCount) * sizeof(GridImagePlant) <= header().demandOffset &&
+        header().demandOffset + uint64_t(header().demandCount) * sizeof(GridImageDemand) <= header().lineOffset &&
+        header().lineOffset + uint64_t(header().lineCount) * sizeof(GridImageLine) <= header().stringOffset &&
+        header().stringOffset <= header().totalBytes;
+
+    if (!valid) {
+        cerr << "Error: Not a grid image " << name << endl;
+        close();
+        return 1;
+    }
+    return 0;
+}
+
+
+void GridImage::close() {
+    if (base)
+        munmap(base, bytes);
+    if (fd >= 0)
+        ::close(fd);
+    if (owner)
+        shm_unlink(segmentName.c_str());
+
+    base = nullptr;
+    bytes = 0;
+    fd = -1;
+    owner = false;
+    segmentName.clear();
+}
+
+
+//
+// buildGrid():  Adds a plant, demand, and line for each record
+//
+int GridImage::buildGrid(PowerGrid& grid, vector<Plant*>& plantOrder) const {
+    if (!base) {
+        cerr << "Error: No grid image mapped" << endl;
+        return 1;
+    }
+    const char* image = static_cast<const char*>(base);
+
+    plantOrder.clear();
+    auto plantRecords = reinterpret_cast<const GridImagePlant*>(image + header().plantOffset);
+    for (uint32_t p = 0; p < header().plantCount; p++) {
+        const GridImagePlant& record = plantRecords[p];
+        ImagePlant* plant = new ImagePlant(text(record.nameOffset), text(record.typeOffset), record.sustainScore,
+            record.maxCapacity, record.costPerMW, record.uptime, record.curCapacity, record.emissionRate);
+        plant->setOnline(record.online != 0);
+        if (grid.addPlantToGrid(plant)) {
+            delete plant;
+            return 1;
+        }
+        plantOrder.push_back(plant);
+    }
+
+    auto demandRecords = reinterpret_cast<const GridImageDemand*>(image + header().demandOffset);
+    for (uint32_t d = 0; d < header().demandCount; d++) {
+        const GridImageDemand& record = demandRecords[d];
+        if (grid.addDemand(Demand(text(record.locationOffset), record.required, record.retailPrice)))
+            return 1;
+    }
+
+    auto lineRecords = reinterpret_cast<const GridImageLine*>(image + header().lineOffset);
+    for (uint32_t l = 0; l < header().lineCount; l++) {
+        const GridImageLine& record = lineRecords[l];
+        TransLine line(text(record.lineIDOffset), record.maxCapacity, record.efficiency);
+        if (record.derateFactor != 1)
+            line.derate(record.derateFactor);
+        if (grid.addTransLine(line))
+            return 1;
+    }
+    return 0;
+}
+
+
+//********************************************************
+//*****             Shard Coordinator                *****
+//********************************************************
+
+ShardCoordinator::~ShardCoordinator() {
+    shutdown();
+}
+
+const GridImage& ShardCoordinator::getImage() const { return image; }
+
+
+//
+// publish():  Writes the grid image the workers map
+//
+int ShardCoordinator::publish(PowerGrid& grid) {
+    return image.create(grid, "/powergrid-image-" + to_string(getpid()));
+}
+
+
+//
+// createRings():  Maps one ring per worker.  The segment is removed as soon
+//                 as it is mapped; the workers inherit the mapping.
+//
+int ShardCoordinator::createRings(int workerCount) {
+    string name = "/powergrid-rings-" + to_string(getpid());
+    ringBytes = size_t(workerCount) * sizeof(ShardRing);
+
+    shm_unlink(name.c_str());
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0 || ftruncate(fd, off_t(ringBytes)) < 0) {
+        cerr << "Error: Unable to create shared memory " << name << ": " << strerror(errno) << endl;
+        if (fd >= 0) {
+            ::close(fd);
+            shm_unlink(name.c_str());
+        }
+        return 1;
+    }
+
+    void* data = mmap(nullptr, ringBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    shm_unlink(name.c_str());
+    if (data == MAP_FAILED) {
+        cerr << "Error: Unable to map shared memory " << name << ": " << strerror(errno) << endl;
+        return 1;
+    }
+
+    rings = static_cast<ShardRing*>(data);
+    for (int w = 0; w < workerCount; w++) {
+        new (&rings[w]) ShardRing;
+        rings[w].head.store(0, memory_order_relaxed);
+        rings[w].tail.store(0, memory_order_relaxed);
+        rings[w].status.store(SHARD_RUNNING, memory_order_relaxed);
+    }
+    return 0;
+}
+
+
+void ShardCoordinator::removeRings() {
+    if (rings)
+        munmap(rings, ringBytes);
+    rings = nullptr;
+    ringBytes = 0;
+}
+
+
+//
+// runWorker():  Maps the image, rebuilds the grid, and runs trials
+//               first .. last - 1, passing each result back through ring
+//
+int ShardCoordinator::runWorker(const string& imageName, ShardRing& ring, uint64_t first, uint64_t last) {
+    Plant::setDestroyLog(false);
+
+    GridImage image;
+    PowerGrid grid;
+    vector<Plant*> plantOrder;
+    grid.setThreadCount(1);
+    if (image.open(imageName) || image.buildGrid(grid, plantOrder)) {
+        ring.status.store(SHARD_FAILED, memory_order_release);
+        grid.shutdownGrid();
+        return 1;
+    }
+
+    // The lines stay in the image's order, which is the coordinator's
+    grid.adjustPlantsForConditions();
+    grid.setAllocationLog(false);
+    grid.setDispatchPolicy(DP_COST);
+    TrialGrid trialGrid = getTrialGrid(grid, plantOrder);
+
+    uint64_t head = 0;
+    for (uint64_t trial = first; trial < last; trial++) {
+        TrialResult result = runTrial(grid, trialGrid, trial);
+
+        // Wait for the coordinator to make room
+        while (head - ring.tail.load(memory_order_acquire) >= SHARD_RING_SLOTS)
+            this_thread::sleep_for(chrono::microseconds(SHARD_POLL_US));
+
+        ring.slots[head % SHARD_RING_SLOTS] = result;
+        ring.head.store(++head, memory_order_release);
+    }
+
+    ring.status.store(SHARD_DONE, memory_order_release);
+    grid.shutdownGrid();
+    return 0;
+}
+
+
+//
+// run():  Forks the workers, each with a contiguous shard of the trials,
+//         and collects their results
+//
+int ShardCoordinator::run(uint64_t trialCount, int workerCount, vector<TrialResult>& results) {
+    results.clear();
+    if (!image.getBytes()) {
+        cerr << "Error: No grid image published" << endl;
+        return 1;
+    }
+    if (trialCount == 0)
+        return 0;
+
+    workerCount = int(min<uint64_t>(max(1, workerCount), trialCount));
+    if (createRings(workerCount))
+        return 1;
+
+    // Output buffered now would otherwise be written again by each worker
+    cout.flush();
+    cerr.flush();
+
+    int rc = 0;
+    for (int w = 0; w < workerCount; w++) {
+        uint64_t first = trialCount * w / workerCount;
+        uint64_t last = trialCount * (w + 1) / workerCount;
+
+        pid_t pid = fork();
+        if (pid < 0) {
+            cerr << "Error: Unable to start worker: " << strerror(errno) << endl;
+            rc = 1;
+            break;
+        }
+        if (pid == 0)
+            _exit(runWorker(image.getName(), rings[w], first, last));
+        workers.push_back(pid);
+    }
+
+    if (rc == 0)
+        rc = collect(trialCount, results);
+
+    stopWorkers();
+    removeRings();
+    return rc;
+}
+
+
+//
+// collect():  Drains the rings into results by trial number until every
+//             trial is in.  Stops early if a worker fails or exits before
+//             sending its whole shard.
+//
+int ShardCoordinator::collect(uint64_t trialCount, vector<TrialResult>& results) {
+    uint64_t workerCount = workers.size();
+    results.assign(trialCount, TrialResult());
+    uint64_t remaining = trialCount;
+
+    while (remaining > 0) {
+        bool progress = false;
+        for (uint64_t w = 0; w < workerCount; w++) {
+            ShardRing& ring = rings[w];
+            uint64_t head = ring.head.load(memory_order_acquire);
+            uint64_t tail = ring.tail.load(memory_order_relaxed);
+            if (tail == head)
+                continue;
+
+            for (; tail < head; tail++) {
+                const TrialResult& result = ring.slots[tail % SHARD_RING_SLOTS];
+                if (result.trial >= trialCount) {
+                    cerr << "Error: Worker " << w << " sent unknown trial " << result.trial << endl;
+                    return 1;
+                }
+                results[result.trial] = result;
+                remaining--;
+            }
+            ring.tail.store(tail, memory_order_release);
+            progress = true;
+        }
+        if (progress)
+            continue;
+
+        // Nothing new: look for workers that have stopped
+        for (uint64_t w = 0; w < workerCount; w++) {
+            uint64_t shard = trialCount * (w + 1) / workerCount - trialCount * w / workerCount;
+            bool exited = false;
+            int status;
+            if (workers[w] > 0 && waitpid(workers[w], &status, WNOHANG) == workers[w]) {
+                workers[w] = 0;
+                exited = true;
+            }
+
+            if (rings[w].status.load(memory_order_acquire) == SHARD_FAILED ||
+                (exited && rings[w].head.load(memory_order_acquire) < shard)) {
+                cerr << "Error: Worker " << w << " stopped before finishing its trials" << endl;
+                return 1;
+            }
+        }
+        this_thread::sleep_for(chrono::microseconds(SHARD_POLL_US));
+    }
+    return 0;
+}
+
+
+//
+// stopWorkers():  Waits for every worker, ending any still running after
+//                 a failure
+//
+void ShardCoordinator::stopWorkers() {
+    for (size_t w = 0; w < workers.size(); w++) {
+        if (workers[w] <= 0)
+            continue;
+        if (!rings || rings[w].status.load(memory_order_acquire) != SHARD_DONE)
+            kill(workers[w], SIGTERM);
+        waitpid(workers[w], nullptr, 0);
+    }
+    workers.clear();
+}
+
+
+//
+// shutdown():  Stops any workers and removes the shared memory
+//
+void ShardCoordinator::shutdown() {
+    stopWorkers();
+    removeRings();
+    image.close();
+}
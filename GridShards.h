@@ -0,0 +1,196 @@
+#pragma once
+// File: GridShards.h
+//
+// Contains the shared memory grid image and the coordinator that runs
+// Monte Carlo trials of the grid in worker processes.
+//
+// Each trial forces a random set of plants out and scales each location's
+// requirement by a random factor, then dispatches in merit order and
+// records what was supplied, what was short, and what it cost.  A trial's
+// random draws depend only on its number, so the results do not depend on
+// how the trials are split between workers.
+//
+// The coordinator writes the loaded grid into a POSIX shared memory
+// segment once.  The image holds no pointers: records refer to each other
+// and to their names by offset from the start of the segment, so every
+// worker can map it read only at whatever address it gets:
+//
+//      offset 0            GridImageHeader
+//      plantOffset         GridImagePlant[plantCount]
+//      demandOffset        GridImageDemand[demandCount]
+//      lineOffset          GridImageLine[lineCount]
+//      stringOffset        names, each null terminated
+//
+// Each worker is a separate process with its own memory and allocator.  It
+// maps the image, rebuilds a grid from it, and runs one contiguous shard
+// of the trials.  Results come back through a second segment holding one
+// single producer, single consumer ring of SHARD_RING_SLOTS results per
+// worker, so no locks are shared between processes.  The coordinator
+// stores each result by trial number, so the results come out in trial
+// order whatever the number of workers.
+//
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include "GridDef.h"
+#include "PowerGrid.h"
+using namespace std;
+
+// Image header, 64 bytes
+struct GridImageHeader {
+    char        magic[8];           // IMAGE_MAGIC
+    uint32_t    plantCount;
+    uint32_t    demandCount;
+    uint32_t    lineCount;
+    uint32_t    reserved;
+    uint64_t    plantOffset;
+    uint64_t    demandOffset;
+    uint64_t    lineOffset;
+    uint64_t    stringOffset;
+    uint64_t    totalBytes;
+};
+
+// A plant as its source calculated it, in the source grid's list order
+struct GridImagePlant {
+    uint64_t    nameOffset;
+    uint64_t    typeOffset;
+    int32_t     sustainScore;
+    uint32_t    online;
+    double      maxCapacity;
+    double      curCapacity;
+    double      costPerMW;
+    double      uptime;
+    double      emissionRate;
+};
+
+struct GridImageDemand {
+    uint64_t    locationOffset;
+    double      required;
+    double      retailPrice;
+};
+
+// Lines in the source grid's order, efficiency order once sorted
+struct GridImageLine {
+    uint64_t    lineIDOffset;
+    double      efficiency;
+    double      maxCapacity;
+    double      derateFactor;
+};
+
+// Outcome of one trial
+struct TrialResult {
+    uint64_t    trial;
+    double      supplied;           // MW delivered to locations
+    double      unserved;           // MW locations were short
+    double      cost;               // Generation cost
+    double      revenue;            // What the locations paid
+    uint32_t    plantsOut;          // Plants forced out
+    uint32_t    shortLocations;     // Locations not fully served
+
+    bool operator==(const TrialResult& other) const;
+};
+
+// Averages over a set of trials
+struct ShardSummary {
+    uint64_t    trials = 0;
+    double      supplied = 0;       // Mean MW delivered
+    double      unserved = 0;       // Mean MW short
+    double      cost = 0;           // Mean generation cost
+    double      revenue = 0;
+    double      lossOfLoad = 0;     // Share of trials with any location short
+    double      plantsOut = 0;      // Mean plants forced out
+};
+
+
+//
+// Class GridImage
+//
+class GridImage {
+private:
+    string      segmentName;
+    int         fd = -1;
+    void*       base = nullptr;
+    size_t      bytes = 0;
+    bool        owner = false;      // The creator removes the segment
+
+    const GridImageHeader& header() const;
+    const char* text(uint64_t offset) const;
+
+public:
+    ~GridImage();
+
+    // Writes the grid into a new segment and maps it read only.  Returns 1
+    // if the segment cannot be created.
+    int create(PowerGrid& grid, const string& name);
+    int open(const string& name);           // Maps an existing image read only
+    void close();
+
+    // Adds the image's plants, demands, and lines to an empty grid.
+    // plantOrder gets the plants in the source grid's list order.
+    int buildGrid(PowerGrid& grid, vector<Plant*>& plantOrder) const;
+
+    const string& getName() const;
+    size_t getBytes() const;
+    uint32_t getPlantCount() const;
+    uint32_t getDemandCount() const;
+    uint32_t getLineCount() const;
+};
+
+
+//
+// ShardRing:  Results from one worker to the coordinator.  The worker
+//             only writes head and the slots, the coordinator only tail.
+//
+struct ShardRing {
+    alignas(64) atomic<uint64_t>    head;   // Results written
+    alignas(64) atomic<uint64_t>    tail;   // Results read
+    alignas(64) atomic<int32_t>     status; // SHARD_RUNNING, SHARD_DONE, or SHARD_FAILED
+    TrialResult                     slots[SHARD_RING_SLOTS];
+};
+
+enum ShardStatus : int32_t {
+    SHARD_RUNNING = 0,
+    SHARD_DONE,
+    SHARD_FAILED
+};
+
+
+//
+// Class ShardCoordinator
+//
+class ShardCoordinator {
+private:
+    GridImage       image;
+    ShardRing*      rings = nullptr;        // One per worker of the current run
+    size_t          ringBytes = 0;
+    vector<pid_t>   workers;
+
+    int createRings(int workerCount);
+    void removeRings();
+    int collect(uint64_t trialCount, vector<TrialResult>& results);
+    void stopWorkers();
+
+    // Body of a worker process; returns its exit code
+    static int runWorker(const string& imageName, ShardRing& ring, uint64_t first, uint64_t last);
+
+public:
+    ~ShardCoordinator();
+
+    int publish(PowerGrid& grid);           // Writes the grid image for the workers
+    // Forks workerCount workers to run trials 0 .. trialCount - 1 and
+    // gathers their results in trial order.  Returns 1 if a worker fails.
+    int run(uint64_t trialCount, int workerCount, vector<TrialResult>& results);
+    void shutdown();                        // Removes the shared memory segments
+
+    const GridImage& getImage() const;
+};
+
+
+// Runs trials first .. first + count - 1 in this process on grid, then
+// restores its plants and demands and dispatches it again.  Workers must
+// match these results exactly.
+vector<TrialResult> runTrialsInProcess(PowerGrid& grid, uint64_t first, uint64_t count);
+
+ShardSummary summarizeTrials(const vector<TrialResult>& results);
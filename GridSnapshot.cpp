@@ -0,0 +1,306 @@
+// File: GridSnapshot.cpp
+//
+// Contains the function definitions for grid snapshots, the snapshot
+// domain, and the snapshot stress test.  See GridSnapshot.h.
+//
+#include "GridSnapshot.h"
+#include "PowerGrid.h"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <chrono>
+#include <cmath>
+using namespace std;
+
+
+//
+// GridSnapshot lookups
+//
+const PlantState* GridSnapshot::findPlant(const string& name) const {
+    auto it = plantIndex.find(name);
+    return (it == plantIndex.end()) ? nullptr : &plants[it->second];
+}
+
+const DemandState* GridSnapshot::findDemand(const string& location) const {
+    auto it = demandIndex.find(location);
+    return (it == demandIndex.end()) ? nullptr : &demands[it->second];
+}
+
+
+
+//********************************************************
+//*****             Snapshot Domain                  *****
+//********************************************************
+
+//
+//  Constructors and Destructors
+//
+SnapshotDomain::SnapshotDomain() : current(nullptr), globalEpoch(1), nextVersion(1) {
+    for (auto& slot : slots) {
+        slot.epoch = 0;
+        slot.inUse = false;
+    }
+}
+
+// No readers may be active when the domain is destroyed
+SnapshotDomain::~SnapshotDomain() {
+    for (auto& r : retired)
+        delete r.snapshot;
+    delete current.load();
+}
+
+
+//
+// registerReader():  Claims a free reader slot for the calling thread
+//
+int SnapshotDomain::registerReader() {
+    for (int i = 0; i < MAX_SNAPSHOT_READERS; i++) {
+        bool expected = false;
+        if (slots[i].inUse.compare_exchange_strong(expected, true))
+            return i;
+    }
+    return -1;
+}
+
+void SnapshotDomain::unregisterReader(int slot) {
+    slots[slot].epoch = 0;
+    slots[slot].inUse = false;
+}
+
+
+//
+// enter():  Starts a read section.  The epoch is announced before the
+//           pointer is loaded, so the writer cannot free the snapshot
+//           this reader is about to see.  Wait free.
+//
+const GridSnapshot* SnapshotDomain::enter(int slot) {
+    slots[slot].epoch.store(globalEpoch.load());
+    return current.load();
+}
+
+//
+// exit():  Ends a read section.  Wait free.
+//
+void SnapshotDomain::exit(int slot) {
+    slots[slot].epoch.store(0, memory_order_release);
+}
+
+
+//
+// publish():  Makes next the current snapshot and retires the old one
+//
+void SnapshotDomain::publish(GridSnapshot* next) {
+    next->version = nextVersion++;
+
+    const GridSnapshot* old = current.exchange(next);
+    uint64_t epoch = globalEpoch.fetch_add(1) + 1;
+
+    if (old)
+        retired.push_back({ old, epoch });
+
+    // Keep the retired list bounded, waiting for slow readers if needed
+    while (reclaim() > MAX_RETIRED_SNAPSHOTS)
+        this_thread::yield();
+}
+
+
+//
+// reclaim():  Frees every retired snapshot that no reader can still hold.
+//             A reader in an epoch at or after the retire epoch loaded
+//             the pointer after the snapshot was replaced.
+//
+size_t SnapshotDomain::reclaim() {
+    uint64_t oldestActive = UINT64_MAX;
+    for (auto& slot : slots) {
+        uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < oldestActive)
+            oldestActive = epoch;
+    }
+
+    size_t kept = 0;
+    for (auto& r : retired) {
+        if (r.epoch <= oldestActive)
+            delete r.snapshot;
+        else
+            retired[kept++] = r;
+    }
+    retired.resize(kept);
+    return kept;
+}
+
+size_t SnapshotDomain::getRetiredCount() const { return retired.size(); }
+
+
+
+//********************************************************
+//*****       PowerGrid snapshot publication         *****
+//********************************************************
+
+//
+// buildSnapshot():  Copies the current state of the grid
+//
+GridSnapshot* PowerGrid::buildSnapshot() const {
+    GridSnapshot* snapshot = new GridSnapshot;
+
+    snapshot->plants.reserve(plants.size());
+    for (auto plant : plants) {
+        snapshot->plantIndex[plant->getName()] = snapshot->plants.size();
+        snapshot->plants.push_back({ plant->getName(), plant->getType(), plant->getMaxCapacity(),
+            plant->getCurCapacity(), plant->getAvailCapacity(), plant->getCostPerMW() });
+    }
+
+    snapshot->demands.reserve(demands.size());
+    for (auto& demand : demands) {
+        snapshot->demandIndex[demand.getLocation()] = snapshot->demands.size();
+        snapshot->demands.push_back({ demand.getLocation(), demand.getStatus(), demand.getPowerRequired(),
+            demand.getPowerAcquired(), demand.getPowerDeficit(), demand.getTotalPowerPrice(),
+            demand.getTotalPowerCost() });
+    }
+
+    snapshot->lines.reserve(transLines.size());
+    for (auto& line : transLines)
+        snapshot->lines.push_back({ line.getLineID(), line.getMaxCapacity(), line.getAvailCapacity(), line.getEfficiency() });
+
+    snapshot->stats = computeStats();
+    return snapshot;
+}
+
+
+//
+// publishSnapshot():  Publishes the current state to snapshot readers
+//
+void PowerGrid::publishSnapshot() {
+    snapshots.publish(buildSnapshot());
+}
+
+//
+// setSnapshotPublishing():  When on, distributePower() publishes a new
+//                           snapshot after every dispatch
+//
+void PowerGrid::setSnapshotPublishing(bool enable) {
+    snapshotPublishing = enable;
+    if (enable)
+        publishSnapshot();
+}
+
+SnapshotDomain& PowerGrid::getSnapshots() { return snapshots; }
+
+
+//
+// publishDispatch():  Publishes the result of a dispatch to snapshot
+//                     readers and to the monitor export, if they are on
+//
+void PowerGrid::publishDispatch() {
+    if (snapshotPublishing)
+        publishSnapshot();
+    if (monitorExport)
+        publishMonitor();
+}
+
+
+
+//********************************************************
+//*****             Snapshot Stress Test             *****
+//********************************************************
+
+//
+// checkSnapshot():  Returns the number of inconsistencies in a snapshot.
+//                   Every value in a snapshot comes from one dispatch,
+//                   so the totals must agree with the entries.
+//
+static int checkSnapshot(const GridSnapshot& snapshot) {
+    int errors = 0;
+    double acquired = 0;
+
+    for (auto& demand : snapshot.demands) {
+        acquired += demand.acquired;
+        if (demand.acquired > demand.required + 0.01)
+            errors++;
+    }
+    if (fabs(acquired - snapshot.stats.demands.acquired.sum()) > 1e-6 * (1 + acquired))
+        errors++;
+
+    for (auto& plant : snapshot.plants) {
+        if (plant.availCapacity > plant.curCapacity + 1e-6)
+            errors++;
+    }
+    return errors;
+}
+
+
+//
+// runSnapshotStress():  Re-dispatches continuously on this thread while
+//      readerCount threads read and check snapshots.  Returns 1 if any
+//      reader saw an inconsistent snapshot or a version going backwards.
+//
+int runSnapshotStress(PowerGrid& grid, int readerCount, double seconds) {
+    atomic<bool>    done(false);
+    atomic<long>    totalReads(0);
+    atomic<int>     totalErrors(0);
+    vector<thread>  readers;
+    SnapshotDomain& domain = grid.getSnapshots();
+
+    grid.setAllocationLog(false);
+    grid.setSnapshotPublishing(true);
+
+    for (int r = 0; r < readerCount; r++) {
+        readers.emplace_back([&]() {
+            int slot = domain.registerReader();
+            if (slot < 0) return;
+
+            uint64_t lastVersion = 0;
+            long reads = 0;
+            int errors = 0;
+            while (!done.load(memory_order_relaxed)) {
+                SnapshotGuard snapshot(domain, slot);
+                if (snapshot->version < lastVersion)
+                    errors++;
+                lastVersion = snapshot->version;
+                errors += checkSnapshot(*snapshot.get());
+                reads++;
+            }
+
+            domain.unregisterReader(slot);
+            totalReads += reads;
+            totalErrors += errors;
+        });
+    }
+
+    // Writer: vary the first demand and re-dispatch until the time is up
+    string location;
+    {
+        int slot = domain.registerReader();
+        SnapshotGuard snapshot(domain, slot);
+        if (!snapshot->demands.empty())
+            location = snapshot->demands[0].location;
+        domain.unregisterReader(slot);
+    }
+
+    long dispatches = 0;
+    size_t maxRetired = 0;
+    auto start = chrono::steady_clock::now();
+    auto elapsed = [&]() { return chrono::duration<double>(chrono::steady_clock::now() - start).count(); };
+
+    while (elapsed() < seconds) {
+        grid.setDemandRequired(location, 1000 + (dispatches % 1000));
+
+        grid.resetDispatch();
+        grid.distributePower();
+        maxRetired = max(maxRetired, domain.getRetiredCount());
+        dispatches++;
+    }
+
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    double runTime = elapsed();
+
+    cout << "\n\t--- Snapshot Stress Test (" << readerCount << " readers) ---\n";
+    cout << std::fixed << std::setprecision(0);
+    cout << "    Dispatches published:  " << dispatches << endl;
+    cout << "    Snapshot reads:        " << totalReads << " (" << totalReads / runTime << "/sec)" << endl;
+    cout << "    Max retired snapshots: " << maxRetired << endl;
+    cout << "    Inconsistencies:       " << totalErrors << endl;
+
+    return totalErrors ? 1 : 0;
+}
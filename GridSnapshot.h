@@ -0,0 +1,125 @@
+#pragma once
+// File: GridSnapshot.h
+//
+// Contains the immutable grid snapshot and the epoch based domain that
+// publishes snapshots to reader threads.
+//
+// The dispatch thread (the writer) copies the numeric state of the grid
+// into a new GridSnapshot and publishes it with one atomic pointer swap.
+// Readers never lock: entering a read section is one load and one store
+// to the reader's own slot, so a reader can never be blocked by dispatch
+// and never blocks it.
+//
+// A replaced snapshot is retired with the epoch it was replaced in and
+// freed once no reader slot is still in an older epoch.  At most
+// MAX_RETIRED_SNAPSHOTS are kept; beyond that the writer waits for slow
+// readers, so memory use is bounded.
+//
+#include <atomic>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include "GridDef.h"
+#include "GridStats.h"
+using namespace std;
+
+struct PlantState {
+    string  name;
+    string  type;
+    double  maxCapacity;
+    double  curCapacity;
+    double  availCapacity;
+    double  costPerMW;
+};
+
+struct DemandState {
+    string  location;
+    string  status;
+    double  required;
+    double  acquired;
+    double  deficit;
+    double  price;
+    double  cost;
+};
+
+struct LineState {
+    string  lineID;
+    double  maxCapacity;
+    double  availCapacity;
+    double  efficiency;
+};
+
+//
+// GridSnapshot:  One consistent, read only version of the grid's state
+//
+struct GridSnapshot {
+    uint64_t                        version = 0;
+    vector<PlantState>              plants;
+    vector<DemandState>             demands;
+    vector<LineState>               lines;
+    unordered_map<string, size_t>   plantIndex;
+    unordered_map<string, size_t>   demandIndex;
+    GridStats                       stats;
+
+    const PlantState* findPlant(const string& name) const;
+    const DemandState* findDemand(const string& location) const;
+};
+
+
+//
+// Class SnapshotDomain
+//
+class SnapshotDomain {
+private:
+    // One slot per reader thread, on its own cache line.  epoch is 0 while
+    // the reader holds no snapshot.
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t>    epoch;
+        atomic<bool>        inUse;
+    };
+
+    struct Retired {
+        const GridSnapshot* snapshot;
+        uint64_t            epoch;
+    };
+
+    atomic<const GridSnapshot*> current;
+    atomic<uint64_t>            globalEpoch;
+    ReaderSlot                  slots[MAX_SNAPSHOT_READERS];
+    vector<Retired>             retired;        // Only used by the writer
+    uint64_t                    nextVersion;
+
+    size_t reclaim();
+
+public:
+    SnapshotDomain();
+    ~SnapshotDomain();
+
+    // Reader side
+    int registerReader();                       // Returns a slot, or -1 if all are in use
+    void unregisterReader(int slot);
+    const GridSnapshot* enter(int slot);        // May return nullptr before the first publish
+    void exit(int slot);
+
+    // Writer side - one writer at a time
+    void publish(GridSnapshot* next);
+    size_t getRetiredCount() const;
+};
+
+
+//
+// SnapshotGuard:  Holds a snapshot for the lifetime of the guard
+//
+class SnapshotGuard {
+private:
+    SnapshotDomain&     domain;
+    int                 slot;
+    const GridSnapshot* snapshot;
+
+public:
+    SnapshotGuard(SnapshotDomain& domain, int slot) : domain(domain), slot(slot), snapshot(domain.enter(slot)) {}
+    ~SnapshotGuard() { domain.exit(slot); }
+
+    const GridSnapshot* get() const { return snapshot; }
+    const GridSnapshot* operator->() const { return snapshot; }
+};
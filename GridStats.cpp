@@ -0,0 +1,257 @@
+// File: GridStats.cpp
+//
+// Contains the function definitions for the grid statistics engine.
+// See GridStats.h for a description of the aggregates.
+//
+#include "GridDef.h"
+#include "GridStats.h"
+#include "PowerGrid.h"
+#include "TaskPool.h"
+#include <algorithm>
+#include <cmath>
+using namespace std;
+
+
+//
+// CompensatedSum::add():  Neumaier summation.  The low order bits lost
+//                         when adding value are kept in error.
+//
+void CompensatedSum::add(double value) {
+    double t = sum + value;
+
+    if (fabs(sum) >= fabs(value))
+        error += (sum - t) + value;
+    else
+        error += (value - t) + sum;
+    sum = t;
+}
+
+void CompensatedSum::merge(const CompensatedSum& other) {
+    add(other.sum);
+    add(other.error);
+}
+
+
+//
+// FieldStats
+//
+void FieldStats::add(double value) {
+    if (count == 0 || value < minValue) minValue = value;
+    if (count == 0 || value > maxValue) maxValue = value;
+    total.add(value);
+    count++;
+}
+
+void FieldStats::merge(const FieldStats& other) {
+    if (other.count == 0)
+        return;
+
+    if (count == 0 || other.minValue < minValue) minValue = other.minValue;
+    if (count == 0 || other.maxValue > maxValue) maxValue = other.maxValue;
+    total.merge(other.total);
+    count += other.count;
+}
+
+
+//
+// PlantStats
+//
+void PlantStats::add(const Plant& plant) {
+    sustain.add(plant.getSustainScore());
+    maxCapacity.add(plant.getMaxCapacity());
+    curCapacity.add(plant.getCurCapacity());
+    availCapacity.add(plant.getAvailCapacity());
+    usedCapacity.add(plant.getMaxCapacity() - plant.getAvailCapacity());
+    uptime.add(plant.getUptimePercent());
+    costPerMW.add(plant.getCostPerMW());
+    count++;
+}
+
+void PlantStats::merge(const PlantStats& other) {
+    sustain.merge(other.sustain);
+    maxCapacity.merge(other.maxCapacity);
+    curCapacity.merge(other.curCapacity);
+    availCapacity.merge(other.availCapacity);
+    usedCapacity.merge(other.usedCapacity);
+    uptime.merge(other.uptime);
+    costPerMW.merge(other.costPerMW);
+    count += other.count;
+}
+
+
+//
+// DemandStats
+//
+void DemandStats::add(const Demand& demand) {
+    required.add(demand.getPowerRequired());
+    acquired.add(demand.getPowerAcquired());
+    deficit.add(demand.getPowerDeficit());
+    price.add(demand.getTotalPowerPrice());
+    cost.add(demand.getTotalPowerCost());
+    profit.add(demand.getTotalPowerPrice() - demand.getTotalPowerCost());
+
+    requiredTicks += demand.getRequiredTicks();
+    acquiredTicks += demand.getAcquiredTicks();
+    priceTicks += demand.getTotalPriceTicks();
+    costTicks += demand.getTotalCostTicks();
+
+    if (demand.getPowerDeficit() == 0)
+        metCount++;
+    count++;
+}
+
+void DemandStats::merge(const DemandStats& other) {
+    required.merge(other.required);
+    acquired.merge(other.acquired);
+    deficit.merge(other.deficit);
+    price.merge(other.price);
+    cost.merge(other.cost);
+    profit.merge(other.profit);
+
+    requiredTicks += other.requiredTicks;
+    acquiredTicks += other.acquiredTicks;
+    priceTicks += other.priceTicks;
+    costTicks += other.costTicks;
+
+    metCount += other.metCount;
+    count += other.count;
+}
+
+double DemandStats::percentMet() const {
+    return (acquired.sum() / required.sum()) * 100;
+}
+
+
+//
+// LineStats
+//
+void LineStats::add(const TransLine& line) {
+    maxCapacity.add(line.getMaxCapacity());
+    availCapacity.add(line.getAvailCapacity());
+    usedCapacity.add(line.getMaxCapacity() - line.getAvailCapacity());
+    efficiency.add(line.getEfficiency());
+    count++;
+}
+
+void LineStats::merge(const LineStats& other) {
+    maxCapacity.merge(other.maxCapacity);
+    availCapacity.merge(other.availCapacity);
+    usedCapacity.merge(other.usedCapacity);
+    efficiency.merge(other.efficiency);
+    count += other.count;
+}
+
+
+//
+// GridStats
+//
+double GridStats::profit() const {
+    return demands.price.sum() - demands.cost.sum();
+}
+
+double GridStats::efficiency() const {
+    return demands.acquired.sum() / plants.usedCapacity.sum();
+}
+
+
+//
+// Support functions to reach the object behind each collection entry
+//
+static const Plant& entryOf(Plant* const& plant) { return *plant; }
+static const Demand& entryOf(const Demand& demand) { return demand; }
+static const TransLine& entryOf(const TransLine& line) { return line; }
+
+static string groupOf(Plant* const& plant) { return plant->getType(); }
+static string groupOf(const Demand& demand) { return demand.getStatus(); }
+static string groupOf(const TransLine&) { return ""; }
+
+
+//
+// summarize():  Splits the collection into one chunk per pool thread,
+//               summarizes the chunks as pool tasks, and merges the partial
+//               results in chunk order.  When groups is given the entries
+//               are also summarized by their group.
+//
+template<typename Stats, typename Item>
+static void summarize(const vector<Item>& items, TaskPool* pool,
+                      Stats& total, map<string, Stats>* groups) {
+    struct Partial {
+        Stats               total;
+        map<string, Stats>  groups;
+    };
+
+    size_t chunkCount = (!pool || items.size() < STATS_PARALLEL_THRESHOLD) ? 1 : pool->getThreadCount();
+    vector<Partial> partials(chunkCount);
+
+    auto summarizeChunk = [&](size_t chunk) {
+        size_t first = items.size() * chunk / chunkCount;
+        size_t last = items.size() * (chunk + 1) / chunkCount;
+
+        for (size_t i = first; i < last; i++) {
+            partials[chunk].total.add(entryOf(items[i]));
+            if (groups)
+                partials[chunk].groups[groupOf(items[i])].add(entryOf(items[i]));
+        }
+    };
+
+    if (chunkCount == 1) {
+        summarizeChunk(0);
+    }
+    else {
+        pool->parallelFor(chunkCount, 1, [&](size_t first, size_t last) {
+            for (size_t chunk = first; chunk < last; chunk++)
+                summarizeChunk(chunk);
+        });
+    }
+
+    // Merge in chunk order so the result does not depend on thread timing
+    for (auto& partial : partials) {
+        total.merge(partial.total);
+        if (groups) {
+            for (auto& group : partial.groups)
+                (*groups)[group.first].merge(group.second);
+        }
+    }
+}
+
+
+//
+// computeGridStats():  Computes all the aggregates for the grid
+//
+GridStats computeGridStats(const vector<Plant*>& plants, const vector<Demand>& demands,
+                           const vector<TransLine>& lines, TaskPool* pool) {
+    GridStats stats;
+
+    summarize(plants, pool, stats.plants, &stats.plantsByType);
+    summarize(demands, pool, stats.demands, &stats.demandsByStatus);
+    summarize(lines, pool, stats.lines, (map<string, LineStats>*)nullptr);
+
+    return stats;
+}
+
+
+//********************************************************
+//*****           PowerGrid statistics               *****
+//********************************************************
+
+//
+// getPlantList():  Copies the plant pointers into a vector in list order
+//
+vector<Plant*> PowerGrid::getPlantList() const {
+    vector<Plant*> list;
+    list.reserve(plants.size());
+    for (auto plant : plants)
+        list.push_back(plant);
+    return list;
+}
+
+const vector<Demand>& PowerGrid::getDemandList() const { return demands; }
+const vector<TransLine>& PowerGrid::getLineList() const { return transLines; }
+
+
+//
+// computeStats():  Summarizes every collection of the grid in one pass
+//
+GridStats PowerGrid::computeStats() const {
+    return computeGridStats(getPlantList(), demands, transLines, &getTaskPool());
+}
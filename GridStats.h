@@ -0,0 +1,118 @@
+#pragma once
+// File: GridStats.h
+//
+// Contains the statistics engine used to summarize the grid.
+//
+// All the totals, means, and ranges used by the reports are computed in
+// one pass over each collection.  Large collections are split into chunks
+// that are summarized in parallel and then combined in chunk order, so
+// the results do not depend on thread timing.  Floating point totals use
+// Neumaier (compensated) summation, and the demand totals are also kept
+// as exact fixed point sums that are identical for any thread count.
+//
+// Results are also grouped by plant type and by demand status so reports
+// and dashboards can read them without walking the grid again.
+//
+#include <vector>
+#include <map>
+#include <string>
+#include "Plant.h"
+#include "Demand.h"
+#include "TransLine.h"
+#include "FixedPoint.h"
+using namespace std;
+
+//
+// CompensatedSum:  Running sum that carries the rounding error of each add
+//
+struct CompensatedSum {
+    double  sum = 0;
+    double  error = 0;
+
+    void add(double value);
+    void merge(const CompensatedSum& other);
+    double value() const { return sum + error; }
+};
+
+//
+// FieldStats:  Total, mean, minimum, and maximum of one attribute
+//
+struct FieldStats {
+    CompensatedSum  total;
+    double          minValue = 0;
+    double          maxValue = 0;
+    size_t          count = 0;
+
+    void add(double value);
+    void merge(const FieldStats& other);
+    double sum() const { return total.value(); }
+    double mean() const { return count ? total.value() / count : 0; }
+};
+
+struct PlantStats {
+    size_t      count = 0;
+    FieldStats  sustain;
+    FieldStats  maxCapacity;
+    FieldStats  curCapacity;
+    FieldStats  availCapacity;
+    FieldStats  usedCapacity;       // maxCapacity - availCapacity
+    FieldStats  uptime;
+    FieldStats  costPerMW;
+
+    void add(const Plant& plant);
+    void merge(const PlantStats& other);
+};
+
+struct DemandStats {
+    size_t      count = 0;
+    size_t      metCount = 0;
+    FieldStats  required;
+    FieldStats  acquired;
+    FieldStats  deficit;
+    FieldStats  price;              // Total retail price owed by each location
+    FieldStats  cost;               // Total cost of the power for each location
+    FieldStats  profit;
+
+    // Exact fixed point totals
+    PowerTicks  requiredTicks = 0;
+    PowerTicks  acquiredTicks = 0;
+    MoneyTicks  priceTicks = 0;
+    MoneyTicks  costTicks = 0;
+
+    void add(const Demand& demand);
+    void merge(const DemandStats& other);
+    double percentMet() const;      // Percent of the required power supplied
+};
+
+struct LineStats {
+    size_t      count = 0;
+    FieldStats  maxCapacity;
+    FieldStats  availCapacity;
+    FieldStats  usedCapacity;
+    FieldStats  efficiency;
+
+    void add(const TransLine& line);
+    void merge(const LineStats& other);
+};
+
+//
+// GridStats:  Aggregates for the whole grid and for each group
+//
+struct GridStats {
+    PlantStats                  plants;
+    map<string, PlantStats>     plantsByType;
+    DemandStats                 demands;
+    map<string, DemandStats>    demandsByStatus;
+    LineStats                   lines;
+
+    double profit() const;          // Total price less total cost
+    double efficiency() const;      // Power supplied per MW of plant capacity used
+};
+
+class TaskPool;
+
+// Computes every aggregate for the grid's collections.  Large collections
+// are split into one chunk per pool thread; with no pool they are
+// summarized on the calling thread.
+GridStats computeGridStats(const vector<Plant*>& plants, const vector<Demand>& demands,
+                           const vector<TransLine>& lines, TaskPool* pool);
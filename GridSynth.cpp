@@ -0,0 +1,1430 @@
+// File: GridSynth.cpp
+//
+// Contains the synthetic grid file generator and the benchmarks that use it.
+// See GridSynth.h.
+//
+#include "GridDef.h"
+#include "GridSynth.h"
+#include "MultiArea.h"
+#include "GridShards.h"
+#include "GridReload.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <cstring>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <sstream>
+#include <cstddef>
+#include <functional>
+#include <unistd.h>
+using namespace std;
+
+// Binary layout of TransLines.dat (see readTransLineData)
+const streamoff SYNTH_RECORD_COUNT_POS = 128;
+const streamoff SYNTH_FIRST_RECORD_POS = 1024;
+const streamoff SYNTH_RECORD_SPACING = 512;
+
+// MWh the reload benchmark's battery holds when its record is resized
+const double BATTERY_RELOAD_CHARGE = 420.0;
+
+// Share of the synthetic demand the anytime benchmark dispatches
+const double ANYTIME_BENCH_LOAD = 0.8;
+
+// Clean plants the carbon benchmark adds per synthetic fossil plant, and
+// their cost range, above the synthetic plants' $40 - $100 per MW
+const int CARBON_BENCH_CLEAN_PER_FOSSIL = 2;
+const double CARBON_BENCH_CLEAN_COST = 110.0;
+const double CARBON_BENCH_CLEAN_SPREAD = 60.0;
+
+// How far open ties may leave the supply and the cost of the flat dispatch,
+// as a share of it.  The areas keep their own lines, so they lose a little
+// more on the way.
+const double AREA_BENCH_MATCH = 0.005;
+
+struct SynthLineRecord
+{
+    char lineName[20];
+    double lineCapacity;
+    double lineEfficiency;
+};
+
+
+//
+// writeSyntheticGrid():  Writes plants, demands, and lines with random but
+//      plausible attributes.  Plant capacity is sized to roughly cover the
+//      total demand so dispatch has real work to do.
+//
+int writeSyntheticGrid(const string& plantsFile, const string& demandsFile, const string& linesFile,
+                       int plantCount, int demandCount, int lineCount, unsigned seed) {
+    mt19937 rng(seed);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    const string types[] = { PT_WIND, PT_FOSSIL, PT_DILITHIUM, PT_FUSION, PT_SOLAR,
+                             PT_HYDRO, PT_NUCLEAR, PT_GEO_THERMAL };
+
+    // Plants - two header lines, then one record per line
+    ofstream osPlant(plantsFile);
+    if (!osPlant) {
+        cerr << "Error: Unable to write file " << plantsFile << endl;
+        return 1;
+    }
+    osPlant << "   Plant   Type   Sustain   Cost   Capacity   Uptime   Specific-1   Specific-2\n";
+    osPlant << "   (synthetic grid, seed " << seed << ")\n";
+    osPlant << std::fixed << std::setprecision(2);
+
+    for (int i = 0; i < plantCount; i++) {
+        const string& type = types[i % 8];
+        double capacity = 20 + unit(rng) * 800;
+
+        osPlant << "P" << setw(7) << setfill('0') << i << setfill(' ') << "  " << type << "  "
+                << int(40 + unit(rng) * 60) << "  " << 40 + unit(rng) * 60 << "  "
+                << capacity << "  " << int(80 + unit(rng) * 20);
+
+        if (type == PT_SOLAR)            osPlant << "  " << int(capacity * 1500) << "  " << int(6 + unit(rng) * 8);
+        else if (type == PT_WIND)        osPlant << "  " << int(capacity / 2) << "  " << int(8 + unit(rng) * 15);
+        else if (type == PT_FOSSIL)      osPlant << "  " << ((i % 2) ? "Coal" : "NatGas") << "  " << int(500000 + unit(rng) * 500000);
+        else if (type == PT_HYDRO)       osPlant << "  " << int(capacity * 35000);
+        else if (type == PT_FUSION)      osPlant << "  " << 80 + unit(rng) * 20;
+        else if (type == PT_DILITHIUM)   osPlant << "  " << int(85 + unit(rng) * 15) << "  " << 150 + unit(rng) * 50;
+        osPlant << "\n";
+    }
+    osPlant.close();
+
+    // Demands - two header lines, then location, MW required, price
+    ofstream osDemand(demandsFile);
+    if (!osDemand) {
+        cerr << "Error: Unable to write file " << demandsFile << endl;
+        return 1;
+    }
+    osDemand << "Location   Power   Price per\n Name   Required   MW Hour\n";
+    osDemand << std::fixed << std::setprecision(2);
+
+    double demandScale = 300.0 * plantCount / max(1, demandCount);
+    for (int i = 0; i < demandCount; i++) {
+        osDemand << "D" << setw(7) << setfill('0') << i << setfill(' ') << "  "
+                 << demandScale * (0.2 + unit(rng) * 1.6) << "  " << 80 + unit(rng) * 60 << "\n";
+    }
+    osDemand.close();
+
+    // Lines - binary records at fixed offsets
+    ofstream osLine(linesFile, ios::binary);
+    if (!osLine) {
+        cerr << "Error: Unable to write file " << linesFile << endl;
+        return 1;
+    }
+
+    osLine.seekp(SYNTH_RECORD_COUNT_POS);
+    osLine.write(reinterpret_cast<const char*>(&lineCount), sizeof(lineCount));
+
+    double lineScale = 350.0 * plantCount / max(1, lineCount);
+    for (int i = 0; i < lineCount; i++) {
+        SynthLineRecord record;
+        memset(&record, 0, sizeof(record));
+        snprintf(record.lineName, sizeof(record.lineName), "L%07d", i);
+        record.lineCapacity = lineScale * (0.2 + unit(rng) * 1.6);
+        record.lineEfficiency = 0.70 + unit(rng) * 0.30;
+
+        osLine.seekp(SYNTH_FIRST_RECORD_POS + i * SYNTH_RECORD_SPACING);
+        osLine.write(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    // Pad the last record slot so the file has its full size
+    char pad[SYNTH_RECORD_SPACING - sizeof(SynthLineRecord)] = {};
+    osLine.write(pad, sizeof(pad));
+    osLine.close();
+
+    return 0;
+}
+
+
+//
+// syntheticFileName():  A benchmark's file in /tmp, named after its tag
+//      and the process id so runs at the same time keep to their own files
+//
+static string syntheticFileName(const string& tag, const string& suffix) {
+    return "/tmp/powergrid_" + tag + "_" + to_string(getpid()) + "_" + suffix;
+}
+
+//
+// writeSyntheticFiles():  Names a benchmark's three input files and writes
+//      a synthetic grid to them
+//
+static int writeSyntheticFiles(const string& tag, int plantCount, int demandCount, int lineCount,
+                               unsigned seed, string files[3]) {
+    files[0] = syntheticFileName(tag, "plants.txt");
+    files[1] = syntheticFileName(tag, "demands.txt");
+    files[2] = syntheticFileName(tag, "lines.dat");
+    return writeSyntheticGrid(files[0], files[1], files[2], plantCount, demandCount, lineCount, seed);
+}
+
+static void removeSyntheticFiles(const string files[3]) {
+    for (int i = 0; i < 3; i++)
+        remove(files[i].c_str());
+}
+
+//
+// prepareSyntheticGrid():  Loads the files and readies the grid the way
+//      the benchmarks run it: lines sorted, plants adjusted, and nothing
+//      logged per allocation or per plant destroyed.  The caller turns
+//      Plant::setDestroyLog() back on when it is done.
+//
+static int prepareSyntheticGrid(PowerGrid& grid, const string files[3]) {
+    Plant::setDestroyLog(false);
+    int rc = grid.loadGrid(files[0], files[1], files[2]);
+    grid.sortTransLines();
+    grid.adjustPlantsForConditions();
+    grid.setAllocationLog(false);
+    return rc;
+}
+
+//
+// loadSyntheticGrid():  Writes a synthetic grid, prepares it in grid, and
+//      removes the files again
+//
+static int loadSyntheticGrid(PowerGrid& grid, const string& tag, int plantCount, int demandCount,
+                             int lineCount, unsigned seed) {
+    string files[3];
+    int rc = writeSyntheticFiles(tag, plantCount, demandCount, lineCount, seed, files);
+    if (rc == 0)
+        rc = prepareSyntheticGrid(grid, files);
+    removeSyntheticFiles(files);
+    return rc;
+}
+
+
+//
+// timeStages():  Loads the synthetic grid with the given thread count and
+//                returns the seconds spent loading, adjusting, and summarizing
+//
+static void timeStages(unsigned threadCount, const string files[3], double seconds[3]) {
+    PowerGrid grid;
+    grid.setThreadCount(threadCount);
+    grid.getTaskPool();         // Start the threads before timing
+
+    auto start = chrono::steady_clock::now();
+    auto lap = [&]() {
+        auto now = chrono::steady_clock::now();
+        double s = chrono::duration<double>(now - start).count();
+        start = now;
+        return s;
+    };
+
+    grid.loadGrid(files[0], files[1], files[2]);
+    seconds[0] = lap();
+
+    grid.adjustPlantsForConditions();
+    seconds[1] = lap();
+
+    grid.computeStats();
+    seconds[2] = lap();
+
+    grid.shutdownGrid();
+}
+
+
+//
+// runPoolBenchmark():  Compares one thread against threadCount threads on
+//      the loading, plant update, and statistics stages
+//
+int runPoolBenchmark(int plantCount, unsigned threadCount) {
+    string files[3];
+    const char* stages[3] = { "Load files", "Adjust plants", "Grid statistics" };
+
+    if (threadCount == 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+
+    if (writeSyntheticFiles("bench", plantCount, plantCount, plantCount, 1, files)) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+
+    Plant::setDestroyLog(false);
+    double serial[3], parallel[3];
+    timeStages(1, files, serial);
+    timeStages(threadCount, files, parallel);
+    Plant::setDestroyLog(true);
+
+    cout << "\n\t--- Task Pool Benchmark (" << plantCount << " plants, demands, and lines) ---\n";
+    cout << "    Stage              1 thread     " << setw(2) << threadCount << " threads    Speedup\n";
+    cout << std::fixed;
+    for (int i = 0; i < 3; i++) {
+        cout << "    " << left << setw(16) << stages[i] << right << setprecision(4)
+             << setw(10) << serial[i] << "s " << setw(10) << parallel[i] << "s "
+             << setprecision(2) << setw(9) << serial[i] / parallel[i] << "x\n";
+    }
+
+    removeSyntheticFiles(files);
+    return 0;
+}
+
+
+//
+// countViolations():  Counts over supplied locations and plants or lines
+//                     that gave more than they have
+//
+static int countViolations(PowerGrid& grid) {
+    unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+    int violations = 0;
+
+    for (auto& plant : state->plants)
+        violations += (plant.availCapacity < -1e-6 || plant.availCapacity > plant.curCapacity + 1e-6);
+    for (auto& line : state->lines)
+        violations += (line.availCapacity < -1e-6);
+    for (auto& demand : state->demands)
+        violations += (demand.acquired > demand.required + 0.01);
+    return violations;
+}
+
+
+//
+// WarmStartRun:  Results of one pass of the warm start benchmark
+//
+struct WarmStartRun {
+    double  seconds = 0;        // Time spent in redispatch()
+    double  acquired = 0;       // Final totals
+    double  cost = 0;
+    int     violations = 0;     // Over supplied locations, overdrawn plants or lines
+};
+
+
+//
+// runDispatchSteps():  Loads the synthetic grid and re-dispatches it after
+//      changing a few demand locations at each step
+//
+static WarmStartRun runDispatchSteps(const string files[3], bool warm, uint64_t stepCount) {
+    WarmStartRun run;
+    PowerGrid grid;
+    prepareSyntheticGrid(grid, files);
+    grid.setWarmStartDispatch(warm);
+    grid.distributePower();
+
+    vector<Demand*> demands;
+    vector<double> required;
+    {
+        unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+        for (auto& demand : state->demands) {
+            demands.push_back(grid.findDemand(demand.location));
+            required.push_back(demand.required);
+        }
+    }
+
+    // One percent of the locations change by up to 5% each step
+    mt19937 rng(7);
+    uniform_real_distribution<double> change(0.95, 1.05);
+    size_t changes = max<size_t>(1, demands.size() / 100);
+
+    for (uint64_t step = 0; step < stepCount; step++) {
+        for (size_t i = 0; i < changes; i++) {
+            size_t d = rng() % demands.size();
+            grid.setDemandRequired(demands[d]->getLocation(), required[d] * change(rng));
+        }
+
+        auto start = chrono::steady_clock::now();
+        grid.redispatch();
+        run.seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    GridStats stats = grid.computeStats();
+    run.acquired = stats.demands.acquired.sum();
+    run.cost = stats.demands.cost.sum();
+    run.violations = countViolations(grid);
+
+    grid.shutdownGrid();
+    return run;
+}
+
+
+//
+// runWarmStartBenchmark():  Compares cold and warm start dispatch on a
+//      synthetic grid with plantCount plants
+//
+int runWarmStartBenchmark(int plantCount, uint64_t stepCount) {
+    string files[3];
+    int demandCount = max(1, plantCount / 4);
+    int lineCount = max(10, plantCount / 20);
+
+    if (writeSyntheticFiles("warm", plantCount, demandCount, lineCount, 3, files)) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+
+    WarmStartRun cold = runDispatchSteps(files, false, stepCount);
+    WarmStartRun warm = runDispatchSteps(files, true, stepCount);
+    Plant::setDestroyLog(true);
+    removeSyntheticFiles(files);
+
+    cout << "\n\t--- Warm Start Dispatch (" << plantCount << " plants, " << demandCount << " demands, "
+         << lineCount << " lines, " << stepCount << " steps) ---\n";
+    cout << "                      Cold start    Warm start\n";
+    cout << std::fixed << std::setprecision(1);
+    cout << "    usec per step:  " << setw(12) << cold.seconds * 1e6 / stepCount
+         << setw(14) << warm.seconds * 1e6 / stepCount
+         << "   (" << setprecision(1) << cold.seconds / warm.seconds << "x)\n";
+    cout << "    MW supplied:    " << setw(12) << cold.acquired << setw(14) << warm.acquired << "\n";
+    cout << "    Power cost:     " << setw(12) << cold.cost << setw(14) << warm.cost << "\n";
+    cout << "    Violations:     " << setw(12) << cold.violations << setw(14) << warm.violations << "\n";
+
+    return (cold.violations || warm.violations) ? 1 : 0;
+}
+
+
+//
+// runAnytimeBenchmark():  Dispatches a synthetic grid in sustainability
+//      order and lets anytime dispatch lower the cost under several budgets
+//
+int runAnytimeBenchmark(int plantCount, double budgetMs) {
+    int demandCount = max(1, plantCount / 4);
+    int lineCount = max(10, plantCount / 20);
+
+    PowerGrid grid;
+    if (loadSyntheticGrid(grid, "anytime", plantCount, demandCount, lineCount, 5))
+        return 1;
+
+    // The plants only just cover the file's demand, so at full load nearly
+    // every plant is used and there is little for the search to move.  At
+    // ANYTIME_BENCH_LOAD of it, sustainability order leaves cheap plants idle.
+    for (auto& demand : grid.getDemandList())
+        grid.setDemandRequired(demand.getLocation(), demand.getPowerRequired() * ANYTIME_BENCH_LOAD);
+
+    cout << "\n\t--- Anytime Dispatch (" << plantCount << " plants, " << demandCount << " demands, "
+         << lineCount << " lines) ---\n";
+    cout << "    Budget ms  Greedy ms   Used ms     Moves       Cost      Saved    Gap   Done  Violations\n";
+
+    int violations = 0;
+    for (double budget : { 0.0, budgetMs / 5, budgetMs, budgetMs * 5 }) {
+        AnytimeResult result = grid.anytimeDispatch(budget);
+        int bad = countViolations(grid);
+        violations += bad;
+
+        cout << std::fixed << setprecision(2)
+             << setw(11) << budget << setw(11) << result.greedyMs << setw(10) << result.elapsedMs
+             << setw(10) << result.moves << setw(11) << setprecision(0) << result.finalCost
+             << setw(10) << setprecision(2) << 100 * (result.greedyCost - result.finalCost) / result.greedyCost << "%"
+             << setw(6) << 100 * result.gap << "%" << setw(6) << (result.converged ? "yes" : "no")
+             << setw(12) << bad << "\n";
+    }
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return violations ? 1 : 0;
+}
+
+
+//
+// runZoneBenchmark():  Dispatches a grid of many small locations in full
+//      and by price zones, and reports the speedup and what zones lose
+//
+int runZoneBenchmark(int plantCount, int demandCount, double priceBand) {
+    int lineCount = max(10, plantCount / 20);
+
+    PowerGrid grid;
+    if (loadSyntheticGrid(grid, "zone", plantCount, demandCount, lineCount, 9))
+        return 1;
+
+    // Ask for more power than the plants have, so locations compete for it
+    {
+        unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+        for (auto& demand : state->demands)
+            grid.setDemandRequired(demand.location, demand.required * 1.5);
+    }
+
+    auto start = chrono::steady_clock::now();
+    grid.resetDispatch();
+    grid.distributePower();
+    double fullMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    GridStats full = grid.computeStats();
+    unique_ptr<GridSnapshot> fullState(grid.buildSnapshot());
+
+    start = chrono::steady_clock::now();
+    grid.resetDispatch();
+    int zoneCount = grid.distributeByZones(priceBand);
+    double zoneMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    GridStats zoned = grid.computeStats();
+    unique_ptr<GridSnapshot> zoneState(grid.buildSnapshot());
+    int violations = countViolations(grid);
+
+    // Power that moved between locations, as a share of the power delivered
+    double moved = 0;
+    for (size_t i = 0; i < fullState->demands.size(); i++)
+        moved += fabs(fullState->demands[i].acquired - zoneState->demands[i].acquired);
+
+    auto change = [](double from, double to) { return (from != 0) ? 100 * (to - from) / fabs(from) : 0.0; };
+
+    cout << "\n\t--- Zone Dispatch (" << plantCount << " plants, " << demandCount << " demands, "
+         << zoneCount << " zones of $" << priceBand << "/MWh) ---\n";
+    cout << "                     Full dispatch   Zone dispatch    Change\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Time ms        " << setw(16) << fullMs << setw(16) << zoneMs << setw(10) << fullMs / zoneMs << "x\n";
+    cout << "    Supplied MW    " << setw(16) << full.demands.acquired.sum() << setw(16) << zoned.demands.acquired.sum()
+         << setw(10) << change(full.demands.acquired.sum(), zoned.demands.acquired.sum()) << "%\n";
+    cout << "    Cost           " << setw(16) << full.demands.cost.sum() << setw(16) << zoned.demands.cost.sum()
+         << setw(10) << change(full.demands.cost.sum(), zoned.demands.cost.sum()) << "%\n";
+    cout << "    Profit         " << setw(16) << full.profit() << setw(16) << zoned.profit()
+         << setw(10) << change(full.profit(), zoned.profit()) << "%\n";
+    cout << "    Power moved between locations: " << 100 * moved / max(1.0, full.demands.acquired.sum()) << "%\n";
+    cout << "    Violations: " << violations << "\n";
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return violations ? 1 : 0;
+}
+
+
+//
+// runCarbonBenchmark():  Dispatches a synthetic grid in cost order, then
+//      under tighter and tighter CO2 caps, and compares cost and time
+//
+// The synthetic plants only just cover the demand, so no carbon price
+// could change which plants run.  Clean plants that cost more than any
+// synthetic one are added, enough to replace the fossil plants, so each
+// cap is met at a carbon price that moves fossil output onto them.
+//
+int runCarbonBenchmark(int plantCount) {
+    int demandCount = max(1, plantCount / 4);
+    int lineCount = max(10, plantCount / 20);
+    int cleanCount = CARBON_BENCH_CLEAN_PER_FOSSIL * plantCount / 8;
+    string files[3];
+
+    if (writeSyntheticFiles("carbon", plantCount, demandCount, lineCount, 13, files)) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+    {
+        ofstream osPlant(files[0], ios::app);
+        mt19937 rng(19);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        osPlant << std::fixed << std::setprecision(2);
+        for (int i = 0; i < cleanCount; i++) {
+            osPlant << "C" << setw(7) << setfill('0') << i << setfill(' ') << "  " << PT_NUCLEAR << "  "
+                    << int(40 + unit(rng) * 60) << "  " << CARBON_BENCH_CLEAN_COST + unit(rng) * CARBON_BENCH_CLEAN_SPREAD
+                    << "  " << 20 + unit(rng) * 800 << "  " << int(80 + unit(rng) * 20) << "\n";
+        }
+        if (!osPlant) {
+            cerr << "Error: Unable to write file " << files[0] << endl;
+            removeSyntheticFiles(files);
+            return 1;
+        }
+    }
+
+    PowerGrid grid;
+    int rc = prepareSyntheticGrid(grid, files);
+    removeSyntheticFiles(files);
+    if (rc)
+        return 1;
+    grid.setDispatchPolicy(DP_COST);
+
+    auto start = chrono::steady_clock::now();
+    grid.resetDispatch();
+    grid.distributePower();
+    double freeMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    GridStats free = grid.computeStats();
+    double freeEmissions = grid.dispatchEmissions();
+    double freeUnitCost = free.demands.cost.sum() / free.demands.acquired.sum();
+    double required = free.demands.required.sum();
+
+    cout << "\n\t--- Carbon Capped Dispatch (" << plantCount << " plants and " << cleanCount << " spare clean plants, "
+         << demandCount << " demands) ---\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Unconstrained: emissions " << setprecision(0) << freeEmissions << ", cost " << free.demands.cost.sum()
+         << ", unserved " << max(0.0, required - free.demands.acquired.sum()) << " MW, " << setprecision(2) << freeMs << " ms\n";
+    cout << "    Cap    Passes  Carbon price     Emissions   Cost/MW change   Unserved MW   Time   Clamped  Violations\n";
+
+    int violations = 0;
+    for (double fraction : { 0.9, 0.75, 0.5, 0.25, 0.1, 0.0 }) {
+        start = chrono::steady_clock::now();
+        CarbonResult result = grid.distributeUnderCarbonCap(fraction * freeEmissions);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        int bad = countViolations(grid) + (result.emissions > result.cap * (1 + 1e-9) + 1e-6);
+        violations += bad;
+
+        cout << setw(6) << setprecision(0) << 100 * fraction << "%" << setw(7) << result.passes
+             << setw(14) << scientific << setprecision(2) << result.carbonPrice << fixed
+             << setw(14) << setprecision(0) << result.emissions
+             << setw(16) << setprecision(2) << 100 * (result.cost / result.acquired - freeUnitCost) / freeUnitCost << "%"
+             << setw(14) << setprecision(0) << max(0.0, required - result.acquired)
+             << setw(6) << setprecision(1) << ms / freeMs << "x" << setw(9) << (result.clamped ? "yes" : "no")
+             << setw(12) << bad << "\n";
+    }
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return violations ? 1 : 0;
+}
+
+
+//
+// writeSyntheticAreas():  Writes an areas file for a synthetic grid.  The
+//      plants are skewed towards the first areas so some areas must import;
+//      locations and lines are dealt out evenly.  Neighbouring areas are
+//      joined in a ring by ties of tieCapacity MW, or not at all if it is 0.
+//
+static int writeSyntheticAreas(const string& areasFile, int plantCount, int demandCount, int lineCount,
+                               int areaCount, double tieCapacity) {
+    ofstream osAreas(areasFile);
+    if (!osAreas) {
+        cerr << "Error: Unable to write file " << areasFile << endl;
+        return 1;
+    }
+    osAreas << "Record   Name   Area   To Area   Capacity\n   (synthetic areas)\n";
+
+    char name[16];
+    for (int a = 0; a < areaCount; a++)
+        osAreas << "AREA  A" << a << "\n";
+
+    mt19937 rng(5);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    for (int i = 0; i < plantCount; i++) {
+        snprintf(name, sizeof(name), "P%07d", i);
+        osAreas << "PLANT  " << name << "  A" << min(areaCount - 1, int(areaCount * pow(unit(rng), 1.5))) << "\n";
+    }
+    for (int i = 0; i < demandCount; i++) {
+        snprintf(name, sizeof(name), "D%07d", i);
+        osAreas << "DEMAND  " << name << "  A" << i % areaCount << "\n";
+    }
+    for (int i = 0; i < lineCount; i++) {
+        snprintf(name, sizeof(name), "L%07d", i);
+        osAreas << "LINE  " << name << "  A" << i % areaCount << "\n";
+    }
+
+    int tieCount = (areaCount < 2 || tieCapacity <= 0) ? 0 : (areaCount == 2) ? 1 : areaCount;
+    for (int a = 0; a < tieCount; a++)
+        osAreas << "TIE  T" << a << "  A" << a << "  A" << (a + 1) % areaCount << "  " << tieCapacity << "\n";
+    osAreas.close();
+    return 0;
+}
+
+
+//
+// sameAreaResults():  True if two multi-area grids delivered bit for bit
+//                     the same power at the same cost everywhere
+//
+static bool sameAreaResults(MultiAreaGrid& a, MultiAreaGrid& b) {
+    for (uint32_t area = 0; area < a.getAreaCount(); area++) {
+        const vector<Demand>& first = a.getArea(area).getDemandList();
+        const vector<Demand>& second = b.getArea(area).getDemandList();
+        for (size_t i = 0; i < first.size(); i++) {
+            if (first[i].getPowerAcquired() != second[i].getPowerAcquired() ||
+                first[i].getTotalPowerCost() != second[i].getTotalPowerCost())
+                return false;
+        }
+    }
+    for (size_t t = 0; t < a.getTies().size(); t++) {
+        if (a.getTies()[t].flow != b.getTies()[t].flow)
+            return false;
+    }
+    return true;
+}
+
+
+//
+// runMultiAreaBenchmark():  Dispatches a synthetic grid flat, then split
+//      into areas with no ties, limited ties, and unlimited ties, and
+//      checks the split results are the same on one thread.  One area
+//      must match the flat dispatch exactly and open ties within
+//      AREA_BENCH_MATCH; the limited splits cannot, so are not matched.
+//
+int runMultiAreaBenchmark(int plantCount, int areaCount) {
+    string files[4];
+    files[3] = syntheticFileName("areas", "areas.txt");
+    areaCount = max(1, areaCount);
+    int demandCount = max(areaCount, plantCount / 4);
+    int lineCount = max(10 * areaCount, plantCount / 20);
+
+    // The flat grid everything is measured against
+    PowerGrid flat;
+    int rc = writeSyntheticFiles("areas", plantCount, demandCount, lineCount, 17, files);
+    if (rc == 0)
+        rc = prepareSyntheticGrid(flat, files);
+    if (rc) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+    flat.setDispatchPolicy(DP_COST);
+
+    auto start = chrono::steady_clock::now();
+    flat.resetDispatch();
+    flat.distributePower();
+    double flatMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    GridStats flatStats = flat.computeStats();
+    double flatAcquired = flatStats.demands.acquired.sum();
+    double flatCost = 0;
+    for (auto& entry : flat.getLastLedger())
+        flatCost += entry.cost;
+
+    cout << "\n\t--- Multi-Area Dispatch (" << plantCount << " plants, " << demandCount << " demands, "
+         << lineCount << " lines, " << areaCount << " areas) ---\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Flat dispatch: " << flatAcquired << " MW supplied, cost " << flatCost << ", " << flatMs << " ms\n";
+    cout << "    Split            Ties(MW)  Rounds  Settled   Supplied  Cost change   Tie flow  Imbalance        ms  Speedup  Match  Violations\n";
+
+    // One area must match the flat grid exactly; then isolated, limited, and open ties
+    const double limited = 20.0 * plantCount / areaCount;
+    struct Split { const char* name; int areas; double ties; bool nearFlat; };
+    const Split splits[] = { { "One area", 1, 0, true }, { "No ties", areaCount, 0, false },
+                             { "Limited ties", areaCount, limited, false }, { "Open ties", areaCount, 1e9, true } };
+
+    int violations = 0, mismatches = 0;
+    for (auto& split : splits) {
+        MultiAreaGrid grid;
+        rc = writeSyntheticAreas(files[3], plantCount, demandCount, lineCount, split.areas, split.ties);
+        if (rc == 0)
+            rc = grid.load(files[0], files[1], files[2], files[3]);
+        if (rc)
+            break;
+
+        MultiAreaResult result = grid.dispatch();
+        int bad = 0;
+        for (uint32_t a = 0; a < grid.getAreaCount(); a++)
+            bad += countViolations(grid.getArea(a));
+
+        // A single area is the flat grid with nothing to coordinate; open
+        // ties must come close to it
+        const char* match = "-";
+        if (split.areas == 1) {
+            const vector<Demand>& expected = flat.getDemandList();
+            const vector<Demand>& got = grid.getArea(0).getDemandList();
+            bool same = expected.size() == got.size();
+            for (size_t i = 0; same && i < expected.size(); i++)
+                same = expected[i].getPowerAcquired() == got[i].getPowerAcquired() &&
+                       expected[i].getTotalPowerCost() == got[i].getTotalPowerCost();
+            match = same ? "yes" : "no";
+        }
+        else if (split.nearFlat) {
+            bool close = fabs(result.acquired - flatAcquired) <= AREA_BENCH_MATCH * flatAcquired &&
+                         fabs(result.cost - flatCost) <= AREA_BENCH_MATCH * flatCost;
+            match = close ? "yes" : "no";
+        }
+        mismatches += (match[0] == 'n');
+
+        // The same split on one thread must give identical results
+        if (split.areas > 1 && split.ties > 0) {
+            MultiAreaGrid serial;
+            serial.setThreadCount(1);
+            if (serial.load(files[0], files[1], files[2], files[3]) == 0) {
+                serial.dispatch();
+                bad += !sameAreaResults(grid, serial);
+            }
+            else
+                bad++;
+            serial.shutdown();
+        }
+        violations += bad;
+
+        cout << "    " << setw(14) << left << split.name << right << setw(10) << setprecision(0) << split.ties
+             << setw(8) << result.rounds << setw(9) << (result.converged ? "yes" : "no")
+             << setw(10) << setprecision(2) << 100 * result.acquired / flatAcquired << "%"
+             << setw(12) << 100 * (result.cost - flatCost) / flatCost << "%"
+             << setw(11) << setprecision(0) << result.tieFlow << setw(11) << setprecision(2) << result.imbalance
+             << setw(10) << setprecision(1) << result.ms << setw(8) << flatMs / result.ms << "x"
+             << setw(7) << match << setw(12) << bad << "\n";
+        grid.shutdown();
+    }
+
+    removeSyntheticFiles(files);
+    remove(files[3].c_str());
+    flat.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return (rc || violations || mismatches) ? 1 : 0;
+}
+
+
+//
+// runShardBenchmark():  Runs the same Monte Carlo trials on a synthetic grid
+//      with more and more worker processes.  Every run must match the one
+//      worker run, and the first trials must match the coordinator's own
+//      grid.
+//
+int runShardBenchmark(int plantCount, uint64_t trialCount, int workerCount) {
+    int demandCount = max(1, plantCount / 4);
+    int lineCount = max(10, plantCount / 20);
+    workerCount = max(1, workerCount);
+
+    PowerGrid grid;
+    if (loadSyntheticGrid(grid, "shards", plantCount, demandCount, lineCount, 23))
+        return 1;
+
+    ShardCoordinator coordinator;
+    auto start = chrono::steady_clock::now();
+    int rc = coordinator.publish(grid);
+    double publishMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    // The coordinator's grid runs the first trials itself as the reference
+    uint64_t checkCount = min(trialCount, SHARD_CHECK_TRIALS);
+    start = chrono::steady_clock::now();
+    vector<TrialResult> expected = runTrialsInProcess(grid, 0, checkCount);
+    double checkMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    cout << "\n\t--- Sharded Trials (" << plantCount << " plants, " << demandCount << " demands, "
+         << lineCount << " lines, " << trialCount << " trials) ---\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Grid image:            " << coordinator.getImage().getBytes() << " bytes, "
+         << publishMs << " ms to publish" << endl;
+    if (checkCount)
+        cout << "    In process:            " << checkCount * 1000.0 / checkMs << " trials/sec" << endl;
+    cout << "    Workers         ms    Trials/sec   Speedup   Match\n";
+
+    vector<TrialResult> baseline;
+    double baselineMs = 0;
+    bool allMatch = true;
+    vector<int> workerCounts;
+    for (int workers = 1; workers < workerCount; workers *= 2)
+        workerCounts.push_back(workers);
+    workerCounts.push_back(workerCount);
+
+    for (int workers : workerCounts) {
+        if (rc)
+            break;
+
+        vector<TrialResult> results;
+        start = chrono::steady_clock::now();
+        rc = coordinator.run(trialCount, workers, results);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (rc)
+            break;
+
+        if (workers == 1) {
+            baseline = results;
+            baselineMs = ms;
+        }
+        bool match = (results == baseline) && equal(expected.begin(), expected.end(), results.begin());
+        allMatch = allMatch && match;
+
+        cout << "    " << setw(7) << workers << setw(11) << setprecision(1) << ms
+             << setw(14) << trialCount * 1000.0 / ms << setw(9) << setprecision(2) << baselineMs / ms << "x"
+             << setw(8) << (match ? "yes" : "NO") << "\n";
+    }
+
+    if (rc == 0) {
+        ShardSummary summary = summarizeTrials(baseline);
+        cout << "    Mean supplied:         " << summary.supplied << " MW" << endl;
+        cout << "    Mean unserved:         " << summary.unserved << " MW" << endl;
+        cout << "    Loss of load:          " << 100 * summary.lossOfLoad << "% of trials" << endl;
+        cout << "    Mean power cost:       " << summary.cost << endl;
+        cout << "    Mean plants out:       " << summary.plantsOut << endl;
+    }
+
+    coordinator.shutdown();
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return (rc || !allMatch) ? 1 : 0;
+}
+
+
+//
+// rewriteRecord():  Replaces the line of a text input file whose record
+//      has the given name, or removes it if line is empty, or appends line
+//      if no record has the name.  The file is saved in place.
+//
+static int rewriteRecord(const string& filename, const string& name, const string& line) {
+    ifstream is(filename, ios::binary);
+    stringstream contents;
+    contents << is.rdbuf();
+    string text = contents.str();
+    is.close();
+
+    size_t pos = text.find("\n" + name + " ");
+    if (pos == string::npos) {
+        text += line + "\n";
+    }
+    else {
+        size_t end = text.find('\n', pos + 1);
+        text.replace(pos + 1, (end == string::npos ? text.size() : end + 1) - (pos + 1), line.empty() ? "" : line + "\n");
+    }
+
+    ofstream os(filename, ios::binary | ios::trunc);
+    os << text;
+    return os ? 0 : 1;
+}
+
+
+//
+// rewriteLineRecord():  Sets the capacity, and the efficiency unless it is
+//                       negative, of one record of a binary lines file
+//
+static int rewriteLineRecord(const string& filename, int index, double capacity, double efficiency) {
+    fstream io(filename, ios::binary | ios::in | ios::out);
+    streamoff pos = SYNTH_FIRST_RECORD_POS + index * SYNTH_RECORD_SPACING;
+    io.seekp(pos + streamoff(offsetof(SynthLineRecord, lineCapacity)));
+    io.write(reinterpret_cast<const char*>(&capacity), sizeof(capacity));
+    if (efficiency >= 0) {
+        io.seekp(pos + streamoff(offsetof(SynthLineRecord, lineEfficiency)));
+        io.write(reinterpret_cast<const char*>(&efficiency), sizeof(efficiency));
+    }
+    return io ? 0 : 1;
+}
+
+
+//
+// chargeBattery():  Sets the energy a storage plant on the grid holds
+//
+static int chargeBattery(PowerGrid& grid, const string& name, double energy) {
+    StoragePlant* unit = dynamic_cast<StoragePlant*>(grid.findPlant(name));
+    if (!unit)
+        return 1;
+    unit->setStorageState(energy, unit->getStepHours(), 0);
+    unit->calculateOutput();
+    return 0;
+}
+
+
+//
+// sameGridState():  Compares two grids record by record, in order
+//
+static bool sameGridState(PowerGrid& a, PowerGrid& b) {
+    unique_ptr<GridSnapshot> first(a.buildSnapshot());
+    unique_ptr<GridSnapshot> second(b.buildSnapshot());
+    if (first->plants.size() != second->plants.size() || first->demands.size() != second->demands.size() ||
+        first->lines.size() != second->lines.size())
+        return false;
+
+    for (auto& plant : first->plants) {
+        const PlantState* other = second->findPlant(plant.name);
+        if (!other || other->type != plant.type || other->maxCapacity != plant.maxCapacity ||
+            other->curCapacity != plant.curCapacity || other->costPerMW != plant.costPerMW)
+            return false;
+    }
+    for (size_t d = 0; d < first->demands.size(); d++) {
+        if (first->demands[d].location != second->demands[d].location ||
+            first->demands[d].required != second->demands[d].required)
+            return false;
+    }
+    for (size_t l = 0; l < first->lines.size(); l++) {
+        if (first->lines[l].lineID != second->lines[l].lineID ||
+            first->lines[l].maxCapacity != second->lines[l].maxCapacity ||
+            first->lines[l].efficiency != second->lines[l].efficiency)
+            return false;
+    }
+    return true;
+}
+
+
+//
+// runReloadBenchmark():  Saves one line edits to the files of a large
+//      synthetic grid and reloads each by diff.  The edited grid must match
+//      a grid loaded from scratch from the edited files.
+//
+int runReloadBenchmark(int rowCount) {
+    string files[3];
+    int demandCount = max(10, rowCount);
+    int plantCount = max(8, rowCount / 1000);
+    int lineCount = max(10, rowCount / 10000);
+
+    if (writeSyntheticFiles("reload", plantCount, demandCount, lineCount, 29, files)) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+
+    auto loadFull = [&](PowerGrid& grid) {
+        auto start = chrono::steady_clock::now();
+        int rc = prepareSyntheticGrid(grid, files);
+        grid.distributePower();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        return rc ? -1.0 : ms;
+    };
+
+    PowerGrid grid;
+    double fullMs = loadFull(grid);
+    GridReloader reloader(grid, files[0], files[1], files[2]);
+    if (fullMs < 0 || reloader.prime()) {
+        grid.shutdownGrid();
+        Plant::setDestroyLog(true);
+        removeSyntheticFiles(files);
+        return 1;
+    }
+    grid.setWarmStartDispatch(true);
+
+    auto name = [](char prefix, int i) {
+        ostringstream os;
+        os << prefix << setw(7) << setfill('0') << i;
+        return os.str();
+    };
+
+    // Each edit changes one record, then the file is reloaded
+    struct Edit {
+        const char* description;
+        int         file;
+        function<int()> save;
+    };
+    int middle = demandCount / 2;
+    int plant = plantCount / 2;
+    int line = lineCount / 2;
+    Edit edits[] = {
+        { "Change a demand",        1, [&]() { return rewriteRecord(files[1], name('D', middle), name('D', middle) + "  1234.50  99.00"); } },
+        { "Remove a demand",        1, [&]() { return rewriteRecord(files[1], name('D', middle + 1), ""); } },
+        { "Add a demand",           1, [&]() { return rewriteRecord(files[1], "DNEW", "DNEW  500.00  120.00"); } },
+        { "Reprice a plant",        0, [&]() { return rewriteRecord(files[0], name('P', plant), name('P', plant) + "  " +
+                                                 PT_NUCLEAR + "  70  55.25  640.00  92"); } },
+        { "Add a battery",          0, [&]() { return rewriteRecord(files[0], "SNEW", string("SNEW  ") + PT_STORAGE +
+                                                 "  88  45.00  150.00  97  600.00  90"); } },
+        { "Resize a battery",       0, [&]() { return chargeBattery(grid, "SNEW", BATTERY_RELOAD_CHARGE) ||
+                                                 rewriteRecord(files[0], "SNEW", string("SNEW  ") + PT_STORAGE +
+                                                 "  88  45.00  200.00  97  600.00  90"); } },
+        { "Rerate a line",          2, [&]() { return rewriteLineRecord(files[2], line, 1500.0, -1); } },
+        { "Change line efficiency", 2, [&]() { return rewriteLineRecord(files[2], line, 1500.0, 0.995); } },
+    };
+
+    cout << "\n\t--- Hot Reload (" << plantCount << " plants, " << demandCount << " demands, "
+         << lineCount << " lines) ---\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Full reload and dispatch: " << fullMs << " ms\n";
+    cout << "    Edit                       Parsed      Read ms   Apply ms  Dispatch ms    Speedup\n";
+
+    int rc = 0;
+    for (auto& edit : edits) {
+        ReloadResult result;
+        if (edit.save() || reloader.reloadFile(files[edit.file], result)) {
+            rc = 1;
+            break;
+        }
+        double total = result.readMs + result.applyMs + result.dispatchMs;
+        cout << "    " << left << setw(24) << edit.description << right << setw(9) << result.bytesParsed << " B"
+             << setw(11) << result.readMs << setw(11) << result.applyMs << setw(13) << result.dispatchMs
+             << setw(10) << setprecision(1) << fullMs / total << "x" << setprecision(2) << "\n";
+    }
+
+    // A save with a bad record is not applied, and is applied in full
+    // once the record is fixed
+    ReloadResult result;
+    bool refused = rc == 0 && !rewriteRecord(files[1], "DBAD", "DBAD  many  120.00") &&
+                   !rewriteRecord(files[1], name('D', middle), name('D', middle) + "  1500.00  99.00") &&
+                   reloader.reloadFile(files[1], result) != 0 &&
+                   !grid.findDemand("DBAD") && grid.findDemand(name('D', middle))->getPowerRequired() != 1500.0;
+    bool fixed = refused && !rewriteRecord(files[1], "DBAD", "DBAD  250.00  120.00") &&
+                 reloader.reloadFile(files[1], result) == 0 && result.added == 1 && result.changed == 1;
+    cout << "    Bad record refused, then applied once fixed: " << (fixed ? "yes" : "NO") << "\n";
+    rc |= !fixed;
+
+    // The edited grid must match the files loaded from scratch, and the
+    // resized battery must have kept its charge
+    PowerGrid fresh;
+    bool match = rc == 0 && loadFull(fresh) >= 0 && sameGridState(grid, fresh);
+    StoragePlant* battery = dynamic_cast<StoragePlant*>(grid.findPlant("SNEW"));
+    bool charged = battery && battery->getMaxCapacity() == 200.0 && battery->getStoredEnergy() == BATTERY_RELOAD_CHARGE;
+    int violations = countViolations(grid);
+    cout << "    Matches a full reload:    " << (match ? "yes" : "NO") << "\n";
+    cout << "    Battery keeps its charge: " << (charged ? "yes" : "NO") << "\n";
+    cout << "    Dispatch violations:      " << violations << "\n";
+
+    fresh.shutdownGrid();
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    removeSyntheticFiles(files);
+    return (rc || !match || !charged || violations) ? 1 : 0;
+}
+
+
+//
+// stepStoragePerPlant():  The storage step done one plant at a time, as a
+//      reference for the batched update.  Walks the plant list, finds the
+//      batteries by cast, and recalculates each through calculateOutput().
+//
+static StorageStep stepStoragePerPlant(PowerGrid& grid, double hours) {
+    StorageStep result;
+    vector<StoragePlant*> units;
+    vector<double> energy, room;
+    double unused = 0, storageUnused = 0, totalRoom = 0;
+
+    for (auto plant : grid.getPlantList()) {
+        unused += plant->getAvailCapacity();
+        StoragePlant* unit = dynamic_cast<StoragePlant*>(plant);
+        if (!unit)
+            continue;
+
+        double efficiency = max(unit->getOneWayEfficiency(), 1e-9);
+        double used = unit->getCurCapacity() - unit->getAvailCapacity();
+        double taken = (used < toMW(1)) ? 0.0 : used;
+        double limit = unit->isOnline() ? unit->getMaxCapacity() * unit->getUptimePercent() / 100 : 0.0;
+        double stored = max(0.0, unit->getStoredEnergy() - taken * hours / efficiency);
+        double fill = (unit->getEnergyCapacity() - stored) / (efficiency * hours);
+
+        storageUnused += unit->getAvailCapacity();
+        units.push_back(unit);
+        energy.push_back(stored);
+        room.push_back((taken > 0.0) ? 0.0 : max(0.0, min(limit, fill)));
+        result.discharged += taken;
+    }
+    for (double r : room)
+        totalRoom += r;
+
+    result.surplus = max(0.0, unused - storageUnused);
+    double share = (totalRoom > 0) ? min(1.0, result.surplus / totalRoom) : 0.0;
+    for (size_t i = 0; i < units.size(); i++) {
+        double efficiency = max(units[i]->getOneWayEfficiency(), 1e-9);
+        double stored = min(units[i]->getEnergyCapacity(), energy[i] + room[i] * share * efficiency * hours);
+        units[i]->setStorageState(stored, hours, 0);
+        units[i]->calculateOutput();
+        result.stored += stored;
+    }
+    result.charged = totalRoom * share;
+    return result;
+}
+
+
+//
+// StorageRun:  Results of one pass of the storage benchmark
+//
+struct StorageRun {
+    double  dispatchSeconds = 0;
+    double  storageSeconds = 0;     // Time spent in the storage step
+    double  charged = 0;            // MWh over the run
+    double  discharged = 0;
+    double  stored = 0;             // MWh held at the end
+    double  acquired = 0;           // MW supplied over the run
+    int     violations = 0;
+};
+
+
+//
+// runStorageSteps():  Loads the grid and steps it through daily demand
+//      cycles, updating the batteries batched or one plant at a time
+//
+static StorageRun runStorageSteps(const string files[3], bool batched, uint64_t stepCount) {
+    StorageRun run;
+    PowerGrid grid;
+    prepareSyntheticGrid(grid, files);
+
+    vector<Demand*> demands;
+    vector<double> required;
+    {
+        unique_ptr<GridSnapshot> state(grid.buildSnapshot());
+        for (auto& demand : state->demands) {
+            demands.push_back(grid.findDemand(demand.location));
+            required.push_back(demand.required);
+        }
+    }
+
+    // Hourly steps; demand swings from 50% to 110% of the file's over a day
+    const double hours = 1.0;
+    for (uint64_t step = 0; step < stepCount; step++) {
+        double load = 0.8 + 0.3 * sin(2 * M_PI * double(step % 24) / 24);
+        for (size_t d = 0; d < demands.size(); d++)
+            grid.setDemandRequired(demands[d]->getLocation(), required[d] * load);
+
+        auto start = chrono::steady_clock::now();
+        grid.redispatch();
+        auto dispatched = chrono::steady_clock::now();
+        StorageStep storage = batched ? grid.stepStorage(hours) : stepStoragePerPlant(grid, hours);
+        auto stepped = chrono::steady_clock::now();
+
+        run.dispatchSeconds += chrono::duration<double>(dispatched - start).count();
+        run.storageSeconds += chrono::duration<double>(stepped - dispatched).count();
+        run.charged += storage.charged * hours;
+        run.discharged += storage.discharged * hours;
+        run.stored = storage.stored;
+        run.violations += countViolations(grid) ? 1 : 0;
+        for (auto demand : demands)
+            run.acquired += demand->getPowerAcquired();
+    }
+
+    grid.shutdownGrid();
+    return run;
+}
+
+
+//
+// runStorageBenchmark():  Adds batteryCount storage plants to a synthetic
+//      grid and compares the batched storage step with the per plant one
+//
+int runStorageBenchmark(int batteryCount, uint64_t stepCount) {
+    string files[3];
+    const int plantCount = 200;
+    const int demandCount = 50;
+    const int lineCount = 20;
+
+    if (writeSyntheticFiles("storage", plantCount, demandCount, lineCount, 31, files)) {
+        removeSyntheticFiles(files);
+        return 1;
+    }
+
+    // Batteries of 1 - 6 MW holding 2 - 4 hours, appended to the plants
+    {
+        ofstream osPlant(files[0], ios::app);
+        mt19937 rng(37);
+        uniform_real_distribution<double> unit(0.0, 1.0);
+        osPlant << std::fixed << std::setprecision(2);
+        for (int i = 0; i < batteryCount; i++) {
+            double capacity = 1 + unit(rng) * 5;
+            osPlant << "S" << setw(7) << setfill('0') << i << setfill(' ') << "  " << PT_STORAGE << "  "
+                    << int(60 + unit(rng) * 35) << "  " << 30 + unit(rng) * 30 << "  " << capacity << "  "
+                    << int(95 + unit(rng) * 5) << "  " << capacity * (2 + unit(rng) * 2) << "  "
+                    << 80 + unit(rng) * 15 << "\n";
+        }
+        if (!osPlant) {
+            cerr << "Error: Unable to write file " << files[0] << endl;
+            removeSyntheticFiles(files);
+            return 1;
+        }
+    }
+
+    StorageRun perPlant = runStorageSteps(files, false, stepCount);
+    StorageRun batched = runStorageSteps(files, true, stepCount);
+    Plant::setDestroyLog(true);
+    removeSyntheticFiles(files);
+
+    bool match = fabs(perPlant.stored - batched.stored) <= 1e-6 * max(1.0, perPlant.stored) &&
+                 fabs(perPlant.acquired - batched.acquired) <= 1e-6 * max(1.0, perPlant.acquired);
+
+    cout << "\n\t--- Battery Storage (" << plantCount << " plants, " << batteryCount << " batteries, "
+         << stepCount << " hourly steps) ---\n";
+    cout << "                        Per plant       Batched\n";
+    cout << std::fixed << std::setprecision(1);
+    cout << "    ns per battery:  " << setw(12) << perPlant.storageSeconds * 1e9 / (double(batteryCount) * stepCount)
+         << setw(14) << batched.storageSeconds * 1e9 / (double(batteryCount) * stepCount)
+         << "   (" << perPlant.storageSeconds / batched.storageSeconds << "x)\n";
+    cout << "    Dispatch ms:     " << setw(12) << perPlant.dispatchSeconds * 1e3 / stepCount
+         << setw(14) << batched.dispatchSeconds * 1e3 / stepCount << "\n";
+    cout << "    MWh charged:     " << setw(12) << perPlant.charged << setw(14) << batched.charged << "\n";
+    cout << "    MWh discharged:  " << setw(12) << perPlant.discharged << setw(14) << batched.discharged << "\n";
+    cout << "    MWh held at end: " << setw(12) << perPlant.stored << setw(14) << batched.stored << "\n";
+    cout << "    Violations:      " << setw(12) << perPlant.violations << setw(14) << batched.violations << "\n";
+    cout << "    Results match:   " << (match ? "yes" : "NO") << "\n";
+
+    return (!match || perPlant.violations || batched.violations) ? 1 : 0;
+}
+
+
+//
+// runCommitBenchmark():  Commits a synthetic grid's thermal plants over a
+//      load profile cold, warm started, and with parallel windows on
+//      threadCount threads (0 = one per core).  The parallel windows are a
+//      different heuristic, so their schedule is not checked against the
+//      sequential one; the search column shows the runs each solve tried
+//      against the warm sequential solve.
+//
+int runCommitBenchmark(int plantCount, size_t hours, unsigned threadCount) {
+    int demandCount = max(1, plantCount / 4);
+    int lineCount = max(10, plantCount / 20);
+
+    PowerGrid grid;
+    grid.setThreadCount(threadCount);
+    if (loadSyntheticGrid(grid, "commit", plantCount, demandCount, lineCount, 41)) {
+        Plant::setDestroyLog(true);
+        return 1;
+    }
+
+    // Peak near the plants' output, so the thermal plants are needed by
+    // day but not all of them overnight
+    GridStats stats = grid.computeStats();
+    UnitCommitment commitment(grid);
+    commitment.setLoad(makeLoadProfile(0.85 * stats.plants.curCapacity.sum(), hours, 43));
+
+    struct Run {
+        const char*                     description;
+        function<CommitmentResult()>    solve;
+    };
+    TaskPool& pool = grid.getTaskPool();
+    Run runs[] = {
+        { "Sequential, cold",   [&]() { return commitment.solveSequential(false); } },
+        { "Sequential, warm",   [&]() { return commitment.solveSequential(true); } },
+        { "Parallel windows",   [&]() { return commitment.solveParallel(pool); } },
+    };
+
+    cout << "\n\t--- Unit Commitment (" << commitment.getUnitCount() << " thermal of " << plantCount << " plants, "
+         << hours << " hours, " << pool.getThreadCount() << " threads) ---\n";
+    cout << "    Solve               Hours/sec    Energy $M   Startup $M   Starts  Unserved MWh     Tried  Search  Resolved  Violations\n";
+
+    const size_t runCount = sizeof(runs) / sizeof(runs[0]);
+    CommitmentResult results[runCount];
+    int bad[runCount];
+    int violations = 0;
+    for (size_t r = 0; r < runCount; r++) {
+        results[r] = runs[r].solve();
+        bad[r] = commitment.countViolations();
+        violations += bad[r];
+    }
+
+    // Runs tried against the warm sequential solve
+    double warmTried = max<double>(1, results[1].evaluations);
+    for (size_t r = 0; r < runCount; r++) {
+        const CommitmentResult& result = results[r];
+        cout << "    " << left << setw(18) << runs[r].description << right << std::fixed
+             << setprecision(0) << setw(11) << result.hoursPerSecond
+             << setprecision(3) << setw(13) << result.energyCost / 1e6 << setw(13) << result.startupCost / 1e6
+             << setw(9) << result.startups << setprecision(1) << setw(14) << result.unserved
+             << setw(10) << result.evaluations << setprecision(2) << setw(7) << result.evaluations / warmTried << "x"
+             << setw(10) << result.resolved << setw(12) << bad[r] << "\n";
+    }
+    cout << "    Parallel windows start from other plans than the sequential solve, so their schedule\n"
+         << "    and costs differ by design.  They tried " << setprecision(2) << results[2].evaluations / warmTried
+         << "x the runs of the warm sequential solve.\n";
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return violations ? 1 : 0;
+}
+
+
+//
+// runDemandOrderBenchmark():  Dispatches a grid short of power serving the
+//      locations in each demand order and compares what they earn, then
+//      times re-pricing locations in the queue against sorting the
+//      locations again after each change
+//
+int runDemandOrderBenchmark(int plantCount, int demandCount, int updateCount) {
+    int lineCount = max(10, plantCount / 20);
+
+    PowerGrid grid;
+    if (loadSyntheticGrid(grid, "order", plantCount, demandCount, lineCount, 49))
+        return 1;
+    grid.setDispatchPolicy(DP_COST);
+
+    // Ask for more power than the plants have, so locations compete for
+    // it, and make one location in twenty critical
+    vector<string> locations;
+    for (auto& demand : grid.getDemandList())
+        locations.push_back(demand.getLocation());
+    for (size_t d = 0; d < locations.size(); d++) {
+        const Demand* demand = grid.findDemand(locations[d]);
+        grid.setDemandRequired(locations[d], demand->getPowerRequired() * 1.5);
+        grid.setDemandCritical(locations[d], d % 20 == 0);
+    }
+
+    struct Run {
+        const char*     description;
+        DemandOrder     order;
+    };
+    const Run runs[] = {
+        { "File order",     DO_FILE },
+        { "Price",          DO_PRICE },
+        { "Critical",       DO_CRITICAL },
+        { "Deficit",        DO_DEFICIT },
+    };
+
+    cout << "\n\t--- Demand Service Order (" << plantCount << " plants, " << demandCount << " demands) ---\n";
+    cout << "    Order          Time ms    Supplied MW      Revenue $       Profit $   Critical met\n";
+
+    int violations = 0;
+    for (auto& run : runs) {
+        grid.setDemandOrder(run.order);
+        auto start = chrono::steady_clock::now();
+        grid.resetDispatch();
+        grid.distributePower();
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+        GridStats stats = grid.computeStats();
+        double criticalRequired = 0, criticalAcquired = 0;
+        for (auto& demand : grid.getDemandList()) {
+            if (!demand.isCritical())
+                continue;
+            criticalRequired += demand.getPowerRequired();
+            criticalAcquired += demand.getPowerAcquired();
+        }
+        violations += countViolations(grid);
+
+        cout << "    " << left << setw(12) << run.description << right << std::fixed << setprecision(2)
+             << setw(10) << ms << setw(15) << stats.demands.acquired.sum() << setw(15) << stats.demands.price.sum()
+             << setw(15) << stats.profit() << setw(14) << 100 * criticalAcquired / max(1.0, criticalRequired) << "%\n";
+    }
+
+    // Re-price random locations through the queue, then by sorting every
+    // location again after each change, for a sample of the changes
+    grid.setDemandOrder(DO_PRICE);
+    mt19937 rng(50);
+    uniform_int_distribution<size_t> pick(0, locations.size() - 1);
+    uniform_real_distribution<double> price(80, 140);
+
+    auto start = chrono::steady_clock::now();
+    for (int u = 0; u < updateCount; u++)
+        grid.setDemandPrice(locations[pick(rng)], price(rng));
+    double queueUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1, updateCount);
+
+    const vector<Demand>& demands = grid.getDemandList();
+    auto byPrice = [&demands](uint32_t a, uint32_t b) {
+        if (demands[a].getMwRetailPrice() != demands[b].getMwRetailPrice())
+            return demands[a].getMwRetailPrice() > demands[b].getMwRetailPrice();
+        return a < b;
+    };
+    vector<uint32_t> sorted(demands.size());
+    int sortCount = max(1, min(updateCount, 100));
+    start = chrono::steady_clock::now();
+    for (int u = 0; u < sortCount; u++) {
+        grid.setDemandPrice(locations[pick(rng)], price(rng));
+        for (uint32_t d = 0; d < sorted.size(); d++)
+            sorted[d] = d;
+        sort(sorted.begin(), sorted.end(), byPrice);
+    }
+    double sortUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / sortCount;
+
+    // The queue kept up through the changes must serve in the sorted order
+    size_t mismatches = 0, next = 0;
+    grid.getDemandQueue().forEach([&](uint32_t d) { mismatches += (d != sorted[next++]); });
+
+    cout << "    Re-price: " << setprecision(3) << queueUs << " us per change in the queue, "
+         << sortUs << " us to sort again (" << setprecision(0) << sortUs / max(queueUs, 1e-9) << "x)\n";
+    cout << "    Order mismatches: " << mismatches << ", Violations: " << violations << "\n";
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return (violations || mismatches) ? 1 : 0;
+}
+
+
+//
+// runAdjustBenchmark():  Changes the uptime of a share of a synthetic
+//      grid's plants each step and brings the plants and capacity totals
+//      up to date, against recalculating and summing every plant, and
+//      checks the totals against a full count
+//
+int runAdjustBenchmark(int plantCount, int stepCount) {
+    PowerGrid grid;
+    if (loadSyntheticGrid(grid, "adjust", plantCount, 10, 10, 50))
+        return 1;
+
+    vector<Plant*> plantList = grid.getPlantList();
+    TaskPool& pool = grid.getTaskPool();
+    mt19937 rng(51);
+    uniform_int_distribution<size_t> pick(0, plantList.size() - 1);
+    uniform_real_distribution<double> uptime(80, 100);
+
+    // Every plant recalculated and summed, as each step used to be
+    double capacity = 0;
+    auto start = chrono::steady_clock::now();
+    for (int step = 0; step < stepCount; step++) {
+        pool.parallelFor(plantList.size(), PLANT_UPDATE_GRAIN, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++)
+                plantList[i]->calculateOutput();
+        });
+        capacity = 0;
+        for (auto plant : plantList)
+            capacity += plant->getCurCapacity();
+    }
+    double fullUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / max(1, stepCount);
+
+    cout << "\n\t--- Plant Condition Updates (" << plantList.size() << " plants, " << stepCount << " steps) ---\n";
+    cout << "    Plants changed      us/step   Share of a full pass\n";
+    cout << std::fixed << setprecision(2);
+    cout << "    Full pass  " << setw(13) << fullUs << setw(22) << 100.0 << "%\n";
+
+    const double shares[] = { 1.0, 0.1, 0.01, 0.001 };
+    for (double share : shares) {
+        size_t changes = max(size_t(1), size_t(plantList.size() * share));
+        double stepUs = 0;
+        for (int step = 0; step < stepCount; step++) {
+            for (size_t c = 0; c < changes; c++)
+                plantList[pick(rng)]->setUptimePercent(uptime(rng));
+
+            start = chrono::steady_clock::now();
+            grid.adjustPlantsForConditions();
+            capacity = grid.getCapacityTotals().curCapacity.value();
+            stepUs += chrono::duration<double, micro>(chrono::steady_clock::now() - start).count();
+        }
+        stepUs /= max(1, stepCount);
+        cout << "    " << setw(6) << setprecision(1) << 100 * share << "%" << setprecision(2)
+             << setw(17) << stepUs << setw(22) << 100 * stepUs / fullUs << "%\n";
+    }
+
+    // The kept totals must match counting every plant again
+    GridStats stats = grid.computeStats();
+    const CapacityTotals& totals = grid.getCapacityTotals();
+    double drift = fabs(capacity - stats.plants.curCapacity.sum());
+    bool match = totals.plants == stats.plants.count && drift <= 1e-9 * max(1.0, stats.plants.curCapacity.sum()) &&
+                 fabs(totals.maxCapacity.value() - stats.plants.maxCapacity.sum()) <= 1e-9 * max(1.0, stats.plants.maxCapacity.sum());
+    cout << "    Totals match a full count: " << (match ? "yes" : "NO") << " (" << setprecision(3) << scientific
+         << drift << " MW apart)" << defaultfloat << "\n";
+
+    grid.shutdownGrid();
+    Plant::setDestroyLog(true);
+    return match ? 0 : 1;
+}
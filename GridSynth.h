@@ -0,0 +1,75 @@
+#pragma once
+// File: GridSynth.h
+//
+// Contains the generator for synthetic grid input files and the
+// benchmarks that use them.
+//
+// Benchmarks and scaling studies need grids far larger than the sample
+// data.  The generator writes Plants.txt, Demands.txt, and TransLines.dat
+// style files with the requested number of records, using every plant
+// type, so they can be loaded with PowerGrid::loadGrid().
+//
+#include <string>
+#include "PowerGrid.h"
+#include "UnitCommitment.h"
+using namespace std;
+
+// Writes the three input files.  The same seed always produces the same
+// files.  Returns 1 if a file cannot be written.
+int writeSyntheticGrid(const string& plantsFile, const string& demandsFile, const string& linesFile,
+                       int plantCount, int demandCount, int lineCount, unsigned seed);
+
+// Loads a synthetic grid of plantCount plants with one thread and with
+// threadCount threads, and prints the time and speedup of each stage.
+int runPoolBenchmark(int plantCount, unsigned threadCount);
+
+// Runs the same small demand changes step after step with cold and with
+// warm start dispatch, and compares the time per step and the results
+int runWarmStartBenchmark(int plantCount, uint64_t stepCount);
+
+// Runs anytime dispatch on a synthetic grid with deadlines around budgetMs
+int runAnytimeBenchmark(int plantCount, double budgetMs);
+
+// Compares zone level dispatch with full dispatch on a grid with many
+// small demand locations
+int runZoneBenchmark(int plantCount, int demandCount, double priceBand);
+
+// Dispatches a synthetic grid under CO2 caps that are fractions of its
+// unconstrained emissions
+int runCarbonBenchmark(int plantCount);
+
+// Splits a synthetic grid into areaCount areas joined by tie lines and
+// compares parallel area dispatch against one flat dispatch
+int runMultiAreaBenchmark(int plantCount, int areaCount);
+
+// Runs trialCount Monte Carlo trials of a synthetic grid with 1, 2, 4, ...
+// up to workerCount worker processes sharing the grid image, and compares
+// the time and results of each
+int runShardBenchmark(int plantCount, uint64_t trialCount, int workerCount);
+
+// Loads a synthetic grid with rowCount demand locations, then saves one
+// line edits to each input file and reloads them by diff.  Compares the
+// time with a full reload and checks the grids match.
+int runReloadBenchmark(int rowCount);
+
+// Adds batteryCount storage plants to a synthetic grid and steps it
+// through daily demand cycles, updating the batteries' charge batched and
+// one plant at a time.  Compares the update time and checks the results
+// match.
+int runStorageBenchmark(int batteryCount, uint64_t stepCount);
+
+// Commits the thermal plants of a synthetic grid over hours of a load
+// profile solved window after window cold, warm started, and with the
+// windows in parallel on threadCount threads, and compares the horizon
+// hours solved per second and the cost of each
+int runCommitBenchmark(int plantCount, size_t hours, unsigned threadCount);
+
+// Dispatches a synthetic grid short of power serving the locations in each
+// demand order and compares the profit of each, then times re-pricing
+// updateCount locations in the queue against sorting them all again
+int runDemandOrderBenchmark(int plantCount, int demandCount, int updateCount);
+
+// Changes the uptime of 100%, 10%, 1%, and 0.1% of a synthetic grid's
+// plants each step and times bringing the plants and capacity totals up
+// to date against recalculating and summing every plant
+int runAdjustBenchmark(int plantCount, int stepCount);
@@ -4,6 +4,7 @@ template<typename T>
 class Node {
 public:
     Node* next;
+    Node* prev;
     T data;
 };
 
@@ -12,25 +13,29 @@ class LinkedList
 {
 private:
     Node<T>* head;
+    int count;      // Number of nodes currently in the List
 
 public:
     //Constructor, initialized to automatically create the head when the List is created
-    LinkedList() : head(nullptr) {}
+    LinkedList() : head(nullptr), count(0) {}
 
     //Deconstructor, to automatically deallocate the memory of every node in the List after the ending of the code
     ~LinkedList() {}
 
-    //insert(T x), inserts new nodes with specified data after the head (at the front)
-    void insert(T x)
+    //insert(T x), inserts new nodes in sorted order and returns the node so callers can index it
+    Node<T>* insert(T x)
     {
         Node<T>* newNode = new Node<T>;
         newNode->data = x;
+        newNode->prev = nullptr;
+        count++;
 
         if (!head || (*x < *head->data))
         {
             newNode->next = head;
+            if (head) head->prev = newNode;
             head = newNode;
-            return;
+            return newNode;
         }
 
         Node<T>* current = head;
@@ -41,9 +46,42 @@ public:
         }
 
         newNode->next = current->next;
+        newNode->prev = current;
+        if (current->next) current->next->prev = newNode;
         current->next = newNode;
+        return newNode;
     }
 
+    //remove(Node<T>* node), unlinks a node in O(1) using its back link and deletes the node and its data
+    void remove(Node<T>* node)
+    {
+        if (node->prev) node->prev->next = node->next;
+        else head = node->next;
+
+        if (node->next) node->next->prev = node->prev;
+
+        delete node->data;
+        delete node;
+        count--;
+    }
+
+    //unlink(Node<T>* node), unlinks a node in O(1) and deletes the node, handing its data back to the caller
+    T unlink(Node<T>* node)
+    {
+        if (node->prev) node->prev->next = node->next;
+        else head = node->next;
+
+        if (node->next) node->next->prev = node->prev;
+
+        T data = node->data;
+        delete node;
+        count--;
+        return data;
+    }
+
+    //size(), returns the number of nodes in the List
+    int size() const { return count; }
+
     //emptyList(), deletes all nodes in the List
     void emptyList()
     {
@@ -60,6 +98,7 @@ public:
         }
 
         head = nullptr;
+        count = 0;
     }
 
     // Iterator for LinkedList
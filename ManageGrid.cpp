@@ -17,38 +17,80 @@ void PowerGrid::printGrid(string description)
 
 int PowerGrid::loadGrid()
 {
-    int rc;
+    return loadGrid(PLANTS_FILE, DEMANDS_FILE, TRANSLINES_FILE);
+}
+
+// The three files fill separate collections, so they are read as
+// independent tasks on the task pool.
+int PowerGrid::loadGrid(const string& plantsFile, const string& demandsFile, const string& linesFile)
+{
+    int plantRc = 0, demandRc = 0, lineRc = 0;
+    TaskPool& pool = getTaskPool();
 
     // Read Plant information
-    rc = readPlantData(PLANTS_FILE);
-    if (rc) { return 1; }
+    auto plantTask = pool.submit([&]() { plantRc = readPlantData(plantsFile); });
 
     // Read Demand information.
-    rc = readDemandData(DEMANDS_FILE);
-    if (rc) { return 1; }
+    auto demandTask = pool.submit([&]() { demandRc = readDemandData(demandsFile); });
 
     // Read Transmission Line information.
-    rc = readTransLineData(TRANSLINES_FILE);
-    if (rc) { return 1; }
+    auto lineTask = pool.submit([&]() { lineRc = readTransLineData(linesFile); });
+
+    pool.wait(plantTask);
+    pool.wait(demandTask);
+    pool.wait(lineTask);
+
+    if (plantRc || demandRc || lineRc) { return 1; }
 
     return 0;
 }
 
+void PowerGrid::setThreadCount(unsigned count)
+{
+    lock_guard<mutex> guard(taskPoolLock);
+    threadCount = count;
+    taskPool.reset();
+}
+
+TaskPool& PowerGrid::getTaskPool() const
+{
+    lock_guard<mutex> guard(taskPoolLock);
+    if (!taskPool)
+        taskPool.reset(new TaskPool(threadCount));
+    return *taskPool;
+}
+
 void PowerGrid::shutdownGrid()
 {
     // Clearing the vector of demands
-    for (Demand a : demands)
-    {
-        demands.pop_back();
-    }
+    demands.clear();
+    demandIndex.clear();
+    demandQueue.clear();
 
     // Clearing the vector of lines
-    for (TransLine b : transLines)
-    {
-        transLines.pop_back();
-    }
+    transLines.clear();
+    lineIndex.clear();
+    lineOrdersValid = false;
+    transLinesSorted = false;
 
     // Clearing the LinkedList of plants
+    plantViews.clear();
+    plantTracker.clear();
     plants.emptyList();
+    plantIndex.clear();
+    plantTable.clear();
+    plantOrdersValid = false;
+    storageBank.clear();
+    storageBankValid = false;
+
+    // Clearing the recorded dispatches
+    ledger.clear();
+    dispatchCache.clear();
+    powerFlow.reset();
 
+    // Tells monitors the grid is gone
+    monitorExport.reset();
+    monitorPlantsValid = false;
+    monitorDemandsValid = false;
+    monitorLinesValid = false;
 }
\ No newline at end of file
@@ -0,0 +1,571 @@
+// File: MultiArea.cpp
+//
+// Contains the function definitions for the MultiAreaGrid.  See
+// MultiArea.h for how the areas and the tie flows are coordinated.
+//
+#include "MultiArea.h"
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+using namespace std;
+
+// Price differences smaller than this do not move a tie
+static const double TIE_PRICE_EPSILON = 1e-6;
+
+static const string TIE_PREFIX = "tie:";
+
+
+//
+// load():  Reads the flat grid, then the areas file, and moves each plant,
+//          location, and line into the grid of its area.  Each tie gets an
+//          import plant in both of its areas.
+//
+int MultiAreaGrid::load(const string& plantsFile, const string& demandsFile, const string& linesFile,
+                        const string& areasFile) {
+    shutdown();
+
+    PowerGrid source;
+    if (source.loadGrid(plantsFile, demandsFile, linesFile)) {
+        source.shutdownGrid();
+        return 1;
+    }
+
+    ifstream isAreas(areasFile);
+    if (!isAreas) {
+        cerr << "Error: Unable to open file " << areasFile << endl;
+        source.shutdownGrid();
+        return 1;
+    }
+
+    string headerLine, record, name, area, toArea;
+    double capacity;
+    unordered_map<string, uint32_t> plantArea, demandArea, lineArea;
+    int rc = 0;
+
+    getline(isAreas, headerLine);
+    getline(isAreas, headerLine);
+
+    while (rc == 0 && isAreas >> record) {
+        if (record == "AREA") {
+            isAreas >> name;
+            if (findArea(name) >= 0) {
+                cerr << "Error: Duplicate area " << name << endl;
+                rc = 1;
+            }
+            else
+                areaNames.push_back(name);
+        }
+        else if (record == "PLANT" || record == "DEMAND" || record == "LINE") {
+            isAreas >> name >> area;
+            int index = findArea(area);
+            bool known = (record == "PLANT") ? source.findPlant(name) != nullptr :
+                         (record == "DEMAND") ? source.findDemand(name) != nullptr : source.findTransLine(name) != nullptr;
+            if (index < 0 || !known) {
+                cerr << "Error: Areas file places " << record << " " << name << " in " << area << endl;
+                rc = 1;
+            }
+            else if (record == "PLANT")
+                plantArea[name] = uint32_t(index);
+            else if (record == "DEMAND")
+                demandArea[name] = uint32_t(index);
+            else
+                lineArea[name] = uint32_t(index);
+        }
+        else if (record == "TIE") {
+            isAreas >> name >> area >> toArea >> capacity;
+            int from = findArea(area), to = findArea(toArea);
+            if (from < 0 || to < 0 || from == to || !(capacity > 0)) {
+                cerr << "Error: Bad tie line " << name << endl;
+                rc = 1;
+            }
+            else {
+                TieLine tie;
+                tie.tieID = name;
+                tie.from = uint32_t(from);
+                tie.to = uint32_t(to);
+                tie.capacity = capacity;
+                ties.push_back(tie);
+            }
+        }
+        else {
+            cerr << "Error: Unknown areas record " << record << endl;
+            rc = 1;
+        }
+
+        if (isAreas.fail()) {
+            cerr << "Error: Incomplete " << record << " record in " << areasFile << endl;
+            rc = 1;
+        }
+    }
+    isAreas.close();
+
+    if (rc == 0 && areaNames.empty()) {
+        cerr << "Error: " << areasFile << " has no areas" << endl;
+        rc = 1;
+    }
+    if (rc) {
+        source.shutdownGrid();
+        shutdown();
+        return 1;
+    }
+
+    // Split the source grid.  The plants are handed over; locations and
+    // lines are copied by the thread that builds their area.
+    uint32_t areaCount = uint32_t(areaNames.size());
+    vector<vector<Plant*>> areaPlants(areaCount);
+    vector<vector<const Demand*>> areaDemands(areaCount);
+    vector<vector<const TransLine*>> areaLines(areaCount);
+
+    for (auto plant : source.getPlantList()) {
+        auto it = plantArea.find(plant->getName());
+        areaPlants[(it == plantArea.end()) ? 0 : it->second].push_back(source.detachPlant(plant->getName()));
+    }
+    for (auto& demand : source.getDemandList()) {
+        auto it = demandArea.find(demand.getLocation());
+        areaDemands[(it == demandArea.end()) ? 0 : it->second].push_back(&demand);
+    }
+    for (auto& line : source.getLineList()) {
+        auto it = lineArea.find(line.getLineID());
+        areaLines[(it == lineArea.end()) ? 0 : it->second].push_back(&line);
+    }
+
+    areas.resize(areaCount);
+    prices.resize(areaCount);
+    meritOrders.resize(areaCount);
+
+    getPool().parallelFor(areaCount, 1, [&](size_t first, size_t last) {
+        for (size_t a = first; a < last; a++) {
+            areas[a].reset(new PowerGrid);
+            PowerGrid& grid = *areas[a];
+            grid.setThreadCount(1);
+
+            for (auto plant : areaPlants[a])
+                grid.addPlantToGrid(plant);
+            for (auto demand : areaDemands[a])
+                grid.addDemand(*demand);
+            for (auto line : areaLines[a])
+                grid.addTransLine(*line);
+
+            for (auto& tie : ties) {
+                if (tie.from == a || tie.to == a)
+                    grid.addPlantToGrid(new TiePlant(TIE_PREFIX + tie.tieID, tie.capacity));
+            }
+
+            grid.sortTransLines();
+            grid.adjustPlantsForConditions();
+            grid.setAllocationLog(false);
+            grid.setDispatchPolicy(DP_COST);
+        }
+    });
+
+    for (auto& tie : ties) {
+        tie.imports[0] = static_cast<TiePlant*>(areas[tie.from]->findPlant(TIE_PREFIX + tie.tieID));
+        tie.imports[1] = static_cast<TiePlant*>(areas[tie.to]->findPlant(TIE_PREFIX + tie.tieID));
+    }
+
+    source.shutdownGrid();
+    return 0;
+}
+
+
+//
+// findArea():  Returns the index of the named area, or -1
+//
+int MultiAreaGrid::findArea(const string& name) const {
+    auto it = find(areaNames.begin(), areaNames.end(), name);
+    return (it == areaNames.end()) ? -1 : int(it - areaNames.begin());
+}
+
+
+//
+// applySchedule():  Sets the area's tie imports to the flows scheduled in,
+//      priced at what the sending area charges
+//
+void MultiAreaGrid::applySchedule(uint32_t area) {
+    PowerGrid& grid = *areas[area];
+
+    for (auto& tie : ties) {
+        if (tie.from != area && tie.to != area)
+            continue;
+
+        int end = (tie.to == area) ? 1 : 0;
+        bool receiving = end ? tie.flow > 0 : tie.flow < 0;
+
+        TiePlant* import = tie.imports[end];
+        import->setSchedule(receiving ? fabs(tie.flow) : 0);
+        import->calculateOutput();
+        if (import->getCostPerMW() != tie.price)
+            grid.repricePlant(import->getName(), tie.price);
+    }
+}
+
+
+//
+// sendExports():  Draws the power scheduled out over each tie after the
+//      area's locations are served, cheapest first.  Power brought in over
+//      other ties and not used here is passed on in price order with the
+//      area's own plants, so an area can carry power between neighbours.
+//      Records what was sent and what making it cost on the tie; only the
+//      sending area writes these, so areas can run at the same time.
+//
+void MultiAreaGrid::sendExports(uint32_t area) {
+    const vector<Plant*>& merit = meritOrders[area];
+    vector<Plant*> imports = areaImports(area);
+    stable_sort(imports.begin(), imports.end(), [](const Plant* a, const Plant* b) {
+        return a->getCostPerMW() < b->getCostPerMW();
+    });
+
+    for (auto& tie : ties) {
+        bool sending = (tie.from == area && tie.flow > 0) || (tie.to == area && tie.flow < 0);
+        if (!sending)
+            continue;
+
+        double needed = fabs(tie.flow);
+        size_t own = 0, passed = 0;
+        tie.sent = tie.sentCost = 0;
+
+        while (needed > 0 && (own < merit.size() || passed < imports.size())) {
+            bool passOn = passed < imports.size() &&
+                          (own == merit.size() || imports[passed]->getCostPerMW() < merit[own]->getCostPerMW());
+            Plant* plant = passOn ? imports[passed++] : merit[own++];
+
+            double taken = min(needed, plant->getAvailCapacity());
+            if (taken <= 0)
+                continue;
+
+            plant->reduceCapacity(taken);
+            tie.sent += taken;
+            needed -= taken;
+            if (!passOn)
+                tie.sentCost += taken * plant->getCostPerMW();
+        }
+    }
+}
+
+
+//
+// areaImports():  The tie imports of one area
+//
+vector<Plant*> MultiAreaGrid::areaImports(uint32_t area) const {
+    vector<Plant*> imports;
+    for (auto& tie : ties) {
+        if (tie.from == area)
+            imports.push_back(tie.imports[0]);
+        else if (tie.to == area)
+            imports.push_back(tie.imports[1]);
+    }
+    return imports;
+}
+
+
+//
+// dispatchArea():  Dispatches one area with the tie schedule and records
+//      the prices it offers its neighbours.  Only the area's own data is
+//      touched, so areas can run at the same time.
+//
+// An area whose ties carry the same flows at the same prices as at its
+// last dispatch keeps that dispatch and its prices.  Otherwise it is
+// dispatched afresh: replaying the last dispatch would keep the area's
+// own dearer plants ahead of cheaper power brought in.
+//
+void MultiAreaGrid::dispatchArea(uint32_t area) {
+    vector<double> tieState;
+    for (auto& tie : ties) {
+        if (tie.from == area || tie.to == area) {
+            tieState.push_back(tie.flow);
+            tieState.push_back(tie.price);
+        }
+    }
+    if (tieState == dispatchedTies[area])
+        return;
+    dispatchedTies[area].swap(tieState);
+
+    PowerGrid& grid = *areas[area];
+    applySchedule(area);
+    grid.redispatch();
+    sendExports(area);
+
+    const double infinite = numeric_limits<double>::infinity();
+    AreaPrices& price = prices[area];
+
+    bool lineRoom = false;
+    for (auto& line : grid.getLineList())
+        lineRoom = lineRoom || line.getAvailCapacity() > AREA_FLOW_TOLERANCE;
+
+    // The merit order is cheapest first, so the first plant with power left
+    // makes the next MW and the last one drawn made the dearest
+    price.nextCost = infinite;
+    price.marginalCost = 0;
+    for (auto plant : meritOrders[area]) {
+        if (plant->getAvailCapacity() < plant->getCurCapacity())
+            price.marginalCost = plant->getCostPerMW();
+        if (plant->getAvailCapacity() > AREA_FLOW_TOLERANCE && price.nextCost == infinite)
+            price.nextCost = plant->getCostPerMW();
+    }
+
+    // Imports count at their price.  One left unused can be passed on, and
+    // caps what more power brought in is worth.
+    double unusedImport = infinite;
+    for (auto import : areaImports(area)) {
+        if (import->getAvailCapacity() < import->getCurCapacity())
+            price.marginalCost = max(price.marginalCost, import->getCostPerMW());
+        if (import->getAvailCapacity() > AREA_FLOW_TOLERANCE)
+            unusedImport = min(unusedImport, import->getCostPerMW());
+    }
+    price.nextCost = min(price.nextCost, unusedImport);
+
+    // More power is worth the dearest MW it would replace, or any price
+    // while a location is short and has a line to bring it in on
+    bool shortOfPower = false;
+    for (auto& demand : grid.getDemandList())
+        shortOfPower = shortOfPower || (lineRoom && demand.getPowerDeficit() > AREA_FLOW_TOLERANCE);
+    price.worth = min(unusedImport, shortOfPower ? infinite : price.marginalCost);
+}
+
+
+//
+// dispatchAreas():  Runs one round, every area as its own task
+//
+void MultiAreaGrid::dispatchAreas() {
+    getPool().parallelFor(areas.size(), 1, [this](size_t first, size_t last) {
+        for (size_t a = first; a < last; a++)
+            dispatchArea(uint32_t(a));
+    });
+}
+
+
+//
+// measureTie():  Records the power the receiving area drew from its tie
+//      import and how much of it the sending area made
+//
+void MultiAreaGrid::measureTie(TieLine& tie) const {
+    tie.used = tie.agreed = 0;
+    if (tie.flow == 0) {
+        tie.sent = tie.sentCost = 0;
+        return;
+    }
+
+    TiePlant* import = tie.imports[(tie.flow > 0) ? 1 : 0];
+    tie.used = import->getCurCapacity() - import->getAvailCapacity();
+    tie.agreed = copysign(min(tie.sent, tie.used), tie.flow);
+}
+
+
+//
+// updateTies():  Moves each tie's flow one step towards the area that
+//      values power above what the other area can make it for, and prices
+//      the flow at the sending area's cost.  Returns true when no flow
+//      moved by more than AREA_FLOW_TOLERANCE.
+//
+bool MultiAreaGrid::updateTies() {
+    bool settled = true;
+
+    for (auto& tie : ties) {
+        measureTie(tie);
+        const AreaPrices& from = prices[tie.from];
+        const AreaPrices& to = prices[tie.to];
+
+        bool forward = to.worth > from.nextCost + TIE_PRICE_EPSILON;
+        bool backward = from.worth > to.nextCost + TIE_PRICE_EPSILON;
+        int direction = (forward == backward) ? 0 : (forward ? 1 : -1);
+
+        // A sender that fell short is held to what it delivered
+        double base = tie.flow;
+        bool overshot = fabs(tie.flow) > tie.sent + AREA_FLOW_TOLERANCE;
+        if (overshot)
+            base = copysign(tie.sent, tie.flow);
+
+        // The step is halved when the flow overshoots, reverses, or stops,
+        // and grows while it keeps moving the same way.  A tie held still
+        // because an end has no power left to send keeps its step for when
+        // other ties bring more in.
+        bool waiting = direction == 0 && !overshot && (isinf(from.nextCost) || isinf(to.nextCost));
+        if (!waiting) {
+            if (overshot || (tie.lastDirection != 0 && direction != tie.lastDirection))
+                tie.step /= 2;
+            else if (direction != 0 && direction == tie.lastDirection)
+                tie.step = min(tie.capacity, tie.step * AREA_STEP_GROWTH);
+            tie.lastDirection = direction;
+        }
+
+        double next = max(-tie.capacity, min(tie.capacity, base + direction * tie.step));
+        if (fabs(next - tie.flow) > AREA_FLOW_TOLERANCE)
+            settled = false;
+        tie.flow = next;
+
+        // The receiving area pays the sender's dearest MW, or its next one
+        // while nothing has been sent yet
+        const AreaPrices& sender = (tie.flow >= 0) ? from : to;
+        bool sending = (tie.flow >= 0) == (tie.agreed >= 0) && tie.sent > 0;
+        double price = sending ? sender.marginalCost : sender.nextCost;
+        tie.price = isfinite(price) ? price : sender.marginalCost;
+    }
+    return settled;
+}
+
+
+//
+// dispatch():  Exchanges tie flows and prices until they settle, then
+//      dispatches once more with each tie at the power both of its areas
+//      matched
+//
+MultiAreaResult MultiAreaGrid::dispatch() {
+    MultiAreaResult result;
+    auto start = chrono::steady_clock::now();
+
+    // Start from no exchange, with steps a quarter of the smaller area
+    vector<double> areaCapacity(areas.size(), 0);
+    for (size_t a = 0; a < areas.size(); a++) {
+        meritOrders[a].clear();
+        for (auto plant : areas[a]->getPlantOrder(PK_COST)) {
+            if (!dynamic_cast<TiePlant*>(plant)) {
+                meritOrders[a].push_back(plant);
+                areaCapacity[a] += plant->getCurCapacity();
+            }
+        }
+    }
+    for (auto& tie : ties) {
+        tie.flow = tie.price = tie.sent = tie.sentCost = 0;
+        tie.lastDirection = 0;
+        tie.step = min(tie.capacity, 0.25 * min(areaCapacity[tie.from], areaCapacity[tie.to]));
+    }
+    // NaN matches no tie state, so every area dispatches in the first round
+    dispatchedTies.assign(areas.size(), vector<double>(1, NAN));
+
+    while (result.rounds < AREA_MAX_ROUNDS) {
+        dispatchAreas();
+        result.rounds++;
+        if (updateTies()) {
+            result.converged = true;
+            break;
+        }
+    }
+
+    // Settle: cut each tie to the power both of its ends matched and
+    // dispatch again.  A cut can leave power passed on over another tie
+    // unused, so repeat until every tie balances.  Flows only shrink.
+    if (!ties.empty()) {
+        dispatchAreas();
+        result.rounds++;
+        for (int pass = 0; pass < AREA_MAX_ROUNDS; pass++) {
+            bool balanced = true;
+            for (auto& tie : ties) {
+                measureTie(tie);
+                balanced = balanced && fabs(tie.sent - tie.used) <= AREA_FLOW_TOLERANCE;
+            }
+            if (balanced)
+                break;
+
+            for (auto& tie : ties)
+                tie.flow = tie.agreed;
+            dispatchAreas();
+            result.rounds++;
+        }
+    }
+
+    for (auto& tie : ties) {
+        measureTie(tie);
+        result.tieFlow += fabs(tie.flow);
+        result.imbalance += fabs(tie.sent - tie.used);
+        result.cost += tie.sentCost;
+    }
+
+    for (size_t a = 0; a < areas.size(); a++) {
+        for (auto& demand : areas[a]->getDemandList())
+            result.acquired += demand.getPowerAcquired();
+        for (auto& entry : areas[a]->getLastLedger()) {
+            if (!dynamic_cast<TiePlant*>(entry.plant))
+                result.cost += entry.cost;
+        }
+    }
+
+    result.ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+
+//
+// printAreas():  Prints the supply of each area and the flow on each tie
+//
+void MultiAreaGrid::printAreas() const {
+    cout << "\n\t--- Grid Areas ---\n";
+    cout << "    Area            Plants  Locations  Lines   Required(MW)   Supplied(MW)    Generation Cost\n";
+    cout << std::fixed << setprecision(2);
+
+    for (size_t a = 0; a < areas.size(); a++) {
+        const PowerGrid& grid = *areas[a];
+        double required = 0, acquired = 0, cost = 0;
+        for (auto& demand : grid.getDemandList()) {
+            required += demand.getPowerRequired();
+            acquired += demand.getPowerAcquired();
+        }
+        for (auto& entry : grid.getLastLedger()) {
+            if (!dynamic_cast<TiePlant*>(entry.plant))
+                cost += entry.cost;
+        }
+        size_t tieCount = 0;
+        for (auto& tie : ties) {
+            tieCount += (tie.from == a || tie.to == a);
+            if ((tie.from == a && tie.flow > 0) || (tie.to == a && tie.flow < 0))
+                cost += tie.sentCost;
+        }
+
+        cout << "    " << setw(14) << left << areaNames[a] << right
+             << setw(8) << grid.getPlantList().size() - tieCount << setw(11) << grid.getDemandList().size()
+             << setw(7) << grid.getLineList().size() << setw(15) << required << setw(15) << acquired
+             << setw(19) << cost << "\n";
+    }
+
+    cout << "\n    Tie             From           To               Capacity       Flow(MW)   Price($/MW)\n";
+    for (auto& tie : ties) {
+        bool forward = tie.flow >= 0;
+        cout << "    " << setw(14) << left << tie.tieID << "  " << setw(14) << areaNames[forward ? tie.from : tie.to]
+             << " " << setw(14) << areaNames[forward ? tie.to : tie.from] << right
+             << setw(11) << tie.capacity << setw(15) << fabs(tie.flow) << setw(14) << tie.price << "\n";
+    }
+    cout << endl;
+}
+
+
+//
+// shutdown():  Removes every area and tie
+//
+void MultiAreaGrid::shutdown() {
+    for (auto& area : areas) {
+        if (area)
+            area->shutdownGrid();
+    }
+    areas.clear();
+    areaNames.clear();
+    ties.clear();
+    prices.clear();
+    meritOrders.clear();
+    dispatchedTies.clear();
+    pool.reset();
+}
+
+
+//
+// setThreadCount():  Threads that dispatch the areas, 0 = one per area
+//
+void MultiAreaGrid::setThreadCount(unsigned count) {
+    threadCount = count;
+    pool.reset();
+}
+
+TaskPool& MultiAreaGrid::getPool() {
+    if (!pool)
+        pool.reset(new TaskPool(threadCount ? threadCount : max<unsigned>(1, unsigned(areaNames.size()))));
+    return *pool;
+}
+
+
+// Accessors
+uint32_t MultiAreaGrid::getAreaCount() const { return uint32_t(areas.size()); }
+PowerGrid& MultiAreaGrid::getArea(uint32_t area) { return *areas[area]; }
+const string& MultiAreaGrid::getAreaName(uint32_t area) const { return areaNames[area]; }
+const vector<TieLine>& MultiAreaGrid::getTies() const { return ties; }
@@ -0,0 +1,130 @@
+#pragma once
+// File: MultiArea.h
+//
+// Contains class definition for the MultiAreaGrid, a regional grid split
+// into areas that each dispatch on their own.
+//
+// One flat PowerGrid draws every plant through every line for every
+// location, so its dispatch grows with plants times locations.  A
+// MultiAreaGrid gives each area its own PowerGrid holding only the area's
+// plants, locations, and lines.  The areas are built in parallel, each by
+// one thread, so an area's locations and lines sit together in memory
+// instead of spread through one large vector.  The areas are joined by
+// tie lines of limited capacity.
+//
+// Each tie line appears in both of its areas as a TiePlant for power
+// flowing in.  Power flowing out is drawn in merit order after the area's
+// locations are served, so an area only sends what it does not need, and
+// imports it does not use can be passed on to the next area.  Exports do
+// not use the area's lines, which join its locations to its grid.  A
+// coordination loop exchanges flows and prices:
+//
+//  1) Every area dispatches in parallel with the tie flows scheduled.  An
+//     area whose ties did not change since its last dispatch keeps it.
+//  2) Each area reports the cost of its next MW (its cheapest plant with
+//     power left) and the value of one more MW brought in (its dearest
+//     plant in use, or unbounded while locations are short).
+//  3) Each tie moves its flow by a step towards the area that values
+//     power more than the other area can make it.  The step is halved
+//     whenever the flow overshoots or turns, and grows while it keeps
+//     moving the same way.
+//
+// The loop ends when no tie moves by more than AREA_FLOW_TOLERANCE MW, or
+// after AREA_MAX_ROUNDS.  Power passed through a long chain of areas only
+// moves one tie per round, so such chains may stop short of the flat
+// grid's dispatch.
+// A last round then settles each tie to the power actually sent and used.
+// Areas only read their own data during a round and the ties are updated
+// in file order between rounds, so the result does not depend on the
+// number of threads.
+//
+// The areas file has two header lines and then one record per line:
+//
+//      AREA    name
+//      PLANT   plantName   area
+//      DEMAND  location    area
+//      LINE    lineID      area
+//      TIE     tieID       fromArea    toArea      capacity (MW)
+//
+// Plants, locations, and lines not listed belong to the first area.
+//
+#include <string>
+#include <vector>
+#include <memory>
+#include "PowerGrid.h"
+using namespace std;
+
+// A tie line between two areas.  Positive flow runs from -> to.
+struct TieLine {
+    string      tieID;
+    uint32_t    from, to;
+    double      capacity;
+    double      flow = 0;           // MW scheduled
+    double      step = 0;           // MW the next adjustment moves the flow
+    int         lastDirection = 0;
+    double      price = 0;          // What the receiving area pays per MW
+    double      sent = 0;           // MW the sending area made for the tie last round
+    double      sentCost = 0;       // What making them cost
+    double      used = 0;           // MW the receiving area drew last round
+    double      agreed = 0;         // Signed MW both areas matched last round
+
+    // The tie's import inside its from [0] and to [1] areas
+    TiePlant*   imports[2] = { nullptr, nullptr };
+};
+
+// Prices an area reports after each round
+struct AreaPrices {
+    double      nextCost;           // Cost of one more MW made here, infinite if none can be
+    double      marginalCost;       // Cost of the dearest MW made or brought in here
+    double      worth;              // What one more MW brought in is worth here
+};
+
+struct MultiAreaResult {
+    int         rounds = 0;         // Times every area was dispatched
+    bool        converged = false;
+    double      acquired = 0;       // MW delivered to locations
+    double      cost = 0;           // Generation cost, tie imports priced at the sender's cost
+    double      tieFlow = 0;        // Sum of the tie flows
+    double      imbalance = 0;      // Power sent over ties that was not drawn, MW
+    double      ms = 0;
+};
+
+//
+// Class MultiAreaGrid
+//
+class MultiAreaGrid {
+private:
+    vector<string>                  areaNames;
+    vector<unique_ptr<PowerGrid>>   areas;
+    vector<TieLine>                 ties;
+    vector<AreaPrices>              prices;
+    vector<vector<Plant*>>          meritOrders;    // Per area, its own plants cheapest first
+    vector<vector<double>>          dispatchedTies; // Per area, its tie flows and prices at its last dispatch
+    unique_ptr<TaskPool>            pool;
+    unsigned                        threadCount = 0;
+
+    int findArea(const string& name) const;
+    void applySchedule(uint32_t area);      // Tie imports into the area's grid
+    void sendExports(uint32_t area);        // Draws the tie exports from the area's plants
+    vector<Plant*> areaImports(uint32_t area) const;
+    void dispatchArea(uint32_t area);       // Dispatches and reports prices
+    void dispatchAreas();                   // Every area, in parallel
+    void measureTie(TieLine& tie) const;    // Power sent and used at the scheduled flow
+    bool updateTies();                      // Returns true once every tie has settled
+    TaskPool& getPool();
+
+public:
+    // Loads the flat grid files and splits them into the areas of areasFile
+    int load(const string& plantsFile, const string& demandsFile, const string& linesFile, const string& areasFile);
+    void setThreadCount(unsigned count);    // 0 = one thread per area
+
+    MultiAreaResult dispatch();
+    void printAreas() const;
+    void shutdown();
+
+    uint32_t getAreaCount() const;
+    PowerGrid& getArea(uint32_t area);
+    const string& getAreaName(uint32_t area) const;
+    const vector<TieLine>& getTies() const;
+};
+
@@ -5,9 +5,12 @@
 
 #include "GridDef.h"
 #include "Plant.h"
+#include "PlantTracker.h"
 #include <iostream>
 #include <sstream>
 #include <iomanip>
+#include <cmath>
+#include <algorithm>
 
 //******************************************************
 //                  Plant Base Class               *****
@@ -16,7 +19,8 @@
 // plantCount
 // 
 // Initializing plantCount to zero
-int Plant::plantCount = 0;
+atomic<int> Plant::plantCount(0);
+bool Plant::destroyLog = true;
 
 
 //
@@ -28,21 +32,33 @@ Plant::Plant(const string& _name, const string& _type, int _sustain, double _cap
     type = _type;
     sustainScore = _sustain;
     uptime = _uptime;
+    online = true;
     maxCapacity = _capacity;        // Initally set all capacities to the same value
     curCapacity = _capacity;
     availCapacity = _capacity;
     costPerMW = _cost;
+    availTicks = toPowerTicks(_capacity);
+    costTicks = toMoneyTicks(_cost);
+
+    tracker = nullptr;
+    inputsChanged = true;           // Nothing calculated yet
+    listed = false;
+    countedCapacity = 0;
+    countedOnline = false;
 
     plantCount++;
 }
 
 Plant::~Plant() // Destructor
 {
-    plantCount--;
+    int plantsLeft = --plantCount;
 
-    cout << "Destroying plant: " << name << ". Number of plants left: " << plantCount << ".\n";
+    if (destroyLog)
+        cout << "Destroying plant: " << name << ". Number of plants left: " << plantsLeft << ".\n";
 }
 
+void Plant::setDestroyLog(bool enable) { destroyLog = enable; }
+
 
 
 //
@@ -60,10 +76,78 @@ void Plant::reduceCapacity(double amount) {
         assert(amount <= availCapacity);
         availCapacity -= amount;
     }
+    availTicks = toPowerTicks(availCapacity);
+}
+
+
+//
+// reduceCapacityTicks() - reduces available capacity by an exact amount.
+//                         No rounding tolerance is needed in fixed point.
+//
+void Plant::reduceCapacityTicks(PowerTicks amount) {
+    assert(amount <= availTicks);
+    availTicks -= amount;
+    availCapacity = toMW(availTicks);
+}
+
+
+//
+// releaseCapacity() - returns part of an allocation to the plant
+//
+void Plant::releaseCapacity(double amount) {
+    availCapacity = min(curCapacity, availCapacity + amount);
+    availTicks = toPowerTicks(availCapacity);
+}
+
+void Plant::releaseCapacityTicks(PowerTicks amount) {
+    availTicks += amount;
+    assert(availTicks <= toPowerTicks(curCapacity));
+    availCapacity = min(curCapacity, toMW(availTicks));   // Ticks round curCapacity up to half a tick
+}
+
+
+//
+// resetAvailCapacity() - releases everything allocated from the plant
+//
+void Plant::resetAvailCapacity() {
+    availCapacity = curCapacity;
+    availTicks = toPowerTicks(curCapacity);
+}
+
+
+//
+// setOutput() - records the output calculated for current conditions as
+//               both the current and the available capacity.  A tripped
+//               plant has no output.
+//
+void Plant::setOutput(double output) {
+    if (!online)
+        output = 0;
+
+    curCapacity = output;
+    availCapacity = output;
+    availTicks = toPowerTicks(output);
+
+    inputsChanged = false;
+    if (tracker && !listed && curCapacity != countedCapacity)
+        tracker->list(this);
+}
+
+
+//
+// conditionsChanged() - marks the plant for calculateOutput() and, on a
+//                       grid, lists it the first time since the grid's
+//                       plants were last brought up to date
+//
+void Plant::conditionsChanged() {
+    inputsChanged = true;
+    if (tracker && !listed)
+        tracker->list(this);
 }
 
 
 // Getters and Setters
+void Plant::setCostPerMW(double cost) { costPerMW = cost; costTicks = toMoneyTicks(cost); }
 string Plant::getName() const { return name; }
 string Plant::getType() const { return type; }
 int Plant::getSustainScore() const { return sustainScore; }
@@ -72,6 +156,24 @@ double Plant::getCurCapacity() const { return curCapacity; }
 double Plant::getAvailCapacity() const { return availCapacity; }
 double Plant::getCostPerMW() const { return costPerMW; }
 double Plant::getUptimePercent() const { return uptime; }
+bool Plant::isOnline() const { return online; }
+void Plant::setOnline(bool isOnline) {
+    if (online != isOnline) {
+        online = isOnline;
+        conditionsChanged();
+    }
+}
+
+void Plant::setUptimePercent(double percent) {
+    if (uptime != percent) {
+        uptime = percent;
+        conditionsChanged();
+    }
+}
+
+bool Plant::hasConditionsChanged() const { return inputsChanged; }
+PowerTicks Plant::getAvailTicks() const { return availTicks; }
+MoneyTicks Plant::getCostTicks() const { return costTicks; }
 
 
 // Display plant information
@@ -91,6 +193,16 @@ string Plant::getCurConditions() {
     return "No plant condtions available.";
 }
 
+//
+// Default condition parameters:  output depends only on uptime
+//
+int Plant::getConditionCount() const { return 0; }
+void Plant::setConditions(const double*) {}
+void Plant::getConditions(double*) const {}
+
+// Default emissions:  none
+double Plant::getEmissionRate() const { return 0; }
+
 //
 // Overloaded Comparison Operator
 //
@@ -121,12 +233,22 @@ double SolarFarm::calculateOutput() {
 
     // Calculate and set the current output of this plant
     double output = panelCount * (sunlightHours / 24) * uptime / 70000.0;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 
 }
 
+// Conditions:  sunlight hours
+int SolarFarm::getConditionCount() const { return 1; }
+void SolarFarm::setConditions(const double* values) {
+    if (sunlightHours != values[0]) {
+        sunlightHours = values[0];
+        conditionsChanged();
+    }
+}
+
+void SolarFarm::getConditions(double* values) const { values[0] = sunlightHours; }
+
 string SolarFarm::getCurConditions() {
     stringstream oss;
     oss << "Panel Cnt: " << panelCount <<
@@ -159,12 +281,22 @@ WindFarm::WindFarm(const string& name, int sustain, double capacity, double cost
 // calcuateOutput():  Override to calculate output of the plant
 double WindFarm::calculateOutput() {
     double output = turbineCount * 2 * avgWindSpeed * uptime / 1900.0;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return  output;
 }
 
 
+// Conditions:  average wind speed
+int WindFarm::getConditionCount() const { return 1; }
+void WindFarm::setConditions(const double* values) {
+    if (avgWindSpeed != values[0]) {
+        avgWindSpeed = values[0];
+        conditionsChanged();
+    }
+}
+
+void WindFarm::getConditions(double* values) const { values[0] = avgWindSpeed; }
+
 //
 // getCurCondtions():  Returns the current conditons at the plant
 // 
@@ -191,8 +323,7 @@ FossilPlant::FossilPlant(const string& name, int sustain, double capacity, doubl
 double FossilPlant::calculateOutput() {
     double output;
     output = maxCapacity * uptime / 100.0;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
@@ -206,6 +337,8 @@ string FossilPlant::getCurConditions() {
     return oss.str();
 }
 
+double FossilPlant::getEmissionRate() const { return emissionRate; }
+
 
 
 
@@ -222,11 +355,21 @@ HydroPlant::HydroPlant(const string& name, int sustain, double capacity, double
 double HydroPlant::calculateOutput() {
     double output;
     output = waterFlowRate * uptime / 3065500.0;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
+// Conditions:  water flow rate
+int HydroPlant::getConditionCount() const { return 1; }
+void HydroPlant::setConditions(const double* values) {
+    if (waterFlowRate != values[0]) {
+        waterFlowRate = values[0];
+        conditionsChanged();
+    }
+}
+
+void HydroPlant::getConditions(double* values) const { values[0] = waterFlowRate; }
+
 //
 // getCurCondtions():  Returns the current conditons at the plant
 // 
@@ -252,8 +395,7 @@ NuclearPlant::NuclearPlant(const string& name, int sustain, double capacity, dou
 double NuclearPlant::calculateOutput() {
     double output;
     output = maxCapacity * uptime / 100;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
@@ -278,8 +420,7 @@ GeothermalPlant::GeothermalPlant(const string& name, int sustain, double capacit
 double GeothermalPlant::calculateOutput() {
     double output;
     output = maxCapacity * uptime / 100;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
@@ -304,8 +445,7 @@ Fusion::Fusion(const string& name, int sustain, double capacity, double cost, do
 double Fusion::calculateOutput() {
     double output;
     output = maxCapacity * 0.6;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
@@ -333,11 +473,27 @@ DiLithium::DiLithium(const string& name, int sustain, double capacity, double co
 double DiLithium::calculateOutput() {
     double output;
     output = maxCapacity * 0.995;
-    curCapacity = output;
-    availCapacity = output;
+    setOutput(output);
     return output;
 }
 
+// Conditions:  crystal purity and field stability
+int DiLithium::getConditionCount() const { return 2; }
+
+void DiLithium::setConditions(const double* values) {
+    int purity = int(lround(values[0]));
+    if (crystalPurity != purity || fieldStability != values[1]) {
+        crystalPurity = purity;
+        fieldStability = values[1];
+        conditionsChanged();
+    }
+}
+
+void DiLithium::getConditions(double* values) const {
+    values[0] = crystalPurity;
+    values[1] = fieldStability;
+}
+
 //
 // getCurCondtions():  Returns the current conditons at the plant
 // 
@@ -348,3 +504,113 @@ string DiLithium::getCurConditions()
         ", Field Stability: " << fieldStability;
     return oss.str();
 }
+
+
+//******************************************************
+//             Battery Storage Plant               *****
+//******************************************************
+//
+//  Constructors and Destructors
+//
+StoragePlant::StoragePlant(const string& name, int sustain, double capacity, double cost, double uptime, double energy, double efficiency) :
+    Plant(name, PT_STORAGE, sustain, capacity, cost, uptime),
+    energyCapacity(energy), roundTrip(efficiency),
+    storedEnergy(energy * STORAGE_INITIAL_CHARGE), stepHours(STORAGE_STEP_HOURS) {
+}
+
+//
+// calculateOutput():  The plant can discharge at its power limit until the
+//                     energy it holds, less the discharge loss, runs out
+//
+double StoragePlant::calculateOutput() {
+    double output = min(maxCapacity * uptime / 100, storedEnergy * getOneWayEfficiency() / stepHours);
+    setOutput(output);
+    return output;
+}
+
+void StoragePlant::setStorageState(double energy, double hours, double output) {
+    storedEnergy = energy;
+    stepHours = hours;
+    setOutput(output);
+}
+
+double StoragePlant::getStoredEnergy() const { return storedEnergy; }
+double StoragePlant::getEnergyCapacity() const { return energyCapacity; }
+double StoragePlant::getOneWayEfficiency() const { return sqrt(roundTrip / 100); }
+double StoragePlant::getStepHours() const { return stepHours; }
+
+//
+// getCurCondtions():  Returns the current conditons at the plant
+//
+string StoragePlant::getCurConditions()
+{
+    stringstream oss;
+    oss << "Stored: " << storedEnergy << " of " << energyCapacity << " MWh"
+        << ", Round Trip: " << roundTrip << "%";
+    return oss.str();
+}
+
+
+//******************************************************
+//             Tie Line Import                     *****
+//******************************************************
+//
+//  Constructors and Destructors
+//
+TiePlant::TiePlant(const string& name, double tieCapacity) :
+    Plant(name, PT_TIE, 0, tieCapacity, 0, 100), scheduled(0) {
+}
+
+void TiePlant::setSchedule(double mw) {
+    mw = min(mw, maxCapacity);
+    if (scheduled != mw) {
+        scheduled = mw;
+        conditionsChanged();
+    }
+}
+
+double TiePlant::getSchedule() const { return scheduled; }
+
+double TiePlant::calculateOutput() {
+    setOutput(scheduled);
+    return scheduled;
+}
+
+//
+// getCurCondtions():  Returns the current conditons at the plant
+// 
+string TiePlant::getCurConditions()
+{
+    stringstream oss;
+    oss << "Import scheduled: " << scheduled << " MW";
+    return oss.str();
+}
+
+
+//******************************************************
+//                 Image Plant                     *****
+//******************************************************
+//
+//  Constructors and Destructors
+//
+ImagePlant::ImagePlant(const string& name, const string& type, int sustain, double capacity, double cost,
+                       double uptime, double output, double emissionRate) :
+    Plant(name, type, sustain, capacity, cost, uptime), ratedOutput(output), emissionRate(emissionRate) {
+}
+
+double ImagePlant::calculateOutput() {
+    setOutput(ratedOutput);
+    return ratedOutput;
+}
+
+double ImagePlant::getEmissionRate() const { return emissionRate; }
+
+//
+// getCurCondtions():  Returns the current conditons at the plant
+// 
+string ImagePlant::getCurConditions()
+{
+    stringstream oss;
+    oss << "Rated output: " << ratedOutput << " MW";
+    return oss.str();
+}
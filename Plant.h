@@ -19,8 +19,12 @@
 #include <fstream>
 #include <iomanip>
 #include <cassert>
+#include <atomic>
+#include "FixedPoint.h"
 using namespace std;
 
+class PlantTracker;
+
 //******************************************************
 //                      Plant                      *****
 //            Base class for all plants            *****
@@ -30,7 +34,8 @@ using namespace std;
 //
 class Plant {
 private:
-    static int plantCount; // Indicates the number of plants
+    static atomic<int> plantCount; // Indicates the number of plants; grids may be built on several threads
+    static bool destroyLog; // Print a line when a plant is destroyed
 
 protected:
     string  name;
@@ -41,17 +46,50 @@ protected:
     double  availCapacity;      // The capacity that is avaiable for demand locations. (not already allocated)
     double  costPerMW;          // Average cost to produce including capital costs
     double  uptime;             // Percentage of time the plant is operational
+    bool    online;             // False while the plant is tripped; its output is then 0
+
+    // Fixed point copies of the available capacity and cost, kept in step
+    // with the double values above
+    PowerTicks  availTicks;
+    MoneyTicks  costTicks;
+
+    // Change tracking for the grid the plant is on (see PlantTracker.h)
+    friend class PlantTracker;
+    PlantTracker*   tracker;
+    bool    inputsChanged;      // Conditions set since calculateOutput() last ran
+    bool    listed;             // On the tracker's change list
+    double  countedCapacity;    // curCapacity as the tracker's totals have it
+    bool    countedOnline;
+
+    void setOutput(double output);      // Sets current and available capacity after calculateOutput
+    void conditionsChanged();           // Call from a setter that changed an input to calculateOutput
 
 public:
     // Consructors & Destructors
     Plant(const string& name, const string& type, int sustain, double maxCapacity, double cost, double uptime);
     virtual ~Plant();                 // Virtual destructor
+    static void setDestroyLog(bool enable);     // Turn off for very large grids
 
     // Mutators
     void reduceCapacity(double amount);         // Reduce the available capacity for the plant when it is allocated to a location
+    void reduceCapacityTicks(PowerTicks amount);    // Exact fixed point version of reduceCapacity
+    void releaseCapacity(double amount);        // Give back capacity taken by reduceCapacity
+    void releaseCapacityTicks(PowerTicks amount);
+    void setCostPerMW(double cost);             // Re-price the plant (use PowerGrid::repricePlant for plants on a grid)
+    void resetAvailCapacity();                  // Return allocated capacity so the plant can be dispatched again
+    void setOnline(bool isOnline);              // Trip (false) or restore (true); call calculateOutput() after
+    void setUptimePercent(double percent);      // New operating conditions; call calculateOutput() after
+                                                // (or PowerGrid::adjustPlantsForConditions() for plants on a grid)
     virtual double calculateOutput() = 0;       // Pure virtual function for calculating output today
     virtual string getCurConditions();          // Virtual functions to get current conditons at plant
 
+    // Time varying operating conditions used by calculateOutput(), such as
+    // sunlight hours or wind speed.  Call calculateOutput() after setting.
+    virtual int getConditionCount() const;              // Parameters this type has (0 - MAX_CONDITION_PARAMS)
+    virtual void setConditions(const double* values);
+    virtual void getConditions(double* values) const;
+    virtual double getEmissionRate() const;             // CO2 per MW generated, 0 unless fossil fuelled
+
 
     // Accessors
     string getName() const;
@@ -62,6 +100,10 @@ public:
     double getAvailCapacity() const;
     double getCostPerMW() const;
     double getUptimePercent() const;
+    bool isOnline() const;
+    bool hasConditionsChanged() const;          // Since calculateOutput() last ran
+    PowerTicks getAvailTicks() const;
+    MoneyTicks getCostTicks() const;
 
     // Print and debug 
     virtual void printAll();          // Prints all the information for the plant
@@ -88,6 +130,9 @@ public:
 
     double calculateOutput() override;          // Calculate output for this plant
     virtual string getCurConditions() override; // Get current conditons at plant
+    int getConditionCount() const override;     // Streamed condition parameters
+    void setConditions(const double* values) override;
+    void getConditions(double* values) const override;
     //    void printAll()  override;                  // printAll to include plant specific attributes
 };
 
@@ -107,6 +152,9 @@ public:
 
     double calculateOutput() override;          // Calculate output for this plant
     virtual string getCurConditions() override; // Get current conditons at plant
+    int getConditionCount() const override;     // Streamed condition parameters
+    void setConditions(const double* values) override;
+    void getConditions(double* values) const override;
 };
 
 
@@ -124,6 +172,7 @@ public:
 
     double calculateOutput() override;          // Calculate output for this plant
     virtual string getCurConditions() override; // Get current conditons at plant
+    double getEmissionRate() const override;
 };
 
 
@@ -139,6 +188,9 @@ public:
 
     double calculateOutput() override;          // Calculate output for this plant
     virtual string getCurConditions() override; // Get current conditons at plant
+    int getConditionCount() const override;     // Streamed condition parameters
+    void setConditions(const double* values) override;
+    void getConditions(double* values) const override;
 };
 
 
@@ -202,5 +254,91 @@ public:
 
     double calculateOutput() override;          // Calculate output for this plant
     virtual string getCurConditions() override; // Get current conditons at plant
+    int getConditionCount() const override;     // Streamed condition parameters
+    void setConditions(const double* values) override;
+    void getConditions(double* values) const override;
+};
+
+
+
+//******************************************************
+//             Battery Storage Plant               *****
+//  Charges from surplus, discharges into deficits *****
+//******************************************************
+//
+// The plant's capacity is its power limit, charging or discharging.  Its
+// output is what it can discharge over one step from the energy it holds,
+// so dispatch draws on it like any other plant.  The energy held is
+// carried from step to step by the grid's StorageBank, which updates all
+// storage plants together (see PowerGrid::stepStorage).
+//
+class StoragePlant : public Plant {
+    double  energyCapacity;     // MWh the plant can hold
+    double  roundTrip;          // Percentage of the energy charged that comes back out
+    double  storedEnergy;       // MWh held now
+    double  stepHours;          // Length of the step the output is for
+
+public:
+    // Constructors and Destructors
+    StoragePlant(const string& name, int sustain, double capacity, double cost, double uptime, double energy, double efficiency);
+
+    double calculateOutput() override;          // What the stored energy can deliver in a step
+    virtual string getCurConditions() override; // Get current conditons at plant
+
+    // Not virtual, so the storage bank can update many plants per step
+    // without a virtual call each.  output must be what calculateOutput()
+    // would give for the energy and step.
+    void setStorageState(double energy, double hours, double output);
+    double getStoredEnergy() const;
+    double getEnergyCapacity() const;
+    double getOneWayEfficiency() const;         // Fraction kept charging, and again discharging
+    double getStepHours() const;
 };
 
+
+
+//******************************************************
+//             Tie Line Import                     *****
+//   Power bought from a neighbouring grid area    *****
+//******************************************************
+//
+// Not read from the plants file.  A multi-area grid gives each area one
+// of these per tie line, sized to the power scheduled to flow in over it
+// and priced at what the sending area's power costs.
+//
+class TiePlant : public Plant {
+    double      scheduled;          // MW scheduled to flow in over the tie
+
+public:
+    // Constructors and Destructors
+    TiePlant(const string& name, double tieCapacity);
+
+    void setSchedule(double mw);                // Call calculateOutput() after
+    double getSchedule() const;
+    double calculateOutput() override;          // The scheduled import
+    virtual string getCurConditions() override; // Get current conditons at plant
+};
+
+
+//******************************************************
+//                 Image Plant                     *****
+//    A plant rebuilt from a shared grid image     *****
+//******************************************************
+//
+// Not read from the plants file.  A sharded trial worker rebuilds the grid
+// from the coordinator's shared memory image, which holds what each plant
+// calculated rather than its type specific conditions.
+//
+class ImagePlant : public Plant {
+    double      ratedOutput;        // Output the source plant calculated
+    double      emissionRate;
+
+public:
+    // Constructors and Destructors
+    ImagePlant(const string& name, const string& type, int sustain, double capacity, double cost,
+               double uptime, double output, double emissionRate);
+
+    double calculateOutput() override;          // The source plant's output
+    virtual string getCurConditions() override; // Get current conditons at plant
+    double getEmissionRate() const override;
+};
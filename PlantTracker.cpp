@@ -0,0 +1,107 @@
+// File: PlantTracker.cpp
+//
+// Contains the function definitions for the PlantTracker class and the
+// grid's capacity totals.  See PlantTracker.h for a description of the
+// change list.
+//
+#include "GridDef.h"
+#include "PlantTracker.h"
+#include "PowerGrid.h"
+#include <cassert>
+using namespace std;
+
+
+//
+//  Constructors and Destructors
+//
+PlantTracker::PlantTracker()
+    : changedCount(0) {
+}
+
+
+//
+//  Mutators
+//
+void PlantTracker::add(Plant* plant) {
+    totals.plants++;
+    totals.maxCapacity.add(plant->maxCapacity);
+    if (changed.size() < totals.plants)
+        changed.resize(max(totals.plants, 2 * changed.size()));
+
+    plant->tracker = this;
+    plant->countedCapacity = 0;
+    plant->countedOnline = false;
+    plant->listed = false;
+    list(plant);
+}
+
+//
+// remove():  Folds first, so the plant is off the list and counted as it
+//            is now, then takes it out of the totals
+//
+void PlantTracker::remove(Plant* plant) {
+    fold();
+    totals.plants--;
+    totals.maxCapacity.add(-plant->maxCapacity);
+    totals.curCapacity.add(-plant->countedCapacity);
+    totals.online -= plant->countedOnline;
+    plant->tracker = nullptr;
+}
+
+void PlantTracker::clear() {
+    changed.clear();
+    changedCount = 0;
+    totals = CapacityTotals();
+}
+
+void PlantTracker::list(Plant* plant) {
+    plant->listed = true;
+    size_t slot = changedCount.fetch_add(1, memory_order_relaxed);
+    assert(slot < changed.size());
+    changed[slot] = plant;
+}
+
+
+void PlantTracker::collectStale(vector<Plant*>& stale) const {
+    size_t count = changedCount.load();
+    stale.clear();
+    for (size_t i = 0; i < count; i++) {
+        if (changed[i]->inputsChanged)
+            stale.push_back(changed[i]);
+    }
+}
+
+void PlantTracker::fold() {
+    size_t count = changedCount.load();
+    for (size_t i = 0; i < count; i++) {
+        Plant* plant = changed[i];
+        totals.curCapacity.add(plant->curCapacity - plant->countedCapacity);
+        if (plant->online != plant->countedOnline)
+            plant->online ? totals.online++ : totals.online--;
+        plant->countedCapacity = plant->curCapacity;
+        plant->countedOnline = plant->online;
+        plant->listed = false;
+    }
+    changedCount = 0;
+}
+
+
+//
+//  Accessors
+//
+size_t PlantTracker::getChangedCount() const { return changedCount.load(); }
+const CapacityTotals& PlantTracker::getTotals() const { return totals; }
+
+
+//********************************************************
+//*****          The Grid's Capacity Totals          *****
+//********************************************************
+
+//
+// getCapacityTotals():  The plant totals, folding in the plants changed
+//                       since they were last brought up to date
+//
+const CapacityTotals& PowerGrid::getCapacityTotals() {
+    plantTracker.fold();
+    return plantTracker.getTotals();
+}
@@ -0,0 +1,65 @@
+#pragma once
+// File: PlantTracker.h
+//
+// Contains class definition for the PlantTracker class, which follows
+// which of the grid's plants have changed since their output and the
+// capacity totals were last brought up to date.
+//
+// A plant's output depends only on its uptime, whether it is online, and
+// its type's conditions (sunlight, wind speed, water flow, ...).  The
+// setters of those mark the plant changed, and a plant on a grid puts
+// itself on the tracker's change list the first time it changes.  So
+// adjustPlantsForConditions() recalculates only the plants on the list,
+// and the totals are moved by the difference each listed plant made
+// rather than summed again over every plant.  A step where few plants
+// change costs in proportion to those few.
+//
+// Plants may be marked from several threads at once, as long as each
+// plant is marked by one thread: the list is sized for every plant on the
+// grid and a slot is taken with one atomic add.
+//
+#include <vector>
+#include <atomic>
+#include "Plant.h"
+#include "GridStats.h"
+using namespace std;
+
+// Totals over the grid's plants, kept up as plants change
+struct CapacityTotals {
+    size_t          plants = 0;
+    size_t          online = 0;
+    CompensatedSum  maxCapacity;
+    CompensatedSum  curCapacity;
+};
+
+//
+// Class PlantTracker
+//
+class PlantTracker {
+private:
+    vector<Plant*>  changed;        // The first changedCount are listed
+    atomic<size_t>  changedCount;
+    CapacityTotals  totals;         // As of the last fold()
+
+public:
+    PlantTracker();
+
+    // Mutators - called by the grid as plants join and leave it
+    void add(Plant* plant);         // Listed, so its output is counted at the next fold
+    void remove(Plant* plant);      // Takes what it was counted as out of the totals
+    void clear();
+
+    // Called by a plant the first time it changes after a fold
+    void list(Plant* plant);
+
+    // Listed plants whose conditions changed since calculateOutput()
+    void collectStale(vector<Plant*>& stale) const;
+
+    // Moves the totals by what each listed plant changed and empties the
+    // list.  Call from one thread.
+    void fold();
+
+    // Accessors
+    size_t getChangedCount() const;
+    const CapacityTotals& getTotals() const;   // Call fold() first
+};
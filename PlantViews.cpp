@@ -0,0 +1,89 @@
+// File: PlantViews.cpp
+//
+// Contains the function definitions for the PlantViews class.  See
+// PlantViews.h for a description of the views.
+//
+#include "GridDef.h"
+#include "PlantViews.h"
+#include <cassert>
+using namespace std;
+
+
+//
+// score():  The value a view is ordered by, smallest first
+//
+double PlantViewLess::score(const Plant* plant) const {
+    if (policy == DP_HYBRID)
+        return plant->getCostPerMW() * (1 + hybridWeight * (100 - plant->getSustainScore()) / 100.0);
+
+    return plant->getCostPerMW();
+}
+
+bool PlantViewLess::operator()(const Plant* a, const Plant* b) const {
+    double scoreA = score(a);
+    double scoreB = score(b);
+
+    if (scoreA != scoreB)
+        return scoreA < scoreB;
+    return a->getName() < b->getName();
+}
+
+
+//
+//  Constructors and Destructors
+//
+PlantViews::PlantViews()
+    : costView(PlantViewLess{ DP_COST, HYBRID_SUSTAIN_WEIGHT }),
+      hybridView(PlantViewLess{ DP_HYBRID, HYBRID_SUSTAIN_WEIGHT }),
+      policy(DP_SUSTAIN) {
+}
+
+
+//
+//  Mutators
+//
+void PlantViews::add(Plant* plant) {
+    costView.insert(plant);
+    hybridView.insert(plant);
+}
+
+void PlantViews::remove(Plant* plant) {
+    costView.erase(plant);
+    hybridView.erase(plant);
+}
+
+//
+// reprice():  Changes the plant's cost.  The plant is taken out of the
+//             views while its key changes and put back afterwards.
+//
+void PlantViews::reprice(Plant* plant, double costPerMW) {
+    remove(plant);
+    plant->setCostPerMW(costPerMW);
+    add(plant);
+}
+
+//
+// setHybridWeight():  The weight is part of every hybrid key, so the
+//                     hybrid view is rebuilt with the new comparator.
+//
+void PlantViews::setHybridWeight(double weight) {
+    PlantView rebuilt(hybridView.begin(), hybridView.end(), PlantViewLess{ DP_HYBRID, weight });
+    hybridView.swap(rebuilt);
+}
+
+void PlantViews::clear() {
+    costView.clear();
+    hybridView.clear();
+}
+
+
+//
+//  Policy selection
+//
+void PlantViews::setPolicy(DispatchPolicy newPolicy) { policy = newPolicy; }
+DispatchPolicy PlantViews::getPolicy() const { return policy; }
+
+const PlantView& PlantViews::getView(DispatchPolicy viewPolicy) const {
+    assert(viewPolicy == DP_COST || viewPolicy == DP_HYBRID);
+    return (viewPolicy == DP_HYBRID) ? hybridView : costView;
+}
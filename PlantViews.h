@@ -0,0 +1,62 @@
+#pragma once
+// File: PlantViews.h
+//
+// Contains class definition for the PlantViews class, the set of ordered
+// views over the plants that dispatch can visit them in.
+//
+// The plant LinkedList keeps the plants in sustainability order.  Economic
+// dispatch needs other orders, so each extra dispatch policy keeps its own
+// ordered view of the same plant pointers.  The views are balanced trees,
+// so adding, removing, or re-pricing a plant is O(log n) per view, and
+// switching the active policy is O(1).
+//
+#include <set>
+#include "Plant.h"
+using namespace std;
+
+// Order in which distributePower() draws from the plants
+enum DispatchPolicy {
+    DP_SUSTAIN,         // Highest sustainability score first (the plant list order)
+    DP_COST,            // Merit order: cheapest cost per MW first
+    DP_HYBRID,          // Cost weighted by how unsustainable the plant is
+    DP_COUNT
+};
+
+// Comparator for one view.  Ties are broken by name, which is unique.
+struct PlantViewLess {
+    DispatchPolicy  policy;
+    double          hybridWeight;
+
+    double score(const Plant* plant) const;
+    bool operator()(const Plant* a, const Plant* b) const;
+};
+
+typedef set<Plant*, PlantViewLess> PlantView;
+
+//
+// Class PlantViews
+//
+// Holds the cost and hybrid views and the active dispatch policy.  The
+// sustainability policy is served by the plant LinkedList itself.
+//
+class PlantViews {
+private:
+    PlantView       costView;
+    PlantView       hybridView;
+    DispatchPolicy  policy;
+
+public:
+    PlantViews();
+
+    // Mutators - keep every view consistent with the plant list
+    void add(Plant* plant);
+    void remove(Plant* plant);
+    void reprice(Plant* plant, double costPerMW);
+    void setHybridWeight(double weight);    // Rebuilds the hybrid view
+    void clear();
+
+    // Policy selection
+    void setPolicy(DispatchPolicy newPolicy);
+    DispatchPolicy getPolicy() const;
+    const PlantView& getView(DispatchPolicy viewPolicy) const;
+};
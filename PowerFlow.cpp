@@ -0,0 +1,726 @@
+// File: PowerFlow.cpp
+//
+// Contains the function definitions for the sparse LDL' factorization,
+// the DC power flow, the PowerGrid functions that run it on the dispatch
+// results, and the power flow benchmark.  See PowerFlow.h.
+//
+#include "PowerGrid.h"
+#include "PowerFlow.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <cmath>
+using namespace std;
+
+
+
+//********************************************************
+//*****          Sparse LDL' Factorization           *****
+//********************************************************
+
+//
+// orderRCM():  Orders the rows by reverse Cuthill-McKee.  Each connected
+//      part is walked breadth first from its lowest degree row, taking
+//      neighbours lowest degree first, and the order is then reversed.
+//      This keeps the rows of each neighbourhood close together, which
+//      keeps the fill of L low on network like matrices.
+//
+void SparseLDLT::orderRCM(const vector<vector<int>>& adjacency) {
+    vector<int> byDegree(size);
+    for (int i = 0; i < size; i++)
+        byDegree[i] = i;
+    auto lowerDegree = [&](int a, int b) { return adjacency[a].size() < adjacency[b].size(); };
+    stable_sort(byDegree.begin(), byDegree.end(), lowerDegree);
+
+    vector<bool> placed(size, false);
+    perm.clear();
+    vector<int> neighbours;
+
+    for (int start : byDegree) {
+        if (placed[start])
+            continue;
+
+        placed[start] = true;
+        perm.push_back(start);
+        for (size_t head = perm.size() - 1; head < perm.size(); head++) {
+            neighbours.clear();
+            for (int next : adjacency[perm[head]]) {
+                if (!placed[next]) {
+                    placed[next] = true;
+                    neighbours.push_back(next);
+                }
+            }
+            stable_sort(neighbours.begin(), neighbours.end(), lowerDegree);
+            perm.insert(perm.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+
+    reverse(perm.begin(), perm.end());
+    permInverse.assign(size, 0);
+    for (int k = 0; k < size; k++)
+        permInverse[perm[k]] = k;
+}
+
+
+//
+// factor():  Orders, then factors the matrix one row at a time.  Row k
+//      of L comes from a sparse triangular solve whose pattern is found by
+//      walking up the elimination tree, so only nonzeros are touched.
+//      Repeated entries are added together.
+//
+int SparseLDLT::factor(int n, const vector<Entry>& upper) {
+    size = n;
+
+    vector<vector<int>> adjacency(size);
+    for (auto& e : upper) {
+        if (e.row != e.col) {
+            adjacency[e.row].push_back(e.col);
+            adjacency[e.col].push_back(e.row);
+        }
+    }
+    orderRCM(adjacency);
+
+    // Upper triangle of the reordered matrix, by column
+    vector<vector<pair<int, double>>> columns(size);
+    for (auto& e : upper) {
+        int i = permInverse[e.row], j = permInverse[e.col];
+        columns[max(i, j)].push_back({ min(i, j), e.value });
+    }
+
+    // Symbolic: elimination tree and the nonzeros in each column of L
+    parent.assign(size, -1);
+    colCount.assign(size, 0);
+    vector<int> flag(size);
+    for (int k = 0; k < size; k++) {
+        flag[k] = k;
+        for (auto& entry : columns[k]) {
+            for (int i = entry.first; flag[i] != k; i = parent[i]) {
+                if (parent[i] == -1)
+                    parent[i] = k;
+                colCount[i]++;
+                flag[i] = k;
+            }
+        }
+    }
+
+    colStart.assign(size + 1, 0);
+    for (int k = 0; k < size; k++)
+        colStart[k + 1] = colStart[k] + colCount[k];
+    rowIndex.assign(colStart[size], 0);
+    values.assign(colStart[size], 0);
+    diagonal.assign(size, 0);
+
+    // Numeric: row k of L and D[k]
+    vector<double> y(size, 0);
+    vector<int> pattern(size);
+    fill(colCount.begin(), colCount.end(), 0);
+
+    for (int k = 0; k < size; k++) {
+        int top = size;
+        flag[k] = k;
+        double scale = 0;
+
+        for (auto& entry : columns[k]) {
+            int i = entry.first;
+            y[i] += entry.second;
+            if (i == k)
+                scale += fabs(entry.second);
+
+            int length = 0;
+            for (; flag[i] != k; i = parent[i]) {
+                pattern[length++] = i;
+                flag[i] = k;
+            }
+            while (length > 0)
+                pattern[--top] = pattern[--length];
+        }
+
+        diagonal[k] = y[k];
+        y[k] = 0;
+        for (; top < size; top++) {
+            int i = pattern[top];
+            double yi = y[i];
+            y[i] = 0;
+
+            int p = colStart[i], last = colStart[i] + colCount[i];
+            for (; p < last; p++)
+                y[rowIndex[p]] -= values[p] * yi;
+
+            double lki = yi / diagonal[i];
+            diagonal[k] -= lki * yi;
+            rowIndex[p] = k;
+            values[p] = lki;
+            colCount[i]++;
+        }
+
+        if (!(diagonal[k] > 1e-12 * scale))
+            return 1;
+    }
+
+    work.assign(size, 0);
+    return 0;
+}
+
+
+//
+// solve():  Solves L * D * L' * x = b in the reordered rows
+//
+void SparseLDLT::solve(vector<double>& x) const {
+    vector<double> y(size);
+    for (int k = 0; k < size; k++)
+        y[k] = x[perm[k]];
+
+    for (int j = 0; j < size; j++) {
+        for (int p = colStart[j]; p < colStart[j] + colCount[j]; p++)
+            y[rowIndex[p]] -= values[p] * y[j];
+    }
+    for (int j = 0; j < size; j++)
+        y[j] /= diagonal[j];
+    for (int j = size - 1; j >= 0; j--) {
+        for (int p = colStart[j]; p < colStart[j] + colCount[j]; p++)
+            y[j] -= values[p] * y[rowIndex[p]];
+    }
+
+    for (int k = 0; k < size; k++)
+        x[perm[k]] = y[k];
+}
+
+
+//
+// rankOneUpdate():  Updates L and D for A + alpha * w * w' (method C1 of
+//      Gill, Golub, Murray and Saunders).  The nonzeros of w only spread to
+//      the ancestors of its first row in the elimination tree, so just
+//      that path of columns changes and the pattern of L stays the same.
+//
+// A + alpha * w * w' stays positive definite while 1 + alpha * w' A^-1 w
+// is above zero, which is checked with one solve before anything changes.
+//
+int SparseLDLT::rankOneUpdate(const vector<pair<int, double>>& w, double alpha) {
+    if (w.empty())
+        return 0;
+
+    if (alpha < 0) {
+        vector<double> b(size, 0);
+        for (auto& e : w)
+            b[e.first] += e.second;
+        vector<double> x = b;
+        solve(x);
+
+        double h = 0;
+        for (int i = 0; i < size; i++)
+            h += b[i] * x[i];
+        if (1 + alpha * h <= 1e-10)
+            return 1;
+    }
+
+    int first = size;
+    for (auto& e : w) {
+        int k = permInverse[e.first];
+        work[k] += e.second;
+        first = min(first, k);
+    }
+
+    for (int j = first; j != -1; j = parent[j]) {
+        double p = work[j];
+        work[j] = 0;
+        if (p == 0)
+            continue;
+
+        double dj = diagonal[j];
+        double dNew = dj + alpha * p * p;
+        double beta = p * alpha / dNew;
+        diagonal[j] = dNew;
+        alpha *= dj / dNew;
+
+        for (int q = colStart[j]; q < colStart[j] + colCount[j]; q++) {
+            int r = rowIndex[q];
+            work[r] -= p * values[q];
+            values[q] += beta * work[r];
+        }
+    }
+    return 0;
+}
+
+int SparseLDLT::getSize() const { return size; }
+size_t SparseLDLT::getFactorNonzeros() const { return rowIndex.size() + size; }
+
+
+
+//********************************************************
+//*****              DC Power Flow                   *****
+//********************************************************
+
+//
+// Network building.  The first bus added is the slack bus.
+//
+int PowerFlow::addBus(const string& name) {
+    if (busIndex.count(name)) {
+        cerr << "Error: Bus " << name << " is already in the topology" << endl;
+        return 1;
+    }
+    busIndex[name] = uint32_t(busNames.size());
+    busNames.push_back(name);
+    angles.push_back(0);
+    factored = false;
+    return 0;
+}
+
+int PowerFlow::attach(const string& name, const string& bus) {
+    auto it = busIndex.find(bus);
+    if (it == busIndex.end()) {
+        cerr << "Error: Unknown bus " << bus << " for " << name << endl;
+        return 1;
+    }
+    attachedBus[name] = it->second;
+    return 0;
+}
+
+int PowerFlow::addBranch(const string& lineID, const string& from, const string& to, double reactance) {
+    auto fromBus = busIndex.find(from), toBus = busIndex.find(to);
+    if (fromBus == busIndex.end() || toBus == busIndex.end() || fromBus == toBus || reactance <= 0 ||
+        branchIndex.count(lineID)) {
+        cerr << "Error: Line " << lineID << " must join two different known buses once, with a positive reactance" << endl;
+        return 1;
+    }
+
+    branchIndex[lineID] = uint32_t(branches.size());
+    branches.push_back({ lineID, fromBus->second, toBus->second, 1 / reactance, true });
+    flows.push_back(0);
+    factored = false;
+    return 0;
+}
+
+
+//
+// branchVector():  +1 at the from bus and -1 at the to bus, in the rows of
+//                  the reduced matrix (bus b is row b - 1)
+//
+vector<pair<int, double>> PowerFlow::branchVector(const Branch& branch) const {
+    vector<pair<int, double>> w;
+    if (branch.from > 0) w.push_back({ int(branch.from) - 1, 1.0 });
+    if (branch.to > 0)   w.push_back({ int(branch.to) - 1, -1.0 });
+    return w;
+}
+
+
+//
+// factor():  Builds B without the slack bus and factors it.  Lines that are
+//      out still get entries (of zero) so the pattern of the factor has
+//      room for them when they come back.
+//
+int PowerFlow::factor() {
+    int n = int(busNames.size()) - 1;
+    vector<SparseLDLT::Entry> upper;
+
+    for (int i = 0; i < n; i++)
+        upper.push_back({ i, i, 0 });
+    for (auto& branch : branches) {
+        double b = branch.inService ? branch.susceptance : 0;
+        int f = int(branch.from) - 1, t = int(branch.to) - 1;
+        if (f >= 0) upper.push_back({ f, f, b });
+        if (t >= 0) upper.push_back({ t, t, b });
+        if (f >= 0 && t >= 0) upper.push_back({ min(f, t), max(f, t), -b });
+    }
+
+    if (n > 0 && factorB.factor(n, upper)) {
+        cerr << "Error: Some buses are not connected to the slack bus " << busNames[0] << endl;
+        factored = false;
+        return 1;
+    }
+
+    factored = true;
+    ptdfRows.assign(branches.size(), vector<double>());
+    return 0;
+}
+
+
+//
+// solve():  Finds the bus angles and line flows for the power injected
+//           at each bus.  The factor is made on first use and reused.
+//
+int PowerFlow::solve(const vector<double>& injections) {
+    if (!factored && factor())
+        return 1;
+
+    vector<double> x(injections.begin() + 1, injections.begin() + busNames.size());
+    if (!x.empty())
+        factorB.solve(x);
+
+    angles[0] = 0;
+    copy(x.begin(), x.end(), angles.begin() + 1);
+
+    for (size_t k = 0; k < branches.size(); k++) {
+        const Branch& branch = branches[k];
+        flows[k] = branch.inService ? branch.susceptance * (angles[branch.from] - angles[branch.to]) : 0;
+    }
+    return 0;
+}
+
+
+//
+// setOutage():  Takes a line out of service or puts it back.  The factor
+//      is updated by the branch's rank one term; a line whose loss would
+//      split the network is refused.
+//
+int PowerFlow::setOutage(const string& lineID, bool out) {
+    auto it = branchIndex.find(lineID);
+    if (it == branchIndex.end()) {
+        cerr << "Error: Line " << lineID << " is not in the topology" << endl;
+        return 1;
+    }
+
+    Branch& branch = branches[it->second];
+    if (branch.inService != out)
+        return 0;
+
+    if (factored) {
+        double alpha = out ? -branch.susceptance : branch.susceptance;
+        if (factorB.rankOneUpdate(branchVector(branch), alpha)) {
+            cerr << "Error: Taking line " << lineID << " out would split the network" << endl;
+            return 1;
+        }
+        ptdfRows.assign(branches.size(), vector<double>());
+    }
+
+    branch.inService = !out;
+    return 0;
+}
+
+
+//
+// getPTDF():  Row of PTDFs for a branch: the change in its flow for one MW
+//      injected at each bus and taken out at the slack bus.  Computed with
+//      one solve on first request.
+//
+const vector<double>& PowerFlow::getPTDF(uint32_t branchNum) {
+    if (!factored)
+        factor();
+
+    vector<double>& row = ptdfRows[branchNum];
+    if (!row.empty())
+        return row;
+
+    const Branch& branch = branches[branchNum];
+    row.assign(busNames.size(), 0);
+    if (!branch.inService)
+        return row;
+
+    vector<double> x(busNames.size() - 1, 0);
+    for (auto& e : branchVector(branch))
+        x[e.first] = e.second;
+    if (!x.empty())
+        factorB.solve(x);
+
+    for (size_t b = 1; b < busNames.size(); b++)
+        row[b] = branch.susceptance * x[b - 1];
+    return row;
+}
+
+
+//
+// Accessors
+//
+uint32_t PowerFlow::getBusCount() const { return uint32_t(busNames.size()); }
+uint32_t PowerFlow::getBranchCount() const { return uint32_t(branches.size()); }
+
+int PowerFlow::findBus(const string& name) const {
+    auto it = busIndex.find(name);
+    return (it == busIndex.end()) ? -1 : int(it->second);
+}
+
+int PowerFlow::findAttachedBus(const string& name) const {
+    auto it = attachedBus.find(name);
+    return (it == attachedBus.end()) ? -1 : int(it->second);
+}
+
+int PowerFlow::findBranch(const string& lineID) const {
+    auto it = branchIndex.find(lineID);
+    return (it == branchIndex.end()) ? -1 : int(it->second);
+}
+
+const string& PowerFlow::getBranchLine(uint32_t branch) const { return branches[branch].lineID; }
+bool PowerFlow::isInService(uint32_t branch) const { return branches[branch].inService; }
+double PowerFlow::getFlow(uint32_t branch) const { return flows[branch]; }
+double PowerFlow::getAngle(uint32_t bus) const { return angles[bus]; }
+size_t PowerFlow::getFactorNonzeros() const { return factored ? factorB.getFactorNonzeros() : 0; }
+
+
+
+//********************************************************
+//*****        PowerGrid network power flow          *****
+//********************************************************
+
+//
+// loadTopology():  Reads the buses, where each plant and demand location
+//      connects, and the buses each line joins.  After two header lines,
+//      each record starts with its type:
+//
+//          BUS     name
+//          PLANT   plantName   bus
+//          DEMAND  location    bus
+//          LINE    lineID      fromBus   toBus   reactance (per unit)
+//
+//      The first bus is the slack bus.  Plants and locations not placed
+//      on a bus connect at the slack bus.
+//
+int PowerGrid::loadTopology(const string& topologyFilename) {
+    ifstream isTopology(topologyFilename);
+    if (!isTopology) {
+        cerr << "Error: Unable to open file " << topologyFilename << endl;
+        return 1;
+    }
+
+    string headerLine, record, name, bus, toBus;
+    double reactance;
+    unique_ptr<PowerFlow> network(new PowerFlow);
+    int rc = 0;
+
+    getline(isTopology, headerLine);
+    getline(isTopology, headerLine);
+
+    while (rc == 0 && isTopology >> record) {
+        if (record == "BUS") {
+            isTopology >> name;
+            rc = network->addBus(name);
+        }
+        else if (record == "PLANT" || record == "DEMAND") {
+            isTopology >> name >> bus;
+            bool known = (record == "PLANT") ? findPlant(name) != nullptr : findDemand(name) != nullptr;
+            if (!known) {
+                cerr << "Error: Topology places unknown " << record << " " << name << endl;
+                rc = 1;
+            }
+            else
+                rc = network->attach(name, bus);
+        }
+        else if (record == "LINE") {
+            isTopology >> name >> bus >> toBus >> reactance;
+            if (!findTransLine(name)) {
+                cerr << "Error: Topology joins unknown line " << name << endl;
+                rc = 1;
+            }
+            else
+                rc = network->addBranch(name, bus, toBus, reactance);
+        }
+        else {
+            cerr << "Error: Unknown topology record " << record << endl;
+            rc = 1;
+        }
+
+        if (isTopology.fail()) {
+            cerr << "Error: Incomplete " << record << " record in " << topologyFilename << endl;
+            rc = 1;
+        }
+    }
+    isTopology.close();
+
+    if (rc == 0 && network->getBusCount() == 0) {
+        cerr << "Error: " << topologyFilename << " has no buses" << endl;
+        rc = 1;
+    }
+    if (rc == 0)
+        rc = network->factor();
+
+    if (rc == 0)
+        powerFlow = std::move(network);
+    return rc;
+}
+
+
+//
+// computeLineFlows():  Solves the network flows for the last dispatch.
+//      Each allocation injects the power delivered at its plant's bus and
+//      takes it out at its location's bus; line losses are not modelled.
+//
+int PowerGrid::computeLineFlows() {
+    if (!powerFlow) {
+        cerr << "Error: No network topology is loaded" << endl;
+        return 1;
+    }
+
+    vector<double> injections(powerFlow->getBusCount(), 0);
+    for (auto& entry : ledger) {
+        int plantBus = powerFlow->findAttachedBus(entry.plant->getName());
+        int demandBus = powerFlow->findAttachedBus(demands[entry.demand].getLocation());
+        injections[max(plantBus, 0)] += entry.supplied;
+        injections[max(demandBus, 0)] -= entry.supplied;
+    }
+    return powerFlow->solve(injections);
+}
+
+
+//
+// setLineOutage():  Takes a line out of the network flows, or puts it back
+//
+int PowerGrid::setLineOutage(const string& lineID, bool out) {
+    if (!powerFlow) {
+        cerr << "Error: No network topology is loaded" << endl;
+        return 1;
+    }
+    return powerFlow->setOutage(lineID, out);
+}
+
+PowerFlow* PowerGrid::getPowerFlow() { return powerFlow.get(); }
+
+
+//
+// printLineFlows():  Prints the network flow on each line next to the
+//      power the dispatch put on it.  Lines loaded past their usable
+//      capacity are marked.
+//
+void PowerGrid::printLineFlows() const {
+    if (!powerFlow)
+        return;
+
+    cout << "    Line ID         Flow(MW)   Capacity   Loading   Dispatched\n";
+    cout << "---------------   ---------   --------   -------   ----------\n";
+
+    for (uint32_t k = 0; k < powerFlow->getBranchCount(); k++) {
+        const string& lineID = powerFlow->getBranchLine(k);
+        auto it = lineIndex.find(lineID);
+        if (it == lineIndex.end())
+            continue;
+
+        const TransLine& line = transLines[it->second];
+        double flow = powerFlow->getFlow(k);
+        double capacity = line.getUsableCapacity();
+
+        cout << setw(18) << left << lineID << right << std::fixed << std::setprecision(2)
+             << setw(9) << flow << setw(11) << capacity;
+        if (!powerFlow->isInService(k))
+            cout << "       out";
+        else
+            cout << setw(9) << ((capacity > 0) ? 100 * fabs(flow) / capacity : 0.0) << "%";
+        cout << setw(13) << capacity - line.getAvailCapacity()
+             << ((fabs(flow) > capacity + 0.01) ? "   OVER" : "") << endl;
+    }
+    cout << endl;
+}
+
+
+
+//********************************************************
+//*****            Power Flow Benchmark              *****
+//********************************************************
+
+//
+// buildSyntheticNetwork():  Buses on a square grid, each joined to its
+//      right and lower neighbours, and one in ten also diagonally.  Every
+//      bus has a random injection and the slack bus balances them.
+//
+static void buildSyntheticNetwork(PowerFlow& network, vector<double>& injections, int busCount) {
+    mt19937 rng(17);
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    int side = max(2, int(ceil(sqrt(double(busCount)))));
+    busCount = side * side;
+
+    for (int b = 0; b < busCount; b++)
+        network.addBus("B" + to_string(b));
+
+    int line = 0;
+    auto join = [&](int from, int to) {
+        network.addBranch("L" + to_string(line++), "B" + to_string(from), "B" + to_string(to), 0.01 + 0.09 * unit(rng));
+    };
+    for (int r = 0; r < side; r++) {
+        for (int c = 0; c < side; c++) {
+            int b = r * side + c;
+            if (c + 1 < side) join(b, b + 1);
+            if (r + 1 < side) join(b, b + side);
+            if (r + 1 < side && c + 1 < side && unit(rng) < 0.1) join(b, b + side + 1);
+        }
+    }
+
+    injections.assign(busCount, 0);
+    for (int b = 1; b < busCount; b++)
+        injections[b] = 200 * (unit(rng) - 0.5);
+}
+
+
+//
+// runPowerFlowBenchmark():  Times a factor, repeated solves, lazy PTDF
+//      rows, and line outages by rank one update against refactoring.
+//      Flows after each update are checked against a fresh factor.
+//
+int runPowerFlowBenchmark(int busCount) {
+    PowerFlow network;
+    vector<double> injections;
+    buildSyntheticNetwork(network, injections, busCount);
+
+    auto start = chrono::steady_clock::now();
+    auto elapsedMs = [&]() { return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count(); };
+
+    start = chrono::steady_clock::now();
+    if (network.factor())
+        return 1;
+    double factorMs = elapsedMs();
+
+    const int solves = 20;
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < solves; i++)
+        network.solve(injections);
+    double solveMs = elapsedMs() / solves;
+
+    // PTDF check: moving one MW from the slack bus to a bus changes each
+    // flow by its PTDF
+    const int rows = 50;
+    uint32_t bus = network.getBusCount() / 2;
+    vector<double> base(network.getBranchCount());
+    for (uint32_t k = 0; k < base.size(); k++)
+        base[k] = network.getFlow(k);
+    injections[bus] += 1;
+    network.solve(injections);
+    injections[bus] -= 1;
+
+    double ptdfError = 0;
+    start = chrono::steady_clock::now();
+    for (int k = 0; k < rows; k++) {
+        uint32_t branch = uint32_t(k * base.size() / rows);
+        ptdfError = max(ptdfError, fabs(network.getFlow(branch) - base[branch] - network.getPTDF(branch)[bus]));
+    }
+    double ptdfMs = elapsedMs() / rows;
+
+    // Outages: rank one updates against refactoring from scratch
+    const int outages = 20;
+    double updateMs = 0, refactorMs = 0, flowError = 0;
+    int refused = 0;
+    mt19937 rng(3);
+
+    for (int i = 0; i < outages; i++) {
+        string lineID = network.getBranchLine(rng() % network.getBranchCount());
+
+        start = chrono::steady_clock::now();
+        if (network.setOutage(lineID, true)) {
+            refused++;
+            continue;
+        }
+        network.solve(injections);
+        updateMs += elapsedMs();
+        for (uint32_t k = 0; k < base.size(); k++)
+            base[k] = network.getFlow(k);
+
+        start = chrono::steady_clock::now();
+        network.factor();
+        network.solve(injections);
+        refactorMs += elapsedMs();
+        for (uint32_t k = 0; k < base.size(); k++)
+            flowError = max(flowError, fabs(network.getFlow(k) - base[k]));
+    }
+    int applied = outages - refused;
+
+    cout << "\n\t--- DC Power Flow (" << network.getBusCount() << " buses, " << network.getBranchCount() << " lines) ---\n";
+    cout << std::fixed << setprecision(3);
+    cout << "    Factor:                 " << factorMs << " ms (" << network.getFactorNonzeros() << " nonzeros in L and D)\n";
+    cout << "    Solve, reusing factor:  " << solveMs << " ms\n";
+    cout << "    PTDF row on demand:     " << ptdfMs << " ms, max error " << scientific << setprecision(1) << ptdfError << fixed << "\n";
+    cout << setprecision(3);
+    cout << "    Outage, rank one:       " << updateMs / max(1, applied) << " ms per outage and solve\n";
+    cout << "    Outage, refactor:       " << refactorMs / max(1, applied) << " ms per outage and solve ("
+         << setprecision(1) << refactorMs / max(1e-9, updateMs) << "x)\n";
+    cout << "    Max flow difference:    " << scientific << flowError << fixed << " MW over " << applied
+         << " outages (" << refused << " refused as splitting the network)\n";
+
+    return (flowError > 1e-6 || ptdfError > 1e-6) ? 1 : 0;
+}
@@ -0,0 +1,121 @@
+#pragma once
+// File: PowerFlow.h
+//
+// Contains class definitions for the DC power flow engine.
+//
+// The dispatch treats the transmission lines as one pool of capacity that
+// any plant can fill.  Real power flows follow the network instead: each
+// line joins two buses and carries power in proportion to the difference
+// of their voltage angles, divided by its reactance.  The DC power flow
+// solves B * theta = P, where B is the bus susceptance matrix and P the
+// power injected at each bus, with one bus held at angle zero (the slack
+// bus, the first bus of the topology).
+//
+// B is sparse and symmetric positive definite once the slack bus is taken
+// out, so it is factored as L * D * L' with the buses reordered to keep L
+// sparse.  The factor is kept and reused for every dispatch until the
+// topology changes.  A line outage removes one branch, which changes B by
+// a rank one term, so the factor is updated in place along one path of the
+// elimination tree instead of being rebuilt.
+//
+// PTDF (power transfer distribution factor) rows give the change in a
+// line's flow per MW injected at each bus.  Each row costs one solve, so
+// rows are only computed when asked for and kept until the topology
+// changes.
+//
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+using namespace std;
+
+//
+// Class SparseLDLT
+//
+// LDL' factorization of a sparse symmetric positive definite matrix.  The
+// matrix is given as the entries of its upper triangle, in any order.
+//
+class SparseLDLT {
+private:
+    int             size = 0;
+    vector<int>     perm;           // perm[k] = original row of factor row k
+    vector<int>     permInverse;
+    vector<int>     parent;         // Elimination tree, -1 at a root
+    vector<int>     colStart;       // Columns of L below the diagonal
+    vector<int>     colCount;
+    vector<int>     rowIndex;
+    vector<double>  values;
+    vector<double>  diagonal;
+    mutable vector<double> work;
+
+    void orderRCM(const vector<vector<int>>& adjacency);   // Reverse Cuthill-McKee ordering
+
+public:
+    struct Entry { int row, col; double value; };
+
+    int factor(int size, const vector<Entry>& upper);   // Returns 1 if not positive definite
+    void solve(vector<double>& x) const;                // Solves A * x = b in place of b
+
+    // A += alpha * w * w' for a w whose nonzeros are already linked in A.
+    // Returns 1 and leaves the factor unchanged if A would stop being
+    // positive definite.
+    int rankOneUpdate(const vector<pair<int, double>>& w, double alpha);
+
+    int getSize() const;
+    size_t getFactorNonzeros() const;
+};
+
+
+//
+// Class PowerFlow
+//
+class PowerFlow {
+private:
+    struct Branch {
+        string      lineID;
+        uint32_t    from, to;
+        double      susceptance;    // 1 / reactance
+        bool        inService;
+    };
+
+    vector<string>                  busNames;
+    unordered_map<string, uint32_t> busIndex;
+    unordered_map<string, uint32_t> attachedBus;    // Plant or demand name to bus
+    vector<Branch>                  branches;
+    unordered_map<string, uint32_t> branchIndex;    // Line ID to branch
+
+    SparseLDLT                      factorB;        // Reduced B, slack bus removed
+    bool                            factored = false;
+    vector<vector<double>>          ptdfRows;       // Per branch, empty until asked for
+    vector<double>                  angles;
+    vector<double>                  flows;
+
+    // A branch's column of the bus incidence matrix in reduced B rows
+    vector<pair<int, double>> branchVector(const Branch& branch) const;
+
+public:
+    int addBus(const string& name);                 // Returns 1 if the name is in use
+    int attach(const string& name, const string& bus);      // Places a plant or demand on a bus
+    int addBranch(const string& lineID, const string& from, const string& to, double reactance);
+
+    int factor();                                   // Returns 1 if the network is not connected
+    int solve(const vector<double>& injections);   // MW per bus; the slack bus balances the rest
+    int setOutage(const string& lineID, bool out);  // Rank one update of the factor
+    const vector<double>& getPTDF(uint32_t branch); // Flow change per MW at each bus, against the slack
+
+    uint32_t getBusCount() const;
+    uint32_t getBranchCount() const;
+    int findBus(const string& name) const;          // -1 if unknown
+    int findAttachedBus(const string& name) const;  // -1 if not placed
+    int findBranch(const string& lineID) const;     // -1 if unknown
+    const string& getBranchLine(uint32_t branch) const;
+    bool isInService(uint32_t branch) const;
+    double getFlow(uint32_t branch) const;          // MW from the from bus to the to bus
+    double getAngle(uint32_t bus) const;            // Radians
+    size_t getFactorNonzeros() const;
+};
+
+
+// Times factoring, solving, PTDF rows and outage updates on a synthetic
+// network of busCount buses
+int runPowerFlowBenchmark(int busCount);
@@ -18,17 +18,90 @@ using namespace std;
 //********************************************************
 
 //
-//  readPlantData():   Reads the information about each plant from the data
-//                  file and adds them to the grid
+//  readPlantRecord():  Reads one plant record and creates the plant of its
+//                  type.  Returns nullptr at the end of the records, and
+//                  fails the stream at a record of an unknown type.
 //
-int PowerGrid::readPlantData(const string& plantFilename) {
+Plant* readPlantRecord(istream& isPlant) {
 
-    // Variables used to read demand info from file
-    string name, type, headerLine;
+    // Variables used to read plant info from file
+    string name, type;
     int sustain;
     double capacity;
     double  costPerMW, uptime;
 
+    // Read the common information of the record
+    isPlant >> name >> type >> sustain >> costPerMW >> capacity >> uptime;
+    if (isPlant.fail())
+        return nullptr;
+
+    // Read the rest of the data depending on the type of the plant
+    if (type == PT_SOLAR) {
+        double panelCount, sunlightHours;
+        isPlant >> panelCount >> sunlightHours;
+        return new SolarFarm(name, sustain, capacity, costPerMW, uptime, panelCount, sunlightHours);
+    }
+
+    else if (type == PT_WIND) {
+        int turbineCnt;
+        double windSpeed;
+        isPlant >> turbineCnt >> windSpeed;
+        return new WindFarm(name, sustain, capacity, costPerMW, uptime, turbineCnt, windSpeed);
+    }
+
+    else if (type == PT_FOSSIL) {
+        string fuelType;
+        double emissionsRate;
+        isPlant >> fuelType >> emissionsRate;
+        return new FossilPlant(name, sustain, capacity, costPerMW, uptime, fuelType, emissionsRate);
+    }
+
+    else if (type == PT_HYDRO) {
+        double waterFlowRate;
+        isPlant >> waterFlowRate;
+        return new HydroPlant(name, sustain, capacity, costPerMW, uptime, waterFlowRate);
+    }
+
+    else if (type == PT_NUCLEAR) {
+        return new NuclearPlant(name, sustain, capacity, costPerMW, uptime);
+    }
+
+    else if (type == PT_GEO_THERMAL) {
+        return new GeothermalPlant(name, sustain, capacity, costPerMW, uptime);
+    }
+
+    else if (type == PT_FUSION) {
+        double neutronFlux;
+        isPlant >> neutronFlux;
+        return new Fusion(name, sustain, capacity, costPerMW, uptime, neutronFlux);
+    }
+
+    else if (type == PT_DILITHIUM) {
+        int crystalPurity;
+        double fieldStability;
+        isPlant >> crystalPurity >> fieldStability;
+        return new DiLithium(name, sustain, capacity, costPerMW, uptime, crystalPurity, fieldStability);
+    }
+
+    else if (type == PT_STORAGE) {
+        double energyCapacity, roundTrip;
+        isPlant >> energyCapacity >> roundTrip;
+        return new StoragePlant(name, sustain, capacity, costPerMW, uptime, energyCapacity, roundTrip);
+    }
+
+    cerr << "\nUnkown plant type found: " << type << endl;
+    isPlant.setstate(ios::failbit);
+    return nullptr;
+}
+
+
+//
+//  readPlantData():   Reads the information about each plant from the data
+//                  file and adds them to the grid
+//
+int PowerGrid::readPlantData(const string& plantFilename) {
+    string headerLine;
+
     // Open data file for reading
     ifstream isPlant(plantFilename);
     if (!isPlant) {
@@ -40,105 +113,133 @@ int PowerGrid::readPlantData(const string& plantFilename) {
     getline(isPlant, headerLine);
     getline(isPlant, headerLine);
 
-    // Read the tcommon information for the first plant
-    isPlant >> name >> type >> sustain >> costPerMW >> capacity >> uptime;
-
-
-    // Process all records in the file 
-    while (!isPlant.eof() && !isPlant.fail()) {
+    // Process all records in the file, adding each plant to the grid
+    Plant* plant;
+    while ((plant = readPlantRecord(isPlant)) != nullptr) {
+        if (addPlantToGrid(plant)) delete plant;
+    }
 
-        // Read the rest of the data depending on the type of the plant and add theplant to the grid
-        if (type == PT_SOLAR) {
-            double panelCount, sunlightHours;
-            isPlant >> panelCount >> sunlightHours;
-            SolarFarm* pSolar = new SolarFarm(name, sustain, capacity, costPerMW, uptime, panelCount, sunlightHours);
-            addPlantToGrid(pSolar);
-        }
+    // The records end at the end of the file, not at a bad record
+    bool complete = isPlant.eof();
+    isPlant.close();
+    if (!complete) {
+        cerr << "Error: Bad plant record in " << plantFilename << endl;
+        return 1;
+    }
 
-        else if (type == PT_WIND) {
-            int turbineCnt;
-            double windSpeed;
-            isPlant >> turbineCnt >> windSpeed;
-            WindFarm* pWind = new WindFarm(name, sustain, capacity, costPerMW, uptime, turbineCnt, windSpeed);
-            addPlantToGrid(pWind);
-        }
+    return 0;
+}
 
-        else if (type == PT_FOSSIL) {
-            string fuelType;
-            double emissionsRate;
-            isPlant >> fuelType >> emissionsRate;
-            FossilPlant* pFossil = new FossilPlant(name, sustain, capacity, costPerMW, uptime, fuelType, emissionsRate);
-            addPlantToGrid(pFossil);
-        }
 
-        else if (type == PT_HYDRO) {
-            double waterFlowRate;
-            isPlant >> waterFlowRate;
-            HydroPlant* pHydro = new HydroPlant(name, sustain, capacity, costPerMW, uptime, waterFlowRate);
-            addPlantToGrid(pHydro);
-        }
+//
+// addPlant():  Inserts the plant in sorted order and indexes it by name.
+//              The grid takes ownership of the plant unless the name is
+//              already in use, in which case 1 is returned.
+//
+int PowerGrid::addPlantToGrid(Plant* plant) {
+    if (plantIndex.count(plant->getName())) {
+        cerr << "Error: Duplicate plant name " << plant->getName() << endl;
+        return 1;
+    }
 
-        else if (type == PT_NUCLEAR) {
-            NuclearPlant* pNuclear = new NuclearPlant(name, sustain, capacity, costPerMW, uptime);
-            addPlantToGrid(pNuclear);
-        }
+    plantIndex[plant->getName()] = plants.insert(plant);
+    plantViews.add(plant);
+    plantTracker.add(plant);
+    plantOrdersValid = false;
+    storageBankValid = false;
+    monitorPlantsValid = false;
+    return 0;
+}
 
-        else if (type == PT_GEO_THERMAL) {
-            GeothermalPlant* pGeo = new GeothermalPlant(name, sustain, capacity, costPerMW, uptime);
-            addPlantToGrid(pGeo);
-        }
 
-        else if (type == PT_FUSION) {
-            double neutronFlux;
-            isPlant >> neutronFlux;
-            Fusion* pFus = new Fusion(name, sustain, capacity, costPerMW, uptime, neutronFlux);
-            addPlantToGrid(pFus);
-        }
+//
+// findPlant():  Returns the plant with the given name, or nullptr
+//
+Plant* PowerGrid::findPlant(const string& name) const {
+    auto it = plantIndex.find(name);
+    return (it == plantIndex.end()) ? nullptr : it->second->data;
+}
 
-        else if (type == PT_DILITHIUM) {
-            int crystalPurity;
-            double fieldStability;
-            isPlant >> crystalPurity >> fieldStability;
-            DiLithium* pDi = new DiLithium(name, sustain, capacity, costPerMW, uptime, crystalPurity, fieldStability);
-            addPlantToGrid(pDi);
-        }
 
-        else {
-            cerr << "\nUnkown plant type found: " << type << endl;
-            assert(0);
-        }
+//
+// removePlant():  Unlinks the plant from the list in O(1) and deletes it
+//
+int PowerGrid::removePlant(const string& name) {
+    auto it = plantIndex.find(name);
+    if (it == plantIndex.end())
+        return 1;
 
-        // Read the common information of the next record
-        isPlant >> name >> type >> sustain >> costPerMW >> capacity >> uptime;
-    }
+    Node<Plant*>* node = it->second;
+    plantIndex.erase(it);
+    plantViews.remove(node->data);
+    plantTracker.remove(node->data);
+    plants.remove(node);
+    plantOrdersValid = false;
+    storageBankValid = false;
+    monitorPlantsValid = false;
+    ledger.clear();         // It may refer to the deleted plant
+    return 0;
+}
 
-    isPlant.close();
 
-    return 0;
+//
+// detachPlant():  Unlinks the plant like removePlant(), but hands it to the
+//                 caller instead of deleting it.  Returns nullptr if the
+//                 name is not on the grid.
+//
+Plant* PowerGrid::detachPlant(const string& name) {
+    auto it = plantIndex.find(name);
+    if (it == plantIndex.end())
+        return nullptr;
+
+    Node<Plant*>* node = it->second;
+    plantIndex.erase(it);
+    plantViews.remove(node->data);
+    plantTracker.remove(node->data);
+    plantOrdersValid = false;
+    storageBankValid = false;
+    monitorPlantsValid = false;
+    ledger.clear();
+    return plants.unlink(node);
 }
 
 
 //
-// addPlant()
+// repricePlant():  Changes a plant's cost per MW and moves it to its new
+//                  position in the cost ordered views.
 //
-void PowerGrid::addPlantToGrid(Plant* plant) {
-    plants.insert(plant);
+int PowerGrid::repricePlant(const string& name, double costPerMW) {
+    Plant* plant = findPlant(name);
+    if (!plant)
+        return 1;
+
+    plantViews.reprice(plant, costPerMW);
+    plantOrdersValid = false;
+    return 0;
 }
 
 
 //
-// adjustPlantsforConditons():  Adjust the available cpacity of each plant by
-//                      calling each plants virtual function calculateOutput.
+// adjustPlantsforConditons():  Adjust the available cpacity of each plant
+//      whose conditions changed by calling its virtual function
+//      calculateOutput, then bring the capacity totals up to date.
+//      Plants whose conditions are unchanged keep their output and what
+//      dispatch has taken from it.
 //
 void PowerGrid::adjustPlantsForConditions() {
     // In assignment 2 and beyond, the plant vector contains pointers to a
     // plant object, not a plant object.   When we itereate, the iteration variable
     // is a pointer so need to use the -> notation instead of the . notation.
 
-    // Loop and call the calculateOutputfor each plant.
-    for (const auto& plant : plants) {
-        plant->calculateOutput();
-    }
+    // Loop and call the calculateOutputfor each plant on the change list.
+    // Each plant only updates itself, so chunks of them are run in parallel.
+    vector<Plant*> stale;
+    plantTracker.collectStale(stale);
+    getTaskPool().parallelFor(stale.size(), PLANT_UPDATE_GRAIN, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+            stale[i]->calculateOutput();
+    });
+    plantTracker.fold();
 }
 
 
@@ -147,13 +248,7 @@ void PowerGrid::adjustPlantsForConditions() {
 // printPlants()
 //
 void PowerGrid::printPlants() const {
-    int     totalSustain = 0;
-    double  totalMaxCap = 0;
-    double  totalCurCap = 0;
-    double  totalAvailCap = 0;
-    double  totalUptime = 0;
-    double  totalMWCost = 0;
-    int     plantCount = 0;
+    GridStats stats = computeStats();
 
     // Print column headings
     cout << "  Plant         Type     Sustain    Max Cap      Cur Cap     Avail Cap     %UpTime   Cost/MwH     Current Operating Conditions\n";
@@ -174,15 +269,6 @@ void PowerGrid::printPlants() const {
     
         // Print the current conditions at the plant
         cout << plant->getCurConditions() << endl;
-    
-        // Accumulate totals
-        totalSustain += plant->getSustainScore();
-        totalMaxCap += plant->getMaxCapacity();
-        totalCurCap += plant->getCurCapacity();
-        totalAvailCap += plant->getAvailCapacity();
-        totalUptime += plant->getUptimePercent();
-        totalMWCost += plant->getCostPerMW();
-        plantCount++;
     }
 
     // Print Totals
@@ -190,12 +276,12 @@ void PowerGrid::printPlants() const {
     cout <<
         setw(24) << left << "Total:" <<
         std::fixed << std::setprecision(2) << right <<
-        setw(7) << right << ((double)totalSustain / plantCount) <<
-        setw(10) << right << totalMaxCap << "mw" <<
-        setw(12) << right << totalCurCap << "mw" <<
-        setw(12) << right << totalAvailCap << "mw" <<
-        setw(11) << right << (totalUptime / plantCount) <<
-        setw(11) << right << (totalMWCost / plantCount) << endl;
+        setw(7) << right << stats.plants.sustain.mean() <<
+        setw(10) << right << stats.plants.maxCapacity.sum() << "mw" <<
+        setw(12) << right << stats.plants.curCapacity.sum() << "mw" <<
+        setw(12) << right << stats.plants.availCapacity.sum() << "mw" <<
+        setw(11) << right << stats.plants.uptime.mean() <<
+        setw(11) << right << stats.plants.costPerMW.mean() << endl;
 
 }
 
@@ -232,28 +318,86 @@ int PowerGrid::readDemandData(const string& demandFilename) {
     isDemand >> location >> requiredCapacity >> price;
 
     // Process all reords in the file 
+    int rc = 0;
     while (!isDemand.eof() && !isDemand.fail()) {
 
         // Declare a Demand variable and add it to the grid 
         Demand newDemand(location, requiredCapacity, price);
-        addDemand(newDemand);
+        if (addDemand(newDemand)) {
+            cerr << "Error: Demand record " << location << " in " << demandFilename << " not added" << endl;
+            rc = 1;
+        }
         // newDemand.printAll();   // Display information to screen before adding 
 
         // Read next record
         isDemand >> location >> requiredCapacity >> price;
     }
 
+    // The records end at the end of the file, not at a bad record
+    bool complete = isDemand.eof();
     isDemand.close();
+    if (!complete) {
+        cerr << "Error: Bad demand record in " << demandFilename << endl;
+        return 1;
+    }
 
-    return 0;
+    return rc;
 }
 
 
 //
-// addDemand()
+// addDemand():  Appends the demand and indexes it by location
 //
-void PowerGrid::addDemand(const Demand& demand) {
+int PowerGrid::addDemand(const Demand& demand) {
+    if (demandIndex.count(demand.getLocation())) {
+        cerr << "Error: Duplicate demand location " << demand.getLocation() << endl;
+        return 1;
+    }
+
+    demandIndex[demand.getLocation()] = demands.size();
     demands.push_back(demand);
+    demandQueue.add(demands, uint32_t(demands.size() - 1));
+    monitorDemandsValid = false;
+    return 0;
+}
+
+
+//
+// findDemand():  Returns the demand at the given location, or nullptr.
+//                The pointer is only valid until the demands are modified.
+//
+Demand* PowerGrid::findDemand(const string& location) {
+    auto it = demandIndex.find(location);
+    return (it == demandIndex.end()) ? nullptr : &demands[it->second];
+}
+
+
+//
+// removeDemand():  Removes the demand while keeping the file order used by
+//                  distributePower(), then renumbers the entries after it.
+//
+int PowerGrid::removeDemand(const string& location) {
+    auto it = demandIndex.find(location);
+    if (it == demandIndex.end())
+        return 1;
+
+    size_t pos = it->second;
+    demandIndex.erase(it);
+    demands.erase(demands.begin() + pos);
+    reindexDemands(pos);
+    demandQueue.rebuild(demands);
+    monitorDemandsValid = false;
+    ledger.clear();         // Its demand indexes have shifted
+    return 0;
+}
+
+
+//
+// reindexDemands():  Refreshes the index for every demand from position first
+//
+void PowerGrid::reindexDemands(size_t first) {
+    for (size_t i = first; i < demands.size(); i++)
+        demandIndex[demands[i].getLocation()] = i;
 }
 
 
@@ -261,8 +405,7 @@ void PowerGrid::addDemand(const Demand& demand) {
 // printDemands()
 //
 void PowerGrid::printDemands() const {
-    double  totalRequired = 0;
-    double  totalSupplied = 0;
+    GridStats stats = computeStats();
 
     // Print column headings
     cout << " Location      Demand     Supplied     Status\n";
@@ -276,9 +419,6 @@ void PowerGrid::printDemands() const {
             setw(8) << right << demand.getPowerRequired() <<
             setw(12) << right << demand.getPowerAcquired() <<
             setw(12) << right << demand.getStatus() << endl;
-
-        totalRequired += demand.getPowerRequired();
-        demand.getPowerAcquired();
     }
 
     // Print totals
@@ -286,8 +426,8 @@ void PowerGrid::printDemands() const {
     cout <<
         setw(14) << left << "Total:" <<
         std::fixed << std::setprecision(1) <<
-        setw(8) << std::right << totalRequired <<
-        setw(12) << std::right << totalSupplied << endl;
+        setw(8) << std::right << stats.demands.required.sum() <<
+        setw(12) << std::right << stats.demands.acquired.sum() << endl;
 
 }
 
@@ -349,10 +489,59 @@ int PowerGrid::readTransLineData(const string& transLineFilename) {
 
 
 //
-// addTransLine()
+// addTransLine():  Appends the line and indexes it by line ID
 //
-void PowerGrid::addTransLine(const TransLine& transLine) {
+int PowerGrid::addTransLine(const TransLine& transLine) {
+    if (lineIndex.count(transLine.getLineID())) {
+        cerr << "Error: Duplicate transmission line " << transLine.getLineID() << endl;
+        return 1;
+    }
+
+    lineIndex[transLine.getLineID()] = transLines.size();
     transLines.push_back(transLine);
+    lineOrdersValid = false;
+    monitorLinesValid = false;
+    transLinesSorted = false;
+    return 0;
+}
+
+
+//
+// findTransLine():  Returns the line with the given ID, or nullptr.
+//                   The pointer is only valid until the lines are modified.
+//
+TransLine* PowerGrid::findTransLine(const string& lineID) {
+    auto it = lineIndex.find(lineID);
+    return (it == lineIndex.end()) ? nullptr : &transLines[it->second];
+}
+
+
+//
+// removeTransLine():  Removes the line, keeping the efficiency order of the
+//                     remaining lines, and renumbers the entries after it.
+//
+int PowerGrid::removeTransLine(const string& lineID) {
+    auto it = lineIndex.find(lineID);
+    if (it == lineIndex.end())
+        return 1;
+
+    size_t pos = it->second;
+    lineIndex.erase(it);
+    transLines.erase(transLines.begin() + pos);
+    reindexTransLines(pos);
+    lineOrdersValid = false;
+    monitorLinesValid = false;
+    ledger.clear();         // Its line indexes have shifted
+    return 0;
+}
+
+
+//
+// reindexTransLines():  Refreshes the index for every line from position first
+//
+void PowerGrid::reindexTransLines(size_t first) {
+    for (size_t i = first; i < transLines.size(); i++)
+        lineIndex[transLines[i].getLineID()] = i;
 }
 
 
@@ -360,10 +549,7 @@ void PowerGrid::addTransLine(const TransLine& transLine) {
 // printTransLines()
 //
 void PowerGrid::printTransLines() const {
-    double  totalMaxCap = 0;
-    double  totalAvailCap = 0;
-    double  totalEff = 0;
-    int     lineCount = 0;
+    GridStats stats = computeStats();
 
     // Print column headings
     cout << "    Line ID       Capacity      Avail    Efficiency\n";
@@ -377,33 +563,37 @@ void PowerGrid::printTransLines() const {
             setw(8) << right << transLine.getMaxCapacity() <<
             setw(12) << right << transLine.getAvailCapacity() <<
             setw(12) << right << transLine.getEfficiency() << endl;
-
-        totalMaxCap += transLine.getMaxCapacity();
-        totalAvailCap += transLine.getAvailCapacity();
-        totalEff += transLine.getEfficiency();
-        lineCount++;
     }
 
     // Print totals
     cout << "                   ========     =======   =========\n";
     cout <<
         setw(18) << left << "Total/Avg" <<
-        setw(8) << right << totalMaxCap <<
-        setw(12) << right << totalAvailCap <<
+        setw(8) << right << stats.lines.maxCapacity.sum() <<
+        setw(12) << right << stats.lines.availCapacity.sum() <<
         setw(12) << std::fixed << std::setprecision(2) <<
-        right << (totalEff / lineCount) << endl << endl;
-
-}
+        right << stats.lines.efficiency.mean() << endl << endl;
 
-int compareTransLines(const void* a, const void* b)
-{
-    const TransLine* T1 = static_cast<const TransLine*>(a);
-    const TransLine* T2 = static_cast<const TransLine*>(b);
-    return (int)(100 * T2->getEfficiency()) - (int)(100 * T1->getEfficiency());
 }
 
-
+//
+// sortTransLines():  Sorts the lines by decreasing efficiency.  The line
+//                    objects are moved into their new positions, equal
+//                    efficiencies keep their file order.
+//
 void PowerGrid::sortTransLines()
 {
-    qsort(&transLines[0], size(transLines), sizeof(TransLine), compareTransLines);
+    OrderIndex order = orderTransLines(transLines, LK_EFFICIENCY);
+
+    vector<TransLine> sorted;
+    sorted.reserve(transLines.size());
+    for (uint32_t i : order)
+        sorted.push_back(std::move(transLines[i]));
+
+    transLines.swap(sorted);
+    reindexTransLines(0);
+    lineOrdersValid = false;
+    monitorLinesValid = false;
+    transLinesSorted = true;
+    ledger.clear();         // Its line indexes have moved
 }
@@ -10,11 +10,35 @@
 #include <vector>
 #include <string>
 #include <cctype>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
 
 #include "Plant.h"
 #include "Demand.h"
 #include "TransLine.h"
 #include "LinkedList.h"
+#include "GridOrder.h"
+#include "PlantViews.h"
+#include "GridStats.h"
+#include "GridSnapshot.h"
+#include "TaskPool.h"
+#include "ResultsStore.h"
+#include "DispatchCache.h"
+#include "AnytimeDispatch.h"
+#include "ZoneDispatch.h"
+#include "PowerFlow.h"
+#include "CarbonDispatch.h"
+#include "GridMonitor.h"
+#include "StorageBank.h"
+#include "DemandQueue.h"
+#include "PlantTracker.h"
+
+struct GridDiff;
+
+// Reads one plant record of a plants file, nullptr at the end of the records
+// or at a bad one
+Plant* readPlantRecord(istream& isPlant);
 
 //
 // Class PowerGrid
@@ -41,31 +65,238 @@ protected:
     vector<Demand>    demands;
     vector<TransLine> transLines;
 
+    // Hash indices from a component's name to its storage.  Plants map to
+    // their list node so they can be unlinked in O(1); demands and lines map
+    // to their position in the vector and are renumbered when it shifts.
+    unordered_map<string, Node<Plant*>*> plantIndex;
+    unordered_map<string, size_t>        demandIndex;
+    unordered_map<string, size_t>        lineIndex;
+
+    // Support functions to rebuild the vector indices after reordering
+    void reindexDemands(size_t first);
+    void reindexTransLines(size_t first);
+
+    // Precomputed orderings of the lines and plants, one per key.  The plant
+    // orderings index into plantTable, a snapshot of the plant list.  Both
+    // are rebuilt on first use after the collection changes.
+    OrderIndex      lineOrders[LK_COUNT];
+    OrderIndex      plantOrders[PK_COUNT];
+    vector<Plant*>  plantTable;
+    bool            lineOrdersValid = false;
+    bool            plantOrdersValid = false;
+    bool            transLinesSorted = false;   // In efficiency order since sortTransLines()
+    void buildLineOrders();
+    void buildPlantOrders();
+
+    // Ordered views of the plants used by the cost based dispatch policies
+    PlantViews      plantViews;
+
+    // Plants changed since their output and the capacity totals were last
+    // brought up to date : in file PlantTracker.cpp
+    PlantTracker    plantTracker;
+
+    // The order dispatch serves the demand locations in : in file DemandQueue.cpp
+    DemandQueue     demandQueue;
+    template<typename Visit>
+    void forEachDemandInOrder(Visit visit);
+
+    // Allocation loops shared by every dispatch policy : in file DistPower.cpp
+    bool            fixedPoint = false;     // Dispatch in exact integer units
+    bool            allocationLog = true;   // Print each allocation as it is made
+    bool            warmStart = false;      // redispatch() starts from the last ledger
+    void warmStartDispatch();
+    void allocateDeficits();                // Allocates to every location still short of power
+    void moveAllocation(uint32_t entryIndex, Plant* plant, uint32_t to);   // Anytime improvement move
+
+    // Zone level dispatch : in file ZoneDispatch.cpp
+    vector<DemandZone> buildDemandZones(double priceBand) const;
+    void splitZone(const DemandZone& zone, const AllocationLedger& pieces, double supplied);
+    void splitZoneTicks(const DemandZone& zone, const AllocationLedger& pieces, PowerTicks supplied);
+
+    // One pass of the carbon price search : in file CarbonDispatch.cpp
+    double dispatchAtCarbonPrice(double carbonPrice, double emissionBudget);
+
+    // Worker threads for parallel loading, plant updates, and aggregation.
+    // Created on first use with threadCount threads (0 = one per core).
+    mutable unique_ptr<TaskPool>    taskPool;
+    mutable mutex                   taskPoolLock;
+    unsigned                        threadCount = 0;
+
+    // Published read only copies of the grid state for reader threads
+    SnapshotDomain  snapshots;
+    bool            snapshotPublishing = false;
+    void publishDispatch();                 // To snapshot readers and monitors, after a dispatch
+
+    // Live state export to other processes : in file GridMonitor.cpp.
+    // The segment is laid out again after components are added, removed,
+    // or reordered.  There is a flag per collection because loadGrid()
+    // reads the three files on separate threads.
+    unique_ptr<MonitorExport>   monitorExport;
+    string                      monitorName;
+    bool                        monitorPlantsValid = false;
+    bool                        monitorDemandsValid = false;
+    bool                        monitorLinesValid = false;
+    int layoutMonitor();
+
+    // Allocations made by the last dispatch, and ledgers of earlier
+    // dispatches keyed by grid state : in file DispatchCache.cpp
+    AllocationLedger    ledger;
+    DispatchCache       dispatchCache;
+    DispatchKey fingerprintDispatch() const;
+    void replayLedger(const AllocationLedger& entries);
+
+    // Battery storage plants, gathered for the step update : in file
+    // StorageBank.cpp.  Rebuilt on first use after the plants change.
+    StorageBank     storageBank;
+    bool            storageBankValid = false;
+
+    // Buses and network flows, when a topology is loaded : in file PowerFlow.cpp
+    unique_ptr<PowerFlow>   powerFlow;
+
+    template<typename PlantRange>
+    void allocateFromPlants(Demand& demand, const PlantRange& plantOrder);
+    template<typename PlantRange, typename PlantIter>
+    void allocateFromPlants(Demand& demand, const PlantRange& plantOrder, PlantIter& firstWithRoom);
+    template<typename PlantRange>
+    void allocateFromPlantsFixed(Demand& demand, const PlantRange& plantOrder);
+    template<typename PlantRange, typename PlantIter>
+    void allocateFromPlantsFixed(Demand& demand, const PlantRange& plantOrder, PlantIter& firstWithRoom);
+    template<typename PlantRange>
+    void allocateDeficitsFrom(const PlantRange& plantOrder);
+    void logAllocation(const Demand& demand, const Plant* plant, const TransLine& line,
+                       double supplied, double rawFromPlant, double sellPrice, double cost) const;
+
 public:
     // Functions to read, manage, and print power plants
     int readPlantData(const string& filename);
-    void addPlantToGrid(Plant* plant);
+    int addPlantToGrid(Plant* plant);       // Returns 1 and does not take the plant if the name is in use
+    Plant* findPlant(const string& name) const;
+    int removePlant(const string& name);    // Unlinks and deletes the plant
+    Plant* detachPlant(const string& name); // Unlinks the plant and gives it to the caller
+    int repricePlant(const string& name, double costPerMW);
     void printPlants() const;
-    void adjustPlantsForConditions();   // Calls each plant to adjust for unique conditions
+    void adjustPlantsForConditions();   // Calls each changed plant to adjust for unique conditions
+    const CapacityTotals& getCapacityTotals();  // Kept up as plants change : in file PlantTracker.cpp
 
     // Functions to read, manage, and print power demand locations
     int readDemandData(const string& filename);
-    void addDemand(const Demand& demand);
+    int addDemand(const Demand& demand);
+    Demand* findDemand(const string& location);     // Change its keys with setDemandRequired() etc.
+    int removeDemand(const string& location);
     void printDemands() const;
 
     // Functions to read, manage, and print the transmison lines
     int readTransLineData(const string& filename);
-    void addTransLine(const TransLine& transLine);
+    int addTransLine(const TransLine& transLine);
+    TransLine* findTransLine(const string& lineID);
+    int removeTransLine(const string& lineID);
     void printTransLines() const;
 
     // Functions to distribute power : in file DistPower.cpp
     void distributePower();                         // Distributes power to all demand locations
+    void resetDispatch();                           // Releases all allocations so power can be distributed again
+    void redispatch();                              // Dispatches again after conditions change
+    void setWarmStartDispatch(bool enable);         // redispatch() repairs the last dispatch instead of starting over
+
+    // Re-dispatches, then lowers the cost until budgetMs has passed : in file AnytimeDispatch.cpp
+    AnytimeResult anytimeDispatch(double budgetMs);
+    double dispatchCostLowerBound() const;          // For the power currently delivered
+
+    // Dispatches locations grouped by retail price band : in file ZoneDispatch.cpp
+    int distributeByZones(double priceBand);        // Returns the number of zones
+
+    // Dispatches within a system wide CO2 cap : in file CarbonDispatch.cpp
+    CarbonResult distributeUnderCarbonCap(double cap);
+    double dispatchEmissions() const;               // CO2 of the last dispatch
+
+    void setAllocationLog(bool enable);             // Print allocations as they are made (default on)
     void allocateToDemand(Demand& demand);          // Allocates power and line capacity to a demand location
     void generateUsageReport(string companyName);   // Generates a power report to the console
+    void setDispatchPolicy(DispatchPolicy policy);  // Order plants are drawn from, O(1) to switch
+    DispatchPolicy getDispatchPolicy() const;
+    void setHybridWeight(double weight);            // Sustainability weight for DP_HYBRID
+    void setFixedPointDispatch(bool enable);        // Exact kW / milli-cent accounting
+    bool isFixedPointDispatch() const;
+
+    // Order the demand locations are served in : in file DemandQueue.cpp
+    void setDemandOrder(DemandOrder order);         // Rebuilds the queue, O(n)
+    DemandOrder getDemandOrder() const;
+    int setDemandRequired(const string& location, double required);    // O(log n) to reorder
+    int setDemandPrice(const string& location, double mwRetailPrice);
+    int setDemandCritical(const string& location, bool critical);
+    const DemandQueue& getDemandQueue() const;
 
     void printGrid(string description); // Prints all the plants, demands, and lines
     int loadGrid(); // Loads all the plants, demands, and lines
+    int loadGrid(const string& plantsFile, const string& demandsFile, const string& linesFile);
+    void setThreadCount(unsigned count); // Worker threads for parallel stages, 0 = one per core
+    TaskPool& getTaskPool() const;
     void shutdownGrid(); // Removes all the grid's information from the system
     void sortTransLines(); // Sorts all the Trans Lines by efficiency
+
+    // Applies the differences found in changed input files, keeping the
+    // last dispatch's allocations for what remains : in file GridReload.cpp
+    void applyGridDiff(GridDiff& diff);
+
+    // Aggregates for reports and dashboards : in file GridStats.cpp
+    GridStats computeStats() const;
+    vector<Plant*> getPlantList() const;            // The plants in list order
+    const vector<Demand>& getDemandList() const;
+    const vector<TransLine>& getLineList() const;   // In efficiency order once sorted
+
+    // Dispatch result cache : in file DispatchCache.cpp
+    void setDispatchCacheBudget(size_t bytes);      // 0 turns the cache off (default)
+    const DispatchCache& getDispatchCache() const;
+    const AllocationLedger& getLastLedger() const;  // Allocations of the last dispatch
+
+    // Lock free snapshots for concurrent readers : in file GridSnapshot.cpp
+    GridSnapshot* buildSnapshot() const;
+    void publishSnapshot();                         // Call from the dispatch thread only
+    void setSnapshotPublishing(bool enable);        // Publish after every distributePower()
+    SnapshotDomain& getSnapshots();
+
+    // Shared memory export for external monitors : in file GridMonitor.cpp
+    int setMonitorExport(const string& name);       // Export after every dispatch, "" turns it off
+    void publishMonitor();                          // Call from the dispatch thread only
+    MonitorExport* getMonitorExport();              // nullptr while the export is off
+
+    // State of charge of the storage plants : in file StorageBank.cpp
+    StorageStep stepStorage(double stepHours);      // After each dispatch of a time series
+    const StorageBank& getStorageBank();
+
+    // Per step results rows : in file ResultsStore.cpp
+    vector<ResultColumn> getResultColumns() const;  // Demands, then plants, then lines
+    void captureResults(vector<int64_t>& row) const;    // Values in column order
+
+    // DC power flow over an optional topology : in file PowerFlow.cpp
+    int loadTopology(const string& filename);       // Returns 1 if the file is bad or the network is split
+    int computeLineFlows();                         // Network flows of the last dispatch
+    int setLineOutage(const string& lineID, bool out);  // Updates the factor, no refactor
+    void printLineFlows() const;
+    PowerFlow* getPowerFlow();                      // nullptr without a topology
+
+    // Precomputed orderings : in file GridOrder.cpp
+    const OrderIndex& getLineOrder(LineKey key);    // Indexes into the transmission lines
+    vector<Plant*> getPlantOrder(PlantKey key);     // Plants in the order for key
 };
 
+
+// Continuously re-dispatches while reader threads check snapshots : in file GridSnapshot.cpp
+int runSnapshotStress(PowerGrid& grid, int readerCount, double seconds);
+
+
+//
+// forEachDemandInOrder():  Calls visit with every demand location in the
+//                          service order.  visit may change the power a
+//                          location has but not its key.
+//
+template<typename Visit>
+void PowerGrid::forEachDemandInOrder(Visit visit) {
+    if (demandQueue.getOrder() == DO_FILE) {
+        for (auto& demand : demands)
+            visit(demand);
+        return;
+    }
+
+    demandQueue.forEach([&](uint32_t d) { visit(demands[d]); });
+}
@@ -0,0 +1,478 @@
+// File: ResultsStore.cpp
+//
+// Contains the function definitions for the columnar results writer and
+// reader.  See ResultsStore.h for the file layout.
+//
+#include "ResultsStore.h"
+#include "PowerGrid.h"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+using namespace std;
+
+const char RESULTS_MAGIC[8] = { 'P', 'G', 'R', 'E', 'S', '1', 0, 0 };
+
+static_assert(sizeof(ResultsHeader) == 32, "ResultsHeader must be 32 bytes");
+static_assert(sizeof(ResultColumn) == 32, "ResultColumn must be 32 bytes");
+
+
+//
+// resultValue():  Converts a stored integer back to its natural units
+//
+double resultValue(ResultField field, int64_t stored) {
+    switch (field) {
+    case RF_PRICE:
+    case RF_COST:               return toDollars(stored);
+    case RF_LINE_UTILIZATION:   return double(stored) / EFFICIENCY_SCALE;
+    default:                    return toMW(stored);
+    }
+}
+
+
+
+//********************************************************
+//*****           Delta Varint Encoding              *****
+//********************************************************
+
+//
+// putVarint():  Appends a delta as a zigzag varint, 7 bits per byte, so
+//               small changes of either sign take a single byte
+//
+static void putVarint(vector<uint8_t>& out, int64_t delta) {
+    uint64_t value = (uint64_t(delta) << 1) ^ uint64_t(delta >> 63);
+    while (value >= 0x80) {
+        out.push_back(uint8_t(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(uint8_t(value));
+}
+
+//
+// getVarint():  Reads one zigzag varint.  Returns false at the end of input.
+//
+static bool getVarint(const uint8_t*& in, const uint8_t* end, int64_t& delta) {
+    uint64_t value = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        value |= uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            delta = int64_t(value >> 1) ^ -int64_t(value & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+
+//********************************************************
+//*****              Results Writer                  *****
+//********************************************************
+
+//
+//  Constructors and Destructors
+//
+ResultsWriter::ResultsWriter() {
+    memset(&header, 0, sizeof(header));
+}
+
+ResultsWriter::~ResultsWriter() {
+    close();
+}
+
+uint64_t ResultsWriter::getStepsRecorded() const { return stepsRecorded; }
+uint64_t ResultsWriter::getBytesWritten() const { return bytesWritten; }
+
+
+//
+// open():  Writes the header and columns and starts the writer thread
+//
+int ResultsWriter::open(const string& filename, const vector<ResultColumn>& columns, double stepHours) {
+    close();
+
+    osResults.open(filename, ios::binary | ios::trunc);
+    if (!osResults) {
+        cerr << "Error: Unable to write file " << filename << endl;
+        return 1;
+    }
+
+    memcpy(header.magic, RESULTS_MAGIC, sizeof(header.magic));
+    header.columnCount = uint32_t(columns.size());
+    header.blockSteps = RESULTS_BLOCK_STEPS;
+    header.stepHours = stepHours;
+    osResults.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    osResults.write(reinterpret_cast<const char*>(columns.data()), columns.size() * sizeof(ResultColumn));
+
+    filling.firstStep = 0;
+    filling.stepCount = 0;
+    filling.values.assign(size_t(header.columnCount) * header.blockSteps, 0);
+    stepsRecorded = 0;
+    bytesWritten = 0;
+    directory.clear();
+
+    closing = false;
+    writer = thread(&ResultsWriter::writerLoop, this);
+    return 0;
+}
+
+
+//
+// recordStep():  Stores one row in the filling block, handing the block to
+//                the writer thread when it is full
+//
+void ResultsWriter::recordStep(const vector<int64_t>& row) {
+    assert(row.size() == header.columnCount);
+
+    uint64_t offset = filling.stepCount;
+    for (size_t c = 0; c < row.size(); c++)
+        filling.values[c * header.blockSteps + offset] = row[c];
+
+    filling.stepCount++;
+    stepsRecorded++;
+    if (filling.stepCount == header.blockSteps)
+        queueBlock();
+}
+
+
+//
+// queueBlock():  Passes the filling block to the writer, waiting while the
+//                writer is too far behind so memory use stays bounded
+//
+void ResultsWriter::queueBlock() {
+    Block next;
+    next.firstStep = filling.firstStep + filling.stepCount;
+    next.stepCount = 0;
+    next.values.resize(filling.values.size());
+
+    {
+        unique_lock<mutex> guard(queueLock);
+        queueChanged.wait(guard, [this]() { return pending.size() < RESULTS_MAX_PENDING_BLOCKS; });
+        pending.push_back(std::move(filling));
+    }
+    queueChanged.notify_all();
+    filling = std::move(next);
+}
+
+
+//
+// writerLoop():  Encodes and writes blocks until the writer is closed
+//
+void ResultsWriter::writerLoop() {
+    vector<uint8_t> buffer;
+
+    while (true) {
+        Block block;
+        {
+            unique_lock<mutex> guard(queueLock);
+            queueChanged.wait(guard, [this]() { return closing || !pending.empty(); });
+            if (pending.empty())
+                return;
+            block = std::move(pending.front());
+            pending.pop_front();
+        }
+        queueChanged.notify_all();
+
+        writeBlock(block, buffer);
+    }
+}
+
+
+//
+// writeBlock():  Delta encodes each column of a block, appends the block
+//                to the file, and adds it to the directory
+//
+void ResultsWriter::writeBlock(const Block& block, vector<uint8_t>& buffer) {
+    ResultsBlockInfo info = { block.firstStep, block.stepCount };
+    vector<ResultsChunk> chunks(header.columnCount);
+
+    buffer.clear();
+    uint64_t blockOffset = uint64_t(osResults.tellp());
+
+    for (size_t c = 0; c < header.columnCount; c++) {
+        const int64_t* column = &block.values[c * header.blockSteps];
+        size_t start = buffer.size();
+
+        int64_t previous = 0;
+        for (uint64_t s = 0; s < block.stepCount; s++) {
+            putVarint(buffer, column[s] - previous);
+            previous = column[s];
+        }
+        chunks[c] = { blockOffset + start, buffer.size() - start };
+    }
+
+    osResults.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+
+    const char* infoBytes = reinterpret_cast<const char*>(&info);
+    directory.insert(directory.end(), infoBytes, infoBytes + sizeof(info));
+    const char* chunkBytes = reinterpret_cast<const char*>(chunks.data());
+    directory.insert(directory.end(), chunkBytes, chunkBytes + chunks.size() * sizeof(ResultsChunk));
+}
+
+
+//
+// close():  Queues the partly filled block, stops the writer thread, and
+//           writes the directory and footer
+//
+int ResultsWriter::close() {
+    if (!writer.joinable())
+        return 0;
+
+    if (filling.stepCount > 0)
+        queueBlock();
+    {
+        lock_guard<mutex> guard(queueLock);
+        closing = true;
+    }
+    queueChanged.notify_all();
+    writer.join();
+
+    ResultsFooter footer;
+    memset(&footer, 0, sizeof(footer));
+    footer.directoryOffset = uint64_t(osResults.tellp());
+    footer.blockCount = directory.size() / (sizeof(ResultsBlockInfo) + header.columnCount * sizeof(ResultsChunk));
+    memcpy(footer.magic, RESULTS_MAGIC, sizeof(footer.magic));
+
+    osResults.write(directory.data(), directory.size());
+    osResults.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+    bytesWritten = uint64_t(osResults.tellp());
+
+    bool failed = !osResults;
+    osResults.close();
+    filling.values.clear();
+
+    if (failed) {
+        cerr << "Error: Unable to write the results file" << endl;
+        return 1;
+    }
+    return 0;
+}
+
+
+
+//********************************************************
+//*****              Results Reader                  *****
+//********************************************************
+
+//
+// open():  Reads the header, columns, and directory
+//
+int ResultsReader::open(const string& filename) {
+    isResults.close();
+    isResults.clear();
+    isResults.open(filename, ios::binary);
+    if (!isResults) {
+        cerr << "Error: Unable to open file " << filename << endl;
+        return 1;
+    }
+
+    ResultsFooter footer;
+    isResults.read(reinterpret_cast<char*>(&header), sizeof(header));
+    isResults.seekg(-int(sizeof(footer)), ios::end);
+    isResults.read(reinterpret_cast<char*>(&footer), sizeof(footer));
+
+    if (!isResults || memcmp(header.magic, RESULTS_MAGIC, sizeof(RESULTS_MAGIC)) ||
+        memcmp(footer.magic, RESULTS_MAGIC, sizeof(RESULTS_MAGIC))) {
+        cerr << "Error: Not a results file " << filename << endl;
+        return 1;
+    }
+
+    columns.resize(header.columnCount);
+    isResults.seekg(sizeof(header));
+    isResults.read(reinterpret_cast<char*>(columns.data()), columns.size() * sizeof(ResultColumn));
+
+    blocks.resize(footer.blockCount);
+    chunks.resize(footer.blockCount * header.columnCount);
+    isResults.seekg(footer.directoryOffset);
+    for (uint64_t b = 0; b < footer.blockCount; b++) {
+        isResults.read(reinterpret_cast<char*>(&blocks[b]), sizeof(ResultsBlockInfo));
+        isResults.read(reinterpret_cast<char*>(&chunks[b * header.columnCount]),
+                       header.columnCount * sizeof(ResultsChunk));
+    }
+
+    if (!isResults) {
+        cerr << "Error: Damaged results file " << filename << endl;
+        return 1;
+    }
+    return 0;
+}
+
+size_t ResultsReader::getColumnCount() const { return columns.size(); }
+const ResultColumn& ResultsReader::getColumn(size_t column) const { return columns[column]; }
+
+uint64_t ResultsReader::getStepCount() const {
+    return blocks.empty() ? 0 : blocks.back().firstStep + blocks.back().stepCount;
+}
+
+int ResultsReader::findColumn(const string& entity, ResultField field) const {
+    for (size_t c = 0; c < columns.size(); c++) {
+        if (columns[c].field == field && entity.compare(0, sizeof(columns[c].entity) - 1, columns[c].entity) == 0)
+            return int(c);
+    }
+    return -1;
+}
+
+
+//
+// readColumn():  Seeks to the column's bytes in each block and decodes them
+//
+int ResultsReader::readColumn(size_t column, vector<int64_t>& values) {
+    if (column >= columns.size()) {
+        cerr << "Error: No results column " << column << endl;
+        return 1;
+    }
+
+    values.clear();
+    values.reserve(getStepCount());
+    vector<uint8_t> buffer;
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        const ResultsChunk& chunk = chunks[b * columns.size() + column];
+        buffer.resize(chunk.length);
+        isResults.seekg(chunk.offset);
+        isResults.read(reinterpret_cast<char*>(buffer.data()), chunk.length);
+
+        const uint8_t* in = buffer.data();
+        const uint8_t* end = in + buffer.size();
+        int64_t value = 0, delta;
+        for (uint64_t s = 0; s < blocks[b].stepCount; s++) {
+            if (!getVarint(in, end, delta)) {
+                cerr << "Error: Damaged results block " << b << endl;
+                return 1;
+            }
+            value += delta;
+            values.push_back(value);
+        }
+    }
+    return isResults ? 0 : 1;
+}
+
+
+
+//********************************************************
+//*****        PowerGrid results rows                *****
+//********************************************************
+
+//
+// getResultColumns():  Describes the row captureResults() produces
+//
+vector<ResultColumn> PowerGrid::getResultColumns() const {
+    vector<ResultColumn> columns;
+    auto addColumn = [&columns](const string& entity, ResultField field) {
+        ResultColumn column;
+        memset(&column, 0, sizeof(column));
+        strncpy(column.entity, entity.c_str(), sizeof(column.entity) - 1);
+        column.field = field;
+        columns.push_back(column);
+    };
+
+    for (auto& demand : demands) {
+        addColumn(demand.getLocation(), RF_ACQUIRED);
+        addColumn(demand.getLocation(), RF_DEFICIT);
+        addColumn(demand.getLocation(), RF_PRICE);
+        addColumn(demand.getLocation(), RF_COST);
+    }
+    for (auto plant : plants)
+        addColumn(plant->getName(), RF_PLANT_USED);
+    for (auto& line : transLines)
+        addColumn(line.getLineID(), RF_LINE_UTILIZATION);
+
+    return columns;
+}
+
+
+//
+// captureResults():  Fills a row with the grid's current dispatch
+//
+void PowerGrid::captureResults(vector<int64_t>& row) const {
+    row.clear();
+
+    for (auto& demand : demands) {
+        row.push_back(toPowerTicks(demand.getPowerAcquired()));
+        row.push_back(toPowerTicks(demand.getPowerDeficit()));
+        row.push_back(toMoneyTicks(demand.getTotalPowerPrice()));
+        row.push_back(toMoneyTicks(demand.getTotalPowerCost()));
+    }
+    for (auto plant : plants)
+        row.push_back(toPowerTicks(plant->getCurCapacity()) - plant->getAvailTicks());
+    for (auto& line : transLines) {
+        double usable = line.getUsableCapacity();
+        double used = usable - line.getAvailCapacity();
+        row.push_back((usable > 0) ? toEfficiencyPPM(used / usable) : 0);
+    }
+}
+
+
+
+//********************************************************
+//*****            Results Benchmark                 *****
+//********************************************************
+
+//
+// runResultsBenchmark():  Re-dispatches under random demand changes,
+//      records every step, then scans one column back and checks it
+//
+int runResultsBenchmark(PowerGrid& grid, uint64_t stepCount) {
+    const string filename = "/tmp/powergrid_results.pgr";
+
+    vector<ResultColumn> columns = grid.getResultColumns();
+    vector<Demand*> demands;
+    vector<double> required;
+    for (auto& column : columns) {
+        if (column.field == RF_ACQUIRED) {
+            demands.push_back(grid.findDemand(column.entity));
+            required.push_back(demands.back()->getPowerRequired());
+        }
+    }
+
+    ResultsWriter writer;
+    if (writer.open(filename, columns, 1.0))
+        return 1;
+
+    mt19937 rng(1);
+    uniform_real_distribution<double> unit(0.8, 1.2);
+    vector<int64_t> row, expected;
+    size_t checkColumn = 0;         // First demand's power acquired
+
+    auto start = chrono::steady_clock::now();
+    for (uint64_t step = 0; step < stepCount; step++) {
+        for (size_t d = 0; d < demands.size(); d++)
+            grid.setDemandRequired(demands[d]->getLocation(), required[d] * unit(rng));
+
+        grid.resetDispatch();
+        grid.distributePower();
+        grid.captureResults(row);
+        writer.recordStep(row);
+        expected.push_back(row[checkColumn]);
+    }
+    if (writer.close())
+        return 1;
+    double writeTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    // Put the demands back as they were
+    for (size_t d = 0; d < demands.size(); d++)
+        grid.setDemandRequired(demands[d]->getLocation(), required[d]);
+
+    ResultsReader reader;
+    vector<int64_t> values;
+    start = chrono::steady_clock::now();
+    if (reader.open(filename) || reader.readColumn(checkColumn, values))
+        return 1;
+    double readTime = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    uint64_t rawBytes = stepCount * columns.size() * sizeof(double);
+    cout << "\n\t--- Results Store (" << stepCount << " steps, " << columns.size() << " columns) ---\n";
+    cout << std::fixed << std::setprecision(0);
+    cout << "    Steps recorded:        " << stepCount / writeTime << "/sec (dispatch included)" << endl;
+    cout << "    File size:             " << writer.getBytesWritten() << " bytes" << endl;
+    cout << "    Raw doubles:           " << rawBytes << " bytes ("
+         << setprecision(1) << double(rawBytes) / writer.getBytesWritten() << "x larger)" << endl;
+    cout << "    One column scan:       " << setprecision(2) << readTime * 1000 << " ms ("
+         << columns[checkColumn].entity << " acquired)" << endl;
+    cout << "    Column matches:        " << ((values == expected) ? "yes" : "NO") << endl;
+
+    remove(filename.c_str());
+    return (values == expected) ? 0 : 1;
+}
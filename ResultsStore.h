@@ -0,0 +1,155 @@
+#pragma once
+// File: ResultsStore.h
+//
+// Contains the columnar results file written during long simulations and
+// the reader that scans it.
+//
+// Each step of a simulation records one row: for every demand location
+// the power acquired, deficit, price, and cost; for every plant the
+// capacity used; and for every line its utilization.  Values are stored as
+// integers in the fixed point units of FixedPoint.h, so they round trip
+// exactly.
+//
+// Rows are collected into blocks of steps.  A full block is handed to a
+// background thread that encodes each column separately as a first value
+// followed by deltas, zigzag varint coded, and appends it to the file.
+// The directory at the end of the file gives the offset and length of
+// every column in every block, so a reader decodes one column without
+// touching the bytes of any other.
+//
+//      ResultsHeader, ResultColumn[columnCount]
+//      block 0:  column 0 bytes, column 1 bytes, ...
+//      block 1:  ...
+//      directory:  per block, ResultsBlockInfo then ResultsChunk[columnCount]
+//      ResultsFooter
+//
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <fstream>
+#include <cstdint>
+using namespace std;
+
+class PowerGrid;
+
+// The value a column holds, and so its units
+enum ResultField : uint32_t {
+    RF_ACQUIRED,            // Demand power acquired (kW)
+    RF_DEFICIT,             // Demand power deficit (kW)
+    RF_PRICE,               // Demand total price (milli-cents)
+    RF_COST,                // Demand total cost (milli-cents)
+    RF_PLANT_USED,          // Plant capacity allocated (kW)
+    RF_LINE_UTILIZATION,    // Line capacity used (parts per million of usable capacity)
+    RF_COUNT
+};
+
+// File header, 32 bytes
+struct ResultsHeader {
+    char        magic[8];
+    uint32_t    columnCount;
+    uint32_t    blockSteps;
+    double      stepHours;
+    char        reserved[8];
+};
+
+// Column description, 32 bytes
+struct ResultColumn {
+    char        entity[24];         // Demand location, plant name, or line ID
+    uint32_t    field;              // ResultField
+    uint32_t    reserved;
+};
+
+// Directory entries
+struct ResultsBlockInfo {
+    uint64_t    firstStep;
+    uint64_t    stepCount;
+};
+
+struct ResultsChunk {
+    uint64_t    offset;             // Encoded column bytes in the file
+    uint64_t    length;
+};
+
+// Last 24 bytes of the file
+struct ResultsFooter {
+    uint64_t    directoryOffset;
+    uint64_t    blockCount;
+    char        magic[8];
+};
+
+// Converts a stored value to MW, dollars, or a 0 - 1 fraction
+double resultValue(ResultField field, int64_t stored);
+
+
+//
+// Class ResultsWriter
+//
+class ResultsWriter {
+private:
+    // Values of one block, column after column
+    struct Block {
+        uint64_t        firstStep;
+        uint64_t        stepCount;
+        vector<int64_t> values;
+    };
+
+    ofstream            osResults;
+    ResultsHeader       header;
+    Block               filling;            // Block receiving rows
+    uint64_t            stepsRecorded = 0;
+    uint64_t            bytesWritten = 0;
+    vector<char>        directory;          // Encoded directory, written at close
+
+    // Background encoding and writing
+    thread              writer;
+    mutex               queueLock;
+    condition_variable  queueChanged;
+    deque<Block>        pending;
+    bool                closing = false;
+
+    void writerLoop();
+    void writeBlock(const Block& block, vector<uint8_t>& buffer);
+    void queueBlock();
+
+public:
+    // Constructors & Destructors
+    ResultsWriter();
+    ~ResultsWriter();
+
+    int open(const string& filename, const vector<ResultColumn>& columns, double stepHours);
+    void recordStep(const vector<int64_t>& row);    // One value per column
+    int close();                                    // Flushes and writes the directory
+
+    uint64_t getStepsRecorded() const;
+    uint64_t getBytesWritten() const;               // Valid after close()
+};
+
+
+//
+// Class ResultsReader
+//
+class ResultsReader {
+private:
+    ifstream                    isResults;
+    ResultsHeader               header;
+    vector<ResultColumn>        columns;
+    vector<ResultsBlockInfo>    blocks;
+    vector<ResultsChunk>        chunks;             // Block after block, columnCount each
+
+public:
+    int open(const string& filename);               // Returns 1 if the file is not a results file
+    size_t getColumnCount() const;
+    uint64_t getStepCount() const;
+    const ResultColumn& getColumn(size_t column) const;
+    int findColumn(const string& entity, ResultField field) const;  // -1 if not found
+
+    // Decodes one column for every step, reading only that column's bytes
+    int readColumn(size_t column, vector<int64_t>& values);
+};
+
+
+// Records a randomized multi step run of the grid and scans one column back
+int runResultsBenchmark(PowerGrid& grid, uint64_t stepCount);
@@ -0,0 +1,152 @@
+// File: StorageBank.cpp
+//
+// Contains the function definitions for the StorageBank class and the
+// grid's storage step.  See StorageBank.h for a description of the update.
+//
+#include "GridDef.h"
+#include "StorageBank.h"
+#include "PowerGrid.h"
+#include <algorithm>
+using namespace std;
+
+
+//
+// build():  Collects the storage plants and their fixed parameters
+//
+void StorageBank::build(const vector<Plant*>& plantList) {
+    clear();
+    for (auto plant : plantList) {
+        StoragePlant* unit = dynamic_cast<StoragePlant*>(plant);
+        if (!unit)
+            continue;
+
+        units.push_back(unit);
+        energyCapacity.push_back(unit->getEnergyCapacity());
+        oneWay.push_back(max(unit->getOneWayEfficiency(), 1e-9));  // A dead cell stores nothing but divides safely
+    }
+
+    size_t count = units.size();
+    powerLimit.resize(count);
+    stored.resize(count);
+    discharged.resize(count);
+    room.resize(count);
+    output.resize(count);
+}
+
+void StorageBank::clear() {
+    units.clear();
+    energyCapacity.clear();
+    oneWay.clear();
+    powerLimit.clear();
+    stored.clear();
+    discharged.clear();
+    room.clear();
+    output.clear();
+}
+
+
+//
+// step():  Gathers the units' state, updates every unit a stage at a time,
+//          and writes the new energy and output back
+//
+StorageStep StorageBank::step(double unusedGeneration, double stepHours) {
+    StorageStep result;
+    size_t count = units.size();
+    if (count == 0) {
+        result.surplus = max(0.0, unusedGeneration);
+        return result;
+    }
+
+    // Gather what dispatch did with each unit.  Allocation leaves up to
+    // half a kW of rounding, which is not a discharge.
+    double storageUnused = 0;
+    for (size_t i = 0; i < count; i++) {
+        const StoragePlant* unit = units[i];
+        double used = unit->getCurCapacity() - unit->getAvailCapacity();
+
+        stored[i] = unit->getStoredEnergy();
+        discharged[i] = (used < toMW(1)) ? 0.0 : used;
+        powerLimit[i] = unit->isOnline() ? unit->getMaxCapacity() * unit->getUptimePercent() / 100 : 0.0;
+        storageUnused += unit->getAvailCapacity();
+    }
+    result.surplus = max(0.0, unusedGeneration - storageUnused);
+
+    // Plain loops over the arrays from here, so each stage vectorizes
+    const double* capacity = energyCapacity.data();
+    const double* efficiency = oneWay.data();
+    const double* limit = powerLimit.data();
+    const double* taken = discharged.data();
+    double* energy = stored.data();
+    double* chargeRoom = room.data();
+    double* nextOutput = output.data();
+    const double hours = stepHours;
+
+    // Take out what dispatch delivered and the loss of delivering it
+    for (size_t i = 0; i < count; i++)
+        energy[i] = max(0.0, energy[i] - taken[i] * hours / efficiency[i]);
+
+    // Room to charge: the power limit, or what fills the unit in a step
+    for (size_t i = 0; i < count; i++) {
+        double fill = (capacity[i] - energy[i]) / (efficiency[i] * hours);
+        chargeRoom[i] = (taken[i] > 0.0) ? 0.0 : max(0.0, min(limit[i], fill));
+    }
+
+    double totalRoom = 0;
+    for (size_t i = 0; i < count; i++)
+        totalRoom += chargeRoom[i];
+    double share = (totalRoom > 0) ? min(1.0, result.surplus / totalRoom) : 0.0;
+
+    // Charge each unit its share of the surplus, less the charging loss,
+    // and find what it can discharge in the next step
+    for (size_t i = 0; i < count; i++) {
+        energy[i] = min(capacity[i], energy[i] + chargeRoom[i] * share * efficiency[i] * hours);
+        nextOutput[i] = min(limit[i], energy[i] * efficiency[i] / hours);
+    }
+
+    // Write the state back and total the step
+    for (size_t i = 0; i < count; i++) {
+        units[i]->setStorageState(energy[i], hours, nextOutput[i]);
+        result.discharged += taken[i];
+        result.stored += energy[i];
+    }
+    result.charged = totalRoom * share;
+
+    return result;
+}
+
+
+size_t StorageBank::size() const { return units.size(); }
+
+double StorageBank::getStoredEnergy() const {
+    double total = 0;
+    for (auto unit : units)
+        total += unit->getStoredEnergy();
+    return total;
+}
+
+
+//
+// stepStorage():  Call after a dispatch.  Moves the energy held by every
+//      storage plant over a step of stepHours and sets what each can
+//      discharge in the next dispatch.
+//
+StorageStep PowerGrid::stepStorage(double stepHours) {
+    if (!storageBankValid) {
+        storageBank.build(getPlantList());
+        storageBankValid = true;
+    }
+
+    double unusedGeneration = 0;
+    for (auto plant : plants)
+        unusedGeneration += plant->getAvailCapacity();
+
+    return storageBank.step(unusedGeneration, stepHours);
+}
+
+const StorageBank& PowerGrid::getStorageBank() {
+    if (!storageBankValid) {
+        storageBank.build(getPlantList());
+        storageBankValid = true;
+    }
+    return storageBank;
+}
@@ -0,0 +1,62 @@
+#pragma once
+// File: StorageBank.h
+//
+// Contains the batched state of charge update for the grid's battery
+// storage plants.
+//
+// Dispatch draws on a storage plant like any other plant, up to what its
+// stored energy can deliver in a step.  Between steps the energy each one
+// holds has to move: down by what dispatch took from it, and up by what
+// it charges from the generation dispatch left unused.  With thousands of
+// batteries that is done for all of them at once: the bank gathers their
+// state into one array per field, runs each stage of the update as a
+// plain loop over the arrays, which the compiler vectorizes, and writes
+// the new energy and output back to the plants.
+//
+// Surplus is shared between the batteries with room in proportion to how
+// much each can take.  Charging is modeled at the plants, so it does not
+// use transmission line capacity.  A battery does not charge in a step it
+// discharged.
+//
+#include <vector>
+#include "Plant.h"
+using namespace std;
+
+// Energy moved by one step, for all storage plants together
+struct StorageStep {
+    double      surplus = 0;        // MW of generation left unused by dispatch
+    double      discharged = 0;     // MW dispatch drew from storage
+    double      charged = 0;        // MW of the surplus taken to charge storage
+    double      stored = 0;         // MWh held after the step
+};
+
+
+//
+// Class StorageBank
+//
+class StorageBank {
+private:
+    vector<StoragePlant*>   units;
+
+    // One entry per unit.  The fixed fields are read when the bank is
+    // built; the rest are gathered from the plants every step.
+    vector<double>      energyCapacity;     // MWh
+    vector<double>      oneWay;             // Efficiency of charging, and of discharging
+    vector<double>      powerLimit;         // MW, 0 while the plant is tripped
+    vector<double>      stored;             // MWh
+    vector<double>      discharged;         // MW
+    vector<double>      room;               // MW each could charge this step
+    vector<double>      output;             // MW each can discharge next step
+
+public:
+    void build(const vector<Plant*>& plantList);    // Finds the storage plants
+    void clear();
+
+    // Moves the energy held by every unit over a step of stepHours, given
+    // the MW of generation dispatch left unused, including any storage
+    // output it left
+    StorageStep step(double unusedGeneration, double stepHours);
+
+    size_t size() const;
+    double getStoredEnergy() const;     // MWh held by all units
+};
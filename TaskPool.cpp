@@ -0,0 +1,206 @@
+// File: TaskPool.cpp
+//
+// Contains the function definitions for the work stealing TaskPool.
+// See TaskPool.h for a description of the scheduling.
+//
+#include "TaskPool.h"
+#include <algorithm>
+using namespace std;
+
+//
+// Task:  A unit of work and the tasks waiting for it to finish
+//
+struct TaskPool::Task {
+    function<void()>    work;
+    atomic<int>         pendingDeps;    // Unfinished dependencies, plus one while submitting
+    atomic<bool>        done;
+    mutex               lock;           // Guards successors and done when linking
+    vector<TaskHandle>  successors;
+
+    Task(function<void()> fn) : work(std::move(fn)), pendingDeps(1), done(false) {}
+};
+
+// Index of the worker running on this thread, or -1 outside the pool
+static thread_local int workerIndex = -1;
+static thread_local const TaskPool* workerPool = nullptr;
+
+
+//
+//  Constructors and Destructors
+//
+TaskPool::TaskPool(unsigned threadCount) : nextQueue(0), readyCount(0), stopping(false) {
+    if (threadCount == 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+
+    for (unsigned i = 0; i < threadCount; i++)
+        queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+    for (unsigned i = 0; i < threadCount; i++)
+        workers.emplace_back(&TaskPool::workerLoop, this, i);
+}
+
+TaskPool::~TaskPool() {
+    {
+        lock_guard<mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+}
+
+unsigned TaskPool::getThreadCount() const { return unsigned(workers.size()); }
+
+
+//
+// submit():  Creates a task and links it after its dependencies.  The task
+//            holds one extra pending count until linking is complete, so
+//            it cannot start while dependencies are still being added.
+//
+TaskPool::TaskHandle TaskPool::submit(function<void()> work, const vector<TaskHandle>& dependsOn) {
+    TaskHandle task = make_shared<Task>(std::move(work));
+
+    for (auto& dep : dependsOn) {
+        lock_guard<mutex> guard(dep->lock);
+        if (!dep->done) {
+            task->pendingDeps++;
+            dep->successors.push_back(task);
+        }
+    }
+
+    if (--task->pendingDeps == 0)
+        schedule(task);
+    return task;
+}
+
+
+//
+// schedule():  Puts a ready task on a queue.  Workers push onto their own
+//              queue; other threads spread tasks round robin.
+//
+void TaskPool::schedule(const TaskHandle& task) {
+    size_t target;
+    if (workerPool == this && workerIndex >= 0)
+        target = size_t(workerIndex);
+    else
+        target = nextQueue++ % queues.size();
+
+    {
+        lock_guard<mutex> guard(queues[target]->lock);
+        queues[target]->tasks.push_back(task);
+    }
+    readyCount++;
+
+    // Take the sleep lock so a worker about to sleep sees the new task
+    { lock_guard<mutex> guard(sleepLock); }
+    wakeUp.notify_one();
+}
+
+
+//
+// runOneTask():  Takes the newest task from the home queue, or steals the
+//                oldest task from another queue, and runs it
+//
+bool TaskPool::runOneTask(size_t home) {
+    TaskHandle task;
+    size_t queueCount = queues.size();
+
+    for (size_t i = 0; i < queueCount && !task; i++) {
+        WorkQueue& queue = *queues[(home + i) % queueCount];
+        lock_guard<mutex> guard(queue.lock);
+        if (queue.tasks.empty())
+            continue;
+
+        if (i == 0) {
+            task = queue.tasks.back();
+            queue.tasks.pop_back();
+        }
+        else {
+            task = queue.tasks.front();
+            queue.tasks.pop_front();
+        }
+    }
+
+    if (!task)
+        return false;
+
+    readyCount--;
+    task->work();
+    finish(*task);
+    return true;
+}
+
+
+//
+// finish():  Marks a task done and releases the tasks that waited on it
+//
+void TaskPool::finish(Task& task) {
+    vector<TaskHandle> released;
+    {
+        lock_guard<mutex> guard(task.lock);
+        task.done = true;
+        released.swap(task.successors);
+    }
+
+    for (auto& next : released) {
+        if (--next->pendingDeps == 0)
+            schedule(next);
+    }
+}
+
+
+//
+// workerLoop():  Runs tasks until the pool is destroyed
+//
+void TaskPool::workerLoop(size_t index) {
+    workerIndex = int(index);
+    workerPool = this;
+
+    while (true) {
+        if (runOneTask(index))
+            continue;
+
+        unique_lock<mutex> guard(sleepLock);
+        wakeUp.wait(guard, [this]() { return stopping || readyCount > 0; });
+        if (stopping && readyCount == 0)
+            return;
+    }
+}
+
+
+//
+// wait():  Helps run ready tasks until the task has finished
+//
+void TaskPool::wait(const TaskHandle& task) {
+    size_t home = (workerPool == this && workerIndex >= 0) ? size_t(workerIndex) : 0;
+
+    while (!task->done) {
+        if (!runOneTask(home))
+            this_thread::yield();
+    }
+}
+
+
+//
+// parallelFor():  Splits [0, count) into chunks and runs them as tasks
+//
+void TaskPool::parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body) {
+    if (count == 0)
+        return;
+    grain = max<size_t>(grain, 1);
+
+    // A single chunk runs on the calling thread
+    if (count <= grain) {
+        body(0, count);
+        return;
+    }
+
+    vector<TaskHandle> chunks;
+    for (size_t first = 0; first < count; first += grain) {
+        size_t last = min(count, first + grain);
+        chunks.push_back(submit([&body, first, last]() { body(first, last); }));
+    }
+
+    for (auto& chunk : chunks)
+        wait(chunk);
+}
@@ -0,0 +1,65 @@
+#pragma once
+// File: TaskPool.h
+//
+// Contains class definition for the TaskPool, a work stealing thread pool
+// with task dependencies used to run simulation stages in parallel.
+//
+// Each worker thread owns a deque of ready tasks.  A worker takes its
+// newest task first (good cache reuse for nested work) and, when its deque
+// is empty, steals the oldest task from another worker.  A task can name
+// the tasks it depends on; it becomes ready when the last of them ends.
+//
+// Threads that wait for a task help run other ready tasks instead of
+// sleeping, so nested parallel loops cannot deadlock the pool.
+//
+#include <functional>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+using namespace std;
+
+class TaskPool {
+public:
+    struct Task;
+    typedef shared_ptr<Task> TaskHandle;
+
+private:
+    // Ready tasks owned by one worker
+    struct WorkQueue {
+        mutex               lock;
+        deque<TaskHandle>   tasks;
+    };
+
+    vector<thread>                  workers;
+    vector<unique_ptr<WorkQueue>>   queues;
+    atomic<size_t>                  nextQueue;      // Round robin target for outside submits
+    atomic<long>                    readyCount;     // Tasks sitting in the queues
+    atomic<bool>                    stopping;
+    mutex                           sleepLock;
+    condition_variable              wakeUp;
+
+    void workerLoop(size_t index);
+    void schedule(const TaskHandle& task);
+    bool runOneTask(size_t home);                   // Runs a ready task if there is one
+    void finish(Task& task);
+
+public:
+    explicit TaskPool(unsigned threadCount = 0);    // 0 = one thread per hardware core
+    ~TaskPool();
+
+    // Adds a task that runs once every task in dependsOn has finished
+    TaskHandle submit(function<void()> work, const vector<TaskHandle>& dependsOn = {});
+
+    // Waits for a task, running other tasks meanwhile
+    void wait(const TaskHandle& task);
+
+    // Runs body(first, last) over [0, count) in chunks of at most grain
+    // items and returns when every chunk has finished
+    void parallelFor(size_t count, size_t grain, const function<void(size_t, size_t)>& body);
+
+    unsigned getThreadCount() const;
+};
@@ -15,6 +15,8 @@
 #include "TransLine.h"
 #include <iostream>
 #include <iomanip>
+#include <cassert>
+#include <algorithm>
 
 
 //
@@ -22,7 +24,9 @@
 //
 // Constructor()  
 TransLine::TransLine(const string& lineID, const double maxCapacity, const double efficiency)
-    : lineID(lineID), maxCapacity(maxCapacity), availCapacity(maxCapacity), efficiency(efficiency) {
+    : lineID(lineID), maxCapacity(maxCapacity), availCapacity(maxCapacity), efficiency(efficiency), derateFactor(1.0) {
+    availTicks = toPowerTicks(maxCapacity);
+    efficiencyPPM = toEfficiencyPPM(efficiency);
 }
 
 // Destructor() 
@@ -36,6 +40,10 @@ string TransLine::getLineID() const { return lineID; }
 double TransLine::getAvailCapacity() const { return availCapacity; }
 double TransLine::getMaxCapacity() const { return maxCapacity; }
 double TransLine::getEfficiency() const { return efficiency; }
+double TransLine::getDerateFactor() const { return derateFactor; }
+double TransLine::getUsableCapacity() const { return maxCapacity * derateFactor; }
+PowerTicks TransLine::getAvailTicks() const { return availTicks; }
+int64_t TransLine::getEfficiencyPPM() const { return efficiencyPPM; }
 
 
 
@@ -71,4 +79,48 @@ void TransLine::allocateLineCapacity(double power) {
     availCapacity -= power;
     if (availCapacity < 0.001)
         availCapacity = 0.0;
+    availTicks = toPowerTicks(availCapacity);
+}
+
+//
+//  allocateLineTicks();   Fixed point version of allocateLineCapacity()
+//
+void TransLine::allocateLineTicks(PowerTicks power) {
+    availTicks -= power;
+    availCapacity = toMW(availTicks);
+}
+
+//
+//  releaseLineCapacity();   Returns capacity when power is moved off the line
+//
+void TransLine::releaseLineCapacity(double power) {
+    availCapacity = min(getUsableCapacity(), availCapacity + power);
+    availTicks = toPowerTicks(availCapacity);
+}
+
+void TransLine::releaseLineTicks(PowerTicks power) {
+    availTicks += power;
+    availCapacity = toMW(availTicks);
+}
+
+//
+//  resetCapacity();   Releases all capacity before a new dispatch
+//
+void TransLine::resetCapacity() {
+    availCapacity = getUsableCapacity();
+    availTicks = toPowerTicks(availCapacity);
+}
+
+//
+//  derate();   Limits the line to a fraction of its rated capacity.  Power
+//              already allocated above the new limit is kept until the
+//              next dispatch.
+//
+void TransLine::derate(double fraction) {
+    assert(fraction >= 0 && fraction <= 1);
+    derateFactor = fraction;
+    if (availCapacity > getUsableCapacity()) {
+        availCapacity = getUsableCapacity();
+        availTicks = toPowerTicks(availCapacity);
+    }
 }
@@ -16,6 +16,7 @@
 // and finctions within the Connection for this. 
 
 #include "GridDef.h"
+#include "FixedPoint.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
@@ -34,6 +35,11 @@ protected:
     double      maxCapacity;
     double      availCapacity;
     double      efficiency;
+    double      derateFactor;       // Fraction of maxCapacity usable while derated
+
+    // Fixed point copies, kept in step with the double values above
+    PowerTicks  availTicks;
+    int64_t     efficiencyPPM;      // Efficiency in parts per million
 
 public:
     // Constructors & Destructors
@@ -42,12 +48,21 @@ public:
 
     // Mutators
     void allocateLineCapacity(double power);
+    void allocateLineTicks(PowerTicks power);   // Exact fixed point version
+    void releaseLineCapacity(double power);     // Give back allocated capacity
+    void releaseLineTicks(PowerTicks power);
+    void resetCapacity();                       // Release all allocated capacity
+    void derate(double fraction);               // Limit use to a fraction of maxCapacity, 1 = fully rated
 
     // Accessors
     string getLineID() const;
     double getMaxCapacity() const;
     double getAvailCapacity() const;
     double getEfficiency() const;
+    double getDerateFactor() const;
+    double getUsableCapacity() const;           // maxCapacity after derating
+    PowerTicks getAvailTicks() const;
+    int64_t getEfficiencyPPM() const;
 
     // Print and debug routines
     void printLineStatus() const;
@@ -0,0 +1,778 @@
+// File: UnitCommitment.cpp
+//
+// Contains the function definitions for the UnitCommitment class.  See
+// UnitCommitment.h for a description of the rolling horizon.
+//
+#include "GridDef.h"
+#include "UnitCommitment.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <iostream>
+#include <iomanip>
+using namespace std;
+
+
+//
+//  Constructors and Destructors
+//
+UnitCommitment::UnitCommitment(PowerGrid& grid) {
+    for (auto plant : grid.getPlantList()) {
+        double capacity = plant->getCurCapacity();
+        if (!plant->isOnline() || capacity <= 0)
+            continue;
+
+        bool nuclear = dynamic_cast<NuclearPlant*>(plant) != nullptr;
+        bool fossil = dynamic_cast<FossilPlant*>(plant) != nullptr;
+        if (!nuclear && !fossil) {
+            merit.push_back({ plant->getCostPerMW(), -1, capacity });
+            flexCapacity += capacity;
+            continue;
+        }
+
+        Unit unit;
+        unit.plant = plant;
+        unit.maxOutput = capacity;
+        unit.minOutput = capacity * (nuclear ? UC_NUCLEAR_MIN_OUTPUT : UC_FOSSIL_MIN_OUTPUT);
+        unit.ramp = capacity * (nuclear ? UC_NUCLEAR_RAMP : UC_FOSSIL_RAMP);
+        unit.startOutput = min(unit.maxOutput, max(unit.minOutput, unit.ramp));
+        unit.cost = plant->getCostPerMW();
+        unit.startupCost = plant->getMaxCapacity() * (nuclear ? UC_NUCLEAR_STARTUP_COST : UC_FOSSIL_STARTUP_COST);
+        unit.minUp = nuclear ? UC_NUCLEAR_MIN_UP : UC_FOSSIL_MIN_UP;
+        unit.minDown = nuclear ? UC_NUCLEAR_MIN_DOWN : UC_FOSSIL_MIN_DOWN;
+
+        // Past the minimum times and the hours to ramp to full output, a
+        // longer time in the same state makes no difference to a solve
+        int rampHours = int(ceil((unit.maxOutput - unit.startOutput) / unit.ramp)) + 1;
+        unit.stateCap = max(max(unit.minUp, unit.minDown), rampHours);
+
+        merit.push_back({ unit.cost, int(units.size()), 0 });
+        units.push_back(unit);
+    }
+
+    stable_sort(merit.begin(), merit.end(), [](const MeritEntry& a, const MeritEntry& b) { return a.cost < b.cost; });
+
+    // Cheapest first at full output over a minimum run, start included
+    priority.resize(units.size());
+    for (size_t u = 0; u < units.size(); u++)
+        priority[u] = u;
+    auto fullLoadCost = [this](size_t u) {
+        return units[u].cost + units[u].startupCost / (units[u].maxOutput * units[u].minUp);
+    };
+    stable_sort(priority.begin(), priority.end(), [&](size_t a, size_t b) { return fullLoadCost(a) < fullLoadCost(b); });
+}
+
+
+void UnitCommitment::setLoad(const vector<double>& hourlyMW) {
+    load = hourlyMW;
+    schedule.clear();
+    output.clear();
+}
+
+void UnitCommitment::setWindow(size_t commit, size_t lookahead) {
+    commitHours = max<size_t>(1, commit);
+    lookaheadHours = lookahead;
+}
+
+
+//
+// sameCommitment():  True if a window solved from one boundary would be
+//                    solved the same from the other
+//
+bool UnitCommitment::Boundary::sameCommitment(const Boundary& other) const {
+    return on == other.on && hours == other.hours;
+}
+
+
+//
+// initialBoundary():  Every unit on and free to change, at the output a
+//                     dispatch of the first hour without ramps gives it
+//
+UnitCommitment::Boundary UnitCommitment::initialBoundary() const {
+    Boundary state;
+    size_t count = units.size();
+    state.on.assign(count, 1);
+    state.hours.resize(count);
+    state.output.resize(count);
+
+    double residual = load.empty() ? 0 : load[0];
+    for (size_t u = 0; u < count; u++) {
+        state.hours[u] = units[u].stateCap;
+        state.output[u] = units[u].minOutput;
+        residual -= units[u].minOutput;
+    }
+    for (auto& entry : merit) {
+        if (residual <= 0) break;
+        double room = (entry.unit < 0) ? entry.capacity : units[entry.unit].maxOutput - units[entry.unit].minOutput;
+        double take = min(residual, room);
+        if (entry.unit >= 0)
+            state.output[entry.unit] += take;
+        residual -= take;
+    }
+    return state;
+}
+
+
+//
+// boundaryAfter():  The on and off states after hours of a plan.  The
+//                   output is left as it was in start.
+//
+UnitCommitment::Boundary UnitCommitment::boundaryAfter(const Boundary& start, const uint8_t* plan, size_t hours) const {
+    Boundary state = start;
+    size_t count = units.size();
+    for (size_t t = 0; t < hours; t++) {
+        for (size_t u = 0; u < count; u++) {
+            uint8_t on = plan[t * count + u];
+            if (on == state.on[u])
+                state.hours[u] = min(state.hours[u] + 1, units[u].stateCap);
+            else {
+                state.on[u] = on;
+                state.hours[u] = 1;
+            }
+        }
+    }
+    return state;
+}
+
+
+//
+// availableAt():  What a unit can give run hours after it started, within
+//                 its ramp rate
+//
+double UnitCommitment::availableAt(size_t u, int run) const {
+    if (run < 0)
+        return 0;
+    return min(units[u].maxOutput, units[u].startOutput + units[u].ramp * run);
+}
+
+void UnitCommitment::computeRun(const Boundary& start, const uint8_t* plan, size_t hours, size_t u, int* run) const {
+    size_t count = units.size();
+    int prev = start.on[u] ? start.hours[u] - 1 : -1;
+    for (size_t t = 0; t < hours; t++) {
+        int r = plan[t * count + u] ? min(prev + 1, units[u].stateCap) : -1;
+        run[t * count + u] = r;
+        prev = r;
+    }
+}
+
+
+//
+// canStart():  True if unit u, off at hour t, may be turned on there
+//
+bool UnitCommitment::canStart(const Boundary& start, const uint8_t* plan, size_t t, size_t u) const {
+    size_t count = units.size();
+
+    // Already on in the hour before, so this only makes its run longer
+    if (t > 0 ? plan[(t - 1) * count + u] : start.on[u])
+        return true;
+
+    int off = 0;
+    long s = long(t) - 1;
+    while (s >= 0 && !plan[s * count + u] && off < units[u].minDown) {
+        off++;
+        s--;
+    }
+    if (off >= units[u].minDown)
+        return true;
+    if (s >= 0)
+        return false;
+    return !start.on[u] && off + start.hours[u] >= units[u].minDown;
+}
+
+
+//
+// enforceMinTimes():  Keeps units on until their minimum up time and off
+//                     until their minimum down time, delaying starts and
+//                     stops in the plan where needed
+//
+void UnitCommitment::enforceMinTimes(const Boundary& start, uint8_t* plan, size_t hours) const {
+    size_t count = units.size();
+    for (size_t u = 0; u < count; u++) {
+        uint8_t state = start.on[u];
+        int inState = start.hours[u];
+
+        for (size_t t = 0; t < hours; t++) {
+            uint8_t want = plan[t * count + u];
+            if (state && !want && inState < units[u].minUp)
+                want = 1;
+            else if (!state && want && inState < units[u].minDown)
+                want = 0;
+
+            plan[t * count + u] = want;
+            if (want == state)
+                inState = min(inState + 1, units[u].stateCap);
+            else {
+                state = want;
+                inState = 1;
+            }
+        }
+    }
+}
+
+
+//
+// ensureCapacity():  Commits units in priority order until every hour has
+//      its load plus the reserve margin, each for at least its minimum up
+//      time.  Leaves the units' run hours and the hourly capacity in work.
+//
+void UnitCommitment::ensureCapacity(const Boundary& start, size_t first, uint8_t* plan, size_t hours, WindowWork& work) const {
+    size_t count = units.size();
+    vector<int>& run = work.run;
+    vector<double>& capacity = work.capacity;
+
+    run.assign(hours * count, -1);
+    capacity.assign(hours, flexCapacity);
+    for (size_t u = 0; u < count; u++) {
+        computeRun(start, plan, hours, u, run.data());
+        for (size_t t = 0; t < hours; t++)
+            capacity[t] += availableAt(u, run[t * count + u]);
+    }
+
+    for (size_t t = 0; t < hours; t++) {
+        double need = load[first + t] * (1 + UC_RESERVE_MARGIN);
+
+        for (size_t p = 0; p < priority.size() && capacity[t] < need; p++) {
+            size_t u = priority[p];
+            if (plan[t * count + u] || !canStart(start, plan, t, u))
+                continue;
+
+            // On for the minimum up time, and on through any gap to its
+            // next run too short to be off for
+            size_t end = min(hours, t + units[u].minUp);
+            size_t next = end;
+            while (next < hours && !plan[next * count + u])
+                next++;
+            if (next < hours && next - end < size_t(units[u].minDown))
+                end = next;
+            for (size_t s = t; s < end; s++)
+                plan[s * count + u] = 1;
+
+            // Run hours change from t until they match the old ones again
+            int prev = (t > 0) ? run[(t - 1) * count + u] : (start.on[u] ? start.hours[u] - 1 : -1);
+            for (size_t s = t; s < hours; s++) {
+                int r = plan[s * count + u] ? min(prev + 1, units[u].stateCap) : -1;
+                if (s >= end && r == run[s * count + u])
+                    break;
+                capacity[s] += availableAt(u, r) - availableAt(u, run[s * count + u]);
+                run[s * count + u] = r;
+                prev = r;
+            }
+        }
+    }
+}
+
+
+//
+// hourCost():  Cost of meeting an hour's load with the units on in run
+//              (one hour's row) and the flexible plants, without ramping
+//              from the hour before.  Load that cannot be met is costed
+//              at UC_UNSERVED_COST.
+//
+double UnitCommitment::hourCost(size_t hour, const int* run) const {
+    double residual = load[hour];
+    double cost = 0;
+    size_t count = units.size();
+
+    for (size_t u = 0; u < count; u++) {
+        if (run[u] >= 0) {
+            residual -= units[u].minOutput;
+            cost += units[u].minOutput * units[u].cost;
+        }
+    }
+
+    for (auto& entry : merit) {
+        if (residual <= 0) break;
+
+        double room;
+        if (entry.unit < 0)
+            room = entry.capacity;
+        else if (run[entry.unit] >= 0)
+            room = availableAt(entry.unit, run[entry.unit]) - units[entry.unit].minOutput;
+        else
+            continue;
+
+        double take = min(residual, room);
+        residual -= take;
+        cost += take * entry.cost;
+    }
+
+    if (residual > 0)
+        cost += residual * UC_UNSERVED_COST;
+    return cost;
+}
+
+
+//
+// tryRemoveRun():  Turns unit u off for its run [begin, end) if every hour
+//                  keeps its reserve and the window's cost goes down
+//
+bool UnitCommitment::tryRemoveRun(const Boundary& start, size_t first, uint8_t* plan, size_t u,
+                                  size_t begin, size_t end, WindowWork& work) const {
+    size_t count = units.size();
+    vector<int>& run = work.run;
+
+    // A run carried over from before the window must last its minimum
+    bool continues = (begin == 0 && start.on[u]);
+    if (continues && start.hours[u] < units[u].minUp)
+        return false;
+
+    for (size_t s = begin; s < end; s++) {
+        if (work.capacity[s] - availableAt(u, run[s * count + u]) < load[first + s] * (1 + UC_RESERVE_MARGIN))
+            return false;
+    }
+
+    work.evaluations++;
+    double change = continues ? 0 : -units[u].startupCost;
+    for (size_t s = begin; s < end; s++) {
+        int saved = run[s * count + u];
+        run[s * count + u] = -1;
+        work.trialCost[s] = hourCost(first + s, &run[s * count]);
+        run[s * count + u] = saved;
+        change += work.trialCost[s] - work.hourCost[s];
+    }
+    if (change >= -1e-6)
+        return false;
+
+    for (size_t s = begin; s < end; s++) {
+        work.capacity[s] -= availableAt(u, run[s * count + u]);
+        run[s * count + u] = -1;
+        plan[s * count + u] = 0;
+        work.hourCost[s] = work.trialCost[s];
+    }
+    return true;
+}
+
+
+//
+// tryBridgeGap():  Keeps unit u on through its gap [begin, end) between
+//      two runs, saving the second start, if the window's cost goes down.
+//      The run after the gap then ramps from further along, so its hours
+//      are costed again too.
+//
+bool UnitCommitment::tryBridgeGap(const Boundary& start, size_t first, uint8_t* plan, size_t hours, size_t u,
+                                  size_t begin, size_t end, WindowWork& work) const {
+    size_t count = units.size();
+    vector<int>& run = work.run;
+    vector<int>& trialRun = work.trialRun;
+
+    int prev = (begin > 0) ? run[(begin - 1) * count + u] : start.hours[u] - 1;
+    size_t last = begin;
+    for (size_t s = begin; s < hours; s++) {
+        int r = (s < end || plan[s * count + u]) ? min(prev + 1, units[u].stateCap) : -1;
+        if (s >= end && r == run[s * count + u])
+            break;
+        trialRun[s] = r;
+        prev = r;
+        last = s + 1;
+    }
+
+    work.evaluations++;
+    double change = -units[u].startupCost;
+    for (size_t s = begin; s < last; s++) {
+        int saved = run[s * count + u];
+        run[s * count + u] = trialRun[s];
+        work.trialCost[s] = hourCost(first + s, &run[s * count]);
+        run[s * count + u] = saved;
+        change += work.trialCost[s] - work.hourCost[s];
+    }
+    if (change >= -1e-6)
+        return false;
+
+    for (size_t s = begin; s < last; s++) {
+        work.capacity[s] += availableAt(u, trialRun[s]) - availableAt(u, run[s * count + u]);
+        run[s * count + u] = trialRun[s];
+        work.hourCost[s] = work.trialCost[s];
+    }
+    for (size_t s = begin; s < end; s++)
+        plan[s * count + u] = 1;
+    return true;
+}
+
+
+//
+// solveWindow():  Commits the units for hours starting at hour first,
+//      starting from the plan passed in.  Each pass tries removing every
+//      run of every unit and bridging every gap between two runs, most
+//      expensive units first, and keeps the changes that lower the
+//      window's cost.
+//
+void UnitCommitment::solveWindow(const Boundary& start, size_t first, vector<uint8_t>& plan, size_t hours, WindowWork& work) const {
+    size_t count = units.size();
+    enforceMinTimes(start, plan.data(), hours);
+    ensureCapacity(start, first, plan.data(), hours, work);
+
+    const vector<int>& run = work.run;
+    work.hourCost.resize(hours);
+    work.trialCost.resize(hours);
+    work.trialRun.resize(hours);
+    for (size_t t = 0; t < hours; t++)
+        work.hourCost[t] = hourCost(first + t, &run[t * count]);
+
+    for (int pass = 0; pass < UC_MAX_PASSES; pass++) {
+        bool improved = false;
+
+        for (auto p = priority.rbegin(); p != priority.rend(); ++p) {
+            size_t u = *p;
+
+            // Runs of the unit
+            for (size_t t = 0; t < hours; ) {
+                if (run[t * count + u] < 0) {
+                    t++;
+                    continue;
+                }
+                size_t begin = t;
+                while (t < hours && run[t * count + u] >= 0)
+                    t++;
+                improved |= tryRemoveRun(start, first, plan.data(), u, begin, t, work);
+            }
+
+            // Gaps with a run, or the state before the window, on each side
+            for (size_t t = 0; t < hours; ) {
+                if (run[t * count + u] >= 0) {
+                    t++;
+                    continue;
+                }
+                size_t begin = t;
+                while (t < hours && run[t * count + u] < 0)
+                    t++;
+                if ((begin > 0 || start.on[u]) && t < hours)
+                    improved |= tryBridgeGap(start, first, plan.data(), hours, u, begin, t, work);
+            }
+        }
+
+        if (!improved)
+            break;
+    }
+}
+
+
+//
+// dispatchHours():  Dispatches hours of a plan from state within the ramp
+//      limits, records them in the schedule, and leaves state at the end
+//
+void UnitCommitment::dispatchHours(Boundary& state, size_t first, const uint8_t* plan, size_t hours, CommitmentResult& result) {
+    size_t count = units.size();
+    vector<double> low(count), high(count);
+
+    for (size_t t = 0; t < hours; t++) {
+        size_t hour = first + t;
+        double residual = load[hour];
+        double* out = &output[hour * count];
+
+        for (size_t u = 0; u < count; u++) {
+            uint8_t on = plan[t * count + u];
+            schedule[hour * count + u] = on;
+            if (!on) {
+                low[u] = high[u] = out[u] = 0;
+                continue;
+            }
+
+            if (state.on[u]) {
+                low[u] = max(units[u].minOutput, state.output[u] - units[u].ramp);
+                high[u] = min(units[u].maxOutput, state.output[u] + units[u].ramp);
+            }
+            else {
+                low[u] = units[u].minOutput;
+                high[u] = units[u].startOutput;
+                result.startups++;
+                result.startupCost += units[u].startupCost;
+            }
+            low[u] = min(low[u], high[u]);
+            out[u] = low[u];
+            residual -= low[u];
+            result.energyCost += low[u] * units[u].cost;
+        }
+
+        for (auto& entry : merit) {
+            if (residual <= 0) break;
+
+            double room = (entry.unit < 0) ? entry.capacity : high[entry.unit] - low[entry.unit];
+            double take = min(residual, room);
+            if (take <= 0) continue;
+            if (entry.unit >= 0)
+                out[entry.unit] += take;
+            residual -= take;
+            result.energyCost += take * entry.cost;
+        }
+        if (residual > 0)
+            result.unserved += residual;
+
+        for (size_t u = 0; u < count; u++) {
+            uint8_t on = plan[t * count + u];
+            if (on == state.on[u])
+                state.hours[u] = min(state.hours[u] + 1, units[u].stateCap);
+            else {
+                state.on[u] = on;
+                state.hours[u] = 1;
+            }
+            state.output[u] = out[u];
+        }
+    }
+}
+
+
+void UnitCommitment::finishResult(CommitmentResult& result, double seconds) const {
+    result.hours = load.size();
+    result.seconds = seconds;
+    result.hoursPerSecond = (seconds > 0) ? load.size() / seconds : 0;
+}
+
+
+//
+// solveSequential():  Solves each window from the state the one before
+//                     left, then commits and dispatches its first hours
+//
+CommitmentResult UnitCommitment::solveSequential(bool warm) {
+    auto start = chrono::steady_clock::now();
+    CommitmentResult result;
+    size_t horizon = load.size();
+    size_t count = units.size();
+    schedule.assign(horizon * count, 0);
+    output.assign(horizon * count, 0);
+
+    Boundary state = initialBoundary();
+    WindowWork work;
+    vector<uint8_t> plan, previous;
+    size_t previousFirst = 0, previousHours = 0;
+
+    for (size_t first = 0; first < horizon; first += commitHours) {
+        size_t hours = min(commitHours + lookaheadHours, horizon - first);
+        size_t commit = min(commitHours, horizon - first);
+
+        // Start from what the last window planned for the hours they share
+        plan.assign(hours * count, 0);
+        if (warm) {
+            for (size_t t = 0; t < hours && first + t < previousFirst + previousHours; t++)
+                copy_n(&previous[(first + t - previousFirst) * count], count, &plan[t * count]);
+        }
+
+        solveWindow(state, first, plan, hours, work);
+        dispatchHours(state, first, plan.data(), commit, result);
+
+        previous.swap(plan);
+        previousFirst = first;
+        previousHours = hours;
+        result.windows++;
+    }
+
+    result.evaluations = work.evaluations;
+    finishResult(result, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    return result;
+}
+
+
+//
+// solveParallel():  Solves every window at once from a priority list plan
+//      of the whole horizon, re-solves in rounds the windows whose start
+//      state moved, then joins them in order
+//
+CommitmentResult UnitCommitment::solveParallel(TaskPool& pool) {
+    auto start = chrono::steady_clock::now();
+    CommitmentResult result;
+    size_t horizon = load.size();
+    size_t count = units.size();
+    schedule.assign(horizon * count, 0);
+    output.assign(horizon * count, 0);
+
+    // A first guess at the whole horizon, with the reserve but no removals
+    Boundary initial = initialBoundary();
+    vector<uint8_t> guess(horizon * count, 0);
+    {
+        WindowWork work;
+        ensureCapacity(initial, 0, guess.data(), horizon, work);
+    }
+
+    vector<Window> windows;
+    Boundary state = initial;
+    for (size_t first = 0; first < horizon; first += commitHours) {
+        Window window;
+        window.first = first;
+        window.hours = min(commitHours + lookaheadHours, horizon - first);
+        window.commit = min(commitHours, horizon - first);
+        window.solvedFrom = state;
+        window.plan.assign(guess.begin() + first * count, guess.begin() + (first + window.hours) * count);
+        state = boundaryAfter(state, window.plan.data(), window.commit);
+        windows.push_back(move(window));
+    }
+    result.windows = windows.size();
+
+    atomic<uint64_t> evaluations(0);
+    auto solveAll = [&](const vector<size_t>& which) {
+        pool.parallelFor(which.size(), 1, [&](size_t first, size_t last) {
+            WindowWork work;
+            for (size_t i = first; i < last; i++) {
+                Window& window = windows[which[i]];
+                solveWindow(window.solvedFrom, window.first, window.plan, window.hours, work);
+            }
+            evaluations += work.evaluations;
+        });
+    };
+
+    vector<size_t> which(windows.size());
+    for (size_t w = 0; w < windows.size(); w++)
+        which[w] = w;
+    solveAll(which);
+
+    // Each window should start where the one before it now ends
+    for (int round = 0; round < UC_MAX_ROUNDS; round++) {
+        vector<Boundary> expected(windows.size());
+        for (size_t w = 1; w < windows.size(); w++)
+            expected[w] = boundaryAfter(windows[w - 1].solvedFrom, windows[w - 1].plan.data(), windows[w - 1].commit);
+
+        which.clear();
+        for (size_t w = 1; w < windows.size(); w++) {
+            if (!expected[w].sameCommitment(windows[w].solvedFrom)) {
+                windows[w].solvedFrom = move(expected[w]);
+                which.push_back(w);
+            }
+        }
+        if (which.empty())
+            break;
+
+        result.rounds++;
+        result.resolved += which.size();
+        solveAll(which);
+    }
+
+    // Join the windows, solving again any whose start still moved
+    WindowWork work;
+    state = initial;
+    for (auto& window : windows) {
+        if (!state.sameCommitment(window.solvedFrom)) {
+            solveWindow(state, window.first, window.plan, window.hours, work);
+            result.resolved++;
+        }
+        dispatchHours(state, window.first, window.plan.data(), window.commit, result);
+    }
+
+    result.evaluations = evaluations + work.evaluations;
+    finishResult(result, chrono::duration<double>(chrono::steady_clock::now() - start).count());
+    return result;
+}
+
+
+//
+// applyHour():  Sets the units on the grid to the schedule's hour
+//
+int UnitCommitment::applyHour(size_t hour) {
+    size_t count = units.size();
+    if (hour >= load.size() || schedule.size() != load.size() * count)
+        return 1;
+
+    for (size_t u = 0; u < count; u++) {
+        units[u].plant->setOnline(schedule[hour * count + u] != 0);
+        units[u].plant->calculateOutput();
+    }
+    return 0;
+}
+
+
+//
+// countViolations():  Walks the schedule from the initial state checking
+//                     every minimum time and ramp
+//
+int UnitCommitment::countViolations() const {
+    size_t count = units.size();
+    if (schedule.size() != load.size() * count)
+        return 0;
+
+    const double tolerance = 1e-6;
+    Boundary state = initialBoundary();
+    int violations = 0;
+
+    for (size_t hour = 0; hour < load.size(); hour++) {
+        for (size_t u = 0; u < count; u++) {
+            uint8_t on = schedule[hour * count + u];
+            double out = output[hour * count + u];
+            const Unit& unit = units[u];
+
+            if (on && state.on[u])
+                violations += fabs(out - state.output[u]) > unit.ramp + tolerance;
+            else if (on)
+                violations += (state.hours[u] < unit.minDown) + (out > unit.startOutput + tolerance);
+            else if (state.on[u])
+                violations += state.hours[u] < unit.minUp;
+            if (on)
+                violations += out < unit.minOutput - tolerance || out > unit.maxOutput + tolerance;
+
+            if (on == state.on[u])
+                state.hours[u] = min(state.hours[u] + 1, unit.stateCap);
+            else {
+                state.on[u] = on;
+                state.hours[u] = 1;
+            }
+            state.output[u] = out;
+        }
+    }
+    return violations;
+}
+
+
+// Accessors
+size_t UnitCommitment::getUnitCount() const { return units.size(); }
+const Plant* UnitCommitment::getUnitPlant(size_t unit) const { return units[unit].plant; }
+bool UnitCommitment::isCommitted(size_t unit, size_t hour) const { return schedule[hour * units.size() + unit] != 0; }
+double UnitCommitment::getOutput(size_t unit, size_t hour) const { return output[hour * units.size() + unit]; }
+
+
+//
+// makeLoadProfile():  Lowest before dawn, highest in the afternoon, 10%
+//                     lower at weekends, with a little noise
+//
+vector<double> makeLoadProfile(double peakMW, size_t hours, unsigned seed) {
+    mt19937 rng(seed);
+    normal_distribution<double> noise(0.0, 0.02);
+    vector<double> profile(hours);
+
+    for (size_t h = 0; h < hours; h++) {
+        double hourOfDay = double(h % 24);
+        double daily = 0.65 + 0.35 * (0.5 - 0.5 * cos(2 * M_PI * (hourOfDay - 4) / 24));
+        double weekend = ((h / 24) % 7 >= 5) ? 0.9 : 1.0;
+        profile[h] = max(0.0, peakMW * daily * weekend * (1 + noise(rng)));
+    }
+    return profile;
+}
+
+
+//
+// runCommitment():  Commits the grid's thermal plants over a profile that
+//      peaks at its total demand and prints each unit's schedule totals
+//
+int runCommitment(PowerGrid& grid, size_t hours) {
+    GridStats stats = grid.computeStats();
+    UnitCommitment commitment(grid);
+    commitment.setLoad(makeLoadProfile(stats.demands.required.sum(), hours, 1));
+    CommitmentResult result = commitment.solveSequential();
+
+    cout << "\n\t--- Unit Commitment (" << commitment.getUnitCount() << " thermal plants, " << hours
+         << " hours, " << result.windows << " windows) ---\n";
+    cout << "  Plant         Type      Hours On   Starts    Avg MW    Max MW\n";
+    for (size_t u = 0; u < commitment.getUnitCount(); u++) {
+        size_t on = 0, starts = 0;
+        double total = 0, most = 0;
+        bool wasOn = true;
+        for (size_t h = 0; h < hours; h++) {
+            bool isOn = commitment.isCommitted(u, h);
+            on += isOn;
+            starts += isOn && !wasOn;
+            wasOn = isOn;
+            total += commitment.getOutput(u, h);
+            most = max(most, commitment.getOutput(u, h));
+        }
+        const Plant* plant = commitment.getUnitPlant(u);
+        cout << "  " << setw(14) << left << plant->getName() << setw(10) << plant->getType() << right
+             << setw(8) << on << setw(9) << starts << std::fixed << setprecision(1)
+             << setw(10) << total / max<size_t>(on, 1) << setw(10) << most << "\n";
+    }
+
+    int violations = commitment.countViolations();
+    cout << std::fixed << setprecision(0);
+    cout << "    Energy cost:           $" << result.energyCost << endl;
+    cout << "    Startup cost:          $" << result.startupCost << " (" << result.startups << " starts)" << endl;
+    cout << "    Load not served:       " << setprecision(1) << result.unserved << " MWh" << endl;
+    cout << "    Horizon hours/sec:     " << setprecision(0) << result.hoursPerSecond << endl;
+    cout << "    Violations:            " << violations << endl;
+    return violations ? 1 : 0;
+}
@@ -0,0 +1,180 @@
+#pragma once
+// File: UnitCommitment.h
+//
+// Contains the rolling horizon unit commitment of the grid's thermal
+// plants.
+//
+// Dispatch treats every plant as able to run anywhere from nothing to its
+// capacity at every run.  Fossil and nuclear plants cannot: once started
+// they must stay on for a minimum number of hours, once stopped stay off,
+// a start costs money, they cannot run below a stable minimum, and their
+// output can only move by a ramp rate each hour.  The commitment decides
+// for each hour of a horizon which of them are on, so the load is met at
+// the least cost of energy and starts; the other plants are taken to be
+// flexible and fill in at their cost.
+//
+// The horizon is solved in windows.  Each window commits UC_COMMIT_HOURS
+// and looks UC_LOOKAHEAD_HOURS past them so it does not start a plant it
+// will want off again.  A window is solved from the state the one before
+// left the plants in, by a priority list (cheapest full load cost first)
+// that commits plants until every hour has its reserve, then by removing
+// whole runs of a plant, or keeping it on through a gap between runs
+// instead of starting it again, where that lowers the window's cost.  The
+// committed hours are then dispatched hour by hour within the ramp limits.
+//
+// Solved one after another, each window starts from the plan the one
+// before made for its lookahead hours.  Solved in parallel, every window
+// first starts from a quick priority list plan of the whole horizon;
+// windows whose start state then differs from what the window before
+// them ended with are solved again, warm started from their own plan, in
+// rounds, and any still different when the windows are joined are solved
+// again in order.  Either way every committed hour was solved from the
+// state the plants were actually in.
+//
+// The parallel solve is a different heuristic, not the sequential solve
+// split over threads: its windows start from other plans, so it finds a
+// different schedule, and its rounds of re-solving search about two and a
+// half times as many runs.  It is only faster with enough cores to pay
+// for that extra search.
+//
+// A plant may shut down from any output.
+//
+#include <vector>
+#include <cstdint>
+#include "PowerGrid.h"
+using namespace std;
+
+struct CommitmentResult {
+    size_t      hours = 0;
+    size_t      windows = 0;
+    size_t      resolved = 0;       // Windows solved again because their start state moved
+    int         rounds = 0;         // Parallel rounds of re-solving
+    double      energyCost = 0;     // $ of the energy dispatched
+    double      startupCost = 0;
+    double      unserved = 0;       // MWh of load not met
+    size_t      startups = 0;
+    uint64_t    evaluations = 0;    // Run removals and gap bridges tried
+    double      seconds = 0;
+    double      hoursPerSecond = 0; // Horizon hours solved per second
+};
+
+
+//
+// Class UnitCommitment
+//
+class UnitCommitment {
+private:
+    // A thermal plant and its operating limits
+    struct Unit {
+        Plant*  plant;
+        double  maxOutput;
+        double  minOutput;
+        double  ramp;               // MW per hour
+        double  startOutput;        // Most it can give in the hour it starts
+        double  cost;               // $ per MWh
+        double  startupCost;        // $ per start
+        int     minUp;
+        int     minDown;
+        int     stateCap;           // Hours in a state past which nothing changes
+    };
+
+    // The state of every unit at the start of an hour
+    struct Boundary {
+        vector<uint8_t> on;
+        vector<int>     hours;      // In the state, up to the unit's stateCap
+        vector<double>  output;     // In the hour before
+        bool sameCommitment(const Boundary& other) const;
+    };
+
+    // Plants in order of cost, thermal ones by index into units and the
+    // flexible ones with their capacity
+    struct MeritEntry {
+        double  cost;
+        int     unit;               // -1 for a flexible plant
+        double  capacity;
+    };
+
+    // Scratch space for solving one window
+    struct WindowWork {
+        vector<int>     run;        // Hour major: hours on since the start, -1 while off
+        vector<double>  capacity;   // Per hour, flexible plus ramp limited thermal
+        vector<double>  hourCost;
+        vector<double>  trialCost;
+        vector<int>     trialRun;
+        uint64_t        evaluations = 0;
+    };
+
+    // One window of the parallel solve
+    struct Window {
+        size_t          first;
+        size_t          hours;      // Committed and lookahead
+        size_t          commit;
+        Boundary        solvedFrom;
+        vector<uint8_t> plan;       // Hour major, 1 where the unit is on
+    };
+
+    vector<Unit>        units;
+    vector<size_t>      priority;   // Units, cheapest full load cost first
+    vector<MeritEntry>  merit;
+    double              flexCapacity = 0;
+    vector<double>      load;
+    size_t              commitHours = UC_COMMIT_HOURS;
+    size_t              lookaheadHours = UC_LOOKAHEAD_HOURS;
+
+    // The committed schedule, hour major
+    vector<uint8_t>     schedule;
+    vector<double>      output;
+
+    Boundary initialBoundary() const;
+    Boundary boundaryAfter(const Boundary& start, const uint8_t* plan, size_t hours) const;
+    double availableAt(size_t u, int run) const;
+    void computeRun(const Boundary& start, const uint8_t* plan, size_t hours, size_t u, int* run) const;
+    bool canStart(const Boundary& start, const uint8_t* plan, size_t t, size_t u) const;
+    void enforceMinTimes(const Boundary& start, uint8_t* plan, size_t hours) const;
+    void ensureCapacity(const Boundary& start, size_t first, uint8_t* plan, size_t hours, WindowWork& work) const;
+    double hourCost(size_t hour, const int* run) const;
+    bool tryRemoveRun(const Boundary& start, size_t first, uint8_t* plan, size_t u,
+                      size_t begin, size_t end, WindowWork& work) const;
+    bool tryBridgeGap(const Boundary& start, size_t first, uint8_t* plan, size_t hours, size_t u,
+                      size_t begin, size_t end, WindowWork& work) const;
+    void solveWindow(const Boundary& start, size_t first, vector<uint8_t>& plan, size_t hours, WindowWork& work) const;
+    void dispatchHours(Boundary& state, size_t first, const uint8_t* plan, size_t hours, CommitmentResult& result);
+    void finishResult(CommitmentResult& result, double seconds) const;
+
+public:
+    // Takes the grid's online fossil and nuclear plants as the units and
+    // the rest as flexible supply, at their current output
+    explicit UnitCommitment(PowerGrid& grid);
+
+    void setLoad(const vector<double>& hourlyMW);   // Sets the horizon, one value per hour
+    void setWindow(size_t commit, size_t lookahead);
+
+    // Solves the horizon window after window, each warm started from the
+    // one before's lookahead plan unless warm is false
+    CommitmentResult solveSequential(bool warm = true);
+
+    // Solves the windows in parallel on the pool
+    CommitmentResult solveParallel(TaskPool& pool);
+
+    // Takes the units the schedule has off at hour out of service on the
+    // grid, and puts the rest back.  Returns 1 past the horizon.
+    int applyHour(size_t hour);
+
+    // Breaches of the minimum times and ramp limits in the schedule
+    int countViolations() const;
+
+    // Accessors
+    size_t getUnitCount() const;
+    const Plant* getUnitPlant(size_t unit) const;
+    bool isCommitted(size_t unit, size_t hour) const;
+    double getOutput(size_t unit, size_t hour) const;
+};
+
+
+// Hourly load that swings over the day and dips at weekends, peaking
+// near peakMW
+vector<double> makeLoadProfile(double peakMW, size_t hours, unsigned seed);
+
+// Commits the loaded grid's thermal plants over hours of a load profile
+// peaking at its total demand, and prints the schedule's totals
+int runCommitment(PowerGrid& grid, size_t hours);
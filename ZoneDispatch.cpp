@@ -0,0 +1,172 @@
+// File: ZoneDispatch.cpp
+//
+// Contains the zone level dispatch of the PowerGrid class.  See
+// ZoneDispatch.h for how locations are grouped.
+//
+#include "PowerGrid.h"
+#include <unordered_map>
+#include <cmath>
+using namespace std;
+
+//
+// buildDemandZones():  Groups the locations that are short of power by
+//      retail price band.  A band of 0 or less puts them all in one band.
+//
+vector<DemandZone> PowerGrid::buildDemandZones(double priceBand) const {
+    vector<DemandZone> zones;
+    unordered_map<long, size_t> bandZone;
+
+    for (uint32_t i = 0; i < demands.size(); i++) {
+        const Demand& demand = demands[i];
+        if (fixedPoint ? demand.getDeficitTicks() <= 0 : demand.getPowerDeficit() <= 0)
+            continue;
+
+        long band = (priceBand > 0) ? long(floor(demand.getMwRetailPrice() / priceBand)) : 0;
+        auto it = bandZone.find(band);
+        if (it == bandZone.end())
+            it = bandZone.emplace(band, zones.size()).first;
+
+        // A full zone is closed and the band starts a new one here
+        if (it->second == zones.size() || zones[it->second].members.size() == ZONE_MAX_LOCATIONS) {
+            it->second = zones.size();
+            zones.push_back(DemandZone());
+        }
+
+        DemandZone& zone = zones[it->second];
+        zone.members.push_back(i);
+        zone.deficit += demand.getPowerDeficit();
+        zone.revenue += demand.getPowerDeficit() * demand.getMwRetailPrice();
+        zone.deficitTicks += demand.getDeficitTicks();
+    }
+    return zones;
+}
+
+
+//
+// distributeByZones():  Dispatches each price zone as one location and
+//      splits the power back over the zone's locations.  Returns the
+//      number of zones.
+//
+// The result is close to, but not the same as, distributePower(), so it
+// is never stored in or taken from the dispatch cache.
+//
+int PowerGrid::distributeByZones(double priceBand) {
+    vector<DemandZone> zones = buildDemandZones(priceBand);
+    ledger.clear();
+
+    for (auto& zone : zones) {
+        double deficit = fixedPoint ? toMW(zone.deficitTicks) : zone.deficit;
+        Demand zoneDemand("Zone", deficit, zone.revenue / zone.deficit);
+
+        // The zone's allocations are recorded in the ledger like any
+        // other, then taken back out and split over the members
+        size_t firstPiece = ledger.size();
+        bool log = allocationLog;
+        allocationLog = false;
+        allocateToDemand(zoneDemand);
+        allocationLog = log;
+
+        AllocationLedger pieces(ledger.begin() + firstPiece, ledger.end());
+        ledger.resize(firstPiece);
+        if (fixedPoint)
+            splitZoneTicks(zone, pieces, zoneDemand.getAcquiredTicks());
+        else
+            splitZone(zone, pieces, zoneDemand.getPowerAcquired());
+    }
+
+    publishDispatch();
+    return int(zones.size());
+}
+
+
+//
+// splitZone():  Gives each member its share of the power supplied to the
+//      zone.  The members' shares are laid end to end and cut where the
+//      zone's allocations meet, so each piece of a plant's power goes to
+//      one member and the ledger stays exact.
+//
+void PowerGrid::splitZone(const DemandZone& zone, const AllocationLedger& pieces, double supplied) {
+    size_t m = 0;
+    double quota = demands[zone.members[0]].getPowerDeficit() * supplied / zone.deficit;
+
+    for (auto& piece : pieces) {
+        double remaining = piece.supplied;
+        TransLine& line = transLines[piece.line];
+
+        while (remaining > 1e-9 && m < zone.members.size()) {
+            double amount = min(remaining, quota);
+            if (amount > 0) {
+                Demand& demand = demands[zone.members[m]];
+                double share = amount / piece.supplied;
+                double raw = piece.rawFromPlant * share;
+                double cost = piece.cost * share;
+                double sellPrice = amount * demand.getMwRetailPrice();
+
+                demand.addPowerToLocation(amount, sellPrice, cost);
+                logAllocation(demand, piece.plant, line, amount, raw, sellPrice, cost);
+                ledger.push_back({ piece.plant, zone.members[m], piece.line, amount, raw, sellPrice, cost, 0, 0, 0, 0 });
+            }
+
+            remaining -= amount;
+            quota -= amount;
+            if (quota <= 1e-9 && ++m < zone.members.size())
+                quota = demands[zone.members[m]].getPowerDeficit() * supplied / zone.deficit;
+        }
+    }
+}
+
+
+//
+// splitZoneTicks():  Fixed point version of splitZone().  Shares are
+//      rounded down and the ticks left over go to the earliest members
+//      with room, so the shares add up exactly to the power supplied.
+//      The last cut of each piece takes what is left of its plant power
+//      and cost.
+//
+void PowerGrid::splitZoneTicks(const DemandZone& zone, const AllocationLedger& pieces, PowerTicks supplied) {
+    vector<PowerTicks> quotas(zone.members.size());
+    PowerTicks leftOver = supplied;
+
+    for (size_t m = 0; m < zone.members.size(); m++) {
+        PowerTicks deficit = demands[zone.members[m]].getDeficitTicks();
+        quotas[m] = min(deficit, PowerTicks(double(deficit) * supplied / zone.deficitTicks));
+        leftOver -= quotas[m];
+    }
+    for (size_t m = 0; m < zone.members.size() && leftOver > 0; m++) {
+        PowerTicks extra = min(leftOver, demands[zone.members[m]].getDeficitTicks() - quotas[m]);
+        quotas[m] += extra;
+        leftOver -= extra;
+    }
+
+    size_t m = 0;
+    for (auto& piece : pieces) {
+        PowerTicks remaining = piece.suppliedTicks;
+        PowerTicks rawLeft = piece.rawTicks;
+        MoneyTicks costLeft = piece.costTicks;
+        TransLine& line = transLines[piece.line];
+
+        while (remaining > 0 && m < zone.members.size()) {
+            PowerTicks amount = min(remaining, quotas[m]);
+            if (amount > 0) {
+                Demand& demand = demands[zone.members[m]];
+                bool last = (amount == remaining);
+                PowerTicks raw = last ? rawLeft : piece.rawTicks * amount / piece.suppliedTicks;
+                MoneyTicks cost = last ? costLeft : piece.costTicks * amount / piece.suppliedTicks;
+                MoneyTicks sellPrice = priceOfPower(amount, demand.getRetailPriceTicks());
+
+                demand.addPowerTicks(amount, sellPrice, cost);
+                logAllocation(demand, piece.plant, line, toMW(amount), toMW(raw), toDollars(sellPrice), toDollars(cost));
+                ledger.push_back({ piece.plant, zone.members[m], piece.line, toMW(amount), toMW(raw),
+                    toDollars(sellPrice), toDollars(cost), amount, raw, sellPrice, cost });
+
+                rawLeft -= raw;
+                costLeft -= cost;
+            }
+
+            remaining -= amount;
+            quotas[m] -= amount;
+            if (quotas[m] == 0)
+                m++;
+        }
+    }
+}
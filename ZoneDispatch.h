@@ -0,0 +1,29 @@
+#pragma once
+// File: ZoneDispatch.h
+//
+// Contains the demand zones used by hierarchical (zone level) dispatch.
+//
+// Grids with very many small demand locations spend most of their
+// dispatch time walking the plants once per location.  Zone dispatch
+// groups locations whose retail prices fall in the same price band into
+// zones, dispatches each zone as a single large location, and then splits
+// every zone allocation back over its locations in proportion to their
+// deficits.
+//
+// Every location reaches every line in this grid model, so all locations
+// are connected and price is the only thing that separates them.  A zone
+// holds at most ZONE_MAX_LOCATIONS locations and zones are dispatched in
+// the order of their first location, so when power runs short the
+// earlier locations keep their priority, give or take one zone.
+//
+#include <vector>
+#include <cstdint>
+#include "FixedPoint.h"
+using namespace std;
+
+struct DemandZone {
+    vector<uint32_t>    members;            // Indexes of the locations, in file order
+    double              deficit = 0;        // Sum of the members' deficits
+    double              revenue = 0;        // Deficit times retail price, for the zone price
+    PowerTicks          deficitTicks = 0;
+};
@@ -14,19 +14,472 @@
 // After the distribution, a well formatted report is produced showing
 // various usage and efficiency characteristics of the power grid.
 //
+// Command line modes:
+//      (none)                  Run the simulation once and print the reports
+//      --daemon [socket]       Keep the grid loaded and serve requests on a socket
+//      --bench-daemon [count]  Time requests against an in-process daemon
+//      --stress-snapshots [readers] [seconds]
+//                              Re-dispatch continuously under many snapshot readers
+//      --bench-pool [plants] [threads]
+//                              Time loading and plant updates on the task pool
+//      --bench-events [count]  Run random outages, derates, and demand steps
+//      --stream-conditions [steps]
+//                              Dispatch under a streamed condition time series
+//      --bench-results [steps] Record per step results to a compressed column file
+//      --bench-cache [steps] [scenarios]
+//                              Sweep repeating scenarios with the dispatch cache
+//      --bench-warm [plants] [steps]
+//                              Compare cold and warm start re-dispatch
+//      --bench-anytime [plants] [ms]
+//                              Improve dispatch cost under several deadlines
+//      --bench-zones [plants] [demands] [band]
+//                              Compare zone level and full dispatch
+//      --flows [topology] [line]
+//                              Network flows of the dispatch, then with line out
+//      --bench-flow [buses]    Time the DC power flow factor, solves and outages
+//      --carbon-cap [fraction] Dispatch with CO2 capped at a fraction of the usual
+//      --bench-carbon [plants] Dispatch a synthetic grid under tighter CO2 caps
+//      --areas [areas file]    Dispatch the grid split into areas joined by ties
+//      --bench-areas [plants] [areas]
+//                              Compare parallel area dispatch with flat dispatch
+//      --shards [trials] [workers]
+//                              Run Monte Carlo trials in worker processes
+//      --bench-shards [plants] [trials] [workers]
+//                              Compare trial throughput with more workers
+//      --monitor [segment] [ms] [count]
+//                              Read the live state a daemon exports
+//      --bench-monitor [seconds]
+//                              Re-dispatch with the export on under a reader process
+//      --watch                 Apply edits to the input files as they are saved
+//      --bench-reload [rows]   Time one line edits reloaded by diff against a full reload
+//      --bench-storage [batteries] [steps]
+//                              Compare batched and per plant battery charge updates
+//      --commit [hours]        Commit the thermal plants over a load profile
+//      --bench-commit [plants] [hours] [threads]
+//                              Compare cold, warm, and parallel window commitment
+//      --bench-demand-order [plants] [demands] [updates]
+//                              Compare demand service orders and queue updates
+//      --bench-adjust [plants] [steps]
+//                              Time plant updates when a share of the plants change
+//
 
 #include "GridDef.h"
 #include "PowerGrid.h"
+#include "GridDaemon.h"
+#include "GridSynth.h"
+#include "GridEvents.h"
+#include "ConditionSeries.h"
+#include "MultiArea.h"
+#include "GridShards.h"
+#include "GridMonitor.h"
+#include "GridReload.h"
+#include "UnitCommitment.h"
 #include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <csignal>
 using namespace std;
 
+// Daemon to stop when SIGINT or SIGTERM arrives
+static GridDaemon* activeDaemon = nullptr;
+
+static void stopDaemon(int) {
+    if (activeDaemon) activeDaemon->stop();
+}
+
+// File watch to stop when SIGINT or SIGTERM arrives
+static GridReloader* activeReloader = nullptr;
+
+static void stopReloader(int) {
+    if (activeReloader) activeReloader->stop();
+}
+
+
+//
+// loadServiceGrid():  Loads, sorts, and dispatches the grid quietly for the
+//                     long running modes
+//
+static int loadServiceGrid(PowerGrid& grid) {
+    if (grid.loadGrid()) {
+        cerr << "Error loading Initial Grid" << endl;
+        return 1;
+    }
+
+    grid.sortTransLines();
+    grid.adjustPlantsForConditions();
+    grid.setAllocationLog(false);
+    grid.distributePower();
+    return 0;
+}
+
+
+//
+// runDaemon():  Serves the grid until it is told to shut down
+//
+static int runDaemon(const string& socketPath) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    // Clients often re-dispatch states the grid has already seen
+    grid.setDispatchCacheBudget(DISPATCH_CACHE_BUDGET);
+
+    // Monitors read the live state from shared memory
+    if (grid.setMonitorExport(MONITOR_SEGMENT))
+        cerr << "Warning: Monitor export is off" << endl;
+
+    GridDaemon daemon(grid, socketPath);
+    if (daemon.start())
+        return 1;
+
+    activeDaemon = &daemon;
+    signal(SIGINT, stopDaemon);
+    signal(SIGTERM, stopDaemon);
+
+    cout << "Grid daemon listening on " << socketPath << endl;
+    int rc = daemon.run();
+
+    activeDaemon = nullptr;
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runDaemonBench():  Runs the daemon latency benchmark
+//
+static int runDaemonBench(int requestCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runDaemonBenchmark(grid, requestCount);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runSnapshotStressTest():  Runs the snapshot reader stress test
+//
+static int runSnapshotStressTest(int readerCount, double seconds) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runSnapshotStress(grid, readerCount, seconds);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runEventBench():  Runs the discrete event engine benchmark
+//
+static int runEventBench(size_t eventCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runEventBenchmark(grid, eventCount);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runConditionSeries():  Streams a synthetic condition series through the grid
+//
+static int runConditionSeries(uint64_t stepCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runConditionStream(grid, stepCount);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runResultsBench():  Records a long run to a results file and reads it back
+//
+static int runResultsBench(uint64_t stepCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runResultsBenchmark(grid, stepCount);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runCacheBench():  Compares scenario sweeps with and without the dispatch cache
+//
+static int runCacheBench(uint64_t stepCount, int scenarioCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runCacheBenchmark(grid, stepCount, scenarioCount);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runLineFlows():  Prints the network flows of the dispatch, and again
+//                  with one line out of service if one is named
+//
+static int runLineFlows(const string& topologyFile, const string& outageLine) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = grid.loadTopology(topologyFile);
+    if (rc == 0)
+        rc = grid.computeLineFlows();
+    if (rc == 0) {
+        cout << "\n\t--- Network Line Flows ---\n";
+        grid.printLineFlows();
+    }
+
+    if (rc == 0 && !outageLine.empty()) {
+        rc = grid.setLineOutage(outageLine, true);
+        if (rc == 0)
+            rc = grid.computeLineFlows();
+        if (rc == 0) {
+            cout << "\t--- Network Line Flows, " << outageLine << " out ---\n";
+            grid.printLineFlows();
+        }
+    }
+
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runCarbonCap():  Dispatches within a CO2 cap set as a fraction of the
+//                  unconstrained emissions and prints the report
+//
+static int runCarbonCap(double fraction) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    double freeEmissions = grid.dispatchEmissions();
+    CarbonResult result = grid.distributeUnderCarbonCap(fraction * freeEmissions);
+    cout << std::fixed << std::setprecision(2);
+    grid.generateUsageReport(GRID_NAME);
+
+    cout << "    CO2 without a cap:     " << freeEmissions << endl;
+    cout << "    CO2 cap:               " << result.cap << endl;
+    cout << "    CO2 emitted:           " << result.emissions << endl;
+    cout << "    Carbon price:          " << scientific << setprecision(3) << result.carbonPrice << fixed
+         << " per unit of CO2 (" << result.passes << " dispatch passes" << (result.clamped ? ", fossil output held back" : "") << ")" << endl;
+
+    grid.shutdownGrid();
+    return 0;
+}
+
+
+//
+// runAreas():  Dispatches the grid split into the areas of areasFile and
+//              compares it with the flat dispatch
+//
+static int runAreas(const string& areasFile) {
+    PowerGrid flat;
+    if (loadServiceGrid(flat))
+        return 1;
+
+    // The areas dispatch in merit order, so the flat grid does too
+    flat.setDispatchPolicy(DP_COST);
+    flat.redispatch();
+    GridStats flatStats = flat.computeStats();
+
+    MultiAreaGrid grid;
+    if (grid.load(PLANTS_FILE, DEMANDS_FILE, TRANSLINES_FILE, areasFile)) {
+        flat.shutdownGrid();
+        return 1;
+    }
+
+    MultiAreaResult result = grid.dispatch();
+    grid.printAreas();
+    cout << "    Exchange rounds:       " << result.rounds << (result.converged ? "" : " (not settled)") << endl;
+    cout << "    Supplied, areas:       " << result.acquired << " MW" << endl;
+    cout << "    Supplied, one grid:    " << flatStats.demands.acquired.sum() << " MW" << endl;
+    cout << "    Power cost, areas:     " << result.cost << endl;
+    cout << "    Power cost, one grid:  " << flatStats.demands.cost.sum() << endl;
+
+    grid.shutdown();
+    flat.shutdownGrid();
+    return 0;
+}
+
+
+//
+// runShards():  Runs Monte Carlo trials of the grid in worker processes
+//               sharing its image, and prints their averages
+//
+static int runShards(uint64_t trialCount, int workerCount) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    ShardCoordinator coordinator;
+    vector<TrialResult> results;
+    auto start = chrono::steady_clock::now();
+    int rc = coordinator.publish(grid);
+    if (rc == 0)
+        rc = coordinator.run(trialCount, workerCount, results);
+    double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+    if (rc == 0) {
+        ShardSummary summary = summarizeTrials(results);
+        cout << std::fixed << setprecision(2);
+        cout << "\n\t--- Monte Carlo Trials (" << summary.trials << " trials, " << workerCount << " workers, "
+             << ms << " ms) ---\n";
+        cout << "    Mean supplied:         " << summary.supplied << " MW" << endl;
+        cout << "    Mean unserved:         " << summary.unserved << " MW" << endl;
+        cout << "    Loss of load:          " << 100 * summary.lossOfLoad << "% of trials" << endl;
+        cout << "    Mean power cost:       " << summary.cost << endl;
+        cout << "    Mean revenue:          " << summary.revenue << endl;
+        cout << "    Mean plants out:       " << summary.plantsOut << endl;
+    }
+
+    coordinator.shutdown();
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runMonitorBench():  Runs the monitor export benchmark
+//
+static int runMonitorBench(double seconds) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runMonitorBenchmark(grid, seconds);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runWatch():  Keeps the grid loaded and applies edits to its input files,
+//              re-dispatching from the last allocations after each
+//
+static int runWatch() {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+    grid.setWarmStartDispatch(true);
+
+    GridReloader reloader(grid, PLANTS_FILE, DEMANDS_FILE, TRANSLINES_FILE);
+    activeReloader = &reloader;
+    signal(SIGINT, stopReloader);
+    signal(SIGTERM, stopReloader);
+
+    cout << "Watching " << PLANTS_FILE << ", " << DEMANDS_FILE << ", and " << TRANSLINES_FILE << endl;
+    int rc = reloader.watch();
+
+    activeReloader = nullptr;
+    grid.shutdownGrid();
+    return rc;
+}
+
+
+//
+// runCommit():  Commits the sample grid's thermal plants over a horizon
+//
+static int runCommit(size_t hours) {
+    PowerGrid grid;
+    if (loadServiceGrid(grid))
+        return 1;
+
+    int rc = runCommitment(grid, hours);
+    grid.shutdownGrid();
+    return rc;
+}
+
+
 //
 // main():  Main function for Power Grid project
 //
-int main() {
+int main(int argc, char* argv[]) {
     PowerGrid myGrid;
     int rc;
 
+    // Select the long running modes from the command line
+    string mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--daemon")
+        return runDaemon((argc > 2) ? argv[2] : DAEMON_SOCKET);
+    if (mode == "--bench-daemon")
+        return runDaemonBench((argc > 2) ? stoi(argv[2]) : 100000);
+    if (mode == "--stress-snapshots")
+        return runSnapshotStressTest((argc > 2) ? stoi(argv[2]) : 8, (argc > 3) ? stod(argv[3]) : 20.0);
+    if (mode == "--bench-pool")
+        return runPoolBenchmark((argc > 2) ? stoi(argv[2]) : 20000, (argc > 3) ? stoi(argv[3]) : 0);
+    if (mode == "--bench-events")
+        return runEventBench((argc > 2) ? stoul(argv[2]) : 2000000);
+    if (mode == "--stream-conditions")
+        return runConditionSeries((argc > 2) ? stoull(argv[2]) : 87600);
+    if (mode == "--bench-results")
+        return runResultsBench((argc > 2) ? stoull(argv[2]) : 100000);
+    if (mode == "--bench-cache")
+        return runCacheBench((argc > 2) ? stoull(argv[2]) : 200000, (argc > 3) ? stoi(argv[3]) : 50);
+    if (mode == "--bench-warm")
+        return runWarmStartBenchmark((argc > 2) ? stoi(argv[2]) : 4000, (argc > 3) ? stoull(argv[3]) : 200);
+    if (mode == "--bench-anytime")
+        return runAnytimeBenchmark((argc > 2) ? stoi(argv[2]) : 4000, (argc > 3) ? stod(argv[3]) : 20.0);
+    if (mode == "--bench-zones")
+        return runZoneBenchmark((argc > 2) ? stoi(argv[2]) : 2000, (argc > 3) ? stoi(argv[3]) : 100000,
+                                (argc > 4) ? stod(argv[4]) : ZONE_PRICE_BAND);
+    if (mode == "--flows")
+        return runLineFlows((argc > 2) ? argv[2] : TOPOLOGY_FILE, (argc > 3) ? argv[3] : "");
+    if (mode == "--bench-flow")
+        return runPowerFlowBenchmark((argc > 2) ? stoi(argv[2]) : 10000);
+    if (mode == "--carbon-cap")
+        return runCarbonCap((argc > 2) ? stod(argv[2]) : 0.5);
+    if (mode == "--bench-carbon")
+        return runCarbonBenchmark((argc > 2) ? stoi(argv[2]) : 4000);
+    if (mode == "--areas")
+        return runAreas((argc > 2) ? argv[2] : AREAS_FILE);
+    if (mode == "--bench-areas")
+        return runMultiAreaBenchmark((argc > 2) ? stoi(argv[2]) : 20000, (argc > 3) ? stoi(argv[3]) : 4);
+    if (mode == "--shards")
+        return runShards((argc > 2) ? stoull(argv[2]) : 10000, (argc > 3) ? stoi(argv[3]) : 4);
+    if (mode == "--bench-shards")
+        return runShardBenchmark((argc > 2) ? stoi(argv[2]) : 2000, (argc > 3) ? stoull(argv[3]) : 400,
+                                 (argc > 4) ? stoi(argv[4]) : 4);
+    if (mode == "--monitor")
+        return runMonitorReader((argc > 2) ? argv[2] : MONITOR_SEGMENT, (argc > 3) ? stoi(argv[3]) : 1000,
+                                (argc > 4) ? stoi(argv[4]) : 10);
+    if (mode == "--bench-monitor")
+        return runMonitorBench((argc > 2) ? stod(argv[2]) : 10.0);
+    if (mode == "--watch")
+        return runWatch();
+    if (mode == "--bench-reload")
+        return runReloadBenchmark((argc > 2) ? stoi(argv[2]) : 1000000);
+    if (mode == "--bench-storage")
+        return runStorageBenchmark((argc > 2) ? stoi(argv[2]) : 4096, (argc > 3) ? stoull(argv[3]) : 240);
+    if (mode == "--commit")
+        return runCommit((argc > 2) ? stoull(argv[2]) : 168);
+    if (mode == "--bench-commit")
+        return runCommitBenchmark((argc > 2) ? stoi(argv[2]) : 1000, (argc > 3) ? stoull(argv[3]) : 2016,
+                                  (argc > 4) ? stoi(argv[4]) : 0);
+    if (mode == "--bench-demand-order")
+        return runDemandOrderBenchmark((argc > 2) ? stoi(argv[2]) : 2000, (argc > 3) ? stoi(argv[3]) : 20000,
+                                       (argc > 4) ? stoi(argv[4]) : 100000);
+    if (mode == "--bench-adjust")
+        return runAdjustBenchmark((argc > 2) ? stoi(argv[2]) : 20000, (argc > 3) ? stoi(argv[3]) : 100);
+
     // Load and print Power Grid information.
     rc = myGrid.loadGrid();
 